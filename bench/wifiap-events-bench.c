@@ -0,0 +1,262 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+/*******************************************************************************
+ *      benchmark of the station events of "iw event"                          *
+ *                                                                             *
+ * Recorded "iw event" lines are written to a socketpair at a given rate and   *
+ * read by readStationEvents() as the event thread of the binding does. The    *
+ * publication of the events by afb-binder is not run here: it is measured in  *
+ * the binding by the event_push tracepoints and the load test.                *
+ *                                                                             *
+ * Usage: wifiap-events-bench [-f lines] [-i interface] [-n lines] [-r rate]   *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wifi-ap-events.h"
+#include "wifi-ap-metrics.h"
+
+#define DEFAULT_INTERFACE   "wlan0"
+#define DEFAULT_LINES       100000
+#define PARSE_ITERATIONS    1000000
+#define MAX_LINE_LENGTH     512
+
+// lines recorded on an access point, used without -f
+static const char *const recordedLines[] = {
+    "wlan0 (phy #0): new station 02:00:00:00:01:00\n",
+    "wlan0 (phy #0): new station 02:00:00:00:02:00\n",
+    "phy #0: reg_change: set to world roaming\n",
+    "wlan0 (phy #0): del station 02:00:00:00:01:00\n",
+    "wlan0 (phy #0): ch_switch_started_notify freq 2437 width 20 MHz\n",
+    "wlan1 (phy #1): new station 02:00:00:00:03:00\n",
+    "wlan0 (phy #0): del station 02:00:00:00:02:00\n",
+    "wlan1 (phy #1): del station 02:00:00:00:03:00\n",
+};
+
+static char **lines;
+static unsigned lineCount;
+
+typedef struct
+{
+    int fd;
+    unsigned total;       ///< number of lines to write
+    unsigned rate;        ///< lines per second, 0 for as fast as possible
+    uint64_t *sentUs;     ///< time each line was written
+} writerT;
+
+typedef struct
+{
+    unsigned index;       ///< index of the line read
+    const uint64_t *sentUs;
+    metricT *latencyMetric;
+} readerT;
+
+/*******************************************************************************
+ *      read the recorded lines of a file                                      *
+ ******************************************************************************/
+static int read_lines(const char *file)
+{
+    char line[MAX_LINE_LENGTH];
+    FILE *input = fopen(file, "r");
+
+    if (input == NULL)
+        return -errno;
+    while (fgets(line, sizeof(line), input) != NULL) {
+        char **grown = realloc(lines, (lineCount + 1) * sizeof(*lines));
+
+        if (grown == NULL || (grown[lineCount] = strdup(line)) == NULL) {
+            lines = grown != NULL ? grown : lines;
+            fclose(input);
+            return -ENOMEM;
+        }
+        lines = grown;
+        lineCount++;
+    }
+    fclose(input);
+    return lineCount == 0 ? -ENODATA : 0;
+}
+
+/*******************************************************************************
+ *      write the lines to the socket at the given rate                        *
+ ******************************************************************************/
+static void *write_lines(void *closure)
+{
+    writerT *writer = closure;
+    struct timespec start, next;
+    uint64_t offsetNs;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (unsigned i = 0; i < writer->total; i++) {
+        const char *line = lines[i % lineCount];
+        size_t length = strlen(line);
+
+        if (writer->rate != 0) {
+            offsetNs = (uint64_t)i * 1000000000ULL / writer->rate;
+            next.tv_sec = start.tv_sec + (time_t)(offsetNs / 1000000000ULL);
+            next.tv_nsec = start.tv_nsec + (long)(offsetNs % 1000000000ULL);
+            if (next.tv_nsec >= 1000000000L) {
+                next.tv_sec++;
+                next.tv_nsec -= 1000000000L;
+            }
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+        }
+        writer->sentUs[i] = metricNowUs();
+        if (write(writer->fd, line, length) != (ssize_t)length)
+            break;
+    }
+    close(writer->fd);
+    return NULL;
+}
+
+/*******************************************************************************
+ *      time a station event from its line written to its callback             *
+ ******************************************************************************/
+static void time_station_event(const char *line,
+                               const stationEventT *event,
+                               void *closure)
+{
+    readerT *reader = closure;
+
+    if (event->type != STATION_EVENT_NONE)
+        metricObserve(reader->latencyMetric,
+                      metricNowUs() - reader->sentUs[reader->index]);
+    reader->index++;
+}
+
+/*******************************************************************************
+ *      time the parsing of the recorded lines                                 *
+ ******************************************************************************/
+static void bench_parse(const char *interfaceName)
+{
+    stationEventT event;
+    unsigned events = 0;
+    uint64_t startUs, elapsedUs;
+
+    startUs = metricNowUs();
+    for (unsigned i = 0; i < PARSE_ITERATIONS; i++) {
+        if (parseStationEvent(lines[i % lineCount], interfaceName, &event) !=
+            STATION_EVENT_NONE)
+            events++;
+    }
+    elapsedUs = metricNowUs() - startUs;
+    printf("parse: %u lines, %u station events, %.1f ns/line\n",
+           PARSE_ITERATIONS, events,
+           (double)elapsedUs * 1000.0 / PARSE_ITERATIONS);
+}
+
+/*******************************************************************************
+ *      read the lines written at the given rate                               *
+ ******************************************************************************/
+static int bench_read(const char *interfaceName, unsigned total, unsigned rate)
+{
+    int source[2];
+    pthread_t writerThread;
+    metricSummaryT latency;
+    writerT writer = {.total = total, .rate = rate};
+    readerT reader = {0};
+    uint64_t startUs, elapsedUs;
+    unsigned events;
+    FILE *input;
+
+    reader.latencyMetric =
+        createMetric(METRIC_HISTOGRAM, "bench_latency",
+                     "Time from the line written to its station event", NULL,
+                     NULL);
+    writer.sentUs = calloc(total, sizeof(*writer.sentUs));
+    if (reader.latencyMetric == NULL || writer.sentUs == NULL)
+        return -ENOMEM;
+    reader.sentUs = writer.sentUs;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, source) != 0)
+        return -errno;
+    writer.fd = source[0];
+    input = fdopen(source[1], "r");
+
+    startUs = metricNowUs();
+    pthread_create(&writerThread, NULL, write_lines, &writer);
+    events = readStationEvents(input, interfaceName, time_station_event,
+                               &reader);
+    elapsedUs = metricNowUs() - startUs;
+    pthread_join(writerThread, NULL);
+    fclose(input);
+
+    summarizeMetric(reader.latencyMetric, &latency);
+    printf("read: %u lines, %u station events, %.0f events/s, latency (us) "
+           "p50 %" PRIu64 " p99 %" PRIu64 " max %" PRIu64 "\n",
+           total, events,
+           elapsedUs == 0 ? 0.0 : (double)events * 1e6 / (double)elapsedUs,
+           latency.p50Us, latency.p99Us, latency.maxUs);
+
+    free(writer.sentUs);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *interfaceName = DEFAULT_INTERFACE;
+    unsigned total = DEFAULT_LINES, rate = 0;
+    int opt, rc;
+
+    while ((opt = getopt(argc, argv, "f:i:n:r:")) != -1) {
+        switch (opt) {
+        case 'f':
+            rc = read_lines(optarg);
+            if (rc < 0) {
+                fprintf(stderr, "%s: %s\n", optarg, strerror(-rc));
+                return 1;
+            }
+            break;
+        case 'i':
+            interfaceName = optarg;
+            break;
+        case 'n':
+            total = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        case 'r':
+            rate = (unsigned)strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr,
+                    "Usage: %s [-f lines] [-i interface] [-n lines] "
+                    "[-r rate]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (lineCount == 0) {
+        lines = (char **)recordedLines;
+        lineCount = sizeof(recordedLines) / sizeof(recordedLines[0]);
+    }
+
+    bench_parse(interfaceName);
+    rc = bench_read(interfaceName, total, rate);
+    if (rc < 0) {
+        fprintf(stderr, "read: %s\n", strerror(-rc));
+        return 1;
+    }
+    return 0;
+}
@@ -96,6 +96,9 @@ case ${CMD} in
     if test -f "/tmp/add_hosts"; then
       rm -f /tmp/add_hosts
     fi
+    rm -f /tmp/hostapd.accept /tmp/hostapd.deny
+    tc qdisc del dev ${IFACE} root > /dev/null 2>&1
+    tc qdisc del dev ${IFACE} ingress > /dev/null 2>&1
     killall hostapd
     sleep 1;
     rm -f /tmp/hostapd.conf
@@ -124,6 +127,13 @@ case ${CMD} in
     dnsmasq -C /tmp/dnsmasq.wlan.conf|| exit ${ERROR}
     ;;
 
+  WIFI_SURVEY)
+    # $3: "ap-force" to scan while the access point is running
+    ip link set ${IFACE} up || exit ${ERROR}
+    iw dev ${IFACE} scan $3 > /dev/null 2>&1
+    iw dev ${IFACE} survey dump || exit ${ERROR}
+    ;;
+
   WIFI_NM_UNMANAGE)
     [ -f /usr/share/polkit-1/rules.d/nm-daemon.rules ] || echo "WARNING: missing nm-daemon.rules"
     nmcli device set ${IFACE} managed no && NM_MANAGED=1
@@ -136,6 +146,37 @@ case ${CMD} in
     # not relevant to restart firewalld service because our config is volatile
     ;;
 
+  WIFIAP_TC_CLEAR)
+    tc qdisc del dev ${IFACE} root > /dev/null 2>&1
+    tc qdisc del dev ${IFACE} ingress > /dev/null 2>&1
+    ;;
+
+  WIFIAP_TC_SETUP)
+    # $3: rate of the access point in kbit/s
+    RATE=$3
+    tc qdisc add dev ${IFACE} root handle 1: htb default 2 || exit ${ERROR}
+    tc class add dev ${IFACE} parent 1: classid 1:1 htb rate ${RATE}kbit ceil ${RATE}kbit || exit ${ERROR}
+    tc class add dev ${IFACE} parent 1:1 classid 1:2 htb rate ${RATE}kbit ceil ${RATE}kbit || exit ${ERROR}
+    tc qdisc add dev ${IFACE} parent 1:2 handle 2: fq_codel || exit ${ERROR}
+    tc qdisc add dev ${IFACE} handle ffff: ingress || exit ${ERROR}
+    ;;
+
+  WIFIAP_TC_STATION)
+    # $3: class (hexadecimal), $4: IP address of the station, $5: rate in kbit/s
+    CLASS=$3
+    STATION_IP=$4
+    RATE=$5
+    tc class add dev ${IFACE} parent 1:1 classid 1:${CLASS} htb rate ${RATE}kbit ceil ${RATE}kbit || exit ${ERROR}
+    tc qdisc add dev ${IFACE} parent 1:${CLASS} handle ${CLASS}: fq_codel || exit ${ERROR}
+    tc filter add dev ${IFACE} parent 1: protocol ip prio 1 u32 match ip dst ${STATION_IP}/32 flowid 1:${CLASS} || exit ${ERROR}
+    tc filter add dev ${IFACE} parent ffff: protocol ip prio 1 u32 match ip src ${STATION_IP}/32 \
+      police rate ${RATE}kbit burst 32k drop flowid :1 || exit ${ERROR}
+    ;;
+
+  WIFIAP_TC_STATS)
+    tc -s class show dev ${IFACE} || exit ${ERROR}
+    ;;
+
   *)
     echo "Parameter not valid"
     exit ${ERROR} ;;
@@ -100,6 +100,9 @@ case ${CMD} in
     if test -f "/tmp/add_hosts"; then
       rm -f /tmp/add_hosts
     fi
+    rm -f /tmp/hostapd.accept /tmp/hostapd.deny
+    sudo tc qdisc del dev ${IFACE} root > /dev/null 2>&1
+    sudo tc qdisc del dev ${IFACE} ingress > /dev/null 2>&1
     sudo killall hostapd
     sleep 1;
     rm -f /tmp/hostapd.conf
@@ -127,6 +130,44 @@ case ${CMD} in
     sudo dnsmasq -C /tmp/dnsmasq.wlan.conf|| exit ${ERROR}
     ;;
 
+  WIFI_SURVEY)
+    # $3: "ap-force" to scan while the access point is running
+    sudo ip link set ${IFACE} up || exit ${ERROR}
+    sudo iw dev ${IFACE} scan $3 > /dev/null 2>&1
+    sudo iw dev ${IFACE} survey dump || exit ${ERROR}
+    ;;
+
+  WIFIAP_TC_CLEAR)
+    sudo tc qdisc del dev ${IFACE} root > /dev/null 2>&1
+    sudo tc qdisc del dev ${IFACE} ingress > /dev/null 2>&1
+    ;;
+
+  WIFIAP_TC_SETUP)
+    # $3: rate of the access point in kbit/s
+    RATE=$3
+    sudo tc qdisc add dev ${IFACE} root handle 1: htb default 2 || exit ${ERROR}
+    sudo tc class add dev ${IFACE} parent 1: classid 1:1 htb rate ${RATE}kbit ceil ${RATE}kbit || exit ${ERROR}
+    sudo tc class add dev ${IFACE} parent 1:1 classid 1:2 htb rate ${RATE}kbit ceil ${RATE}kbit || exit ${ERROR}
+    sudo tc qdisc add dev ${IFACE} parent 1:2 handle 2: fq_codel || exit ${ERROR}
+    sudo tc qdisc add dev ${IFACE} handle ffff: ingress || exit ${ERROR}
+    ;;
+
+  WIFIAP_TC_STATION)
+    # $3: class (hexadecimal), $4: IP address of the station, $5: rate in kbit/s
+    CLASS=$3
+    STATION_IP=$4
+    RATE=$5
+    sudo tc class add dev ${IFACE} parent 1:1 classid 1:${CLASS} htb rate ${RATE}kbit ceil ${RATE}kbit || exit ${ERROR}
+    sudo tc qdisc add dev ${IFACE} parent 1:${CLASS} handle ${CLASS}: fq_codel || exit ${ERROR}
+    sudo tc filter add dev ${IFACE} parent 1: protocol ip prio 1 u32 match ip dst ${STATION_IP}/32 flowid 1:${CLASS} || exit ${ERROR}
+    sudo tc filter add dev ${IFACE} parent ffff: protocol ip prio 1 u32 match ip src ${STATION_IP}/32 \
+      police rate ${RATE}kbit burst 32k drop flowid :1 || exit ${ERROR}
+    ;;
+
+  WIFIAP_TC_STATS)
+    sudo tc -s class show dev ${IFACE} || exit ${ERROR}
+    ;;
+
   *)
     echo "Parameter not valid"
     exit ${ERROR} ;;
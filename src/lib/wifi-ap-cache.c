@@ -0,0 +1,234 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-cache.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wifi-ap-platform.h"
+#include "wifi-ap-utilities.h"
+
+#define FNV_PRIME 0x100000001b3ULL
+
+// length of the name of an entry: the hash in hexadecimal
+#define ENTRY_NAME_LENGTH 16
+
+// list of the entries, the one used last first
+#define INDEX_FILE "index"
+
+// max size of the header of a file in an entry: "<name> <length>\n"
+#define ENTRY_HEADER_SIZE (NAME_MAX + 32)
+
+/*******************************************************************************
+ *      hash the settings the generated files depend on (FNV-1a 64 bits)       *
+ *                                                                             *
+ * Start with CONFIG_CACHE_HASH_INIT, the result can be passed again to hash   *
+ * more data.                                                                  *
+ ******************************************************************************/
+uint64_t hashConfigCache(const char *data, uint64_t hash)
+{
+    while (*data != '\0') {
+        hash ^= (unsigned char)*data++;
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+/*******************************************************************************
+ *      path of an entry of the cache, of the index of the cache               *
+ ******************************************************************************/
+static int entry_path(char *path, const char *cacheDir, uint64_t hash)
+{
+    if (snprintf(path, PATH_MAX, "%s/%016" PRIx64, cacheDir, hash) >=
+        PATH_MAX)
+        return -ENAMETOOLONG;
+    return 0;
+}
+
+static int index_path(char *path, const char *cacheDir)
+{
+    if (snprintf(path, PATH_MAX, "%s/%s", cacheDir, INDEX_FILE) >= PATH_MAX)
+        return -ENAMETOOLONG;
+    return 0;
+}
+
+static const char *file_name(const char *file)
+{
+    const char *name = strrchr(file, '/');
+
+    return name == NULL ? file : name + 1;
+}
+
+/*******************************************************************************
+ *      put an entry first in the index of the cache                           *
+ *                                                                             *
+ * The index lists the entries, the one used last first. The entries beyond    *
+ * CONFIG_CACHE_ENTRIES are removed.                                           *
+ ******************************************************************************/
+static int touch_entry(const char *cacheDir, uint64_t hash)
+{
+    char path[PATH_MAX];
+    char index[(ENTRY_NAME_LENGTH + 1) * CONFIG_CACHE_ENTRIES + 1];
+    char *content = NULL, *line, *next;
+    uint64_t entry;
+    unsigned kept = 1;
+    int rc;
+
+    rc = index_path(path, cacheDir);
+    if (rc != 0)
+        return rc;
+    snprintf(index, sizeof(index), "%016" PRIx64 "\n", hash);
+
+    // a missing or damaged index only loses the order of the entries
+    if (readPlatformFile(path, CONFIG_CACHE_FILE_SIZE, &content) == 0) {
+        for (line = content; *line != '\0'; line = next) {
+            next = strchrnul(line, '\n');
+            if (*next == '\n')
+                *next++ = '\0';
+            if (strlen(line) != ENTRY_NAME_LENGTH ||
+                strspn(line, "0123456789abcdef") != ENTRY_NAME_LENGTH ||
+                sscanf(line, "%" SCNx64, &entry) != 1 || entry == hash)
+                continue;
+            if (kept < CONFIG_CACHE_ENTRIES) {
+                strcat(index, line);
+                strcat(index, "\n");
+                kept++;
+            } else if (entry_path(path, cacheDir, entry) == 0) {
+                getPlatform()->removeFile(path);
+            }
+        }
+        free(content);
+    }
+
+    index_path(path, cacheDir);
+    return getPlatform()->writeFile(path, index);
+}
+
+/*******************************************************************************
+ *      restore the generated files of a hash from the cache                   *
+ *                                                                             *
+ * The entry <cacheDir>/<hash> holds each file as a "<name> <length>" line     *
+ * followed by its content. The files are written to their paths, in the       *
+ * order they were stored.                                                     *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if restored, -ENOENT if not in the cache, or another -errno          *
+ ******************************************************************************/
+int getConfigCache(const char *cacheDir,
+                   uint64_t hash,
+                   const char *const *files,
+                   unsigned count)
+{
+    char path[PATH_MAX];
+    char name[ENTRY_HEADER_SIZE];
+    char *content, *data, *end;
+    size_t length;
+    int used, rc;
+    char saved;
+
+    rc = entry_path(path, cacheDir, hash);
+    if (rc == 0)
+        rc = readPlatformFile(path, (size_t)count * (CONFIG_CACHE_FILE_SIZE +
+                                                     ENTRY_HEADER_SIZE),
+                              &content);
+    if (rc != 0)
+        return rc;
+
+    data = content;
+    for (unsigned i = 0; i < count && rc == 0; i++) {
+        if (sscanf(data, "%255s %zu\n%n", name, &length, &used) != 2 ||
+            strcmp(name, file_name(files[i])) != 0 ||
+            length > CONFIG_CACHE_FILE_SIZE ||
+            length > strlen(data + used)) {
+            rc = -EBADMSG;
+            break;
+        }
+        data += used;
+        end = data + length;
+
+        // the content is written as a string, the next header follows it
+        saved = *end;
+        *end = '\0';
+        rc = getPlatform()->writeFile(files[i], data);
+        *end = saved;
+        data = end;
+    }
+    free(content);
+
+    // mark the entry as used for the pruning
+    if (rc == 0)
+        touch_entry(cacheDir, hash);
+    return rc;
+}
+
+/*******************************************************************************
+ *      store the generated files of a hash in the cache                       *
+ *                                                                             *
+ * The entry <cacheDir>/<hash> is written atomically, then the entries beyond  *
+ * the CONFIG_CACHE_ENTRIES used last are removed.                             *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if stored (or already there), or -errno                              *
+ ******************************************************************************/
+int putConfigCache(const char *cacheDir,
+                   uint64_t hash,
+                   const char *const *files,
+                   unsigned count)
+{
+    char path[PATH_MAX];
+    char *entry = NULL, *content;
+    size_t size = 0;
+    FILE *stream;
+    int rc;
+
+    rc = entry_path(path, cacheDir, hash);
+    if (rc != 0)
+        return rc;
+    if (checkFileExists(path))
+        return 0;
+    rc = getPlatform()->makeDirectory(cacheDir);
+    if (rc != 0)
+        return rc;
+
+    stream = open_memstream(&entry, &size);
+    if (stream == NULL)
+        return -ENOMEM;
+    for (unsigned i = 0; i < count && rc == 0; i++) {
+        rc = readPlatformFile(files[i], CONFIG_CACHE_FILE_SIZE, &content);
+        if (rc == 0) {
+            fprintf(stream, "%s %zu\n%s", file_name(files[i]),
+                    strlen(content), content);
+            free(content);
+        }
+    }
+    if (fclose(stream) != 0 && rc == 0)
+        rc = -ENOMEM;
+
+    if (rc == 0)
+        rc = getPlatform()->writeFile(path, entry);
+    free(entry);
+
+    if (rc == 0)
+        touch_entry(cacheDir, hash);
+    return rc;
+}
@@ -0,0 +1,41 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef CACHE_HEADER_FILE
+#define CACHE_HEADER_FILE
+
+#include <stdint.h>
+
+// number of versions of the generated files kept in the cache
+#define CONFIG_CACHE_ENTRIES 4
+
+// first value of the FNV-1a hash of the cached settings
+#define CONFIG_CACHE_HASH_INIT 0xcbf29ce484222325ULL
+
+// max size of a cached file
+#define CONFIG_CACHE_FILE_SIZE 65536
+
+//------------------------------------------------------------------------------
+
+uint64_t hashConfigCache(const char *data, uint64_t hash);
+int getConfigCache(const char *cacheDir,
+                   uint64_t hash,
+                   const char *const *files,
+                   unsigned count);
+int putConfigCache(const char *cacheDir,
+                   uint64_t hash,
+                   const char *const *files,
+                   unsigned count);
+#endif
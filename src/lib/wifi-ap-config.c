@@ -23,6 +23,8 @@
 #define AFB_BINDING_VERSION 4
 #include <afb/afb-binding.h>
 
+#include "wifi-ap-platform.h"
+#include "wifi-ap-psk.h"
 #include "wifi-ap-utilities.h"
 
 /*******************************************************************************
@@ -34,9 +36,9 @@
 
 int createHostsConfigFile(const char *ip_ap, char *hostName)
 {
-    const char *configFileName = "/tmp/add_hosts";
+    const char *configFileName = WIFI_HOSTS_FILE;
 
-    FILE *ConfigFile = fopen(configFileName, "w");
+    FILE *ConfigFile = getPlatform()->createFile(configFileName);
     if (!ConfigFile) {
         fclose(ConfigFile);
         return -1;
@@ -55,6 +57,32 @@ int createHostsConfigFile(const char *ip_ap, char *hostName)
     return 0;
 }
 
+/*******************************************************************************
+ *      Format a DHCP lease time the way dnsmasq expects it                    *
+ ******************************************************************************/
+static void formatLeaseTime(char *buffer, size_t size, uint32_t leaseTime)
+{
+    if (leaseTime % 3600 == 0)
+        snprintf(buffer, size, "%uh", (unsigned)(leaseTime / 3600));
+    else if (leaseTime % 60 == 0)
+        snprintf(buffer, size, "%um", (unsigned)(leaseTime / 60));
+    else
+        snprintf(buffer, size, "%u", (unsigned)leaseTime);
+}
+
+/*******************************************************************************
+ *      Check if a DHCP option is overridden by the options table              *
+ ******************************************************************************/
+static bool isDhcpOptionSet(wifiApT *wifiApData, uint8_t code)
+{
+    uint32_t idx;
+
+    for (idx = 0; idx < wifiApData->dhcp.optionCount; idx++)
+        if (wifiApData->dhcp.options[idx].code == code)
+            return true;
+    return false;
+}
+
 /*******************************************************************************
  *      Create access point specific DNSMASQ configuration file                *
  *                                                                             *
@@ -62,39 +90,121 @@ int createHostsConfigFile(const char *ip_ap, char *hostName)
  *      0 if success, or -1 if not.                                            *
  ******************************************************************************/
 
-int createDnsmasqConfigFile(const char *ip_ap,
-                            const char *ip_start,
-                            const char *ip_stop,
-                            char *domainName)
+int createDnsmasqConfigFile(wifiApT *wifiApData)
 {
-    const char *configFileName = "/tmp/dnsmasq.wlan.conf";
+    const char *configFileName = WIFI_DNSMASQ_FILE;
+    char leaseTime[16];
+    uint32_t idx;
 
-    FILE *ConfigFile = fopen(configFileName, "w");
+    FILE *ConfigFile = getPlatform()->createFile(configFileName);
     if (!ConfigFile) {
-        fclose(ConfigFile);
+        AFB_ERROR("Unable to open the dnsmasq configuration file: %m.");
         return -1;
     }
 
-    if (ConfigFile != NULL) {
-        // Interface is generated when COMMAND_DNSMASQ_RESTART called
-        fprintf(ConfigFile, "bind-interfaces\nlisten-address=%s\n", ip_ap);
-        fprintf(
-            ConfigFile,
-            "expand-hosts\naddn-hosts=/tmp/add_hosts\ndomain=%s\nlocal=/%s/\n",
-            domainName, domainName);
-        fprintf(ConfigFile, "dhcp-range=%s,%s,%dh\n", ip_start, ip_stop, 24);
-        fprintf(ConfigFile, "dhcp-option=%d,%s\n", 3, ip_ap);
-        fprintf(ConfigFile, "dhcp-option=%d,%s\n", 6, ip_ap);
-        fclose(ConfigFile);
+    formatLeaseTime(leaseTime, sizeof(leaseTime), wifiApData->dhcp.leaseTime);
+
+    // Interface is generated when COMMAND_DNSMASQ_RESTART called
+    fprintf(ConfigFile, "bind-interfaces\nlisten-address=%s\n",
+            wifiApData->ip_ap);
+    fprintf(ConfigFile,
+            "expand-hosts\naddn-hosts=" WIFI_HOSTS_FILE
+            "\ndomain=%s\nlocal=/%s/\n",
+            wifiApData->domainName, wifiApData->domainName);
+    fprintf(ConfigFile, "dhcp-leasefile=" WIFI_DNSMASQ_LEASE_FILE "\n");
+    fprintf(ConfigFile, "cache-size=%u\n",
+            (unsigned)wifiApData->dhcp.dnsCacheSize);
+    fprintf(ConfigFile, "dhcp-range=%s,%s,%s\n", wifiApData->ip_start,
+            wifiApData->ip_stop, leaseTime);
+    if (wifiApData->dhcp.authoritative)
+        fprintf(ConfigFile, "dhcp-authoritative\n");
+    if (wifiApData->dhcp.rapidCommit)
+        fprintf(ConfigFile, "dhcp-rapid-commit\n");
+
+    // Static leases: the lease time of dhcp-range also applies to them
+    for (idx = 0; idx < wifiApData->dhcp.staticLeaseCount; idx++) {
+        wifiAp_DhcpStaticLease_t *lease = &wifiApData->dhcp.staticLeases[idx];
+        if (lease->hostName[0] != '\0')
+            fprintf(ConfigFile, "dhcp-host=%s,%s,%s,%s\n", lease->mac,
+                    lease->ip, lease->hostName, leaseTime);
+        else
+            fprintf(ConfigFile, "dhcp-host=%s,%s,%s\n", lease->mac, lease->ip,
+                    leaseTime);
     }
-    else {
-        AFB_ERROR("Unable to open the dnsmasq configuration file: %m.");
+
+    // Router (3) and DNS server (6) default to the access point itself
+    if (!isDhcpOptionSet(wifiApData, 3))
+        fprintf(ConfigFile, "dhcp-option=%d,%s\n", 3, wifiApData->ip_ap);
+    if (!isDhcpOptionSet(wifiApData, 6))
+        fprintf(ConfigFile, "dhcp-option=%d,%s\n", 6, wifiApData->ip_ap);
+    for (idx = 0; idx < wifiApData->dhcp.optionCount; idx++)
+        fprintf(ConfigFile, "dhcp-option=%d,%s\n",
+                wifiApData->dhcp.options[idx].code,
+                wifiApData->dhcp.options[idx].value);
+
+    if (fclose(ConfigFile) != 0) {
+        AFB_ERROR("Unable to write the dnsmasq configuration file: %m.");
         return -2;
     }
 
     return 0;
 }
 
+/*******************************************************************************
+ *      Prepare the HT/VHT/HE capabilities and channel width settings          *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, or -1 if the buffer is too small.                        *
+ ******************************************************************************/
+static int generateHtVhtConfig(wifiApT *wifiApData, char *buffer, size_t size)
+{
+    uint32_t stdMask = wifiApData->IeeeStdMask;
+    uint16_t width = wifiApData->radio.channelWidth;
+    bool acs = wifiApData->autoChannel == WIFI_AP_AUTO_CHANNEL_HOSTAPD;
+    const char *ht40 = "";
+    int chwidth = 0;
+    uint16_t center = 0;
+    int len = 0;
+
+    buffer[0] = '\0';
+    // with acs_survey, hostapd derives the secondary and center channels
+    if (width >= CHANNEL_WIDTH_40)
+        ht40 = acs || getHt40SecondaryOffset(stdMask,
+                                             wifiApData->channelNumber) > 0
+                   ? "[HT40+]"
+                   : "[HT40-]";
+    if (width >= CHANNEL_WIDTH_80) {
+        // vht_oper_chwidth: 0 = 20 or 40 MHz, 1 = 80 MHz, 2 = 160 MHz
+        chwidth = width == CHANNEL_WIDTH_80 ? 1 : 2;
+        if (!acs)
+            center = getVhtCenterChannel(wifiApData->channelNumber, width);
+    }
+
+    if (stdMask & WIFI_AP_BITMASK_IEEE_STD_N)
+        len += snprintf(buffer + len, size - (size_t)len, "ht_capab=%s%s\n",
+                        ht40, wifiApData->radio.htCapab);
+    if ((stdMask & WIFI_AP_BITMASK_IEEE_STD_AC) && len < (int)size) {
+        len += snprintf(buffer + len, size - (size_t)len,
+                        "vht_oper_chwidth=%d\n", chwidth);
+        if (center != 0 && len < (int)size)
+            len += snprintf(buffer + len, size - (size_t)len,
+                            "vht_oper_centr_freq_seg0_idx=%u\n",
+                            (unsigned)center);
+        if (wifiApData->radio.vhtCapab[0] != '\0' && len < (int)size)
+            len += snprintf(buffer + len, size - (size_t)len,
+                            "vht_capab=%s\n", wifiApData->radio.vhtCapab);
+    }
+    if ((stdMask & WIFI_AP_BITMASK_IEEE_STD_AX) && len < (int)size) {
+        len += snprintf(buffer + len, size - (size_t)len,
+                        "he_oper_chwidth=%d\n", chwidth);
+        if (center != 0 && len < (int)size)
+            len += snprintf(buffer + len, size - (size_t)len,
+                            "he_oper_centr_freq_seg0_idx=%u\n",
+                            (unsigned)center);
+    }
+    return len < (int)size ? 0 : -1;
+}
+
 /*******************************************************************************
  *                   Generate hostapd configuration file                       *
  *                                                                             *
@@ -105,10 +215,11 @@ int createDnsmasqConfigFile(const char *ip_ap,
 int GenerateHostApConfFile(wifiApT *wifiApData)
 {
     char tmpConfig[TEMP_STRING_MAX_BYTES];
+    char channel[16];
     FILE *configFile = NULL;
     int result = -1;
 
-    configFile = fopen(WIFI_HOSTAPD_FILE, "w");
+    configFile = getPlatform()->createFile(WIFI_HOSTAPD_FILE);
     if (NULL == configFile) {
         AFB_ERROR("Unable to create hostapd.conf file");
         return -1;
@@ -116,15 +227,25 @@ int GenerateHostApConfFile(wifiApT *wifiApData)
     else
         AFB_INFO("hostapd.conf file created successfully");
 
+    if (wifiApData->autoChannel == WIFI_AP_AUTO_CHANNEL_HOSTAPD)
+        utf8_Copy(channel, "acs_survey", sizeof(channel), NULL);
+    else
+        snprintf(channel, sizeof(channel), "%u",
+                 (unsigned)wifiApData->channelNumber);
+
     memset(tmpConfig, '\0', sizeof(tmpConfig));
     // prepare SSID, channel, country code etc in hostapd.conf
     snprintf(
         tmpConfig, sizeof(tmpConfig),
-        (HOSTAPD_CONFIG_COMMON "ssid=%s\nchannel=%d\nmax_num_sta=%d\ncountry_"
-                               "code=%s\nignore_broadcast_ssid=%d\n"),
-        (char *)wifiApData->ssid, wifiApData->channelNumber,
-        wifiApData->maxNumberClient, (char *)wifiApData->countryCode,
-        !wifiApData->discoverable);
+        (HOSTAPD_CONFIG_COMMON HOSTAPD_CONFIG_RADIO
+         "ssid=%s\nchannel=%s\nmax_num_sta=%d\ncountry_"
+         "code=%s\nignore_broadcast_ssid=%d\n"),
+        wifiApData->radio.wmmEnabled, (unsigned)wifiApData->radio.beaconInterval,
+        (unsigned)wifiApData->radio.dtimPeriod,
+        (unsigned)wifiApData->radio.rtsThreshold,
+        (unsigned)wifiApData->radio.fragmThreshold, (char *)wifiApData->ssid,
+        channel, wifiApData->maxNumberClient,
+        (char *)wifiApData->countryCode, !wifiApData->discoverable);
     // Write common config such as SSID, channel, country code, etc in
     // hostapd.conf
     tmpConfig[TEMP_STRING_MAX_BYTES - 1] = '\0';
@@ -147,9 +268,12 @@ int GenerateHostApConfFile(wifiApT *wifiApData)
     case WIFI_AP_SECURITY_WPA2:
         AFB_DEBUG("WIFI_AP_SECURITY_WPA2");
         if ('\0' != wifiApData->passphrase[0]) {
+            // derive the key here so hostapd does not run PBKDF2 at each start
+            char psk[2 * WPA_PSK_LENGTH + 1];
+            if (getWpaPsk(wifiApData->ssid, wifiApData->passphrase, psk))
+                AFB_DEBUG("WPA pre-shared key derived from the passphrase");
             snprintf(tmpConfig, sizeof(tmpConfig),
-                     (HOSTAPD_CONFIG_SECURITY_WPA2 "wpa_passphrase=%s\n"),
-                     wifiApData->passphrase);
+                     (HOSTAPD_CONFIG_SECURITY_WPA2 "wpa_psk=%s\n"), psk);
             tmpConfig[TEMP_STRING_MAX_BYTES - 1] = '\0';
             result = writeApConfigFile(tmpConfig, configFile);
         }
@@ -166,6 +290,29 @@ int GenerateHostApConfFile(wifiApT *wifiApData)
         }
         break;
 
+    case WIFI_AP_SECURITY_WPA3:
+    case WIFI_AP_SECURITY_WPA2_WPA3:
+        AFB_DEBUG("WIFI_AP_SECURITY_%s",
+                  getSecurityProtocolName(wifiApData->securityProtocol));
+        if ((wifiApData->IeeeStdMask & WIFI_AP_BITMASK_IEEE_STD_W) == 0) {
+            AFB_ERROR("WPA3 needs IEEE 802.11w (PMF)!");
+            result = -1;
+        }
+        else if ('\0' != wifiApData->passphrase[0]) {
+            snprintf(tmpConfig, sizeof(tmpConfig), "%swpa_passphrase=%s\n",
+                     wifiApData->securityProtocol == WIFI_AP_SECURITY_WPA3
+                         ? HOSTAPD_CONFIG_SECURITY_WPA3
+                         : HOSTAPD_CONFIG_SECURITY_WPA2_WPA3,
+                     wifiApData->passphrase);
+            tmpConfig[TEMP_STRING_MAX_BYTES - 1] = '\0';
+            result = writeApConfigFile(tmpConfig, configFile);
+        }
+        else {
+            AFB_ERROR("WPA3 needs a passphrase, SAE can't use a PSK!");
+            result = -1;
+        }
+        break;
+
     default:
         AFB_ERROR("Unsupported security protocol!");
         result = -1;
@@ -181,6 +328,22 @@ int GenerateHostApConfFile(wifiApT *wifiApData)
         AFB_INFO(
             "Security parameters has been set successfully in hostapd.conf ");
 
+    // Write the MAC access control lists and their use in hostapd.conf
+    snprintf(tmpConfig, sizeof(tmpConfig), HOSTAPD_CONFIG_ACL,
+             (int)wifiApData->acl.policy);
+    if (writeMacAclFiles(wifiApData) != 0 ||
+        writeApConfigFile(tmpConfig, configFile) != 0) {
+        AFB_ERROR("Unable to set the MAC access control in hostapd.conf");
+        goto error;
+    }
+
+    // Advertise the BSS transition management used by the band steering
+    if (wifiApData->steering.enabled &&
+        writeApConfigFile("bss_transition=1\n", configFile) != 0) {
+        AFB_ERROR("Unable to set the BSS transition in hostapd.conf");
+        goto error;
+    }
+
     // prepare IEEE std including hardware mode into hostapd.conf
     memset(tmpConfig, '\0', sizeof(tmpConfig));
     switch (wifiApData->IeeeStdMask & HARDWARE_MODE_MASK) {
@@ -218,7 +381,12 @@ int GenerateHostApConfFile(wifiApT *wifiApData)
         utf8_Append(tmpConfig, "ieee80211ax=1\n", sizeof(tmpConfig), NULL);
     }
     if (wifiApData->IeeeStdMask & WIFI_AP_BITMASK_IEEE_STD_W) {
-        utf8_Append(tmpConfig, "ieee80211w=1\n", sizeof(tmpConfig), NULL);
+        // PMF is optional, but required by WPA3 only
+        utf8_Append(tmpConfig,
+                    wifiApData->securityProtocol == WIFI_AP_SECURITY_WPA3
+                        ? "ieee80211w=2\n"
+                        : "ieee80211w=1\n",
+                    sizeof(tmpConfig), NULL);
     }
     // Write IEEE std in hostapd.conf
     tmpConfig[TEMP_STRING_MAX_BYTES - 1] = '\0';
@@ -228,16 +396,67 @@ int GenerateHostApConfFile(wifiApT *wifiApData)
     }
     else
         AFB_INFO("IEEE std has been set successfully in hostapd.conf");
+
+    // prepare HT/VHT/HE capabilities and channel width into hostapd.conf
+    if (checkChannelWidth(wifiApData) != WIFIAP_NO_ERROR) {
+        AFB_ERROR("Channel %u with a width of %u MHz is not usable",
+                  (unsigned)wifiApData->channelNumber,
+                  (unsigned)wifiApData->radio.channelWidth);
+        goto error;
+    }
+    if (generateHtVhtConfig(wifiApData, tmpConfig, sizeof(tmpConfig)) != 0 ||
+        writeApConfigFile(tmpConfig, configFile) != 0) {
+        AFB_ERROR("Unable to set HT/VHT capabilities in hostapd.conf");
+        goto error;
+    }
+    else
+        AFB_INFO("HT/VHT capabilities have been set successfully");
     fclose(configFile);
     return 0;
 
 error:
     fclose(configFile);
     // Remove generated hostapd.conf file
-    remove(WIFI_HOSTAPD_FILE);
+    getPlatform()->removeFile(WIFI_HOSTAPD_FILE);
     return -1;
 }
 
+/*******************************************************************************
+ *      write a set of MAC addresses, one per line                             *
+ ******************************************************************************/
+static int write_mac_set(const char *fileName, const wifiAp_MacSet_t *set)
+{
+    char content[MAX_MAC_ACL_ENTRIES * (MAC_ADDRESS_LENGTH + 1) + 1];
+    size_t length = 0;
+    uint64_t mac;
+
+    for (unsigned slot = 0; slot < MAC_SET_SLOTS; slot++) {
+        if (getMacSetEntry(set, slot, &mac)) {
+            formatMacAddress(mac, &content[length]);
+            length += MAC_ADDRESS_LENGTH;
+            content[length++] = '\n';
+        }
+    }
+    content[length] = '\0';
+    return getPlatform()->writeFile(fileName, content);
+}
+
+/*******************************************************************************
+ *      write the accept and deny files of hostapd                             *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, or -1 if not.                                            *
+ ******************************************************************************/
+int writeMacAclFiles(const wifiApT *wifiApData)
+{
+    if (write_mac_set(WIFI_HOSTAPD_ACCEPT_FILE, &wifiApData->acl.allow) != 0 ||
+        write_mac_set(WIFI_HOSTAPD_DENY_FILE, &wifiApData->acl.deny) != 0) {
+        AFB_ERROR("Unable to write the MAC access control lists");
+        return -1;
+    }
+    return 0;
+}
+
 /*******************************************************************************
  *                       write hostapd config file                             *
  *                                                                             *
@@ -26,6 +26,11 @@
 
 // WiFi access point configuration files
 #define WIFI_HOSTAPD_FILE               "/tmp/hostapd.conf"
+#define WIFI_DNSMASQ_FILE               "/tmp/dnsmasq.wlan.conf"
+#define WIFI_HOSTS_FILE                 "/tmp/add_hosts"
+#define WIFI_DNSMASQ_LEASE_FILE         "/tmp/dnsmasq.wlan.leases"
+#define WIFI_HOSTAPD_ACCEPT_FILE        "/tmp/hostapd.accept"
+#define WIFI_HOSTAPD_DENY_FILE          "/tmp/hostapd.deny"
 #define WIFI_POLKIT_NM_CONF_FILE        "/tmp/nm-daemon.rules"
 #define WIFI_POLKIT_FIREWALLD_CONF_FILE "/tmp/fd-daemon.rules"
 
@@ -33,20 +38,28 @@
 // Host access point global configuration
 #define HOSTAPD_CONFIG_COMMON           \
     "driver=nl80211\n"                  \
-    "wmm_enabled=1\n"                   \
-    "beacon_int=100\n"                  \
-    "dtim_period=2\n"                   \
-    "rts_threshold=2347\n"              \
-    "fragm_threshold=2346\n"            \
     "ctrl_interface=/var/run/hostapd\n" \
     "ctrl_interface_group=0\n"
 
+// Host access point radio configuration (timings, thresholds and QoS)
+#define HOSTAPD_CONFIG_RADIO  \
+    "wmm_enabled=%d\n"        \
+    "beacon_int=%u\n"         \
+    "dtim_period=%u\n"        \
+    "rts_threshold=%u\n"      \
+    "fragm_threshold=%u\n"
+
 // Host access point configuration with no security
 #define HOSTAPD_CONFIG_SECURITY_NONE \
     "auth_algs=1\n"                  \
     "eap_server=0\n"                 \
-    "eapol_key_index_workaround=0\n" \
-    "macaddr_acl=0\n"
+    "eapol_key_index_workaround=0\n"
+
+// Host access point MAC access control (lists updated by ACCEPT/DENY_ACL)
+#define HOSTAPD_CONFIG_ACL                         \
+    "macaddr_acl=%d\n"                             \
+    "accept_mac_file=" WIFI_HOSTAPD_ACCEPT_FILE "\n" \
+    "deny_mac_file=" WIFI_HOSTAPD_DENY_FILE "\n"
 
 // Host access point configuration with WPA2 security
 #define HOSTAPD_CONFIG_SECURITY_WPA2 \
@@ -54,15 +67,47 @@
     "wpa_key_mgmt=WPA-PSK\n"         \
     "rsn_pairwise=CCMP\n"
 
+// Host access point SAE settings: both password element derivations (hunting
+// and pecking, hash-to-element), anti-clogging tokens after 5 pending commits,
+// PMKSA caching with opportunistic key caching for the fast reconnections
+#define HOSTAPD_CONFIG_SAE                \
+    "sae_pwe=2\n"                        \
+    "sae_anti_clogging_threshold=5\n"    \
+    "sae_require_mfp=1\n"                \
+    "disable_pmksa_caching=0\n"          \
+    "okc=1\n"
+
+// Host access point configuration with WPA3 security
+#define HOSTAPD_CONFIG_SECURITY_WPA3 \
+    "wpa=2\n"                        \
+    "wpa_key_mgmt=SAE\n"             \
+    "rsn_pairwise=CCMP\n" HOSTAPD_CONFIG_SAE
+
+// Host access point configuration with WPA2/WPA3 transition security
+#define HOSTAPD_CONFIG_SECURITY_WPA2_WPA3 \
+    "wpa=2\n"                             \
+    "wpa_key_mgmt=WPA-PSK SAE\n"          \
+    "rsn_pairwise=CCMP\n" HOSTAPD_CONFIG_SAE
+
+// All the templates above, hashed in the key of the cache of the generated
+// files (the SAE settings are part of the WPA3 ones)
+#define HOSTAPD_CONFIG_TEMPLATES                                        \
+    HOSTAPD_CONFIG_COMMON HOSTAPD_CONFIG_RADIO                          \
+        HOSTAPD_CONFIG_SECURITY_NONE HOSTAPD_CONFIG_ACL                 \
+            HOSTAPD_CONFIG_SECURITY_WPA2 HOSTAPD_CONFIG_SECURITY_WPA3   \
+                HOSTAPD_CONFIG_SECURITY_WPA2_WPA3
+
+// Version of the generated files, also hashed in the key of the cache: to be
+// changed with the code writing them (dnsmasq.conf, hosts, fixed keys)
+#define CONFIG_FILES_VERSION "wifiap-config-1\n"
+
 //------------------------------------------------------------------------------
 
 int createHostsConfigFile(const char *ip_ap, char *hostName);
 int createPolkitRulesFile_NM();
 int createPolkitRulesFile_Firewalld();
-int createDnsmasqConfigFile(const char *ip_ap,
-                            const char *ip_start,
-                            const char *ip_stop,
-                            char *domainName);
+int createDnsmasqConfigFile(wifiApT *wifiApData);
 int GenerateHostApConfFile(wifiApT *wifiApData);
+int writeMacAclFiles(const wifiApT *wifiApData);
 int writeApConfigFile(const char *data, FILE *file);
 #endif
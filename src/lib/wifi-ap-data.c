@@ -18,11 +18,16 @@
 
 #include "wifi-ap-data.h"
 
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define AFB_BINDING_VERSION 4
 #include <afb/afb-binding.h>
 
+#include "wifi-ap-nl80211.h"
 #include "wifi-ap-utilities.h"
 
 /*******************************************************************************
@@ -81,6 +86,287 @@ static int set_buffer(char *dest, const char *src, size_t minlen, size_t maxlen)
     return WIFIAP_NO_ERROR;
 }
 
+/*******************************************************************************
+ * check that a MAC address is written as aa:bb:cc:dd:ee:ff                    *
+ ******************************************************************************/
+static bool is_valid_mac(const char *mac)
+{
+    int idx;
+
+    if (mac == NULL || strlen(mac) != MAC_ADDRESS_LENGTH)
+        return false;
+
+    for (idx = 0; idx < MAC_ADDRESS_LENGTH; idx++) {
+        if ((idx % 3) == 2) {
+            if (mac[idx] != ':')
+                return false;
+        }
+        else if (!isxdigit((unsigned char)mac[idx]))
+            return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ * check that a string can be written as is in a configuration file line       *
+ ******************************************************************************/
+static bool is_config_safe(const char *value)
+{
+    for (; *value; value++)
+        if (*value == '\n' || *value == '\r')
+            return false;
+    return true;
+}
+
+/*******************************************************************************
+ * check that hostapd capabilities are written as a list of [FLAG]             *
+ ******************************************************************************/
+static bool is_valid_capab(const char *capab)
+{
+    bool inFlag = false;
+
+    for (; *capab; capab++) {
+        if (*capab == '[' && !inFlag)
+            inFlag = true;
+        else if (*capab == ']' && inFlag)
+            inFlag = false;
+        else if (!inFlag || !(isalnum((unsigned char)*capab) ||
+                              *capab == '-' || *capab == '+' || *capab == '_'))
+            return false;
+    }
+    return !inFlag;
+}
+
+/*******************************************************************************
+ *     Set the default values of the access point parameters                   *
+ ******************************************************************************/
+void initWifiApData(wifiApT *wifiApData)
+{
+    wifiApData->radio.beaconInterval = DEFAULT_BEACON_INTERVAL;
+    wifiApData->radio.dtimPeriod = DEFAULT_DTIM_PERIOD;
+    wifiApData->radio.rtsThreshold = DEFAULT_RTS_THRESHOLD;
+    wifiApData->radio.fragmThreshold = DEFAULT_FRAGM_THRESHOLD;
+    wifiApData->radio.wmmEnabled = true;
+    wifiApData->radio.channelWidth = CHANNEL_WIDTH_20;
+    wifiApData->dhcp.leaseTime = DEFAULT_DHCP_LEASE_TIME;
+    wifiApData->dhcp.dnsCacheSize = DEFAULT_DNS_CACHE_SIZE;
+    wifiApData->steering.intervalMs = DEFAULT_STEERING_INTERVAL_MS;
+    wifiApData->steering.cooldownMs = DEFAULT_STEERING_COOLDOWN_MS;
+}
+
+/*******************************************************************************
+ *     Free a wifiApData allocated by its user and the names it holds          *
+ ******************************************************************************/
+void deleteWifiApData(wifiApT *wifiApData)
+{
+    free(wifiApData->interfaceName);
+    free(wifiApData->domainName);
+    free(wifiApData->hostName);
+    free(wifiApData);
+}
+
+/*******************************************************************************
+ *     compare two strings that may be NULL                                    *
+ ******************************************************************************/
+static bool same_string(const char *a, const char *b)
+{
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+/*******************************************************************************
+ *     compare the DHCP settings of two configurations                         *
+ ******************************************************************************/
+static bool same_dhcp(const wifiApT *a, const wifiApT *b)
+{
+    uint32_t idx;
+
+    if (a->dhcp.leaseTime != b->dhcp.leaseTime ||
+        a->dhcp.authoritative != b->dhcp.authoritative ||
+        a->dhcp.rapidCommit != b->dhcp.rapidCommit ||
+        a->dhcp.dnsCacheSize != b->dhcp.dnsCacheSize ||
+        a->dhcp.staticLeaseCount != b->dhcp.staticLeaseCount ||
+        a->dhcp.optionCount != b->dhcp.optionCount)
+        return false;
+
+    for (idx = 0; idx < a->dhcp.staticLeaseCount; idx++) {
+        const wifiAp_DhcpStaticLease_t *la = &a->dhcp.staticLeases[idx];
+        const wifiAp_DhcpStaticLease_t *lb = &b->dhcp.staticLeases[idx];
+        if (strcmp(la->mac, lb->mac) || strcmp(la->ip, lb->ip) ||
+            strcmp(la->hostName, lb->hostName))
+            return false;
+    }
+    for (idx = 0; idx < a->dhcp.optionCount; idx++) {
+        if (a->dhcp.options[idx].code != b->dhcp.options[idx].code ||
+            strcmp(a->dhcp.options[idx].value, b->dhcp.options[idx].value))
+            return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ *     compare two sets of MAC addresses (whatever the order of insertion)     *
+ ******************************************************************************/
+static bool same_mac_set(const wifiAp_MacSet_t *a, const wifiAp_MacSet_t *b)
+{
+    uint64_t mac;
+
+    if (a->count != b->count)
+        return false;
+    for (unsigned slot = 0; slot < MAC_SET_SLOTS; slot++) {
+        if (getMacSetEntry(a, slot, &mac) && !containsMacSet(b, mac))
+            return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ *     compare the traffic shaping settings of two configurations              *
+ ******************************************************************************/
+static bool same_shaping(const wifiApT *a, const wifiApT *b)
+{
+    if (a->shaping.ssidKbps != b->shaping.ssidKbps ||
+        a->shaping.stationCount != b->shaping.stationCount)
+        return false;
+
+    for (uint32_t idx = 0; idx < a->shaping.stationCount; idx++) {
+        const wifiAp_StationLimit_t *la = &a->shaping.stations[idx];
+        const wifiAp_StationLimit_t *lb = &b->shaping.stations[idx];
+        if (strcmp(la->mac, lb->mac) || la->kbps != lb->kbps)
+            return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ *     compare the band steering settings of two configurations                *
+ ******************************************************************************/
+static bool same_steering(const wifiApT *a, const wifiApT *b)
+{
+    const wifiAp_Steering_t *sa = &a->steering, *sb = &b->steering;
+
+    if (sa->intervalMs != sb->intervalMs || sa->maxClients != sb->maxClients ||
+        sa->minSignal != sb->minSignal || sa->cooldownMs != sb->cooldownMs ||
+        sa->disassocTimer != sb->disassocTimer ||
+        sa->neighborCount != sb->neighborCount)
+        return false;
+
+    for (uint32_t idx = 0; idx < sa->neighborCount; idx++) {
+        if (strcasecmp(sa->neighbors[idx], sb->neighbors[idx]))
+            return false;
+    }
+    return true;
+}
+
+/*******************************************************************************
+ *     Compare a staged configuration with the current one                     *
+ *                                                                             *
+ * The channel is not compared when it is selected automatically, the current  *
+ * one comes from the selection.                                               *
+ *                                                                             *
+ * @return                                                                     *
+ *     the WIFIAP_CHANGE_* groups of the changed settings (0 if none)          *
+ ******************************************************************************/
+unsigned compareWifiApData(const wifiApT *current, const wifiApT *staged)
+{
+    unsigned changes = 0;
+
+    if (!same_string(current->interfaceName, staged->interfaceName) ||
+        strcmp(current->ip_ap, staged->ip_ap) ||
+        strcmp(current->ip_netmask, staged->ip_netmask) ||
+        strcmp(current->countryCode, staged->countryCode) ||
+        current->IeeeStdMask != staged->IeeeStdMask ||
+        current->autoChannel != staged->autoChannel ||
+        current->radio.channelWidth != staged->radio.channelWidth)
+        changes |= WIFIAP_CHANGE_RESTART;
+
+    if (current->securityProtocol != staged->securityProtocol ||
+        strcmp(current->passphrase, staged->passphrase) ||
+        strcmp(current->presharedKey, staged->presharedKey) ||
+        current->radio.beaconInterval != staged->radio.beaconInterval ||
+        current->radio.dtimPeriod != staged->radio.dtimPeriod ||
+        current->radio.rtsThreshold != staged->radio.rtsThreshold ||
+        current->radio.fragmThreshold != staged->radio.fragmThreshold ||
+        current->radio.wmmEnabled != staged->radio.wmmEnabled ||
+        strcmp(current->radio.htCapab, staged->radio.htCapab) ||
+        strcmp(current->radio.vhtCapab, staged->radio.vhtCapab) ||
+        current->acl.policy != staged->acl.policy ||
+        !same_mac_set(&current->acl.allow, &staged->acl.allow) ||
+        !same_mac_set(&current->acl.deny, &staged->acl.deny) ||
+        current->steering.enabled != staged->steering.enabled)
+        changes |= WIFIAP_CHANGE_HOSTAPD_RELOAD;
+
+    // the PSK of a secured network is derived from the SSID, hostapd must
+    // load it again with the new SSID
+    if (strcmp(current->ssid, staged->ssid))
+        changes |= staged->securityProtocol != WIFI_AP_SECURITY_NONE
+                       ? WIFIAP_CHANGE_HOSTAPD_RELOAD
+                       : WIFIAP_CHANGE_HOSTAPD_SET;
+
+    if (current->discoverable != staged->discoverable ||
+        current->maxNumberClient != staged->maxNumberClient)
+        changes |= WIFIAP_CHANGE_HOSTAPD_SET;
+
+    if (staged->autoChannel == WIFI_AP_AUTO_CHANNEL_OFF &&
+        current->channelNumber != staged->channelNumber)
+        changes |= WIFIAP_CHANGE_CHANNEL;
+
+    if (strcmp(current->ip_start, staged->ip_start) ||
+        strcmp(current->ip_stop, staged->ip_stop) ||
+        !same_string(current->hostName, staged->hostName) ||
+        !same_string(current->domainName, staged->domainName) ||
+        !same_dhcp(current, staged))
+        changes |= WIFIAP_CHANGE_DHCP;
+
+    if (!same_shaping(current, staged))
+        changes |= WIFIAP_CHANGE_SHAPING;
+
+    if (current->steering.enabled != staged->steering.enabled ||
+        !same_steering(current, staged))
+        changes |= WIFIAP_CHANGE_STEERING;
+
+    return changes;
+}
+
+/*******************************************************************************
+ *     Exchange the settings of two configurations                             *
+ *                                                                             *
+ * The status of each configuration is kept. The strings that did not          *
+ * change keep their allocation, so that the pointers given to threads stay    *
+ * valid. The channel selected automatically is kept too when the staged       *
+ * configuration still selects it.                                             *
+ ******************************************************************************/
+static void keep_same_string(char **current, char **staged)
+{
+    char *tmp;
+
+    if (same_string(*current, *staged)) {
+        tmp = *current;
+        *current = *staged;
+        *staged = tmp;
+    }
+}
+
+void swapWifiApData(wifiApT *current, wifiApT *staged)
+{
+    const char *currentStatus = current->status;
+    const char *stagedStatus = staged->status;
+    uint16_t channel = current->channelNumber;
+    wifiApT tmp;
+
+    memcpy(&tmp, current, sizeof(tmp));
+    memcpy(current, staged, sizeof(*current));
+    memcpy(staged, &tmp, sizeof(*staged));
+
+    current->status = currentStatus;
+    staged->status = stagedStatus;
+    keep_same_string(&current->interfaceName, &staged->interfaceName);
+    keep_same_string(&current->domainName, &staged->domainName);
+    keep_same_string(&current->hostName, &staged->hostName);
+    if (current->autoChannel != WIFI_AP_AUTO_CHANNEL_OFF &&
+        current->autoChannel == staged->autoChannel)
+        current->channelNumber = channel;
+}
+
 /*******************************************************************************
  *     Set the host name                                                       *
  * @return                                                                     *
@@ -117,7 +403,15 @@ int setDomainNameParameter(wifiApT *wifiApData, const char *domainName)
  ******************************************************************************/
 int setInterfaceNameParameter(wifiApT *wifiApData, const char *interfaceName)
 {
-    return set_string_copy(&wifiApData->interfaceName, interfaceName);
+    int rc = set_string_copy(&wifiApData->interfaceName, interfaceName);
+
+    // the settings are checked against the static tables without capabilities
+    if (rc == WIFIAP_NO_ERROR &&
+        loadRadioCapabilities(interfaceName,
+                              &wifiApData->radioCapabilities) != 0)
+        AFB_WARNING("No nl80211 capabilities for %s, using static tables",
+                    interfaceName);
+    return rc;
 }
 
 /*******************************************************************************
@@ -133,8 +427,78 @@ int setSsidParameter(wifiApT *wifiApData, const char *ssid)
     return set_buffer(wifiApData->ssid, ssid, MIN_SSID_LENGTH, MAX_SSID_LENGTH);
 }
 
+/*******************************************************************************
+ *   get the radio band of the hardware mode of an IEEE standard mask          *
+ * @return                                                                     *
+ *     * the band (WIFI_AP_BAND_*)                                             *
+ *     * -1 if no hardware mode is set                                         *
+ ******************************************************************************/
+static int get_band(uint32_t stdMask)
+{
+    switch (stdMask & HARDWARE_MODE_MASK) {
+    case WIFI_AP_BITMASK_IEEE_STD_A:
+        return WIFI_AP_BAND_5GHZ;
+    case WIFI_AP_BITMASK_IEEE_STD_B:
+    case WIFI_AP_BITMASK_IEEE_STD_G:
+        return WIFI_AP_BAND_2GHZ;
+    case WIFI_AP_BITMASK_IEEE_STD_AD:
+        return WIFI_AP_BAND_60GHZ;
+    default:
+        return -1;
+    }
+}
+
+/*******************************************************************************
+ *   find a frequency in the channels of the radio                             *
+ * @return                                                                     *
+ *     * the channel of the radio                                              *
+ *     * NULL if the radio does not have this frequency                        *
+ ******************************************************************************/
+const wifiAp_RadioChannel_t *findRadioChannel(
+    const wifiAp_RadioCapabilities_t *capabilities,
+    uint32_t frequency)
+{
+    for (uint32_t i = 0; i < capabilities->channelCount; i++) {
+        if (capabilities->channels[i].frequency == frequency)
+            return &capabilities->channels[i];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ *   check that the radio can operate an access point on a 20 MHz channel      *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_UNSUPPORTED if the radio or the regulatory domain        *
+ *       does not allow the channel                                            *
+ *     * WIFIAP_ERROR_STD_H if the channel needs radar detection (802.11h)     *
+ *     * WIFIAP_NO_ERROR if the channel can be used                            *
+ ******************************************************************************/
+static int check_radio_channel(const wifiApT *wifiApData, uint16_t channel)
+{
+    const wifiAp_RadioChannel_t *radioChannel =
+        findRadioChannel(&wifiApData->radioCapabilities,
+                         channelToFrequency(channel, wifiApData->IeeeStdMask));
+
+    if (radioChannel == NULL || radioChannel->disabled)
+        return WIFIAP_ERROR_UNSUPPORTED;
+
+    // DFS channels are no-IR until hostapd has checked there is no radar
+    if (radioChannel->radar)
+        return (wifiApData->IeeeStdMask & WIFI_AP_BITMASK_IEEE_STD_H) != 0
+                   ? WIFIAP_NO_ERROR
+                   : WIFIAP_ERROR_STD_H;
+
+    return radioChannel->noIr ? WIFIAP_ERROR_UNSUPPORTED : WIFIAP_NO_ERROR;
+}
+
 /*******************************************************************************
  *               set the number of wifi access point channel                   *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL or WIFIAP_ERROR_TOO_LARGE if the channel is    *
+ *       out of the range of the hardware mode                                 *
+ *     * WIFIAP_ERROR_UNSUPPORTED or WIFIAP_ERROR_STD_H if the radio does not  *
+ *       allow the channel                                                     *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
  ******************************************************************************/
 int setChannelParameter(wifiApT *wifiApData, uint32_t channelNumber)
 {
@@ -164,16 +528,237 @@ int setChannelParameter(wifiApT *wifiApData, uint32_t channelNumber)
     if (channelNumber > (int)wifiApData->channel.MAX_CHANNEL_VALUE)
         return WIFIAP_ERROR_TOO_LARGE;
 
+    if (wifiApData->radioCapabilities.valid) {
+        int rc = check_radio_channel(wifiApData, (uint16_t)channelNumber);
+        if (rc != WIFIAP_NO_ERROR)
+            return rc;
+    }
+
     wifiApData->channelNumber = (uint16_t)channelNumber;
     return WIFIAP_NO_ERROR;
 }
 
+/*******************************************************************************
+ *               set the automatic channel selection mode                      *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if autoChannel is invalid                        *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setAutoChannelParameter(wifiApT *wifiApData, const char *autoChannel)
+{
+    if (autoChannel == NULL)
+        return WIFIAP_ERROR_INVALID;
+
+    if (!strcasecmp(autoChannel, "off"))
+        wifiApData->autoChannel = WIFI_AP_AUTO_CHANNEL_OFF;
+    else if (!strcasecmp(autoChannel, "acs_survey"))
+        wifiApData->autoChannel = WIFI_AP_AUTO_CHANNEL_HOSTAPD;
+    else if (!strcasecmp(autoChannel, "survey"))
+        wifiApData->autoChannel = WIFI_AP_AUTO_CHANNEL_SURVEY;
+    else
+        return WIFIAP_ERROR_INVALID;
+
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *   get the position of the secondary 20 MHz channel for HT40                 *
+ * @return                                                                     *
+ *     * 1 if the secondary channel is above (HT40+)                           *
+ *     * -1 if the secondary channel is below (HT40-)                          *
+ *     * 0 if 40 MHz operation is not possible on this channel                 *
+ ******************************************************************************/
+int getHt40SecondaryOffset(uint32_t stdMask, uint16_t channel)
+{
+    switch (stdMask & HARDWARE_MODE_MASK) {
+    case WIFI_AP_BITMASK_IEEE_STD_B:
+    case WIFI_AP_BITMASK_IEEE_STD_G:
+        if (channel >= 1 && channel <= 7)
+            return 1;
+        if (channel >= 8 && channel <= 13)
+            return -1;
+        return 0;
+    case WIFI_AP_BITMASK_IEEE_STD_A:
+        // 40 MHz channels are bonded by pairs: 36+40, 44+48, ... 157+161
+        if (channel >= 36 && channel <= 144 && (channel % 4) == 0)
+            return (((channel - 36) / 4) % 2) == 0 ? 1 : -1;
+        if (channel >= 149 && channel <= 161 && (channel % 4) == 1)
+            return (((channel - 149) / 4) % 2) == 0 ? 1 : -1;
+        return 0;
+    default:
+        return 0;
+    }
+}
+
+/*******************************************************************************
+ *   get the center channel of a 80 or 160 MHz 5 GHz channel                   *
+ * @return                                                                     *
+ *     * the center channel index (vht_oper_centr_freq_seg0_idx)               *
+ *     * 0 if the width is not possible on this channel                        *
+ ******************************************************************************/
+uint16_t getVhtCenterChannel(uint16_t channel, uint16_t channelWidth)
+{
+    if (channelWidth == CHANNEL_WIDTH_80) {
+        if (channel >= 36 && channel <= 64 && (channel % 4) == 0)
+            return (uint16_t)(36 + 16 * ((channel - 36) / 16) + 6);
+        if (channel >= 100 && channel <= 144 && (channel % 4) == 0)
+            return (uint16_t)(100 + 16 * ((channel - 100) / 16) + 6);
+        if (channel >= 149 && channel <= 161 && (channel % 4) == 1)
+            return 155;
+    }
+    else if (channelWidth == CHANNEL_WIDTH_160) {
+        if (channel >= 36 && channel <= 64 && (channel % 4) == 0)
+            return 50;
+        if (channel >= 100 && channel <= 128 && (channel % 4) == 0)
+            return 114;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ *   check if a channel width is possible with an IEEE standard and a channel  *
+ *   (channel 0 stands for a channel still to be selected)                     *
+ ******************************************************************************/
+bool isChannelWidthPossible(uint32_t stdMask,
+                            uint16_t channel,
+                            uint16_t channelWidth)
+{
+    switch (channelWidth) {
+    case CHANNEL_WIDTH_20:
+        return true;
+
+    case CHANNEL_WIDTH_40:
+        // 40 MHz needs HT (VHT and HE are built on top of it)
+        return (stdMask & WIFI_AP_BITMASK_IEEE_STD_N) != 0 &&
+               (channel == 0 || getHt40SecondaryOffset(stdMask, channel) != 0);
+
+    case CHANNEL_WIDTH_80:
+    case CHANNEL_WIDTH_160:
+        // 80 and 160 MHz need VHT or HE in the 5 GHz band
+        return (stdMask & WIFI_AP_BITMASK_IEEE_STD_N) != 0 &&
+               (stdMask & (WIFI_AP_BITMASK_IEEE_STD_AC |
+                           WIFI_AP_BITMASK_IEEE_STD_AX)) != 0 &&
+               (channel == 0 ||
+                (getHt40SecondaryOffset(stdMask, channel) != 0 &&
+                 getVhtCenterChannel(channel, channelWidth) != 0));
+
+    default:
+        return false;
+    }
+}
+
+/*******************************************************************************
+ *   get the 20 MHz channels covered by a channel of a given width             *
+ * @return                                                                     *
+ *     * the number of channels written in channels                            *
+ *     * 0 if the width is not possible on this channel                        *
+ ******************************************************************************/
+unsigned getCoveredChannels(uint32_t stdMask,
+                            uint16_t channel,
+                            uint16_t channelWidth,
+                            uint16_t channels[MAX_COVERED_CHANNELS])
+{
+    unsigned count = 0;
+
+    if (!isChannelWidthPossible(stdMask, channel, channelWidth))
+        return 0;
+
+    if (channelWidth == CHANNEL_WIDTH_20) {
+        channels[count++] = channel;
+    }
+    else if (channelWidth == CHANNEL_WIDTH_40) {
+        channels[count++] = channel;
+        channels[count++] = (uint16_t)(
+            channel + 4 * getHt40SecondaryOffset(stdMask, channel));
+    }
+    else {
+        unsigned width = channelWidth / CHANNEL_WIDTH_20;
+        uint16_t first = (uint16_t)(getVhtCenterChannel(channel, channelWidth) -
+                                    2 * (width - 1));
+
+        while (count < width) {
+            channels[count] = (uint16_t)(first + 4 * count);
+            count++;
+        }
+    }
+    return count;
+}
+
+/*******************************************************************************
+ *   check a channel and a channel width against the IEEE standard and the     *
+ *   capabilities of the radio (channel 0 stands for a channel still to be     *
+ *   selected)                                                                 *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_WIDTH if the width is not possible                       *
+ *     * WIFIAP_ERROR_UNSUPPORTED if a covered channel is not allowed          *
+ *     * WIFIAP_ERROR_STD_H if a covered channel needs radar detection         *
+ *     * WIFIAP_NO_ERROR if the settings are possible                          *
+ ******************************************************************************/
+int checkChannelSettings(const wifiApT *wifiApData,
+                         uint16_t channel,
+                         uint16_t channelWidth)
+{
+    const wifiAp_RadioCapabilities_t *capabilities =
+        &wifiApData->radioCapabilities;
+    uint32_t stdMask = wifiApData->IeeeStdMask;
+    uint16_t channels[MAX_COVERED_CHANNELS];
+    unsigned count;
+    int band = get_band(stdMask);
+
+    if (!isChannelWidthPossible(stdMask, channel, channelWidth))
+        return WIFIAP_ERROR_WIDTH;
+
+    if (!capabilities->valid || band < 0)
+        return WIFIAP_NO_ERROR;
+
+    // the radio must support the width
+    if (channelWidth >= CHANNEL_WIDTH_40 &&
+        (capabilities->bands[band].htCapa & HT_CAPA_SUP_WIDTH_20_40) == 0)
+        return WIFIAP_ERROR_WIDTH;
+    if (channelWidth >= CHANNEL_WIDTH_80 && !capabilities->bands[band].vht &&
+        !capabilities->bands[band].he)
+        return WIFIAP_ERROR_WIDTH;
+    if (channelWidth == CHANNEL_WIDTH_160 &&
+        (capabilities->bands[band].vhtCapa & VHT_CAPA_SUP_WIDTH_MASK) == 0)
+        return WIFIAP_ERROR_WIDTH;
+
+    if (channel == 0)
+        return WIFIAP_NO_ERROR;
+
+    // and all the covered channels
+    count = getCoveredChannels(stdMask, channel, channelWidth, channels);
+    for (unsigned i = 0; i < count; i++) {
+        int rc = check_radio_channel(wifiApData, channels[i]);
+        if (rc != WIFIAP_NO_ERROR)
+            return rc;
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *   check the channel width against the IEEE standard and the channel         *
+ * @return                                                                     *
+ *     * the result of checkChannelSettings for the configured channel         *
+ ******************************************************************************/
+int checkChannelWidth(const wifiApT *wifiApData)
+{
+    // hostapd selects the channel itself with acs_survey
+    uint16_t channel = wifiApData->autoChannel == WIFI_AP_AUTO_CHANNEL_HOSTAPD
+                           ? 0
+                           : wifiApData->channelNumber;
+
+    return checkChannelSettings(wifiApData, channel,
+                                wifiApData->radio.channelWidth);
+}
+
 /*******************************************************************************
  *           set the IEEE standard to use for the access point                 *
  * @return
  *     - WIFIAP_NO_ERROR no error
  *     - WIFIAP_ERROR_NO_HARD no hardware bit set
  *     - WIFIAP_ERROR_MANY_HARD more than one hardware bit set
+ *     - WIFIAP_ERROR_UNSUPPORTED the radio does not support the standards
+ *     - WIFIAP_ERROR_PMF IEEE 802.11w removed while WPA3 is used
  ******************************************************************************/
 
 int setIeeeStandardParameter(wifiApT *wifiApData, uint32_t stdMask)
@@ -200,6 +785,33 @@ int setIeeeStandardParameter(wifiApT *wifiApData, uint32_t stdMask)
         (stdMask & WIFI_AP_BITMASK_IEEE_STD_D) == 0)
         return WIFIAP_ERROR_STD_H;
 
+    // HT, VHT and HE need WMM
+    if ((stdMask & (WIFI_AP_BITMASK_IEEE_STD_N | WIFI_AP_BITMASK_IEEE_STD_AC |
+                    WIFI_AP_BITMASK_IEEE_STD_AX)) != 0 &&
+        !wifiApData->radio.wmmEnabled)
+        return WIFIAP_ERROR_WMM;
+
+    // WPA3 (SAE) needs the protected management frames
+    if ((stdMask & WIFI_AP_BITMASK_IEEE_STD_W) == 0 &&
+        isSaeSecurityProtocol(wifiApData->securityProtocol))
+        return WIFIAP_ERROR_PMF;
+
+    // The radio must support the band and the standards
+    if (wifiApData->radioCapabilities.valid) {
+        int band = get_band(stdMask);
+        const wifiAp_RadioCapabilities_t *capabilities =
+            &wifiApData->radioCapabilities;
+
+        if (!capabilities->bands[band].present ||
+            ((stdMask & WIFI_AP_BITMASK_IEEE_STD_N) != 0 &&
+             !capabilities->bands[band].ht) ||
+            ((stdMask & WIFI_AP_BITMASK_IEEE_STD_AC) != 0 &&
+             !capabilities->bands[band].vht) ||
+            ((stdMask & WIFI_AP_BITMASK_IEEE_STD_AX) != 0 &&
+             !capabilities->bands[band].he))
+            return WIFIAP_ERROR_UNSUPPORTED;
+    }
+
     wifiApData->IeeeStdMask = stdMask;
     return WIFIAP_NO_ERROR;
 }
@@ -220,8 +832,12 @@ int setPassPhraseParameter(wifiApT *wifiApData, const char *passphrase)
 
 /*******************************************************************************
  *                     set access point pre-shared key                         *
+ *                                                                             *
+ * The key is the 256 bits PSK in hexadecimal, an empty string clears it.      *
  * @return                                                                     *
- *     * WIFIAP_ERROR_TOO_LARGE if countryCode is too long                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if preSharedKey is too short                   *
+ *     * WIFIAP_ERROR_TOO_LARGE if preSharedKey is too long                    *
+ *     * WIFIAP_ERROR_INVALID if preSharedKey is not hexadecimal               *
  *     * WIFIAP_NO_ERROR if function succeeded                                 *
  ******************************************************************************/
 int setPreSharedKeyParameter(wifiApT *wifiApData, const char *preSharedKey)
@@ -230,6 +846,10 @@ int setPreSharedKeyParameter(wifiApT *wifiApData, const char *preSharedKey)
 
     if (length > MAX_PSK_LENGTH)
         return WIFIAP_ERROR_TOO_LARGE;
+    if (length != 0 && length < MAX_PSK_LENGTH)
+        return WIFIAP_ERROR_TOO_SMALL;
+    if (strspn(preSharedKey, "0123456789abcdefABCDEF") != length)
+        return WIFIAP_ERROR_INVALID;
 
     // Store PSK to be used later during startup procedure
     utf8_Copy(wifiApData->presharedKey, preSharedKey,
@@ -237,25 +857,61 @@ int setPreSharedKeyParameter(wifiApT *wifiApData, const char *preSharedKey)
     return WIFIAP_NO_ERROR;
 }
 
+/*******************************************************************************
+ *                     names of the security protocols                         *
+ ******************************************************************************/
+static const char *const securityProtocolNames[] = {
+    [WIFI_AP_SECURITY_NONE] = "none",
+    [WIFI_AP_SECURITY_WPA2] = "WPA2",
+    [WIFI_AP_SECURITY_WPA3] = "WPA3",
+    [WIFI_AP_SECURITY_WPA2_WPA3] = "WPA2-WPA3",
+};
+
+const char *getSecurityProtocolName(wifiAp_SecurityProtocol_t securityProtocol)
+{
+    return securityProtocolNames[securityProtocol];
+}
+
+/*******************************************************************************
+ *               tell if a security protocol uses SAE (WPA3)                   *
+ *                                                                             *
+ * SAE needs the protected management frames (IEEE 802.11w).                   *
+ ******************************************************************************/
+bool isSaeSecurityProtocol(wifiAp_SecurityProtocol_t securityProtocol)
+{
+    return securityProtocol == WIFI_AP_SECURITY_WPA3 ||
+           securityProtocol == WIFI_AP_SECURITY_WPA2_WPA3;
+}
+
 /*******************************************************************************
  *                     set access point security protocol                      *
  * @return                                                                     *
  *     * WIFIAP_NO_ERROR if function succeeded                                 *
  *     * WIFIAP_ERROR_INVALID if securityProtocol is invalid                   *
+ *     * WIFIAP_ERROR_PMF if WPA3 is set without the IEEE 802.11w bit          *
  ******************************************************************************/
 int setSecurityProtocolParameter(wifiApT *wifiApData,
                                  const char *securityProtocol)
 {
+    unsigned idx;
+
     if (securityProtocol == NULL)
         return WIFIAP_ERROR_INVALID;
 
-    if (!strcasecmp(securityProtocol, "none"))
-        wifiApData->securityProtocol = WIFI_AP_SECURITY_NONE;
-    else if (!strcasecmp(securityProtocol, "WPA2"))
-        wifiApData->securityProtocol = WIFI_AP_SECURITY_WPA2;
-    else
+    for (idx = 0; idx < sizeof securityProtocolNames /
+                            sizeof *securityProtocolNames;
+         idx++) {
+        if (!strcasecmp(securityProtocol, securityProtocolNames[idx]))
+            break;
+    }
+    if (idx == sizeof securityProtocolNames / sizeof *securityProtocolNames)
         return WIFIAP_ERROR_INVALID;
 
+    if (isSaeSecurityProtocol((wifiAp_SecurityProtocol_t)idx) &&
+        (wifiApData->IeeeStdMask & WIFI_AP_BITMASK_IEEE_STD_W) == 0)
+        return WIFIAP_ERROR_PMF;
+
+    wifiApData->securityProtocol = (wifiAp_SecurityProtocol_t)idx;
     return WIFIAP_NO_ERROR;
 }
 
@@ -396,3 +1052,660 @@ int setIpNetMaskParameter(wifiApT *wifiApData, const char *ip_netmask)
     return set_buffer(wifiApData->ip_netmask, ip_netmask, MIN_IP_ADDRESS_LENGTH,
                       MAX_IP_ADDRESS_LENGTH);
 }
+
+/*******************************************************************************
+ *     Set the beacon interval (in Time Units)                                 *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if beacon interval is too small                *
+ *     * WIFIAP_ERROR_TOO_LARGE if beacon interval is too large                *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setBeaconIntervalParameter(wifiApT *wifiApData, uint32_t beaconInterval)
+{
+    if (beaconInterval < MIN_BEACON_INTERVAL)
+        return WIFIAP_ERROR_TOO_SMALL;
+    if (beaconInterval > MAX_BEACON_INTERVAL)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    wifiApData->radio.beaconInterval = (uint16_t)beaconInterval;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set the DTIM period (in number of beacons)                              *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if DTIM period is too small                    *
+ *     * WIFIAP_ERROR_TOO_LARGE if DTIM period is too large                    *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setDtimPeriodParameter(wifiApT *wifiApData, uint32_t dtimPeriod)
+{
+    if (dtimPeriod < MIN_DTIM_PERIOD)
+        return WIFIAP_ERROR_TOO_SMALL;
+    if (dtimPeriod > MAX_DTIM_PERIOD)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    wifiApData->radio.dtimPeriod = (uint16_t)dtimPeriod;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set the RTS/CTS threshold (in octets, 2347 disables it)                 *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_LARGE if threshold is too large                      *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setRtsThresholdParameter(wifiApT *wifiApData, uint32_t rtsThreshold)
+{
+    if (rtsThreshold > MAX_RTS_THRESHOLD)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    wifiApData->radio.rtsThreshold = (uint16_t)rtsThreshold;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set the fragmentation threshold (in octets, 2346 disables it)           *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if threshold is too small                      *
+ *     * WIFIAP_ERROR_TOO_LARGE if threshold is too large                      *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setFragmThresholdParameter(wifiApT *wifiApData, uint32_t fragmThreshold)
+{
+    if (fragmThreshold < MIN_FRAGM_THRESHOLD)
+        return WIFIAP_ERROR_TOO_SMALL;
+    if (fragmThreshold > MAX_FRAGM_THRESHOLD)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    wifiApData->radio.fragmThreshold = (uint16_t)fragmThreshold;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set if WMM (QoS) is enabled                                             *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_WMM if WMM is needed by the IEEE standard                *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setWmmEnabledParameter(wifiApT *wifiApData, bool wmmEnabled)
+{
+    if (!wmmEnabled &&
+        (wifiApData->IeeeStdMask &
+         (WIFI_AP_BITMASK_IEEE_STD_N | WIFI_AP_BITMASK_IEEE_STD_AC |
+          WIFI_AP_BITMASK_IEEE_STD_AX)) != 0)
+        return WIFIAP_ERROR_WMM;
+
+    wifiApData->radio.wmmEnabled = wmmEnabled;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set the channel width (20, 40, 80 or 160 MHz)                           *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_WIDTH if the width is not possible with the current      *
+ *       IEEE standard, channel and radio                                      *
+ *     * WIFIAP_ERROR_UNSUPPORTED or WIFIAP_ERROR_STD_H if a covered channel   *
+ *       is not allowed                                                        *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setChannelWidthParameter(wifiApT *wifiApData, uint32_t channelWidth)
+{
+    uint16_t previous = wifiApData->radio.channelWidth;
+    int rc;
+
+    if (channelWidth > CHANNEL_WIDTH_160)
+        return WIFIAP_ERROR_WIDTH;
+
+    wifiApData->radio.channelWidth = (uint16_t)channelWidth;
+    rc = checkChannelWidth(wifiApData);
+    if (rc != WIFIAP_NO_ERROR)
+        wifiApData->radio.channelWidth = previous;
+    return rc;
+}
+
+/*******************************************************************************
+ *     Set the extra HT capabilities (e.g. "[SHORT-GI-20][SHORT-GI-40]")       *
+ *     The [HT40+]/[HT40-] flag is derived from the channel width              *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if capabilities are not a list of [FLAG]         *
+ *     * WIFIAP_ERROR_TOO_LARGE if capabilities are too long                   *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setHtCapabParameter(wifiApT *wifiApData, const char *htCapab)
+{
+    if (htCapab == NULL || !is_valid_capab(htCapab))
+        return WIFIAP_ERROR_INVALID;
+
+    return set_buffer(wifiApData->radio.htCapab, htCapab, 0, MAX_CAPAB_LENGTH);
+}
+
+/*******************************************************************************
+ *     Set the extra VHT capabilities (e.g. "[SHORT-GI-80][RXLDPC]")           *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if capabilities are not a list of [FLAG]         *
+ *     * WIFIAP_ERROR_TOO_LARGE if capabilities are too long                   *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setVhtCapabParameter(wifiApT *wifiApData, const char *vhtCapab)
+{
+    if (vhtCapab == NULL || !is_valid_capab(vhtCapab))
+        return WIFIAP_ERROR_INVALID;
+
+    return set_buffer(wifiApData->radio.vhtCapab, vhtCapab, 0,
+                      MAX_CAPAB_LENGTH);
+}
+
+/*******************************************************************************
+ *     Set the DHCP lease time (in seconds)                                    *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if lease time is below dnsmasq minimum         *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setDhcpLeaseTimeParameter(wifiApT *wifiApData, uint32_t leaseTime)
+{
+    if (leaseTime < MIN_DHCP_LEASE_TIME)
+        return WIFIAP_ERROR_TOO_SMALL;
+
+    wifiApData->dhcp.leaseTime = leaseTime;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set if the DHCP server is the only one on the network                   *
+ * @return                                                                     *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setDhcpAuthoritativeParameter(wifiApT *wifiApData, bool authoritative)
+{
+    wifiApData->dhcp.authoritative = authoritative;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set if the DHCP server answers with rapid commit (2 messages exchange)  *
+ * @return                                                                     *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setDhcpRapidCommitParameter(wifiApT *wifiApData, bool rapidCommit)
+{
+    wifiApData->dhcp.rapidCommit = rapidCommit;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Set the size of the DNS cache (0 disables caching)                      *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_LARGE if cache size is too large                     *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setDnsCacheSizeParameter(wifiApT *wifiApData, uint32_t cacheSize)
+{
+    if (cacheSize > MAX_DNS_CACHE_SIZE)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    wifiApData->dhcp.dnsCacheSize = cacheSize;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Add or replace a static lease (MAC to IP reservation)                   *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if MAC, IP or host name is invalid               *
+ *     * WIFIAP_ERROR_TOO_LARGE if host name is too long                       *
+ *     * WIFIAP_ERROR_FULL if the static lease table is full                   *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int addDhcpStaticLeaseParameter(wifiApT *wifiApData,
+                                const char *mac,
+                                const char *ip,
+                                const char *hostName)
+{
+    struct in_addr addr;
+    wifiAp_DhcpStaticLease_t *lease = NULL;
+    uint32_t idx;
+
+    if (!is_valid_mac(mac) || ip == NULL || inet_pton(AF_INET, ip, &addr) <= 0)
+        return WIFIAP_ERROR_INVALID;
+
+    if (hostName != NULL) {
+        if (strlen(hostName) > MAX_DHCP_HOSTNAME_LENGTH)
+            return WIFIAP_ERROR_TOO_LARGE;
+        for (idx = 0; hostName[idx]; idx++)
+            if (!isalnum((unsigned char)hostName[idx]) && hostName[idx] != '-')
+                return WIFIAP_ERROR_INVALID;
+    }
+
+    for (idx = 0; idx < wifiApData->dhcp.staticLeaseCount; idx++) {
+        if (!strcasecmp(wifiApData->dhcp.staticLeases[idx].mac, mac)) {
+            lease = &wifiApData->dhcp.staticLeases[idx];
+            break;
+        }
+    }
+
+    if (lease == NULL) {
+        if (wifiApData->dhcp.staticLeaseCount >= MAX_DHCP_STATIC_LEASES)
+            return WIFIAP_ERROR_FULL;
+        lease = &wifiApData->dhcp.staticLeases[wifiApData->dhcp
+                                                   .staticLeaseCount++];
+    }
+
+    // MAC addresses are stored in lower case to ease comparisons
+    for (idx = 0; idx <= MAC_ADDRESS_LENGTH; idx++)
+        lease->mac[idx] = (char)tolower((unsigned char)mac[idx]);
+    utf8_Copy(lease->ip, ip, sizeof(lease->ip), NULL);
+    utf8_Copy(lease->hostName, hostName ? hostName : "",
+              sizeof(lease->hostName), NULL);
+
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Remove the static lease of a MAC address                                *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if MAC is invalid                                *
+ *     * WIFIAP_ERROR_NOT_FOUND if no static lease exists for MAC              *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int removeDhcpStaticLeaseParameter(wifiApT *wifiApData, const char *mac)
+{
+    uint32_t idx;
+
+    if (!is_valid_mac(mac))
+        return WIFIAP_ERROR_INVALID;
+
+    for (idx = 0; idx < wifiApData->dhcp.staticLeaseCount; idx++) {
+        if (!strcasecmp(wifiApData->dhcp.staticLeases[idx].mac, mac)) {
+            // keep the table packed by moving the last entry in the hole
+            wifiApData->dhcp.staticLeases[idx] =
+                wifiApData->dhcp
+                    .staticLeases[--wifiApData->dhcp.staticLeaseCount];
+            return WIFIAP_NO_ERROR;
+        }
+    }
+    return WIFIAP_ERROR_NOT_FOUND;
+}
+
+/*******************************************************************************
+ *     Add or replace a DHCP option sent to the clients                        *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if option code or value is too small           *
+ *     * WIFIAP_ERROR_TOO_LARGE if option code or value is too large           *
+ *     * WIFIAP_ERROR_INVALID if value is invalid                              *
+ *     * WIFIAP_ERROR_FULL if the option table is full                         *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setDhcpOptionParameter(wifiApT *wifiApData,
+                           uint32_t code,
+                           const char *value)
+{
+    wifiAp_DhcpOption_t *option = NULL;
+    uint32_t idx;
+    int sts;
+
+    if (code < MIN_DHCP_OPTION_CODE)
+        return WIFIAP_ERROR_TOO_SMALL;
+    if (code > MAX_DHCP_OPTION_CODE)
+        return WIFIAP_ERROR_TOO_LARGE;
+    if (value == NULL || !is_config_safe(value))
+        return WIFIAP_ERROR_INVALID;
+
+    for (idx = 0; idx < wifiApData->dhcp.optionCount; idx++) {
+        if (wifiApData->dhcp.options[idx].code == code) {
+            option = &wifiApData->dhcp.options[idx];
+            break;
+        }
+    }
+
+    if (option == NULL) {
+        if (wifiApData->dhcp.optionCount >= MAX_DHCP_OPTIONS)
+            return WIFIAP_ERROR_FULL;
+        option = &wifiApData->dhcp.options[wifiApData->dhcp.optionCount];
+    }
+
+    sts = set_buffer(option->value, value, 1, MAX_DHCP_OPTION_VALUE_LENGTH);
+    if (sts != WIFIAP_NO_ERROR)
+        return sts;
+
+    if (option == &wifiApData->dhcp.options[wifiApData->dhcp.optionCount])
+        wifiApData->dhcp.optionCount++;
+    option->code = (uint8_t)code;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Remove a DHCP option                                                    *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_NOT_FOUND if option was not set                          *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int removeDhcpOptionParameter(wifiApT *wifiApData, uint32_t code)
+{
+    uint32_t idx;
+
+    for (idx = 0; idx < wifiApData->dhcp.optionCount; idx++) {
+        if (wifiApData->dhcp.options[idx].code == code) {
+            wifiApData->dhcp.options[idx] =
+                wifiApData->dhcp.options[--wifiApData->dhcp.optionCount];
+            return WIFIAP_NO_ERROR;
+        }
+    }
+    return WIFIAP_ERROR_NOT_FOUND;
+}
+
+/*******************************************************************************
+ *     Read a MAC address written as aa:bb:cc:dd:ee:ff                         *
+ * @return                                                                     *
+ *     true if the MAC address is valid                                        *
+ ******************************************************************************/
+bool parseMacAddress(const char *text, uint64_t *mac)
+{
+    if (!is_valid_mac(text))
+        return false;
+
+    *mac = 0;
+    for (int idx = 0; idx < MAC_ADDRESS_LENGTH; idx += 3)
+        *mac = (*mac << 8) | strtoul(&text[idx], NULL, 16);
+    return true;
+}
+
+/*******************************************************************************
+ *     Write a MAC address as aa:bb:cc:dd:ee:ff                                *
+ ******************************************************************************/
+void formatMacAddress(uint64_t mac, char text[MAC_ADDRESS_LENGTH + 1])
+{
+    snprintf(text, MAC_ADDRESS_LENGTH + 1, "%02x:%02x:%02x:%02x:%02x:%02x",
+             (unsigned)(mac >> 40) & 0xff, (unsigned)(mac >> 32) & 0xff,
+             (unsigned)(mac >> 24) & 0xff, (unsigned)(mac >> 16) & 0xff,
+             (unsigned)(mac >> 8) & 0xff, (unsigned)mac & 0xff);
+}
+
+/*******************************************************************************
+ *     first slot of the probe sequence of a MAC address                       *
+ ******************************************************************************/
+static unsigned mac_slot(uint64_t mac)
+{
+    // Fibonacci hashing, MAC_SET_SLOTS is a power of 2
+    return (unsigned)((mac * 0x9E3779B97F4A7C15ULL) >> 32) &
+           (MAC_SET_SLOTS - 1);
+}
+
+/*******************************************************************************
+ *     find the slot of a MAC address                                          *
+ * @return                                                                     *
+ *     the slot, or -1 if not in the set                                       *
+ ******************************************************************************/
+static int find_mac_slot(const wifiAp_MacSet_t *set, uint64_t mac)
+{
+    unsigned slot = mac_slot(mac);
+
+    for (unsigned probe = 0; probe < MAC_SET_SLOTS; probe++) {
+        if (set->slots[slot] == 0)
+            return -1;
+        if (set->slots[slot] == (mac | MAC_SET_PRESENT))
+            return (int)slot;
+        slot = (slot + 1) & (MAC_SET_SLOTS - 1);
+    }
+    return -1;
+}
+
+/*******************************************************************************
+ *     put back the MAC addresses of a set, dropping the removed slots         *
+ ******************************************************************************/
+static void rehash_mac_set(wifiAp_MacSet_t *set)
+{
+    uint64_t macs[MAX_MAC_ACL_ENTRIES];
+    uint32_t count = 0;
+
+    for (unsigned slot = 0; slot < MAC_SET_SLOTS; slot++) {
+        if (getMacSetEntry(set, slot, &macs[count]))
+            count++;
+    }
+    memset(set, 0, sizeof(*set));
+    while (count > 0)
+        addMacSet(set, macs[--count]);
+}
+
+/*******************************************************************************
+ *     Add a MAC address to a set                                              *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_FULL if the set has MAX_MAC_ACL_ENTRIES addresses        *
+ *     * WIFIAP_NO_ERROR if function succeeded (or already in the set)         *
+ ******************************************************************************/
+int addMacSet(wifiAp_MacSet_t *set, uint64_t mac)
+{
+    unsigned slot;
+
+    if (find_mac_slot(set, mac) >= 0)
+        return WIFIAP_NO_ERROR;
+    if (set->count >= MAX_MAC_ACL_ENTRIES)
+        return WIFIAP_ERROR_FULL;
+
+    // the removed slots lengthen the probes, clean them when too many
+    if (set->used >= MAC_SET_SLOTS * 3 / 4)
+        rehash_mac_set(set);
+
+    slot = mac_slot(mac);
+    while (set->slots[slot] != 0 && set->slots[slot] != MAC_SET_REMOVED)
+        slot = (slot + 1) & (MAC_SET_SLOTS - 1);
+    if (set->slots[slot] == 0)
+        set->used++;
+    set->slots[slot] = mac | MAC_SET_PRESENT;
+    set->count++;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Remove a MAC address from a set                                         *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_NOT_FOUND if the MAC address is not in the set           *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int removeMacSet(wifiAp_MacSet_t *set, uint64_t mac)
+{
+    int slot = find_mac_slot(set, mac);
+
+    if (slot < 0)
+        return WIFIAP_ERROR_NOT_FOUND;
+
+    // the slot stays used so that the probes continue past it
+    set->slots[slot] = MAC_SET_REMOVED;
+    set->count--;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     Check if a MAC address is in a set                                      *
+ ******************************************************************************/
+bool containsMacSet(const wifiAp_MacSet_t *set, uint64_t mac)
+{
+    return find_mac_slot(set, mac) >= 0;
+}
+
+/*******************************************************************************
+ *     Get the MAC address of a slot of a set, to walk through the set         *
+ * @return                                                                     *
+ *     true if the slot holds a MAC address                                    *
+ ******************************************************************************/
+bool getMacSetEntry(const wifiAp_MacSet_t *set, unsigned slot, uint64_t *mac)
+{
+    if (slot >= MAC_SET_SLOTS || (set->slots[slot] & MAC_SET_PRESENT) == 0)
+        return false;
+    *mac = set->slots[slot] & ~MAC_SET_PRESENT;
+    return true;
+}
+
+/*******************************************************************************
+ *     Set the MAC access control policy ("deny" or "allow")                   *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if the policy is unknown                         *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setMacAclPolicyParameter(wifiApT *wifiApData, const char *policy)
+{
+    if (policy == NULL)
+        return WIFIAP_ERROR_INVALID;
+
+    if (!strcasecmp(policy, "deny"))
+        wifiApData->acl.policy = WIFI_AP_MAC_ACL_DENY;
+    else if (!strcasecmp(policy, "allow"))
+        wifiApData->acl.policy = WIFI_AP_MAC_ACL_ALLOW;
+    else
+        return WIFIAP_ERROR_INVALID;
+
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     get the MAC set of an access control list ("allow" or "deny")           *
+ ******************************************************************************/
+static wifiAp_MacSet_t *get_acl_set(wifiApT *wifiApData, const char *list)
+{
+    if (list == NULL)
+        return NULL;
+    if (!strcasecmp(list, "allow"))
+        return &wifiApData->acl.allow;
+    if (!strcasecmp(list, "deny"))
+        return &wifiApData->acl.deny;
+    return NULL;
+}
+
+/*******************************************************************************
+ *     Add a MAC address to an access control list ("allow" or "deny")         *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if the list or the MAC address is invalid        *
+ *     * WIFIAP_ERROR_FULL if the list has MAX_MAC_ACL_ENTRIES addresses       *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int addMacAclParameter(wifiApT *wifiApData, const char *list, const char *mac)
+{
+    wifiAp_MacSet_t *set = get_acl_set(wifiApData, list);
+    uint64_t value;
+
+    if (set == NULL || !parseMacAddress(mac, &value))
+        return WIFIAP_ERROR_INVALID;
+    return addMacSet(set, value);
+}
+
+/*******************************************************************************
+ *     Remove a MAC address from an access control list ("allow" or "deny")    *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if the list or the MAC address is invalid        *
+ *     * WIFIAP_ERROR_NOT_FOUND if the MAC address is not in the list          *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int removeMacAclParameter(wifiApT *wifiApData,
+                          const char *list,
+                          const char *mac)
+{
+    wifiAp_MacSet_t *set = get_acl_set(wifiApData, list);
+    uint64_t value;
+
+    if (set == NULL || !parseMacAddress(mac, &value))
+        return WIFIAP_ERROR_INVALID;
+    return removeMacSet(set, value);
+}
+
+/*******************************************************************************
+ *     Set the bandwidth limit of a station, or of the access point when mac   *
+ *     is NULL (kbit/s, 0 removes the limit)                                   *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_INVALID if the MAC address is invalid                    *
+ *     * WIFIAP_ERROR_TOO_LARGE if the rate is above MAX_RATE_LIMIT            *
+ *     * WIFIAP_ERROR_FULL if MAX_STATION_LIMITS stations are limited          *
+ *     * WIFIAP_ERROR_NOT_FOUND if the station to unlimit has no limit         *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setRateLimitParameter(wifiApT *wifiApData, const char *mac, uint32_t kbps)
+{
+    wifiAp_StationLimit_t *limit = NULL;
+    uint32_t idx;
+
+    if (kbps > MAX_RATE_LIMIT)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    if (mac == NULL) {
+        wifiApData->shaping.ssidKbps = kbps;
+        return WIFIAP_NO_ERROR;
+    }
+    if (!is_valid_mac(mac))
+        return WIFIAP_ERROR_INVALID;
+
+    for (idx = 0; idx < wifiApData->shaping.stationCount; idx++) {
+        if (!strcasecmp(wifiApData->shaping.stations[idx].mac, mac)) {
+            limit = &wifiApData->shaping.stations[idx];
+            break;
+        }
+    }
+
+    if (kbps == 0) {
+        if (limit == NULL)
+            return WIFIAP_ERROR_NOT_FOUND;
+        // keep the table packed by moving the last entry in the hole
+        *limit =
+            wifiApData->shaping.stations[--wifiApData->shaping.stationCount];
+        return WIFIAP_NO_ERROR;
+    }
+
+    if (limit == NULL) {
+        if (wifiApData->shaping.stationCount >= MAX_STATION_LIMITS)
+            return WIFIAP_ERROR_FULL;
+        limit = &wifiApData->shaping.stations[wifiApData->shaping
+                                                  .stationCount++];
+    }
+
+    // MAC addresses are stored in lower case to ease comparisons
+    for (idx = 0; idx <= MAC_ADDRESS_LENGTH; idx++)
+        limit->mac[idx] = (char)tolower((unsigned char)mac[idx]);
+    limit->kbps = kbps;
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *     check a neighbor of the band steering                                   *
+ *                                                                             *
+ * The format is the one of the neighbor reports of hostapd:                   *
+ * "<bssid>,<bssid info>,<op class>,<channel>,<phy type>", the numbers but     *
+ * the channel in hexadecimal, e.g. "02:00:00:00:05:00,0x0000,115,36,9".       *
+ ******************************************************************************/
+static bool is_valid_neighbor(const char *neighbor)
+{
+    char bssid[MAC_ADDRESS_LENGTH + 1];
+    unsigned info, opClass, channel, phyType;
+    int length = 0;
+
+    return strlen(neighbor) <= STEERING_NEIGHBOR_LENGTH &&
+           sscanf(neighbor, "%17[0-9a-fA-F:],%x,%u,%u,%u%n", bssid, &info,
+                  &opClass, &channel, &phyType, &length) == 5 &&
+           neighbor[length] == '\0' && is_valid_mac(bssid) &&
+           opClass <= UINT8_MAX && channel <= UINT8_MAX && phyType <= UINT8_MAX;
+}
+
+/*******************************************************************************
+ *     Set the band steering settings                                          *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_TOO_SMALL if the interval is below                       *
+ *       MIN_STEERING_INTERVAL_MS or the signal below MIN_STEERING_SIGNAL      *
+ *     * WIFIAP_ERROR_TOO_LARGE if the signal is positive or the timer above   *
+ *       MAX_DISASSOC_TIMER                                                    *
+ *     * WIFIAP_ERROR_INVALID if a neighbor is invalid                         *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int setSteeringParameter(wifiApT *wifiApData, const wifiAp_Steering_t *steering)
+{
+    if (steering->intervalMs < MIN_STEERING_INTERVAL_MS ||
+        steering->minSignal < MIN_STEERING_SIGNAL)
+        return WIFIAP_ERROR_TOO_SMALL;
+    if (steering->minSignal > 0 ||
+        steering->disassocTimer > MAX_DISASSOC_TIMER ||
+        steering->neighborCount > MAX_STEERING_NEIGHBORS)
+        return WIFIAP_ERROR_TOO_LARGE;
+
+    for (uint32_t idx = 0; idx < steering->neighborCount; idx++) {
+        if (!is_valid_neighbor(steering->neighbors[idx]))
+            return WIFIAP_ERROR_INVALID;
+    }
+
+    wifiApData->steering = *steering;
+    return WIFIAP_NO_ERROR;
+}
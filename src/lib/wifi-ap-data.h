@@ -60,6 +60,29 @@
 // length of country code
 #define ISO_COUNTRYCODE_LENGTH 2
 
+// hostapd radio definitions (intervals in Time Units of 1.024 ms)
+#define DEFAULT_BEACON_INTERVAL 100
+#define MIN_BEACON_INTERVAL     15
+#define MAX_BEACON_INTERVAL     65535
+#define DEFAULT_DTIM_PERIOD     2
+#define MIN_DTIM_PERIOD         1
+#define MAX_DTIM_PERIOD         255
+#define DEFAULT_RTS_THRESHOLD   2347  ///< greater than MPDU size: disabled
+#define MAX_RTS_THRESHOLD       65535
+#define DEFAULT_FRAGM_THRESHOLD 2346  ///< max MPDU size: disabled
+#define MIN_FRAGM_THRESHOLD     256
+#define MAX_FRAGM_THRESHOLD     2346
+#define MAX_CAPAB_LENGTH        255
+
+// channel widths in MHz
+#define CHANNEL_WIDTH_20  20
+#define CHANNEL_WIDTH_40  40
+#define CHANNEL_WIDTH_80  80
+#define CHANNEL_WIDTH_160 160
+
+// max number of 20 MHz channels covered by a channel (160 MHz)
+#define MAX_COVERED_CHANNELS 8
+
 // Max number of users allowed
 #define WIFI_AP_MAX_USERS 1000
 
@@ -70,14 +93,163 @@
 #define MIN_IP_ADDRESS_LENGTH 1
 #define MAX_IP_ADDRESS_LENGTH 15
 
+// length of a MAC address (aa:bb:cc:dd:ee:ff)
+#define MAC_ADDRESS_LENGTH 17
+
+// DHCP server definitions
+#define DEFAULT_DHCP_LEASE_TIME      86400  ///< 24 hours, in seconds
+#define MIN_DHCP_LEASE_TIME          120    ///< dnsmasq minimum, in seconds
+#define MAX_DHCP_STATIC_LEASES       64
+#define MAX_DHCP_OPTIONS             16
+#define MIN_DHCP_OPTION_CODE         1
+#define MAX_DHCP_OPTION_CODE         254
+#define MAX_DHCP_OPTION_VALUE_LENGTH 127
+#define MAX_DHCP_HOSTNAME_LENGTH     63
+#define DEFAULT_DNS_CACHE_SIZE       150
+#define MAX_DNS_CACHE_SIZE           10000
+
+// MAC access control lists (hashed sets, open addressing)
+#define MAX_MAC_ACL_ENTRIES 256
+#define MAC_SET_SLOTS       512  ///< power of 2, twice MAX_MAC_ACL_ENTRIES
+
+// traffic shaping definitions (rates in kbit/s, 0 means no limit)
+#define MAX_STATION_LIMITS 64
+#define MAX_RATE_LIMIT     10000000  ///< 10 Gbit/s
+
+// band steering definitions (802.11v BSS transition management)
+#define MAX_STEERING_NEIGHBORS       4
+#define STEERING_NEIGHBOR_LENGTH     63
+#define DEFAULT_STEERING_INTERVAL_MS 5000
+#define MIN_STEERING_INTERVAL_MS     500
+#define DEFAULT_STEERING_COOLDOWN_MS 60000
+#define MIN_STEERING_SIGNAL          -100  ///< dBm
+#define MAX_DISASSOC_TIMER           65535  ///< beacons
+
+// radio bands (same values as enum nl80211_band)
+#define WIFI_AP_BAND_2GHZ  0
+#define WIFI_AP_BAND_5GHZ  1
+#define WIFI_AP_BAND_60GHZ 2
+#define WIFI_AP_BAND_6GHZ  3
+#define WIFI_AP_BAND_COUNT 4
+
+// max number of channels cached from the radio capabilities
+#define MAX_RADIO_CHANNELS 160
+
+// capability bits reported by the radio
+#define HT_CAPA_SUP_WIDTH_20_40 0x0002  ///< HT capabilities: 40 MHz
+#define VHT_CAPA_SUP_WIDTH_MASK 0x000C  ///< VHT capabilities: 160 MHz
+
 typedef enum {
     WIFI_AP_SECURITY_NONE = 0,
     ///< WiFi Access Point is open and has no password.
 
-    WIFI_AP_SECURITY_WPA2 = 1
+    WIFI_AP_SECURITY_WPA2 = 1,
     ///< WiFi Access Point has WPA2 activated.
+
+    WIFI_AP_SECURITY_WPA3 = 2,
+    ///< WiFi Access Point has WPA3 (SAE) activated, PMF is required.
+
+    WIFI_AP_SECURITY_WPA2_WPA3 = 3
+    ///< WiFi Access Point accepts WPA2 (PSK) and WPA3 (SAE) clients.
 } wifiAp_SecurityProtocol_t;
 
+typedef enum {
+    WIFI_AP_AUTO_CHANNEL_OFF = 0,
+    ///< The configured channel is used as is.
+
+    WIFI_AP_AUTO_CHANNEL_HOSTAPD = 1,
+    ///< hostapd picks the channel itself (channel=acs_survey).
+
+    WIFI_AP_AUTO_CHANNEL_SURVEY = 2
+    ///< The binding picks the channel from its own survey scorer.
+} wifiAp_AutoChannel_t;
+
+typedef enum {
+    WIFI_AP_MAC_ACL_DENY = 0,
+    ///< Every station but the ones of the deny list (macaddr_acl=0).
+
+    WIFI_AP_MAC_ACL_ALLOW = 1
+    ///< Only the stations of the allow list (macaddr_acl=1).
+} wifiAp_MacAclPolicy_t;
+
+// Set of MAC addresses: a slot holds the 48 bits of a MAC with the
+// MAC_SET_PRESENT bit, 0 when free or MAC_SET_REMOVED once removed
+#define MAC_SET_PRESENT 0x1000000000000ULL
+#define MAC_SET_REMOVED 0x2000000000000ULL
+typedef struct
+{
+    uint32_t count;  ///< MAC addresses in the set
+    uint32_t used;   ///< slots not free (present or removed)
+    uint64_t slots[MAC_SET_SLOTS];
+} wifiAp_MacSet_t;
+
+// Bandwidth limit of a station
+typedef struct
+{
+    char mac[MAC_ADDRESS_LENGTH + 1];
+    uint32_t kbps;
+} wifiAp_StationLimit_t;
+
+// Band steering: the stations are asked to move to the neighbors (BSSs of
+// the other radios) when this one is overloaded or their signal is too low
+typedef struct
+{
+    bool enabled;
+    uint32_t intervalMs;     ///< period of the evaluation of the stations
+    uint32_t maxClients;     ///< stations above it are moved (0: no limit)
+    int32_t minSignal;       ///< stations below it (dBm) are moved (0: none)
+    uint32_t cooldownMs;     ///< time before asking a station again
+    uint32_t disassocTimer;  ///< beacons before disassociation (0: none)
+    uint32_t neighborCount;
+    char neighbors[MAX_STEERING_NEIGHBORS][STEERING_NEIGHBOR_LENGTH + 1];
+    ///< "<bssid>,<bssid info>,<op class>,<channel>,<phy type>"
+} wifiAp_Steering_t;
+
+// DHCP static lease (MAC to IP reservation)
+typedef struct
+{
+    char mac[MAC_ADDRESS_LENGTH + 1];
+    char ip[MAX_IP_ADDRESS_LENGTH + 1];
+    char hostName[MAX_DHCP_HOSTNAME_LENGTH + 1];  ///< optional, may be empty
+} wifiAp_DhcpStaticLease_t;
+
+// DHCP option sent to the clients
+typedef struct
+{
+    uint8_t code;
+    char value[MAX_DHCP_OPTION_VALUE_LENGTH + 1];
+} wifiAp_DhcpOption_t;
+
+// Channel of the radio (as reported by nl80211 for the regulatory domain)
+typedef struct
+{
+    uint32_t frequency;  ///< frequency in MHz
+    uint16_t channel;
+    uint8_t band;      ///< WIFI_AP_BAND_*
+    bool disabled;     ///< not allowed at all
+    bool noIr;         ///< no initiating radiation (no beaconing)
+    bool radar;        ///< DFS: radar detection needed
+    uint32_t maxPower;  ///< max TX power in mBm
+} wifiAp_RadioChannel_t;
+
+// Capabilities of the radio of the interface, read once from nl80211
+typedef struct
+{
+    bool valid;  ///< false when nl80211 could not be queried
+    uint32_t wiphy;
+    struct
+    {
+        bool present;
+        bool ht;
+        uint16_t htCapa;
+        bool vht;
+        uint32_t vhtCapa;
+        bool he;
+    } bands[WIFI_AP_BAND_COUNT];
+    uint32_t channelCount;
+    wifiAp_RadioChannel_t channels[MAX_RADIO_CHANNELS];
+} wifiAp_RadioCapabilities_t;
+
 // Structure to store WiFi access point data
 typedef struct wifiApT_
 {
@@ -103,19 +275,86 @@ typedef struct wifiApT_
     bool discoverable;
     uint32_t IeeeStdMask;
     uint16_t channelNumber;
+    wifiAp_AutoChannel_t autoChannel;
     uint32_t maxNumberClient;
     wifiAp_SecurityProtocol_t securityProtocol;
+
+    struct
+    {
+        uint16_t beaconInterval;
+        uint16_t dtimPeriod;
+        uint16_t rtsThreshold;
+        uint16_t fragmThreshold;
+        bool wmmEnabled;
+        uint16_t channelWidth;  ///< 20, 40, 80 or 160 MHz
+        char htCapab[MAX_CAPAB_LENGTH + 1];   ///< extra ht_capab flags
+        char vhtCapab[MAX_CAPAB_LENGTH + 1];  ///< extra vht_capab flags
+    } radio;
+
+    struct
+    {
+        uint32_t leaseTime;     ///< lease time in seconds
+        bool authoritative;     ///< dnsmasq dhcp-authoritative
+        bool rapidCommit;       ///< dnsmasq dhcp-rapid-commit
+        uint32_t dnsCacheSize;  ///< dnsmasq cache-size, 0 disables caching
+        uint32_t staticLeaseCount;
+        wifiAp_DhcpStaticLease_t staticLeases[MAX_DHCP_STATIC_LEASES];
+        uint32_t optionCount;
+        wifiAp_DhcpOption_t options[MAX_DHCP_OPTIONS];
+    } dhcp;
+
+    struct
+    {
+        wifiAp_MacAclPolicy_t policy;
+        wifiAp_MacSet_t allow;
+        wifiAp_MacSet_t deny;
+    } acl;
+
+    struct
+    {
+        uint32_t ssidKbps;  ///< limit of the whole access point
+        uint32_t stationCount;
+        wifiAp_StationLimit_t stations[MAX_STATION_LIMITS];
+    } shaping;
+
+    wifiAp_Steering_t steering;
+
+    wifiAp_RadioCapabilities_t radioCapabilities;
 } wifiApT;
 
-#define WIFIAP_NO_ERROR        0
-#define WIFIAP_ERROR_INVALID   -1
-#define WIFIAP_ERROR_OOM       -2
-#define WIFIAP_ERROR_TOO_SMALL -3
-#define WIFIAP_ERROR_TOO_LARGE -4
-#define WIFIAP_ERROR_NO_HARD   -5
-#define WIFIAP_ERROR_MANY_HARD -6
-#define WIFIAP_ERROR_STD_AC    -7
-#define WIFIAP_ERROR_STD_H     -8
+#define WIFIAP_NO_ERROR          0
+#define WIFIAP_ERROR_INVALID     -1
+#define WIFIAP_ERROR_OOM         -2
+#define WIFIAP_ERROR_TOO_SMALL   -3
+#define WIFIAP_ERROR_TOO_LARGE   -4
+#define WIFIAP_ERROR_NO_HARD     -5
+#define WIFIAP_ERROR_MANY_HARD   -6
+#define WIFIAP_ERROR_STD_AC      -7
+#define WIFIAP_ERROR_STD_H       -8
+#define WIFIAP_ERROR_FULL        -9
+#define WIFIAP_ERROR_NOT_FOUND   -10
+#define WIFIAP_ERROR_WIDTH       -11
+#define WIFIAP_ERROR_WMM         -12
+#define WIFIAP_ERROR_UNSUPPORTED -13
+#define WIFIAP_ERROR_PMF         -14
+
+// Groups of settings changed between two configurations, by the way they
+// are applied to a running access point
+#define WIFIAP_CHANGE_HOSTAPD_SET    0x01  ///< hostapd SET (ssid, clients...)
+#define WIFIAP_CHANGE_CHANNEL        0x02  ///< channel switch announcement
+#define WIFIAP_CHANGE_HOSTAPD_RELOAD 0x04  ///< hostapd.conf reloaded
+#define WIFIAP_CHANGE_DHCP           0x08  ///< dnsmasq restarted
+#define WIFIAP_CHANGE_RESTART        0x10  ///< access point restarted
+#define WIFIAP_CHANGE_SHAPING        0x20  ///< traffic shaping set again
+#define WIFIAP_CHANGE_STEERING       0x40  ///< band steering restarted
+
+// Function to set the default values of wifi access point parameters
+void initWifiApData(wifiApT *wifiApData);
+void deleteWifiApData(wifiApT *wifiApData);
+
+// Functions to compare and exchange two configurations
+unsigned compareWifiApData(const wifiApT *current, const wifiApT *staged);
+void swapWifiApData(wifiApT *current, wifiApT *staged);
 
 // Functions to set the paramaters of wifi access point
 int setHostNameParameter(wifiApT *wifiApData, const char *hostName);
@@ -123,6 +362,7 @@ int setDomainNameParameter(wifiApT *wifiApData, const char *domainName);
 int setInterfaceNameParameter(wifiApT *wifiApData, const char *interfaceName);
 int setSsidParameter(wifiApT *wifiApData, const char *ssid);
 int setChannelParameter(wifiApT *wifiApData, uint32_t channelNumber);
+int setAutoChannelParameter(wifiApT *wifiApData, const char *autoChannel);
 int setIeeeStandardParameter(wifiApT *wifiApData, uint32_t stdMask);
 int setPassPhraseParameter(wifiApT *wifiApData, const char *passphrase);
 int setPreSharedKeyParameter(wifiApT *wifiApData, const char *preSharedKey);
@@ -140,5 +380,67 @@ int setIpApParameter(wifiApT *wifiApData, const char *ip_ap);
 int setIpStartParameter(wifiApT *wifiApData, const char *ip_start);
 int setIpStopParameter(wifiApT *wifiApData, const char *ip_stop);
 int setIpNetMaskParameter(wifiApT *wifiApData, const char *ip_netmask);
+int setBeaconIntervalParameter(wifiApT *wifiApData, uint32_t beaconInterval);
+int setDtimPeriodParameter(wifiApT *wifiApData, uint32_t dtimPeriod);
+int setRtsThresholdParameter(wifiApT *wifiApData, uint32_t rtsThreshold);
+int setFragmThresholdParameter(wifiApT *wifiApData, uint32_t fragmThreshold);
+int setWmmEnabledParameter(wifiApT *wifiApData, bool wmmEnabled);
+int setChannelWidthParameter(wifiApT *wifiApData, uint32_t channelWidth);
+int setHtCapabParameter(wifiApT *wifiApData, const char *htCapab);
+int setVhtCapabParameter(wifiApT *wifiApData, const char *vhtCapab);
+int setDhcpLeaseTimeParameter(wifiApT *wifiApData, uint32_t leaseTime);
+int setDhcpAuthoritativeParameter(wifiApT *wifiApData, bool authoritative);
+int setDhcpRapidCommitParameter(wifiApT *wifiApData, bool rapidCommit);
+int setDnsCacheSizeParameter(wifiApT *wifiApData, uint32_t cacheSize);
+int addDhcpStaticLeaseParameter(wifiApT *wifiApData,
+                                const char *mac,
+                                const char *ip,
+                                const char *hostName);
+int removeDhcpStaticLeaseParameter(wifiApT *wifiApData, const char *mac);
+int setDhcpOptionParameter(wifiApT *wifiApData,
+                           uint32_t code,
+                           const char *value);
+int removeDhcpOptionParameter(wifiApT *wifiApData, uint32_t code);
+int setMacAclPolicyParameter(wifiApT *wifiApData, const char *policy);
+int addMacAclParameter(wifiApT *wifiApData, const char *list, const char *mac);
+int removeMacAclParameter(wifiApT *wifiApData,
+                          const char *list,
+                          const char *mac);
+int setRateLimitParameter(wifiApT *wifiApData, const char *mac, uint32_t kbps);
+int setSteeringParameter(wifiApT *wifiApData,
+                         const wifiAp_Steering_t *steering);
+
+// Functions to handle the sets of MAC addresses
+bool parseMacAddress(const char *text, uint64_t *mac);
+void formatMacAddress(uint64_t mac, char text[MAC_ADDRESS_LENGTH + 1]);
+int addMacSet(wifiAp_MacSet_t *set, uint64_t mac);
+int removeMacSet(wifiAp_MacSet_t *set, uint64_t mac);
+bool containsMacSet(const wifiAp_MacSet_t *set, uint64_t mac);
+bool getMacSetEntry(const wifiAp_MacSet_t *set, unsigned slot, uint64_t *mac);
+
+
+// Functions to check and derive the channel width settings
+int checkChannelWidth(const wifiApT *wifiApData);
+
+// Functions to handle the security protocols
+const char *getSecurityProtocolName(wifiAp_SecurityProtocol_t securityProtocol);
+bool isSaeSecurityProtocol(wifiAp_SecurityProtocol_t securityProtocol);
+int checkChannelSettings(const wifiApT *wifiApData,
+                         uint16_t channel,
+                         uint16_t channelWidth);
+bool isChannelWidthPossible(uint32_t stdMask,
+                            uint16_t channel,
+                            uint16_t channelWidth);
+int getHt40SecondaryOffset(uint32_t stdMask, uint16_t channel);
+unsigned getCoveredChannels(uint32_t stdMask,
+                            uint16_t channel,
+                            uint16_t channelWidth,
+                            uint16_t channels[MAX_COVERED_CHANNELS]);
+uint16_t getVhtCenterChannel(uint16_t channel, uint16_t channelWidth);
+
+// Functions to check settings against the capabilities of the radio
+const wifiAp_RadioChannel_t *findRadioChannel(
+    const wifiAp_RadioCapabilities_t *capabilities,
+    uint32_t frequency);
 
 #endif
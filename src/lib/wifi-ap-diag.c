@@ -0,0 +1,134 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-diag.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+// The ring: a writer reserves the next sequence number, then fills the slot
+// of that number. The sequence of the slot is 0 while it is written, so that
+// a reader copying it meanwhile (or a record overwritten) is detected.
+static diagRecordT ring[DIAG_RING_SIZE];
+static uint64_t ringHead = 0;  // sequence of the last record reserved
+
+static const char *const subsystemNames[DIAG_SUBSYSTEM_COUNT] = {
+    [DIAG_SUBSYSTEM_AP] = "ap",
+    [DIAG_SUBSYSTEM_COMMAND] = "command",
+    [DIAG_SUBSYSTEM_STATION] = "station",
+    [DIAG_SUBSYSTEM_EVENT] = "event",
+    [DIAG_SUBSYSTEM_CONFIG] = "config",
+};
+
+static const char *const codeNames[DIAG_CODE_COUNT] = {
+    [DIAG_CODE_START] = "start",
+    [DIAG_CODE_PHASE] = "phase",
+    [DIAG_CODE_STARTED] = "started",
+    [DIAG_CODE_START_FAILED] = "start-failed",
+    [DIAG_CODE_READY] = "ready",
+    [DIAG_CODE_NOT_READY] = "not-ready",
+    [DIAG_CODE_STOPPED] = "stopped",
+    [DIAG_CODE_EXIT] = "exit",
+    [DIAG_CODE_OPEN] = "open",
+    [DIAG_CODE_CONNECTED] = "connected",
+    [DIAG_CODE_DISCONNECTED] = "disconnected",
+    [DIAG_CODE_PUSH_FAILED] = "push-failed",
+    [DIAG_CODE_RELOADED] = "reloaded",
+};
+
+/*******************************************************************************
+ *      add a record to the ring, without lock                                 *
+ *                                                                             *
+ * The payload is formatted with printf and truncated to DIAG_PAYLOAD_LENGTH.  *
+ ******************************************************************************/
+void diagRecord(diagSubsystemT subsystem,
+                diagCodeT code,
+                int32_t status,
+                const char *format,
+                ...)
+{
+    uint64_t sequence = __atomic_add_fetch(&ringHead, 1, __ATOMIC_RELAXED);
+    diagRecordT *slot = &ring[(sequence - 1) & (DIAG_RING_SIZE - 1)];
+    struct timespec now;
+    va_list args;
+
+    __atomic_store_n(&slot->sequence, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    clock_gettime(CLOCK_REALTIME, &now);
+    slot->timeUs =
+        (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+    slot->subsystem = (uint16_t)subsystem;
+    slot->code = (uint16_t)code;
+    slot->status = status;
+    va_start(args, format);
+    vsnprintf(slot->payload, sizeof(slot->payload), format, args);
+    va_end(args);
+
+    __atomic_store_n(&slot->sequence, sequence, __ATOMIC_RELEASE);
+}
+
+/*******************************************************************************
+ *      copy the last records of the ring, the oldest first                    *
+ *                                                                             *
+ * The records being written, or overwritten while copied, are skipped.        *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of records copied, at most count and DIAG_RING_SIZE         *
+ ******************************************************************************/
+unsigned readDiagRecords(diagRecordT *records, unsigned count)
+{
+    uint64_t head = __atomic_load_n(&ringHead, __ATOMIC_ACQUIRE);
+    uint64_t sequence;
+    unsigned copied = 0;
+
+    if (count > DIAG_RING_SIZE)
+        count = DIAG_RING_SIZE;
+    sequence = head > count ? head - count + 1 : 1;
+
+    for (; sequence <= head; sequence++) {
+        const diagRecordT *slot = &ring[(sequence - 1) & (DIAG_RING_SIZE - 1)];
+
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != sequence)
+            continue;
+        records[copied] = *slot;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->sequence, __ATOMIC_RELAXED) != sequence)
+            continue;
+        records[copied].sequence = sequence;
+        records[copied].payload[DIAG_PAYLOAD_LENGTH] = '\0';
+        copied++;
+    }
+    return copied;
+}
+
+/*******************************************************************************
+ *      names of the subsystems and of the codes                               *
+ ******************************************************************************/
+const char *getDiagSubsystemName(unsigned subsystem)
+{
+    return subsystem < DIAG_SUBSYSTEM_COUNT ? subsystemNames[subsystem]
+                                            : "unknown";
+}
+
+const char *getDiagCodeName(unsigned code)
+{
+    return code < DIAG_CODE_COUNT ? codeNames[code] : "unknown";
+}
@@ -0,0 +1,76 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef DIAG_HEADER_FILE
+#define DIAG_HEADER_FILE
+
+#include <stdint.h>
+
+// number of records kept (a power of 2), the oldest are overwritten
+#define DIAG_RING_SIZE 256
+
+// max length of the payload of a record
+#define DIAG_PAYLOAD_LENGTH 47
+
+typedef enum
+{
+    DIAG_SUBSYSTEM_AP,       ///< start and stop of the access point
+    DIAG_SUBSYSTEM_COMMAND,  ///< commands run by the binding
+    DIAG_SUBSYSTEM_STATION,  ///< stations connecting and disconnecting
+    DIAG_SUBSYSTEM_EVENT,    ///< events pushed to the subscribers
+    DIAG_SUBSYSTEM_CONFIG,   ///< reloads of the configuration
+    DIAG_SUBSYSTEM_COUNT
+} diagSubsystemT;
+
+typedef enum
+{
+    DIAG_CODE_START,           ///< start requested, payload: interface
+    DIAG_CODE_PHASE,           ///< phase of the start done, status: ms
+    DIAG_CODE_STARTED,         ///< hostapd running, payload: interface
+    DIAG_CODE_START_FAILED,    ///< status: error of startAp
+    DIAG_CODE_READY,           ///< beacons sent, status: ms since start
+    DIAG_CODE_NOT_READY,       ///< hostapd not enabled, status: ms
+    DIAG_CODE_STOPPED,         ///< access point stopped
+    DIAG_CODE_EXIT,            ///< command done, status: exit code
+    DIAG_CODE_OPEN,            ///< command output opened, status: -errno
+    DIAG_CODE_CONNECTED,       ///< station connected, status: stations
+    DIAG_CODE_DISCONNECTED,    ///< station disconnected, status: stations
+    DIAG_CODE_PUSH_FAILED,     ///< event not pushed, status: error
+    DIAG_CODE_RELOADED,        ///< status: result, payload: changes
+    DIAG_CODE_COUNT
+} diagCodeT;
+
+// A record of the ring
+typedef struct
+{
+    uint64_t sequence;    ///< number of the record, from 1
+    uint64_t timeUs;      ///< wall clock time, in microseconds since epoch
+    uint16_t subsystem;   ///< diagSubsystemT
+    uint16_t code;        ///< diagCodeT
+    int32_t status;       ///< exit status, error or value, by code
+    char payload[DIAG_PAYLOAD_LENGTH + 1];
+} diagRecordT;
+
+//------------------------------------------------------------------------------
+
+void diagRecord(diagSubsystemT subsystem,
+                diagCodeT code,
+                int32_t status,
+                const char *format,
+                ...) __attribute__((format(printf, 4, 5)));
+unsigned readDiagRecords(diagRecordT *records, unsigned count);
+const char *getDiagSubsystemName(unsigned subsystem);
+const char *getDiagCodeName(unsigned code);
+#endif
@@ -0,0 +1,93 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-events.h"
+
+#include <limits.h>
+#include <string.h>
+
+/*******************************************************************************
+ *      parse a line of "iw event"                                             *
+ *                                                                             *
+ * The station events look like "wlan0 (phy #0): new station <mac>", they are  *
+ * kept when the text before the first ':' names the interface.                *
+ *                                                                             *
+ * @return                                                                     *
+ *      the type of the event, also set in event                               *
+ ******************************************************************************/
+stationEventTypeT parseStationEvent(const char *line,
+                                    const char *interfaceName,
+                                    stationEventT *event)
+{
+    const char *colon, *mac;
+    size_t length, nameLength = strlen(interfaceName);
+
+    event->type = STATION_EVENT_NONE;
+    event->mac[0] = '\0';
+
+    if (NULL != (mac = strstr(line, "del station")))
+        event->type = STATION_EVENT_DEL;
+    else if (NULL != (mac = strstr(line, "new station")))
+        event->type = STATION_EVENT_NEW;
+    else
+        return STATION_EVENT_NONE;
+
+    // the interface is in the text before the first ':'
+    colon = strchr(line, ':');
+    if (colon == NULL)
+        colon = line + strlen(line);
+    line = strstr(line, interfaceName);
+    if (line == NULL || line + nameLength > colon) {
+        event->type = STATION_EVENT_NONE;
+        return STATION_EVENT_NONE;
+    }
+
+    mac += sizeof("new station") - 1;
+    mac += strspn(mac, " ");
+    length = strcspn(mac, " \r\n");
+    if (length >= STATION_MAC_LENGTH)
+        length = STATION_MAC_LENGTH - 1;
+    memcpy(event->mac, mac, length);
+    event->mac[length] = '\0';
+    return event->type;
+}
+
+/*******************************************************************************
+ *      read the lines of "iw event" until the end of the input                *
+ *                                                                             *
+ * The input can be the pipe of "iw event", a file of recorded lines or a      *
+ * socket, the handler is called for each line.                                *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of station events of the interface                          *
+ ******************************************************************************/
+unsigned readStationEvents(FILE *input,
+                           const char *interfaceName,
+                           stationEventHandlerT handler,
+                           void *closure)
+{
+    char line[PATH_MAX];
+    stationEventT event;
+    unsigned count = 0;
+
+    while (NULL != fgets(line, sizeof(line) - 1, input)) {
+        if (parseStationEvent(line, interfaceName, &event) !=
+            STATION_EVENT_NONE)
+            count++;
+        handler(line, &event, closure);
+    }
+    return count;
+}
@@ -0,0 +1,52 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef EVENTS_HEADER_FILE
+#define EVENTS_HEADER_FILE
+
+#include <stdio.h>
+
+// length of a MAC address in text, with its terminating zero
+#define STATION_MAC_LENGTH 18
+
+typedef enum
+{
+    STATION_EVENT_NONE,   ///< not a station event of the interface
+    STATION_EVENT_NEW,    ///< "new station <mac>"
+    STATION_EVENT_DEL,    ///< "del station <mac>"
+} stationEventTypeT;
+
+typedef struct
+{
+    stationEventTypeT type;
+    char mac[STATION_MAC_LENGTH];
+} stationEventT;
+
+// Called for each line read, event->type is STATION_EVENT_NONE when the line
+// is not a station event of the interface
+typedef void (*stationEventHandlerT)(const char *line,
+                                     const stationEventT *event,
+                                     void *closure);
+
+//------------------------------------------------------------------------------
+
+stationEventTypeT parseStationEvent(const char *line,
+                                    const char *interfaceName,
+                                    stationEventT *event);
+unsigned readStationEvents(FILE *input,
+                           const char *interfaceName,
+                           stationEventHandlerT handler,
+                           void *closure);
+#endif
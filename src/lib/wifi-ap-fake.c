@@ -0,0 +1,479 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-fake.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+
+// reply to the commands starting with a prefix, the last one set wins
+typedef struct fakeReply
+{
+    platformDomainT domain;
+    char *prefix;
+    int exitCode;
+    char *output;
+    struct fakeReply *next;
+} fakeReplyT;
+
+// a file written, its content is updated when its stream is flushed or closed
+typedef struct fakeFile
+{
+    char *name;
+    char *content;
+    size_t size;
+    struct fakeFile *next;
+} fakeFileT;
+
+// a command or an event source opened
+typedef struct fakeStream
+{
+    FILE *stream;
+    int status;
+    struct fakeStream *next;
+} fakeStreamT;
+
+typedef struct
+{
+    platformDomainT domain;
+    char *cmd;
+} fakeCallT;
+
+static pthread_mutex_t fakeMutex = PTHREAD_MUTEX_INITIALIZER;
+static fakeReplyT *fakeReplies;
+static fakeFileT *fakeFiles;
+static fakeStreamT *fakeStreams;
+static char *fakeEvents;
+static fakeCallT *fakeCalls;
+static unsigned fakeCallCount;
+
+/*******************************************************************************
+ *      log a call and find its reply (with the mutex locked)                  *
+ ******************************************************************************/
+static const fakeReplyT *log_call(platformDomainT domain, const char *cmd)
+{
+    fakeCallT *calls;
+
+    calls = realloc(fakeCalls, (fakeCallCount + 1) * sizeof(*fakeCalls));
+    if (calls != NULL) {
+        fakeCalls = calls;
+        calls[fakeCallCount].domain = domain;
+        calls[fakeCallCount].cmd = strdup(cmd);
+        if (calls[fakeCallCount].cmd != NULL)
+            fakeCallCount++;
+    }
+
+    for (const fakeReplyT *reply = fakeReplies; reply != NULL;
+         reply = reply->next) {
+        if (reply->domain == domain &&
+            strncmp(cmd, reply->prefix, strlen(reply->prefix)) == 0)
+            return reply;
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ *      a stream reading a text, the buffer belongs to the stream              *
+ ******************************************************************************/
+static FILE *open_text(const char *text)
+{
+    size_t length = text == NULL ? 0 : strlen(text);
+    FILE *stream = fmemopen(NULL, length + 1, "w+");
+
+    if (stream != NULL) {
+        if (length != 0)
+            fwrite(text, 1, length, stream);
+        rewind(stream);
+    }
+    return stream;
+}
+
+/*******************************************************************************
+ *      keep the status of a stream for closeCommand (with the mutex locked)   *
+ ******************************************************************************/
+static FILE *track_stream(FILE *output, int status)
+{
+    fakeStreamT *stream;
+
+    if (output == NULL)
+        return NULL;
+    stream = malloc(sizeof(*stream));
+    if (stream == NULL) {
+        fclose(output);
+        return NULL;
+    }
+    stream->stream = output;
+    stream->status = status;
+    stream->next = fakeStreams;
+    fakeStreams = stream;
+    return output;
+}
+
+/*******************************************************************************
+ *      the calls of the platform                                              *
+ ******************************************************************************/
+static int fake_run_command(platformDomainT domain, const char *cmd)
+{
+    const fakeReplyT *reply;
+    int exitCode;
+
+    pthread_mutex_lock(&fakeMutex);
+    reply = log_call(domain, cmd);
+    exitCode = reply == NULL ? 0 : reply->exitCode;
+    pthread_mutex_unlock(&fakeMutex);
+    return W_EXITCODE(exitCode, 0);
+}
+
+static FILE *fake_open_command(platformDomainT domain, const char *cmd)
+{
+    const fakeReplyT *reply;
+    FILE *output;
+
+    pthread_mutex_lock(&fakeMutex);
+    reply = log_call(domain, cmd);
+    output = track_stream(open_text(reply == NULL ? NULL : reply->output),
+                          W_EXITCODE(reply == NULL ? 0 : reply->exitCode, 0));
+    pthread_mutex_unlock(&fakeMutex);
+    return output;
+}
+
+static int fake_close_command(FILE *output)
+{
+    fakeStreamT **link, *stream;
+    int status = -1;
+
+    pthread_mutex_lock(&fakeMutex);
+    for (link = &fakeStreams; *link != NULL; link = &(*link)->next) {
+        if ((*link)->stream == output) {
+            stream = *link;
+            *link = stream->next;
+            status = stream->status;
+            free(stream);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fakeMutex);
+
+    fclose(output);
+    return status;
+}
+
+static int fake_control_command(const char *interfaceName,
+                                const char *command,
+                                char *reply,
+                                size_t replySize)
+{
+    const fakeReplyT *fakeReply;
+    int rc;
+
+    if (replySize == 0)
+        return -EINVAL;
+
+    pthread_mutex_lock(&fakeMutex);
+    fakeReply = log_call(PLATFORM_CONTROL, command);
+    if (fakeReply != NULL && fakeReply->exitCode != 0)
+        rc = -fakeReply->exitCode;
+    else
+        rc = snprintf(reply, replySize, "%s",
+                      fakeReply == NULL ? "OK\n" : fakeReply->output);
+    pthread_mutex_unlock(&fakeMutex);
+
+    if (rc >= (int)replySize)
+        rc = (int)replySize - 1;
+    return rc;
+}
+
+static FILE *fake_open_events(const char *interfaceName)
+{
+    FILE *events;
+
+    pthread_mutex_lock(&fakeMutex);
+    log_call(PLATFORM_LINK, "iw event");
+    events = track_stream(open_text(fakeEvents), 0);
+    pthread_mutex_unlock(&fakeMutex);
+    return events;
+}
+
+static int fake_open_netlink(const char *interfaceName, unsigned *ifindex)
+{
+    char cmd[64];
+
+    // no radio in memory: the capabilities are the ones of the configuration
+    snprintf(cmd, sizeof(cmd), "nl80211 %s", interfaceName);
+    pthread_mutex_lock(&fakeMutex);
+    log_call(PLATFORM_LINK, cmd);
+    pthread_mutex_unlock(&fakeMutex);
+    return -ENODEV;
+}
+
+static fakeFileT *get_file(const char *fileName)
+{
+    fakeFileT *file;
+
+    for (file = fakeFiles; file != NULL; file = file->next) {
+        if (strcmp(file->name, fileName) == 0)
+            return file;
+    }
+    file = calloc(1, sizeof(*file));
+    if (file == NULL || (file->name = strdup(fileName)) == NULL) {
+        free(file);
+        return NULL;
+    }
+    file->next = fakeFiles;
+    fakeFiles = file;
+    return file;
+}
+
+static FILE *fake_create_file(const char *fileName)
+{
+    fakeFileT *file;
+    FILE *stream = NULL;
+
+    pthread_mutex_lock(&fakeMutex);
+    file = get_file(fileName);
+    if (file != NULL) {
+        free(file->content);
+        file->content = NULL;
+        file->size = 0;
+        stream = open_memstream(&file->content, &file->size);
+    }
+    pthread_mutex_unlock(&fakeMutex);
+    return stream;
+}
+
+static int fake_write_file(const char *fileName, const char *content)
+{
+    fakeFileT *file;
+    char *copy = strdup(content);
+    int rc = -ENOMEM;
+
+    pthread_mutex_lock(&fakeMutex);
+    file = get_file(fileName);
+    if (file != NULL && copy != NULL) {
+        free(file->content);
+        file->content = copy;
+        file->size = strlen(copy);
+        copy = NULL;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&fakeMutex);
+    free(copy);
+    return rc;
+}
+
+static FILE *fake_open_file(const char *fileName)
+{
+    FILE *stream = NULL;
+
+    pthread_mutex_lock(&fakeMutex);
+    for (const fakeFileT *file = fakeFiles; file != NULL; file = file->next) {
+        if (strcmp(file->name, fileName) == 0) {
+            stream = open_text(file->content);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fakeMutex);
+    if (stream == NULL)
+        errno = ENOENT;
+    return stream;
+}
+
+static int fake_remove_file(const char *fileName)
+{
+    fakeFileT **link, *file;
+    int rc = -ENOENT;
+
+    pthread_mutex_lock(&fakeMutex);
+    for (link = &fakeFiles; *link != NULL; link = &(*link)->next) {
+        if (strcmp((*link)->name, fileName) == 0) {
+            file = *link;
+            *link = file->next;
+            free(file->name);
+            free(file->content);
+            free(file);
+            rc = 0;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fakeMutex);
+    return rc;
+}
+
+static int fake_make_directory(const char *path)
+{
+    // the files in memory need no directory
+    return 0;
+}
+
+static const platformT fakePlatform = {
+    .name = "fake",
+    .runCommand = fake_run_command,
+    .openCommand = fake_open_command,
+    .closeCommand = fake_close_command,
+    .controlCommand = fake_control_command,
+    .openEvents = fake_open_events,
+    .openNetlink = fake_open_netlink,
+    .createFile = fake_create_file,
+    .writeFile = fake_write_file,
+    .openFile = fake_open_file,
+    .removeFile = fake_remove_file,
+    .makeDirectory = fake_make_directory,
+};
+
+/*******************************************************************************
+ *      the fake platform, to pass to setPlatform                              *
+ ******************************************************************************/
+const platformT *getFakePlatform(void)
+{
+    return &fakePlatform;
+}
+
+/*******************************************************************************
+ *      forget the replies, the events, the files and the calls                *
+ *                                                                             *
+ * The streams still opened stay valid.                                        *
+ ******************************************************************************/
+void resetFakePlatform(void)
+{
+    pthread_mutex_lock(&fakeMutex);
+    while (fakeReplies != NULL) {
+        fakeReplyT *reply = fakeReplies;
+
+        fakeReplies = reply->next;
+        free(reply->prefix);
+        free(reply->output);
+        free(reply);
+    }
+    while (fakeFiles != NULL) {
+        fakeFileT *file = fakeFiles;
+
+        fakeFiles = file->next;
+        free(file->name);
+        free(file->content);
+        free(file);
+    }
+    while (fakeCallCount > 0)
+        free(fakeCalls[--fakeCallCount].cmd);
+    free(fakeCalls);
+    fakeCalls = NULL;
+    free(fakeEvents);
+    fakeEvents = NULL;
+    pthread_mutex_unlock(&fakeMutex);
+}
+
+/*******************************************************************************
+ *      reply to the commands of a domain starting with a prefix               *
+ *                                                                             *
+ * runCommand and closeCommand return the exit code as system() and pclose()   *
+ * do, openCommand and controlCommand give the output (controlCommand fails    *
+ * with -exitCode if not 0).                                                   *
+ *                                                                             *
+ * @return                                                                     *
+ *      0, or -ENOMEM                                                          *
+ ******************************************************************************/
+int setFakeReply(platformDomainT domain,
+                 const char *prefix,
+                 int exitCode,
+                 const char *output)
+{
+    fakeReplyT *reply = malloc(sizeof(*reply));
+
+    if (reply == NULL)
+        return -ENOMEM;
+    reply->domain = domain;
+    reply->exitCode = exitCode;
+    reply->prefix = strdup(prefix);
+    reply->output = strdup(output == NULL ? "" : output);
+    if (reply->prefix == NULL || reply->output == NULL) {
+        free(reply->prefix);
+        free(reply->output);
+        free(reply);
+        return -ENOMEM;
+    }
+
+    pthread_mutex_lock(&fakeMutex);
+    reply->next = fakeReplies;
+    fakeReplies = reply;
+    pthread_mutex_unlock(&fakeMutex);
+    return 0;
+}
+
+/*******************************************************************************
+ *      the lines given by the next event source opened                        *
+ ******************************************************************************/
+int setFakeEvents(const char *lines)
+{
+    char *copy = strdup(lines);
+
+    if (copy == NULL)
+        return -ENOMEM;
+    pthread_mutex_lock(&fakeMutex);
+    free(fakeEvents);
+    fakeEvents = copy;
+    pthread_mutex_unlock(&fakeMutex);
+    return 0;
+}
+
+/*******************************************************************************
+ *      a copy of the content of a file written, to free, NULL if none         *
+ ******************************************************************************/
+char *getFakeFile(const char *fileName)
+{
+    char *content = NULL;
+
+    pthread_mutex_lock(&fakeMutex);
+    for (const fakeFileT *file = fakeFiles; file != NULL; file = file->next) {
+        if (strcmp(file->name, fileName) == 0) {
+            content = strndup(file->content == NULL ? "" : file->content,
+                              file->size);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&fakeMutex);
+    return content;
+}
+
+/*******************************************************************************
+ *      the calls logged, in their order                                       *
+ ******************************************************************************/
+unsigned getFakeCallCount(void)
+{
+    unsigned count;
+
+    pthread_mutex_lock(&fakeMutex);
+    count = fakeCallCount;
+    pthread_mutex_unlock(&fakeMutex);
+    return count;
+}
+
+const char *getFakeCall(unsigned index, platformDomainT *domain)
+{
+    const char *cmd = NULL;
+
+    pthread_mutex_lock(&fakeMutex);
+    if (index < fakeCallCount) {
+        cmd = fakeCalls[index].cmd;
+        if (domain != NULL)
+            *domain = fakeCalls[index].domain;
+    }
+    pthread_mutex_unlock(&fakeMutex);
+    return cmd;
+}
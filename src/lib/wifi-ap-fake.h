@@ -0,0 +1,37 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef FAKE_HEADER_FILE
+#define FAKE_HEADER_FILE
+
+#include "wifi-ap-platform.h"
+
+// A deterministic platform in memory: the commands succeed with an empty
+// output unless a reply is set, the control commands answer "OK", the files
+// are kept in memory, there is no radio for nl80211 and every call is logged.
+
+//------------------------------------------------------------------------------
+
+const platformT *getFakePlatform(void);
+void resetFakePlatform(void);
+int setFakeReply(platformDomainT domain,
+                 const char *prefix,
+                 int exitCode,
+                 const char *output);
+int setFakeEvents(const char *lines);
+char *getFakeFile(const char *fileName);
+unsigned getFakeCallCount(void);
+const char *getFakeCall(unsigned index, platformDomainT *domain);
+#endif
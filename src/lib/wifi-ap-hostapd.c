@@ -0,0 +1,154 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-hostapd.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "wifi-ap-platform.h"
+
+// counter making the local socket names unique in the process
+static unsigned SocketCounter = 0;
+
+/*******************************************************************************
+ *      send a command to the control socket of hostapd and read its answer    *
+ *                                                                             *
+ * The protocol is the one of hostapd_cli: a datagram socket bound to a local  *
+ * name and connected to HOSTAPD_CTRL_DIR/<interface>. The unsolicited event   *
+ * messages (starting with '<') are skipped.                                   *
+ *                                                                             *
+ * @return                                                                     *
+ *      the length of the answer, or a negative errno if failed.               *
+ ******************************************************************************/
+int hostapdSocketCommand(const char *interfaceName,
+                         const char *command,
+                         char *reply,
+                         size_t replySize)
+{
+    struct sockaddr_un local = {.sun_family = AF_UNIX};
+    struct sockaddr_un remote = {.sun_family = AF_UNIX};
+    struct pollfd pfd;
+    ssize_t received;
+    int fd, rc;
+
+    if (replySize == 0)
+        return -EINVAL;
+
+    if ((size_t)snprintf(remote.sun_path, sizeof(remote.sun_path), "%s/%s",
+                         HOSTAPD_CTRL_DIR,
+                         interfaceName) >= sizeof(remote.sun_path))
+        return -ENAMETOOLONG;
+    snprintf(local.sun_path, sizeof(local.sun_path), "/tmp/wifiap_ctrl_%d-%u",
+             (int)getpid(),
+             __atomic_add_fetch(&SocketCounter, 1, __ATOMIC_RELAXED));
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -errno;
+
+    unlink(local.sun_path);
+    if (bind(fd, (struct sockaddr *)&local, sizeof(local)) < 0) {
+        rc = -errno;
+        close(fd);
+        return rc;
+    }
+
+    if (connect(fd, (struct sockaddr *)&remote, sizeof(remote)) < 0 ||
+        send(fd, command, strlen(command), 0) < 0) {
+        rc = -errno;
+        goto end;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    for (;;) {
+        rc = poll(&pfd, 1, HOSTAPD_TIMEOUT_MS);
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0) {
+            rc = rc == 0 ? -ETIMEDOUT : -errno;
+            break;
+        }
+        received = recv(fd, reply, replySize - 1, 0);
+        if (received < 0) {
+            rc = -errno;
+            break;
+        }
+        if (received > 0 && reply[0] == '<')
+            continue;
+        reply[received] = '\0';
+        rc = (int)received;
+        break;
+    }
+
+end:
+    close(fd);
+    unlink(local.sun_path);
+    return rc;
+}
+
+/*******************************************************************************
+ *      send a command to hostapd through the platform in use                  *
+ ******************************************************************************/
+int hostapdCommand(const char *interfaceName,
+                   const char *command,
+                   char *reply,
+                   size_t replySize)
+{
+    return getPlatform()->controlCommand(interfaceName, command, reply,
+                                         replySize);
+}
+
+/*******************************************************************************
+ *      send a command expecting "OK"                                          *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, -EIO if hostapd refused it, or a negative errno.         *
+ ******************************************************************************/
+int hostapdRequest(const char *interfaceName, const char *command)
+{
+    char reply[HOSTAPD_REPLY_SIZE];
+    int rc = hostapdCommand(interfaceName, command, reply, sizeof(reply));
+
+    if (rc < 0)
+        return rc;
+    return strncmp(reply, "OK", 2) == 0 ? 0 : -EIO;
+}
+
+/*******************************************************************************
+ *      change a field of the running configuration ("SET <field> <value>")    *
+ *                                                                             *
+ * Only the in-memory configuration of hostapd is changed, some fields need an *
+ * "UPDATE_BEACON" to be advertised.                                           *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, -EIO if hostapd refused it, or a negative errno.         *
+ ******************************************************************************/
+int hostapdSet(const char *interfaceName, const char *field, const char *value)
+{
+    char command[HOSTAPD_REPLY_SIZE];
+
+    if ((size_t)snprintf(command, sizeof(command), "SET %s %s", field,
+                         value) >= sizeof(command))
+        return -E2BIG;
+    return hostapdRequest(interfaceName, command);
+}
@@ -0,0 +1,42 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef HOSTAPD_HEADER_FILE
+#define HOSTAPD_HEADER_FILE
+
+#include <stddef.h>
+
+// directory of the control sockets (ctrl_interface of hostapd.conf)
+#define HOSTAPD_CTRL_DIR "/var/run/hostapd"
+
+// max time to wait for an answer of hostapd (ms)
+#define HOSTAPD_TIMEOUT_MS 2000
+
+// size of the answers read from hostapd
+#define HOSTAPD_REPLY_SIZE 4096
+
+//------------------------------------------------------------------------------
+
+int hostapdSocketCommand(const char *interfaceName,
+                         const char *command,
+                         char *reply,
+                         size_t replySize);
+int hostapdCommand(const char *interfaceName,
+                   const char *command,
+                   char *reply,
+                   size_t replySize);
+int hostapdSet(const char *interfaceName, const char *field, const char *value);
+int hostapdRequest(const char *interfaceName, const char *command);
+#endif
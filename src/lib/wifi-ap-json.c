@@ -0,0 +1,497 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-json.h"
+
+#include <stdint.h>
+
+#include <rp-utils/rp-jsonc.h>
+
+#define AFB_BINDING_VERSION 4
+#include <afb/afb-binding.h>
+
+#include "wifi-ap-utilities.h"
+
+/*******************************************************************************
+ *        read band steering settings from a JSON-C object                     *
+ *                                                                             *
+ * The keys not given keep the values of steering.                             *
+ ******************************************************************************/
+static int steering_from_json(struct json_object *obj,
+                              wifiAp_Steering_t *steering)
+{
+    struct json_object *neighborsJ = NULL, *itemJ;
+    int enabled = steering->enabled;
+    int intervalMs = (int)steering->intervalMs;
+    int maxClients = (int)steering->maxClients;
+    int minSignal = (int)steering->minSignal;
+    int cooldownMs = (int)steering->cooldownMs;
+    int disassocTimer = (int)steering->disassocTimer;
+    size_t idx, length;
+
+    if (rp_jsonc_unpack(obj, "{s?b,s?i,s?i,s?i,s?i,s?i,s?o !}", "enabled",
+                        &enabled, "intervalMs", &intervalMs, "maxClients",
+                        &maxClients, "minSignal", &minSignal, "cooldownMs",
+                        &cooldownMs, "disassocTimer", &disassocTimer,
+                        "neighbors", &neighborsJ) != 0)
+        return WIFIAP_ERROR_INVALID;
+    if (intervalMs < 0 || maxClients < 0 || cooldownMs < 0 ||
+        disassocTimer < 0)
+        return WIFIAP_ERROR_TOO_SMALL;
+
+    steering->enabled = enabled;
+    steering->intervalMs = (uint32_t)intervalMs;
+    steering->maxClients = (uint32_t)maxClients;
+    steering->minSignal = minSignal;
+    steering->cooldownMs = (uint32_t)cooldownMs;
+    steering->disassocTimer = (uint32_t)disassocTimer;
+
+    if (neighborsJ != NULL) {
+        if (!json_object_is_type(neighborsJ, json_type_array))
+            return WIFIAP_ERROR_INVALID;
+        length = json_object_array_length(neighborsJ);
+        if (length > MAX_STEERING_NEIGHBORS)
+            return WIFIAP_ERROR_TOO_LARGE;
+        for (idx = 0; idx < length; idx++) {
+            itemJ = json_object_array_get_idx(neighborsJ, idx);
+            if (!json_object_is_type(itemJ, json_type_string) ||
+                utf8_Copy(steering->neighbors[idx],
+                          json_object_get_string(itemJ),
+                          sizeof(steering->neighbors[idx]), NULL) != 0)
+                return WIFIAP_ERROR_INVALID;
+        }
+        steering->neighborCount = (uint32_t)length;
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *                    Set the band steering from a JSON-C object               *
+ ******************************************************************************/
+int setSteeringFromJson(wifiApT *wifiApData, struct json_object *obj)
+{
+    wifiAp_Steering_t steering = wifiApData->steering;
+    int sts = steering_from_json(obj, &steering);
+
+    return sts != WIFIAP_NO_ERROR ? sts
+                                  : setSteeringParameter(wifiApData, &steering);
+}
+
+
+/*******************************************************************************
+ *                    Set the DHCP static leases from a JSON-C array           *
+ ******************************************************************************/
+static int setDhcpStaticLeasesFromJson(wifiApT *wifiApData,
+                                       struct json_object *array)
+{
+    size_t idx, length = json_object_array_length(array);
+
+    for (idx = 0; idx < length; idx++) {
+        const char *mac, *ip, *hostname = NULL;
+        struct json_object *item = json_object_array_get_idx(array, idx);
+        if (rp_jsonc_unpack(item, "{ss,ss,s?s !}", "mac", &mac, "ip", &ip,
+                            "hostname", &hostname) != 0)
+            return WIFIAP_ERROR_INVALID;
+
+        int sts = addDhcpStaticLeaseParameter(wifiApData, mac, ip, hostname);
+        if (sts != WIFIAP_NO_ERROR)
+            return sts;
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *                    Set the DHCP options from a JSON-C array                 *
+ ******************************************************************************/
+static int setDhcpOptionsFromJson(wifiApT *wifiApData,
+                                  struct json_object *array)
+{
+    size_t idx, length = json_object_array_length(array);
+
+    for (idx = 0; idx < length; idx++) {
+        const char *value;
+        int code;
+        struct json_object *item = json_object_array_get_idx(array, idx);
+        if (rp_jsonc_unpack(item, "{si,ss !}", "code", &code, "value",
+                            &value) != 0 ||
+            code < 0)
+            return WIFIAP_ERROR_INVALID;
+
+        int sts = setDhcpOptionParameter(wifiApData, (uint32_t)code, value);
+        if (sts != WIFIAP_NO_ERROR)
+            return sts;
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *                    Set a MAC access control list from a JSON-C array        *
+ ******************************************************************************/
+static int setMacListFromJson(wifiApT *wifiApData,
+                              const char *list,
+                              struct json_object *array)
+{
+    size_t idx, length = json_object_array_length(array);
+
+    for (idx = 0; idx < length; idx++) {
+        struct json_object *item = json_object_array_get_idx(array, idx);
+        if (!json_object_is_type(item, json_type_string))
+            return WIFIAP_ERROR_INVALID;
+
+        int sts = addMacAclParameter(wifiApData, list,
+                                     json_object_get_string(item));
+        if (sts != WIFIAP_NO_ERROR)
+            return sts;
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+static int setMacAllowListFromJson(wifiApT *wifiApData,
+                                   struct json_object *array)
+{
+    return setMacListFromJson(wifiApData, "allow", array);
+}
+
+static int setMacDenyListFromJson(wifiApT *wifiApData,
+                                  struct json_object *array)
+{
+    return setMacListFromJson(wifiApData, "deny", array);
+}
+
+/*******************************************************************************
+ *                    Set the rate limits                                      *
+ ******************************************************************************/
+static int setSsidRateLimit(wifiApT *wifiApData, uint32_t kbps)
+{
+    return setRateLimitParameter(wifiApData, NULL, kbps);
+}
+
+static int setStationRateLimitsFromJson(wifiApT *wifiApData,
+                                        struct json_object *array)
+{
+    size_t idx, length = json_object_array_length(array);
+
+    for (idx = 0; idx < length; idx++) {
+        const char *mac;
+        int kbps;
+        struct json_object *item = json_object_array_get_idx(array, idx);
+        if (rp_jsonc_unpack(item, "{ss,si !}", "mac", &mac, "kbps", &kbps) !=
+                0 ||
+            kbps <= 0)
+            return WIFIAP_ERROR_INVALID;
+
+        int sts = setRateLimitParameter(wifiApData, mac, (uint32_t)kbps);
+        if (sts != WIFIAP_NO_ERROR)
+            return sts;
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+
+/*******************************************************************************
+ *        set a wifiApData from the "config" section of the configuration      *
+ *                                                                             *
+ * The keys are the ones of the configuration file, each invalid or missing    *
+ * mandatory key is logged.                                                    *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of invalid or missing keys, 0 if all were set               *
+ ******************************************************************************/
+int setWifiApDataFromJson(wifiApT *wifiApData, struct json_object *obj)
+{
+    static struct
+    {
+        const char *key;
+        bool mandatory;
+        char type;
+        union {
+            int (*set_s)(wifiApT *, const char *);
+            int (*set_u)(wifiApT *, uint32_t);
+            int (*set_b)(wifiApT *, bool);
+            int (*set_a)(wifiApT *, struct json_object *);
+            int (*set_o)(wifiApT *, struct json_object *);
+        };
+    }
+    // clang-format off
+    descs[] = {
+        { "interfaceName",     true, 's', { .set_s = setInterfaceNameParameter }},
+        { "domaine_name",      true, 's', { .set_s = setDomainNameParameter }},
+        { "hostname",          true, 's', { .set_s = setHostNameParameter }},
+        { "ssid",              true, 's', { .set_s = setSsidParameter }},
+        { "passphrase",        true, 's', { .set_s = setPassPhraseParameter }},
+        { "preSharedKey",     false, 's', { .set_s = setPreSharedKeyParameter }},
+        { "countryCode",       true, 's', { .set_s = setCountryCodeParameter }},
+        { "ip_ap",             true, 's', { .set_s = setIpApParameter }},
+        { "ip_start",          true, 's', { .set_s = setIpStartParameter }},
+        { "ip_stop",           true, 's', { .set_s = setIpStopParameter }},
+        { "ip_netmask",        true, 's', { .set_s = setIpNetMaskParameter }},
+        { "discoverable",      true, 'b', { .set_b = setDiscoverableParameter }},
+        { "maxNumberClient",   true, 'u', { .set_u = setMaxNumberClients }},
+        { "IeeeStdMask",       true, 'u', { .set_u = setIeeeStandardParameter }},
+        // after IeeeStdMask: WPA3 is checked against its 802.11w bit
+        { "securityProtocol",  true, 's', { .set_s = setSecurityProtocolParameter }},
+        { "channelNumber",     true, 'u', { .set_u = setChannelParameter }},
+        { "autoChannel",      false, 's', { .set_s = setAutoChannelParameter }},
+        { "wmmEnabled",       false, 'b', { .set_b = setWmmEnabledParameter }},
+        { "beaconInterval",   false, 'u', { .set_u = setBeaconIntervalParameter }},
+        { "dtimPeriod",       false, 'u', { .set_u = setDtimPeriodParameter }},
+        { "rtsThreshold",     false, 'u', { .set_u = setRtsThresholdParameter }},
+        { "fragmThreshold",   false, 'u', { .set_u = setFragmThresholdParameter }},
+        { "channelWidth",     false, 'u', { .set_u = setChannelWidthParameter }},
+        { "htCapab",          false, 's', { .set_s = setHtCapabParameter }},
+        { "vhtCapab",         false, 's', { .set_s = setVhtCapabParameter }},
+        { "dhcpLeaseTime",    false, 'u', { .set_u = setDhcpLeaseTimeParameter }},
+        { "dhcpAuthoritative",false, 'b', { .set_b = setDhcpAuthoritativeParameter }},
+        { "dhcpRapidCommit",  false, 'b', { .set_b = setDhcpRapidCommitParameter }},
+        { "dnsCacheSize",     false, 'u', { .set_u = setDnsCacheSizeParameter }},
+        { "dhcpStaticLeases", false, 'a', { .set_a = setDhcpStaticLeasesFromJson }},
+        { "dhcpOptions",      false, 'a', { .set_a = setDhcpOptionsFromJson }},
+        { "macAclPolicy",     false, 's', { .set_s = setMacAclPolicyParameter }},
+        { "macAllowList",     false, 'a', { .set_a = setMacAllowListFromJson }},
+        { "macDenyList",      false, 'a', { .set_a = setMacDenyListFromJson }},
+        { "rateLimitKbps",    false, 'u', { .set_u = setSsidRateLimit }},
+        { "stationRateLimits",false, 'a', { .set_a = setStationRateLimitsFromJson }},
+        { "steering",         false, 'o', { .set_o = setSteeringFromJson }}
+    };
+    // clang-format on
+
+    int idx, err = 0;
+
+    for (idx = 0; idx < (int)(sizeof descs / sizeof *descs); idx++) {
+        struct json_object *val;
+        const char *key = descs[idx].key;
+        if (!json_object_object_get_ex(obj, key, &val)) {
+            if (descs[idx].mandatory) {
+                AFB_ERROR("can't find key '%s' in config", key);
+                err++;
+            }
+        }
+        else {
+            switch (descs[idx].type) {
+            case 's':
+                if (!json_object_is_type(val, json_type_string)) {
+                    AFB_ERROR("key '%s' in config should be a string", key);
+                    err++;
+                }
+                else {
+                    const char *s = json_object_get_string(val);
+                    int sts = descs[idx].set_s(wifiApData, s);
+                    if (sts != WIFIAP_NO_ERROR) {
+                        AFB_ERROR("invalid value for key '%s' in config", key);
+                        err++;
+                    }
+                }
+                break;
+
+            case 'b':
+                if (!json_object_is_type(val, json_type_boolean)) {
+                    AFB_ERROR("key '%s' in config should be a boolean", key);
+                    err++;
+                }
+                else {
+                    bool b = json_object_get_boolean(val);
+                    int sts = descs[idx].set_b(wifiApData, b);
+                    if (sts != WIFIAP_NO_ERROR) {
+                        AFB_ERROR("invalid value for key '%s' in config", key);
+                        err++;
+                    }
+                }
+                break;
+
+            case 'u':
+                if (!json_object_is_type(val, json_type_int)) {
+                    AFB_ERROR("key '%s' in config should be an integer", key);
+                    err++;
+                }
+                else {
+                    int64_t x = json_object_get_int64(val);
+                    int sts = x < 0 ? WIFIAP_ERROR_TOO_SMALL
+                              : x > UINT32_MAX
+                                  ? WIFIAP_ERROR_TOO_LARGE
+                                  : descs[idx].set_u(wifiApData, (uint32_t)x);
+                    if (sts != WIFIAP_NO_ERROR) {
+                        AFB_ERROR("invalid value for key '%s' in config", key);
+                        err++;
+                    }
+                }
+                break;
+
+            case 'a':
+                if (!json_object_is_type(val, json_type_array)) {
+                    AFB_ERROR("key '%s' in config should be an array", key);
+                    err++;
+                }
+                else {
+                    int sts = descs[idx].set_a(wifiApData, val);
+                    if (sts != WIFIAP_NO_ERROR) {
+                        AFB_ERROR("invalid value for key '%s' in config", key);
+                        err++;
+                    }
+                }
+                break;
+
+            case 'o':
+                if (!json_object_is_type(val, json_type_object)) {
+                    AFB_ERROR("key '%s' in config should be an object", key);
+                    err++;
+                }
+                else {
+                    int sts = descs[idx].set_o(wifiApData, val);
+                    if (sts != WIFIAP_NO_ERROR) {
+                        AFB_ERROR("invalid value for key '%s' in config", key);
+                        err++;
+                    }
+                }
+                break;
+            }
+        }
+    }
+
+    return err;
+}
+
+/*******************************************************************************
+ *        serialize a set of MAC addresses to a JSON-C array                   *
+ ******************************************************************************/
+struct json_object *macSetToJson(const wifiAp_MacSet_t *set)
+{
+    struct json_object *array = json_object_new_array();
+    char text[MAC_ADDRESS_LENGTH + 1];
+    uint64_t mac;
+
+    for (unsigned slot = 0; slot < MAC_SET_SLOTS; slot++) {
+        if (getMacSetEntry(set, slot, &mac)) {
+            formatMacAddress(mac, text);
+            json_object_array_add(array, json_object_new_string(text));
+        }
+    }
+    return array;
+}
+
+/*******************************************************************************
+ *        serialize the band steering settings to a JSON-C object              *
+ ******************************************************************************/
+struct json_object *steeringToJson(const wifiAp_Steering_t *steering)
+{
+    struct json_object *obj, *neighborsJ = json_object_new_array();
+
+    for (uint32_t i = 0; i < steering->neighborCount; i++)
+        json_object_array_add(neighborsJ,
+                              json_object_new_string(steering->neighbors[i]));
+    rp_jsonc_pack(&obj, "{sb,si,si,si,si,si,so}", "enabled", steering->enabled,
+                  "intervalMs", (int)steering->intervalMs, "maxClients",
+                  (int)steering->maxClients, "minSignal",
+                  (int)steering->minSignal, "cooldownMs",
+                  (int)steering->cooldownMs, "disassocTimer",
+                  (int)steering->disassocTimer, "neighbors", neighborsJ);
+    return obj;
+}
+
+/*******************************************************************************
+ *        serialize the settings with the keys of the configuration file       *
+ ******************************************************************************/
+struct json_object *wifiApDataToJson(const wifiApT *wifiApData)
+{
+    static const char *const autoChannels[] = {"off", "acs_survey", "survey"};
+    struct json_object *obj, *leasesJ, *optionsJ, *limitsJ, *itemJ;
+
+    rp_jsonc_pack(
+        &obj,
+        "{ss,ss,ss,ss,ss,ss,ss,ss,ss,ss,sb,si,si,si,ss,sb,si,si,si,si,si,ss,ss,"
+        "si,sb,sb,si}",
+        "interfaceName", wifiApData->interfaceName, "domaine_name",
+        wifiApData->domainName, "hostname", wifiApData->hostName, "ssid",
+        wifiApData->ssid, "countryCode", wifiApData->countryCode,
+        "securityProtocol",
+        getSecurityProtocolName(wifiApData->securityProtocol),
+        "ip_ap", wifiApData->ip_ap, "ip_start", wifiApData->ip_start, "ip_stop",
+        wifiApData->ip_stop, "ip_netmask", wifiApData->ip_netmask,
+        "discoverable", wifiApData->discoverable, "maxNumberClient",
+        (int)wifiApData->maxNumberClient, "IeeeStdMask",
+        (int)wifiApData->IeeeStdMask, "channelNumber",
+        (int)wifiApData->channelNumber, "autoChannel",
+        autoChannels[wifiApData->autoChannel], "wmmEnabled",
+        wifiApData->radio.wmmEnabled, "beaconInterval",
+        (int)wifiApData->radio.beaconInterval, "dtimPeriod",
+        (int)wifiApData->radio.dtimPeriod, "rtsThreshold",
+        (int)wifiApData->radio.rtsThreshold, "fragmThreshold",
+        (int)wifiApData->radio.fragmThreshold, "channelWidth",
+        (int)wifiApData->radio.channelWidth, "htCapab",
+        wifiApData->radio.htCapab, "vhtCapab", wifiApData->radio.vhtCapab,
+        "dhcpLeaseTime", (int)wifiApData->dhcp.leaseTime, "dhcpAuthoritative",
+        wifiApData->dhcp.authoritative, "dhcpRapidCommit",
+        wifiApData->dhcp.rapidCommit, "dnsCacheSize",
+        (int)wifiApData->dhcp.dnsCacheSize);
+    if (obj == NULL)
+        return NULL;
+
+    // an empty secret is not valid in the configuration
+    if (wifiApData->passphrase[0] != '\0')
+        json_object_object_add(obj, "passphrase",
+                               json_object_new_string(wifiApData->passphrase));
+    if (wifiApData->presharedKey[0] != '\0')
+        json_object_object_add(
+            obj, "preSharedKey",
+            json_object_new_string(wifiApData->presharedKey));
+
+    leasesJ = json_object_new_array();
+    for (uint32_t i = 0; i < wifiApData->dhcp.staticLeaseCount; i++) {
+        const wifiAp_DhcpStaticLease_t *lease =
+            &wifiApData->dhcp.staticLeases[i];
+        rp_jsonc_pack(&itemJ, "{ss,ss}", "mac", lease->mac, "ip", lease->ip);
+        if (lease->hostName[0] != '\0')
+            json_object_object_add(itemJ, "hostname",
+                                   json_object_new_string(lease->hostName));
+        json_object_array_add(leasesJ, itemJ);
+    }
+    json_object_object_add(obj, "dhcpStaticLeases", leasesJ);
+
+    optionsJ = json_object_new_array();
+    for (uint32_t i = 0; i < wifiApData->dhcp.optionCount; i++) {
+        rp_jsonc_pack(&itemJ, "{si,ss}", "code",
+                      (int)wifiApData->dhcp.options[i].code, "value",
+                      wifiApData->dhcp.options[i].value);
+        json_object_array_add(optionsJ, itemJ);
+    }
+    json_object_object_add(obj, "dhcpOptions", optionsJ);
+
+    json_object_object_add(
+        obj, "macAclPolicy",
+        json_object_new_string(wifiApData->acl.policy == WIFI_AP_MAC_ACL_ALLOW
+                                   ? "allow"
+                                   : "deny"));
+    json_object_object_add(obj, "macAllowList",
+                           macSetToJson(&wifiApData->acl.allow));
+    json_object_object_add(obj, "macDenyList",
+                           macSetToJson(&wifiApData->acl.deny));
+
+    json_object_object_add(
+        obj, "rateLimitKbps",
+        json_object_new_int((int)wifiApData->shaping.ssidKbps));
+    limitsJ = json_object_new_array();
+    for (uint32_t i = 0; i < wifiApData->shaping.stationCount; i++) {
+        rp_jsonc_pack(&itemJ, "{ss,si}", "mac",
+                      wifiApData->shaping.stations[i].mac, "kbps",
+                      (int)wifiApData->shaping.stations[i].kbps);
+        json_object_array_add(limitsJ, itemJ);
+    }
+    json_object_object_add(obj, "stationRateLimits", limitsJ);
+    json_object_object_add(obj, "steering",
+                           steeringToJson(&wifiApData->steering));
+    return obj;
+}
@@ -0,0 +1,30 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef JSON_HEADER_FILE
+#define JSON_HEADER_FILE
+
+#include <json-c/json.h>
+
+#include "wifi-ap-data.h"
+
+//------------------------------------------------------------------------------
+
+int setWifiApDataFromJson(wifiApT *wifiApData, struct json_object *obj);
+int setSteeringFromJson(wifiApT *wifiApData, struct json_object *obj);
+struct json_object *macSetToJson(const wifiAp_MacSet_t *set);
+struct json_object *steeringToJson(const wifiAp_Steering_t *steering);
+struct json_object *wifiApDataToJson(const wifiApT *wifiApData);
+#endif
@@ -0,0 +1,299 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-metrics.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// largest bound exported in the OpenMetrics buckets (2^27 us)
+#define METRIC_LAST_BOUND_BUCKET \
+    (METRIC_HISTOGRAM_BUCKETS - METRIC_SUB_BUCKETS - 1)
+
+// the registry: metrics are appended, never removed, so it is read without lock
+static metricT *metricsHead = NULL;
+static metricT **metricsTail = &metricsHead;
+static pthread_mutex_t metrics_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *      bucket of a value: values below 4 have their own bucket, the next      *
+ *      powers of 2 are split in METRIC_SUB_BUCKETS linear buckets             *
+ ******************************************************************************/
+static unsigned bucket_index(uint64_t us)
+{
+    unsigned exponent, index;
+
+    if (us < METRIC_SUB_BUCKETS)
+        return (unsigned)us;
+    exponent = 63 - (unsigned)__builtin_clzll(us);
+    index = METRIC_SUB_BUCKETS * (exponent - 1) +
+            (unsigned)((us >> (exponent - 2)) & (METRIC_SUB_BUCKETS - 1));
+    return index < METRIC_HISTOGRAM_BUCKETS ? index
+                                            : METRIC_HISTOGRAM_BUCKETS - 1;
+}
+
+// exclusive upper bound of a bucket
+static uint64_t bucket_bound(unsigned index)
+{
+    unsigned exponent = index / METRIC_SUB_BUCKETS + 1;
+
+    if (index < METRIC_SUB_BUCKETS)
+        return index + 1;
+    return (uint64_t)(METRIC_SUB_BUCKETS + 1 + index % METRIC_SUB_BUCKETS)
+           << (exponent - 2);
+}
+
+/*******************************************************************************
+ *      create a metric and add it to the registry                             *
+ *                                                                             *
+ * The name, help and label name are not copied (string literals expected).    *
+ *                                                                             *
+ * @return                                                                     *
+ *      the metric, NULL if out of memory (the update functions ignore NULL)   *
+ ******************************************************************************/
+metricT *createMetric(metricTypeT type,
+                      const char *name,
+                      const char *help,
+                      const char *labelName,
+                      const char *labelValue)
+{
+    metricT *metric = calloc(1, sizeof(*metric));
+
+    if (metric == NULL)
+        return NULL;
+    metric->type = type;
+    metric->name = name;
+    metric->help = help;
+    metric->labelName = labelName;
+    if (labelName != NULL) {
+        metric->labelValue = strdup(labelValue);
+        if (metric->labelValue == NULL) {
+            free(metric);
+            return NULL;
+        }
+    }
+    if (type == METRIC_HISTOGRAM) {
+        metric->buckets = calloc(METRIC_HISTOGRAM_BUCKETS, sizeof(uint64_t));
+        if (metric->buckets == NULL) {
+            free(metric->labelValue);
+            free(metric);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_lock(&metrics_mutex);
+    __atomic_store_n(metricsTail, metric, __ATOMIC_RELEASE);
+    metricsTail = &metric->next;
+    pthread_mutex_unlock(&metrics_mutex);
+    return metric;
+}
+
+/*******************************************************************************
+ *      walk the registry, in the order of creation                            *
+ ******************************************************************************/
+const metricT *listMetrics(void)
+{
+    return __atomic_load_n(&metricsHead, __ATOMIC_ACQUIRE);
+}
+
+const metricT *nextMetric(const metricT *metric)
+{
+    return __atomic_load_n(&metric->next, __ATOMIC_ACQUIRE);
+}
+
+/*******************************************************************************
+ *      increment a counter                                                    *
+ ******************************************************************************/
+void metricAdd(metricT *metric, uint64_t count)
+{
+    if (metric != NULL)
+        __atomic_add_fetch(&metric->count, count, __ATOMIC_RELAXED);
+}
+
+/*******************************************************************************
+ *      add an observation in microseconds to a histogram                      *
+ ******************************************************************************/
+void metricObserve(metricT *metric, uint64_t us)
+{
+    uint64_t max;
+
+    if (metric == NULL || metric->buckets == NULL)
+        return;
+    __atomic_add_fetch(&metric->buckets[bucket_index(us)], 1,
+                       __ATOMIC_RELAXED);
+    __atomic_add_fetch(&metric->sumUs, us, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&metric->count, 1, __ATOMIC_RELAXED);
+    max = __atomic_load_n(&metric->maxUs, __ATOMIC_RELAXED);
+    while (us > max &&
+           !__atomic_compare_exchange_n(&metric->maxUs, &max, us, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        ;
+}
+
+/*******************************************************************************
+ *      monotonic time in microseconds, to compute the observations            *
+ ******************************************************************************/
+uint64_t metricNowUs(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+/*******************************************************************************
+ *      count, sum, max and quantiles of a histogram                           *
+ *                                                                             *
+ * The buckets are read one by one while they may be updated: the summary is   *
+ * consistent within one observation per concurrent update.                    *
+ ******************************************************************************/
+static uint64_t quantile(const uint64_t *buckets,
+                         uint64_t total,
+                         unsigned percent,
+                         uint64_t max)
+{
+    uint64_t rank = (total * percent + 99) / 100, seen = 0;
+
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (rank != 0 && seen >= rank) {
+            uint64_t bound = bucket_bound(i) - 1;
+            return bound < max ? bound : max;
+        }
+    }
+    return max;
+}
+
+void summarizeMetric(const metricT *metric, metricSummaryT *summary)
+{
+    uint64_t buckets[METRIC_HISTOGRAM_BUCKETS];
+    uint64_t total = 0;
+
+    memset(summary, 0, sizeof(*summary));
+    summary->count = __atomic_load_n(&metric->count, __ATOMIC_RELAXED);
+    if (metric->buckets == NULL)
+        return;
+
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++) {
+        buckets[i] = __atomic_load_n(&metric->buckets[i], __ATOMIC_RELAXED);
+        total += buckets[i];
+    }
+    summary->count = total;
+    summary->sumUs = __atomic_load_n(&metric->sumUs, __ATOMIC_RELAXED);
+    summary->maxUs = __atomic_load_n(&metric->maxUs, __ATOMIC_RELAXED);
+    summary->p50Us = quantile(buckets, total, 50, summary->maxUs);
+    summary->p90Us = quantile(buckets, total, 90, summary->maxUs);
+    summary->p99Us = quantile(buckets, total, 99, summary->maxUs);
+}
+
+/*******************************************************************************
+ *      write the metrics in the OpenMetrics text format                       *
+ *                                                                             *
+ * The metrics of a family are written together. The histograms are in         *
+ * seconds, with a bucket per power of 2 of microseconds up to the largest     *
+ * observation. The label values are identifiers, they are not escaped.        *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 on success, -1 on write error                                        *
+ ******************************************************************************/
+static void write_labels(FILE *output,
+                         const metricT *metric,
+                         const char *le,
+                         uint64_t leUs)
+{
+    const char *sep = "{";
+
+    if (metric->labelName != NULL) {
+        fprintf(output, "%s%s=\"%s\"", sep, metric->labelName,
+                metric->labelValue);
+        sep = ",";
+    }
+    if (le != NULL)
+        fprintf(output, "%sle=\"%s\"", sep, le);
+    else if (leUs != 0)
+        fprintf(output, "%sle=\"%" PRIu64 ".%06" PRIu64 "\"", sep,
+                leUs / 1000000, leUs % 1000000);
+    else if (metric->labelName == NULL)
+        return;
+    fputc('}', output);
+}
+
+static void write_histogram(FILE *output, const metricT *metric)
+{
+    uint64_t total = 0, seen = 0, sum;
+
+    for (unsigned i = 0; i < METRIC_HISTOGRAM_BUCKETS; i++)
+        total += __atomic_load_n(&metric->buckets[i], __ATOMIC_RELAXED);
+    sum = __atomic_load_n(&metric->sumUs, __ATOMIC_RELAXED);
+
+    for (unsigned i = 0; i <= METRIC_LAST_BOUND_BUCKET && seen < total; i++) {
+        uint64_t bound = bucket_bound(i);
+        seen += __atomic_load_n(&metric->buckets[i], __ATOMIC_RELAXED);
+        if ((bound & (bound - 1)) == 0) {
+            fprintf(output, "%s_bucket", metric->name);
+            write_labels(output, metric, NULL, bound);
+            fprintf(output, " %" PRIu64 "\n", seen);
+        }
+    }
+    fprintf(output, "%s_bucket", metric->name);
+    write_labels(output, metric, "+Inf", 0);
+    fprintf(output, " %" PRIu64 "\n%s_count", total, metric->name);
+    write_labels(output, metric, NULL, 0);
+    fprintf(output, " %" PRIu64 "\n%s_sum", total, metric->name);
+    write_labels(output, metric, NULL, 0);
+    fprintf(output, " %" PRIu64 ".%06" PRIu64 "\n", sum / 1000000,
+            sum % 1000000);
+}
+
+int writeOpenMetrics(FILE *output)
+{
+    for (const metricT *family = listMetrics(); family != NULL;
+         family = nextMetric(family)) {
+        const metricT *metric;
+
+        // already written with a previous metric of the family
+        for (metric = listMetrics(); metric != family &&
+                                    strcmp(metric->name, family->name) != 0;
+             metric = nextMetric(metric))
+            ;
+        if (metric != family)
+            continue;
+
+        fprintf(output, "# TYPE %s %s\n# HELP %s %s\n", family->name,
+                family->type == METRIC_HISTOGRAM ? "histogram" : "counter",
+                family->name, family->help);
+        for (; metric != NULL; metric = nextMetric(metric)) {
+            if (strcmp(metric->name, family->name) != 0)
+                continue;
+            if (metric->type == METRIC_HISTOGRAM)
+                write_histogram(output, metric);
+            else {
+                fprintf(output, "%s_total", metric->name);
+                write_labels(output, metric, NULL, 0);
+                fprintf(output, " %" PRIu64 "\n",
+                        __atomic_load_n(&metric->count, __ATOMIC_RELAXED));
+            }
+        }
+    }
+    fputs("# EOF\n", output);
+    return ferror(output) ? -1 : 0;
+}
@@ -0,0 +1,74 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef METRICS_HEADER_FILE
+#define METRICS_HEADER_FILE
+
+#include <stdint.h>
+#include <stdio.h>
+
+// buckets of the latency histograms: 4 linear buckets per power of 2 of
+// microseconds up to 2^27 us (about 134 s), the last 4 keep the larger ones
+#define METRIC_SUB_BUCKETS       4
+#define METRIC_HISTOGRAM_BUCKETS 108
+
+typedef enum
+{
+    METRIC_COUNTER,
+    METRIC_HISTOGRAM,
+} metricTypeT;
+
+// A counter or a latency histogram (in microseconds). The values are updated
+// with atomic operations, the metrics are never freed.
+typedef struct metric
+{
+    const char *name;        ///< name of the family, without unit suffix
+    const char *help;        ///< description of the family
+    const char *labelName;   ///< name of the label, NULL if none
+    char *labelValue;        ///< value of the label
+    metricTypeT type;
+    uint64_t count;          ///< counter value, or number of observations
+    uint64_t sumUs;          ///< histograms: sum of the observations
+    uint64_t maxUs;          ///< histograms: largest observation
+    uint64_t *buckets;       ///< histograms: METRIC_HISTOGRAM_BUCKETS counts
+    struct metric *next;
+} metricT;
+
+// Summary of a histogram, the quantiles are upper bounds of their buckets
+typedef struct
+{
+    uint64_t count;
+    uint64_t sumUs;
+    uint64_t maxUs;
+    uint64_t p50Us;
+    uint64_t p90Us;
+    uint64_t p99Us;
+} metricSummaryT;
+
+//------------------------------------------------------------------------------
+
+metricT *createMetric(metricTypeT type,
+                      const char *name,
+                      const char *help,
+                      const char *labelName,
+                      const char *labelValue);
+const metricT *listMetrics(void);
+const metricT *nextMetric(const metricT *metric);
+void metricAdd(metricT *metric, uint64_t count);
+void metricObserve(metricT *metric, uint64_t us);
+uint64_t metricNowUs(void);
+void summarizeMetric(const metricT *metric, metricSummaryT *summary);
+int writeOpenMetrics(FILE *output);
+#endif
@@ -0,0 +1,431 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-nl80211.h"
+
+#include <errno.h>
+#include <net/if.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/genetlink.h>
+#include <linux/netlink.h>
+#include <linux/nl80211.h>
+
+#include "wifi-ap-platform.h"
+#include "wifi-ap-utilities.h"
+
+// unsigned versions of the netlink attribute macros
+#define ATTR_ALIGN(len)  (((len) + NLA_ALIGNTO - 1U) & ~(NLA_ALIGNTO - 1U))
+#define ATTR_HDRLEN      ATTR_ALIGN((unsigned)sizeof(struct nlattr))
+#define ATTR_TYPE_MASK   ((unsigned)NLA_TYPE_MASK)
+
+// generic netlink socket
+typedef struct
+{
+    int fd;
+    uint32_t seq;
+} nl_socket_t;
+
+// generic netlink request (the requests of this file are small)
+typedef union {
+    struct nlmsghdr header;
+    char buffer[256];
+} nl_message_t;
+
+// handler of the attributes of the messages of an answer
+typedef void (*nl_handler_t)(const void *attrs, size_t len, void *closure);
+
+/*******************************************************************************
+ *      open a generic netlink socket for an interface                         *
+ *                                                                             *
+ * The socket of the system platform.                                          *
+ *                                                                             *
+ * @return                                                                     *
+ *      the socket and the index of the interface, or a negative errno.        *
+ ******************************************************************************/
+int nl80211OpenSocket(const char *interfaceName, unsigned *ifindex)
+{
+    struct sockaddr_nl address = {.nl_family = AF_NETLINK};
+    struct timeval timeout = {
+        .tv_sec = NL80211_TIMEOUT_MS / 1000,
+        .tv_usec = (NL80211_TIMEOUT_MS % 1000) * 1000,
+    };
+    int fd;
+
+    *ifindex = if_nametoindex(interfaceName);
+    if (*ifindex == 0)
+        return -ENODEV;
+
+    fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_GENERIC);
+    if (fd < 0)
+        return -errno;
+
+    if (bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0 ||
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) <
+            0) {
+        int rc = -errno;
+        close(fd);
+        return rc;
+    }
+    return fd;
+}
+
+/*******************************************************************************
+ *      prepare a generic netlink request                                      *
+ ******************************************************************************/
+static void nl_message_init(nl_message_t *msg,
+                            uint16_t family,
+                            uint16_t flags,
+                            uint8_t cmd)
+{
+    struct genlmsghdr *genl;
+
+    memset(msg, 0, sizeof(*msg));
+    msg->header.nlmsg_len = NLMSG_LENGTH(GENL_HDRLEN);
+    msg->header.nlmsg_type = family;
+    msg->header.nlmsg_flags = (uint16_t)(NLM_F_REQUEST | flags);
+    genl = (struct genlmsghdr *)NLMSG_DATA(&msg->header);
+    genl->cmd = cmd;
+    genl->version = 1;
+}
+
+/*******************************************************************************
+ *      add an attribute to a generic netlink request                          *
+ ******************************************************************************/
+static void nl_message_put(nl_message_t *msg,
+                           uint16_t type,
+                           const void *data,
+                           uint16_t size)
+{
+    uint32_t offset = NLMSG_ALIGN(msg->header.nlmsg_len);
+    struct nlattr *attr = (struct nlattr *)&msg->buffer[offset];
+
+    attr->nla_type = type;
+    attr->nla_len = (uint16_t)(ATTR_HDRLEN + size);
+    if (size != 0)
+        memcpy(&msg->buffer[offset + ATTR_HDRLEN], data, size);
+    msg->header.nlmsg_len = offset + ATTR_ALIGN(attr->nla_len);
+}
+
+/*******************************************************************************
+ *      get the first attribute of a list of attributes                        *
+ ******************************************************************************/
+static const struct nlattr *nla_first(const void *data, size_t len)
+{
+    const struct nlattr *attr = (const struct nlattr *)data;
+
+    return len >= ATTR_HDRLEN && attr->nla_len >= ATTR_HDRLEN &&
+                   attr->nla_len <= len
+               ? attr
+               : NULL;
+}
+
+/*******************************************************************************
+ *      get the next attribute of a list, len is the remaining length          *
+ ******************************************************************************/
+static const struct nlattr *nla_next(const struct nlattr *attr, size_t *len)
+{
+    size_t step = ATTR_ALIGN(attr->nla_len);
+
+    if (step >= *len)
+        return NULL;
+    *len -= step;
+    return nla_first((const char *)attr + step, *len);
+}
+
+/*******************************************************************************
+ *      payload and payload length of an attribute                             *
+ ******************************************************************************/
+static const void *nla_data(const struct nlattr *attr)
+{
+    return (const char *)attr + ATTR_HDRLEN;
+}
+
+static size_t nla_size(const struct nlattr *attr)
+{
+    return (size_t)(attr->nla_len - ATTR_HDRLEN);
+}
+
+static uint32_t nla_u32(const struct nlattr *attr)
+{
+    uint32_t value = 0;
+
+    if (nla_size(attr) >= sizeof(value))
+        memcpy(&value, nla_data(attr), sizeof(value));
+    return value;
+}
+
+static uint16_t nla_u16(const struct nlattr *attr)
+{
+    uint16_t value = 0;
+
+    if (nla_size(attr) >= sizeof(value))
+        memcpy(&value, nla_data(attr), sizeof(value));
+    return value;
+}
+
+/*******************************************************************************
+ *      index a list of attributes by type (unknown types are ignored)         *
+ ******************************************************************************/
+static void nla_parse(const struct nlattr **table,
+                      unsigned max,
+                      const void *data,
+                      size_t len)
+{
+    memset(table, 0, (max + 1) * sizeof(*table));
+    for (const struct nlattr *attr = nla_first(data, len); attr != NULL;
+         attr = nla_next(attr, &len)) {
+        unsigned type = attr->nla_type & ATTR_TYPE_MASK;
+        if (type <= max)
+            table[type] = attr;
+    }
+}
+
+/*******************************************************************************
+ *      send a request and give each message of the answer to a handler        *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, or a negative errno if not.                              *
+ ******************************************************************************/
+static int nl_transact(nl_socket_t *sock,
+                       nl_message_t *msg,
+                       char *buffer,
+                       nl_handler_t handler,
+                       void *closure)
+{
+    msg->header.nlmsg_seq = ++sock->seq;
+    if (send(sock->fd, msg, msg->header.nlmsg_len, 0) < 0)
+        return -errno;
+
+    for (;;) {
+        ssize_t received = recv(sock->fd, buffer, NL80211_BUFFER_SIZE, 0);
+        const char *cursor = buffer;
+        size_t len;
+
+        if (received < 0)
+            return errno == EAGAIN ? -ETIMEDOUT : -errno;
+
+        len = (size_t)received;
+        while (len >= sizeof(struct nlmsghdr)) {
+            const struct nlmsghdr *hdr = (const struct nlmsghdr *)cursor;
+            size_t step = NLMSG_ALIGN(hdr->nlmsg_len);
+
+            if (hdr->nlmsg_len < sizeof(*hdr) || hdr->nlmsg_len > len)
+                return -EBADMSG;
+
+            if (hdr->nlmsg_seq == sock->seq) {
+                if (hdr->nlmsg_type == NLMSG_DONE)
+                    return 0;
+                if (hdr->nlmsg_type == NLMSG_ERROR) {
+                    const struct nlmsgerr *err = NLMSG_DATA(hdr);
+                    return hdr->nlmsg_len < NLMSG_LENGTH(sizeof(*err))
+                               ? -EBADMSG
+                               : err->error;
+                }
+                if (hdr->nlmsg_len >= NLMSG_LENGTH(GENL_HDRLEN))
+                    handler((const char *)NLMSG_DATA(hdr) + GENL_HDRLEN,
+                            hdr->nlmsg_len - NLMSG_LENGTH(GENL_HDRLEN),
+                            closure);
+                if ((hdr->nlmsg_flags & NLM_F_MULTI) == 0)
+                    return 0;
+            }
+
+            if (step >= len)
+                break;
+            cursor += step;
+            len -= step;
+        }
+    }
+}
+
+/*******************************************************************************
+ *      read the family id of an answer to CTRL_CMD_GETFAMILY                  *
+ ******************************************************************************/
+static void family_handler(const void *attrs, size_t len, void *closure)
+{
+    const struct nlattr *table[CTRL_ATTR_MAX + 1];
+
+    nla_parse(table, CTRL_ATTR_MAX, attrs, len);
+    if (table[CTRL_ATTR_FAMILY_ID] != NULL)
+        *(int *)closure = nla_u16(table[CTRL_ATTR_FAMILY_ID]);
+}
+
+/*******************************************************************************
+ *      read the frequencies of a band                                         *
+ ******************************************************************************/
+static void parse_frequencies(wifiAp_RadioCapabilities_t *capabilities,
+                              uint8_t band,
+                              const struct nlattr *freqs)
+{
+    const struct nlattr *table[NL80211_FREQUENCY_ATTR_MAX + 1];
+    size_t len = nla_size(freqs);
+
+    for (const struct nlattr *attr = nla_first(nla_data(freqs), len);
+         attr != NULL; attr = nla_next(attr, &len)) {
+        wifiAp_RadioChannel_t *channel;
+        uint32_t frequency;
+
+        nla_parse(table, NL80211_FREQUENCY_ATTR_MAX, nla_data(attr),
+                  nla_size(attr));
+        if (table[NL80211_FREQUENCY_ATTR_FREQ] == NULL)
+            continue;
+
+        // split dumps may repeat a frequency
+        frequency = nla_u32(table[NL80211_FREQUENCY_ATTR_FREQ]);
+        channel = (wifiAp_RadioChannel_t *)findRadioChannel(capabilities,
+                                                            frequency);
+        if (channel == NULL) {
+            if (capabilities->channelCount >= MAX_RADIO_CHANNELS)
+                continue;
+            channel = &capabilities->channels[capabilities->channelCount++];
+        }
+
+        channel->frequency = frequency;
+        channel->channel = frequencyToChannel(frequency);
+        channel->band = band;
+        channel->disabled = table[NL80211_FREQUENCY_ATTR_DISABLED] != NULL;
+        channel->noIr = table[NL80211_FREQUENCY_ATTR_NO_IR] != NULL;
+        channel->radar = table[NL80211_FREQUENCY_ATTR_RADAR] != NULL;
+        if (table[NL80211_FREQUENCY_ATTR_MAX_TX_POWER] != NULL)
+            channel->maxPower =
+                nla_u32(table[NL80211_FREQUENCY_ATTR_MAX_TX_POWER]);
+    }
+}
+
+/*******************************************************************************
+ *      read the bands of an answer to NL80211_CMD_GET_WIPHY                   *
+ ******************************************************************************/
+static void wiphy_handler(const void *attrs, size_t len, void *closure)
+{
+    wifiAp_RadioCapabilities_t *capabilities = closure;
+    const struct nlattr *table[NL80211_ATTR_MAX + 1];
+    const struct nlattr *band[NL80211_BAND_ATTR_MAX + 1];
+    const struct nlattr *iftype[NL80211_BAND_IFTYPE_ATTR_MAX + 1];
+    const struct nlattr *bands;
+    size_t bandsLen;
+
+    nla_parse(table, NL80211_ATTR_MAX, attrs, len);
+    if (table[NL80211_ATTR_WIPHY] != NULL)
+        capabilities->wiphy = nla_u32(table[NL80211_ATTR_WIPHY]);
+
+    bands = table[NL80211_ATTR_WIPHY_BANDS];
+    if (bands == NULL)
+        return;
+
+    bandsLen = nla_size(bands);
+    for (const struct nlattr *attr = nla_first(nla_data(bands), bandsLen);
+         attr != NULL; attr = nla_next(attr, &bandsLen)) {
+        unsigned index = attr->nla_type & ATTR_TYPE_MASK;
+
+        if (index >= WIFI_AP_BAND_COUNT)
+            continue;
+
+        capabilities->bands[index].present = true;
+        nla_parse(band, NL80211_BAND_ATTR_MAX, nla_data(attr), nla_size(attr));
+        if (band[NL80211_BAND_ATTR_HT_CAPA] != NULL) {
+            capabilities->bands[index].ht = true;
+            capabilities->bands[index].htCapa =
+                nla_u16(band[NL80211_BAND_ATTR_HT_CAPA]);
+        }
+        if (band[NL80211_BAND_ATTR_VHT_CAPA] != NULL) {
+            capabilities->bands[index].vht = true;
+            capabilities->bands[index].vhtCapa =
+                nla_u32(band[NL80211_BAND_ATTR_VHT_CAPA]);
+        }
+        if (band[NL80211_BAND_ATTR_IFTYPE_DATA] != NULL) {
+            const struct nlattr *data = band[NL80211_BAND_ATTR_IFTYPE_DATA];
+            size_t dataLen = nla_size(data);
+
+            for (const struct nlattr *entry = nla_first(nla_data(data), dataLen);
+                 entry != NULL; entry = nla_next(entry, &dataLen)) {
+                nla_parse(iftype, NL80211_BAND_IFTYPE_ATTR_MAX,
+                          nla_data(entry), nla_size(entry));
+                if (iftype[NL80211_BAND_IFTYPE_ATTR_HE_CAP_PHY] != NULL)
+                    capabilities->bands[index].he = true;
+            }
+        }
+        if (band[NL80211_BAND_ATTR_FREQS] != NULL)
+            parse_frequencies(capabilities, (uint8_t)index,
+                              band[NL80211_BAND_ATTR_FREQS]);
+    }
+}
+
+/*******************************************************************************
+ *      read the capabilities of the radio of an interface from nl80211        *
+ *                                                                             *
+ * The bands, the channels allowed by the regulatory domain and the            *
+ * HT/VHT/HE capabilities are read with a split NL80211_CMD_GET_WIPHY dump.    *
+ * capabilities->valid is false when the radio could not be queried.           *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, or a negative errno if not.                              *
+ ******************************************************************************/
+int loadRadioCapabilities(const char *interfaceName,
+                          wifiAp_RadioCapabilities_t *capabilities)
+{
+    nl_socket_t sock;
+    nl_message_t msg;
+    uint32_t ifindex;
+    int family = -1;
+    char *buffer;
+    int rc;
+
+    memset(capabilities, 0, sizeof(*capabilities));
+
+    sock.fd = getPlatform()->openNetlink(interfaceName, &ifindex);
+    if (sock.fd < 0)
+        return sock.fd;
+    sock.seq = (uint32_t)time(NULL);
+
+    buffer = malloc(NL80211_BUFFER_SIZE);
+    if (buffer == NULL) {
+        close(sock.fd);
+        return -ENOMEM;
+    }
+
+    // resolve the id of the nl80211 family
+    nl_message_init(&msg, GENL_ID_CTRL, 0, CTRL_CMD_GETFAMILY);
+    nl_message_put(&msg, CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME,
+                   sizeof(NL80211_GENL_NAME));
+    rc = nl_transact(&sock, &msg, buffer, family_handler, &family);
+    if (rc == 0 && family < 0)
+        rc = -ENOENT;
+
+    // dump the radio of the interface
+    if (rc == 0) {
+        nl_message_init(&msg, (uint16_t)family, NLM_F_DUMP,
+                        NL80211_CMD_GET_WIPHY);
+        nl_message_put(&msg, NL80211_ATTR_IFINDEX, &ifindex, sizeof(ifindex));
+        nl_message_put(&msg, NL80211_ATTR_SPLIT_WIPHY_DUMP, NULL, 0);
+        rc = nl_transact(&sock, &msg, buffer, wiphy_handler, capabilities);
+    }
+    close(sock.fd);
+
+    if (rc == 0 && capabilities->channelCount == 0)
+        rc = -ENODATA;
+    if (rc == 0)
+        capabilities->valid = true;
+    else
+        memset(capabilities, 0, sizeof(*capabilities));
+
+    free(buffer);
+    return rc;
+}
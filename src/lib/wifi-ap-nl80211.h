@@ -0,0 +1,32 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef NL80211_HEADER_FILE
+#define NL80211_HEADER_FILE
+
+#include "wifi-ap-data.h"
+
+// size of the buffer receiving the nl80211 messages
+#define NL80211_BUFFER_SIZE 32768
+
+// max time to wait for an answer of the kernel (ms)
+#define NL80211_TIMEOUT_MS 1000
+
+//------------------------------------------------------------------------------
+
+int nl80211OpenSocket(const char *interfaceName, unsigned *ifindex);
+int loadRadioCapabilities(const char *interfaceName,
+                          wifiAp_RadioCapabilities_t *capabilities);
+#endif
@@ -0,0 +1,145 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-platform.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "wifi-ap-hostapd.h"
+#include "wifi-ap-nl80211.h"
+#include "wifi-ap-utilities.h"
+
+static const char *const domainNames[PLATFORM_DOMAIN_COUNT] = {
+    "link", "daemon", "firewall", "nm", "control",
+};
+
+/*******************************************************************************
+ *      the platform of the system: shell commands, hostapd socket, /tmp files *
+ ******************************************************************************/
+static int system_run_command(platformDomainT domain, const char *cmd)
+{
+    return system(cmd);
+}
+
+static FILE *system_open_command(platformDomainT domain, const char *cmd)
+{
+    return popen(cmd, "r");
+}
+
+static FILE *system_open_events(const char *interfaceName)
+{
+    return popen("iw event", "r");
+}
+
+static FILE *system_create_file(const char *fileName)
+{
+    return fopen(fileName, "w");
+}
+
+static FILE *system_open_file(const char *fileName)
+{
+    return fopen(fileName, "re");
+}
+
+static int system_remove_file(const char *fileName)
+{
+    return remove(fileName) == 0 ? 0 : -errno;
+}
+
+static int system_make_directory(const char *path)
+{
+    return mkdir(path, 0700) == 0 || errno == EEXIST ? 0 : -errno;
+}
+
+static const platformT systemPlatform = {
+    .name = "system",
+    .runCommand = system_run_command,
+    .openCommand = system_open_command,
+    .closeCommand = pclose,
+    .controlCommand = hostapdSocketCommand,
+    .openEvents = system_open_events,
+    .openNetlink = nl80211OpenSocket,
+    .createFile = system_create_file,
+    .writeFile = writeFileAtomically,
+    .openFile = system_open_file,
+    .removeFile = system_remove_file,
+    .makeDirectory = system_make_directory,
+};
+
+// set at the initialization, before any thread runs
+static const platformT *currentPlatform = &systemPlatform;
+
+/*******************************************************************************
+ *      the platform in use, the one of the system by default                  *
+ ******************************************************************************/
+const platformT *getPlatform(void)
+{
+    return currentPlatform;
+}
+
+const platformT *getSystemPlatform(void)
+{
+    return &systemPlatform;
+}
+
+void setPlatform(const platformT *platform)
+{
+    currentPlatform = platform == NULL ? &systemPlatform : platform;
+}
+
+const char *getPlatformDomainName(platformDomainT domain)
+{
+    return domain < PLATFORM_DOMAIN_COUNT ? domainNames[domain] : "unknown";
+}
+
+/*******************************************************************************
+ *      read a whole file through the platform in use                          *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 and the content to free, -EFBIG if longer than maxSize, or -errno    *
+ ******************************************************************************/
+int readPlatformFile(const char *fileName, size_t maxSize, char **content)
+{
+    FILE *file = currentPlatform->openFile(fileName);
+    size_t length;
+    char *text;
+    int rc = 0;
+
+    if (file == NULL)
+        return errno == 0 ? -ENOENT : -errno;
+    text = malloc(maxSize + 1);
+    if (text == NULL) {
+        fclose(file);
+        return -ENOMEM;
+    }
+
+    length = fread(text, 1, maxSize + 1, file);
+    if (ferror(file))
+        rc = -EIO;
+    else if (length > maxSize)
+        rc = -EFBIG;
+    fclose(file);
+
+    if (rc != 0) {
+        free(text);
+        return rc;
+    }
+    text[length] = '\0';
+    *content = text;
+    return 0;
+}
@@ -0,0 +1,93 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef PLATFORM_HEADER_FILE
+#define PLATFORM_HEADER_FILE
+
+#include <stddef.h>
+#include <stdio.h>
+
+// Set of commands of the adapter script (wifi_setup.sh) to drive the WiFi
+// features.
+#define COMMAND_WIFI_HW_START        " WIFI_START"
+#define COMMAND_WIFI_HW_STOP         " WIFI_STOP"
+#define COMMAND_WIFI_SET_EVENT       " WIFI_SET_EVENT"
+#define COMMAND_WIFI_UNSET_EVENT     " WIFI_UNSET_EVENT"
+#define COMMAND_WIFI_FIREWALLD_ALLOW " WIFI_FIREWALLD_ALLOW"
+#define COMMAND_WIFI_NM_UNMANAGE     " WIFI_NM_UNMANAGE"
+#define COMMAND_WIFIAP_HOSTAPD_START " WIFIAP_HOSTAPD_START"
+#define COMMAND_WIFIAP_HOSTAPD_STOP  " WIFIAP_HOSTAPD_STOP"
+#define COMMAND_WIFIAP_WLAN_UP       " WIFIAP_WLAN_UP"
+#define COMMAND_DNSMASQ_RESTART      " DNSMASQ_RESTART"
+#define COMMAND_WIFI_SURVEY          " WIFI_SURVEY"
+#define COMMAND_WIFIAP_TC_CLEAR      " WIFIAP_TC_CLEAR"
+#define COMMAND_WIFIAP_TC_SETUP      " WIFIAP_TC_SETUP"
+#define COMMAND_WIFIAP_TC_STATION    " WIFIAP_TC_STATION"
+#define COMMAND_WIFIAP_TC_STATS      " WIFIAP_TC_STATS"
+
+// What a command acts on, for the fake platform and its log of the calls
+typedef enum
+{
+    PLATFORM_LINK,       ///< interfaces and radios (iw, ip, the hardware)
+    PLATFORM_DAEMON,     ///< hostapd and dnsmasq processes
+    PLATFORM_FIREWALL,   ///< firewalld and the traffic control
+    PLATFORM_NM,         ///< NetworkManager
+    PLATFORM_CONTROL,    ///< control interface of hostapd
+    PLATFORM_DOMAIN_COUNT,
+} platformDomainT;
+
+// The side effects of the binding: every command, event source, socket and
+// file goes through the platform in use.
+typedef struct
+{
+    const char *name;
+
+    // link, daemons, firewall and NetworkManager: the status is the one of
+    // system(), the output of an opened command is closed by closeCommand
+    int (*runCommand)(platformDomainT domain, const char *cmd);
+    FILE *(*openCommand)(platformDomainT domain, const char *cmd);
+    int (*closeCommand)(FILE *output);
+
+    // control interface of hostapd: length of the reply or -errno
+    int (*controlCommand)(const char *interfaceName,
+                          const char *command,
+                          char *reply,
+                          size_t replySize);
+
+    // event source: the lines of "iw event", closed by closeCommand
+    FILE *(*openEvents)(const char *interfaceName);
+
+    // nl80211: a generic netlink socket closed by close() and the index of
+    // the interface, or -errno
+    int (*openNetlink)(const char *interfaceName, unsigned *ifindex);
+
+    // files: a file created for writing, a file replaced atomically, a file
+    // opened for reading, a file removed and a directory created if missing
+    // (0 or -errno)
+    FILE *(*createFile)(const char *fileName);
+    int (*writeFile)(const char *fileName, const char *content);
+    FILE *(*openFile)(const char *fileName);
+    int (*removeFile)(const char *fileName);
+    int (*makeDirectory)(const char *path);
+} platformT;
+
+//------------------------------------------------------------------------------
+
+const platformT *getPlatform(void);
+const platformT *getSystemPlatform(void);
+void setPlatform(const platformT *platform);
+const char *getPlatformDomainName(platformDomainT domain);
+int readPlatformFile(const char *fileName, size_t maxSize, char **content);
+#endif
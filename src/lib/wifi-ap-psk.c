@@ -0,0 +1,404 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-psk.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wifi-ap-platform.h"
+
+#define SHA1_BLOCK_LENGTH  64
+#define SHA1_DIGEST_LENGTH 20
+
+// length of the hexadecimal key
+#define WPA_PSK_HEX_LENGTH (2 * WPA_PSK_LENGTH)
+
+// content of the cache file: the key, the length of the SSID, the SSID and
+// the passphrase
+#define WPA_PSK_CACHE_FORMAT "%s %zu\n%s%s"
+
+typedef struct
+{
+    uint32_t state[5];
+    uint64_t length;
+    unsigned char block[SHA1_BLOCK_LENGTH];
+    size_t used;
+} sha1ContextT;
+
+// HMAC-SHA1 with the inner and outer pads of the key already hashed
+typedef struct
+{
+    sha1ContextT inner;
+    sha1ContextT outer;
+} hmacSha1ContextT;
+
+static char *pskCacheDir;
+
+// last derived key, the derivation is only done again if the SSID or the
+// passphrase change
+static struct
+{
+    char *ssid;  // NULL if no key
+    char *passphrase;
+    char psk[WPA_PSK_HEX_LENGTH + 1];
+} lastPsk;
+
+static pthread_mutex_t psk_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *      SHA-1 (FIPS 180-4)                                                     *
+ ******************************************************************************/
+static uint32_t rol32(uint32_t value, unsigned count)
+{
+    return (value << count) | (value >> (32 - count));
+}
+
+static void sha1_init(sha1ContextT *context)
+{
+    context->state[0] = 0x67452301;
+    context->state[1] = 0xefcdab89;
+    context->state[2] = 0x98badcfe;
+    context->state[3] = 0x10325476;
+    context->state[4] = 0xc3d2e1f0;
+    context->length = 0;
+    context->used = 0;
+}
+
+static void sha1_transform(uint32_t state[5], const unsigned char *block)
+{
+    uint32_t w[80], a, b, c, d, e, f, k, t;
+
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)block[4 * i] << 24 |
+               (uint32_t)block[4 * i + 1] << 16 |
+               (uint32_t)block[4 * i + 2] << 8 | (uint32_t)block[4 * i + 3];
+    for (int i = 16; i < 80; i++)
+        w[i] = rol32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+    a = state[0];
+    b = state[1];
+    c = state[2];
+    d = state[3];
+    e = state[4];
+    for (int i = 0; i < 80; i++) {
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5a827999;
+        }
+        else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ed9eba1;
+        }
+        else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8f1bbcdc;
+        }
+        else {
+            f = b ^ c ^ d;
+            k = 0xca62c1d6;
+        }
+        t = rol32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rol32(b, 30);
+        b = a;
+        a = t;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+static void sha1_update(sha1ContextT *context,
+                        const unsigned char *data,
+                        size_t length)
+{
+    context->length += length;
+    while (length > 0) {
+        size_t count = SHA1_BLOCK_LENGTH - context->used;
+
+        if (count > length)
+            count = length;
+        memcpy(&context->block[context->used], data, count);
+        context->used += count;
+        data += count;
+        length -= count;
+        if (context->used == SHA1_BLOCK_LENGTH) {
+            sha1_transform(context->state, context->block);
+            context->used = 0;
+        }
+    }
+}
+
+static void sha1_final(sha1ContextT *context,
+                       unsigned char digest[SHA1_DIGEST_LENGTH])
+{
+    uint64_t bits = context->length * 8;
+    unsigned char padding = 0x80;
+    unsigned char size[8];
+
+    for (int i = 0; i < 8; i++)
+        size[i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha1_update(context, &padding, 1);
+    padding = 0;
+    while (context->used != SHA1_BLOCK_LENGTH - sizeof(size))
+        sha1_update(context, &padding, 1);
+    sha1_update(context, size, sizeof(size));
+
+    for (int i = 0; i < SHA1_DIGEST_LENGTH; i++)
+        digest[i] =
+            (unsigned char)(context->state[i / 4] >> (24 - 8 * (i % 4)));
+}
+
+/*******************************************************************************
+ *      HMAC-SHA1 (RFC 2104)                                                   *
+ *                                                                             *
+ * The pads of the key are hashed once, each HMAC then starts from a copy.     *
+ ******************************************************************************/
+static void hmac_sha1_init(hmacSha1ContextT *context,
+                           const unsigned char *key,
+                           size_t keyLength)
+{
+    unsigned char pad[SHA1_BLOCK_LENGTH];
+    unsigned char digest[SHA1_DIGEST_LENGTH];
+
+    if (keyLength > SHA1_BLOCK_LENGTH) {
+        sha1_init(&context->inner);
+        sha1_update(&context->inner, key, keyLength);
+        sha1_final(&context->inner, digest);
+        key = digest;
+        keyLength = sizeof(digest);
+    }
+
+    memset(pad, 0x36, sizeof(pad));
+    for (size_t i = 0; i < keyLength; i++)
+        pad[i] ^= key[i];
+    sha1_init(&context->inner);
+    sha1_update(&context->inner, pad, sizeof(pad));
+
+    memset(pad, 0x5c, sizeof(pad));
+    for (size_t i = 0; i < keyLength; i++)
+        pad[i] ^= key[i];
+    sha1_init(&context->outer);
+    sha1_update(&context->outer, pad, sizeof(pad));
+}
+
+static void hmac_sha1(const hmacSha1ContextT *context,
+                      const unsigned char *data,
+                      size_t length,
+                      unsigned char digest[SHA1_DIGEST_LENGTH])
+{
+    sha1ContextT sha1 = context->inner;
+
+    sha1_update(&sha1, data, length);
+    sha1_final(&sha1, digest);
+    sha1 = context->outer;
+    sha1_update(&sha1, digest, SHA1_DIGEST_LENGTH);
+    sha1_final(&sha1, digest);
+}
+
+/*******************************************************************************
+ *      PBKDF2 with HMAC-SHA1 (RFC 8018)                                       *
+ ******************************************************************************/
+void pbkdf2Sha1(const char *password,
+                const unsigned char *salt,
+                size_t saltLength,
+                unsigned iterations,
+                unsigned char *key,
+                size_t keyLength)
+{
+    hmacSha1ContextT hmac;
+    sha1ContextT sha1;
+    unsigned char u[SHA1_DIGEST_LENGTH];
+    unsigned char t[SHA1_DIGEST_LENGTH];
+    unsigned char index[4];
+
+    hmac_sha1_init(&hmac, (const unsigned char *)password, strlen(password));
+    for (uint32_t block = 1; keyLength > 0; block++) {
+        size_t count =
+            keyLength < SHA1_DIGEST_LENGTH ? keyLength : SHA1_DIGEST_LENGTH;
+
+        // U1 = HMAC(password, salt || INT(block))
+        for (int i = 0; i < 4; i++)
+            index[i] = (unsigned char)(block >> (24 - 8 * i));
+        sha1 = hmac.inner;
+        sha1_update(&sha1, salt, saltLength);
+        sha1_update(&sha1, index, sizeof(index));
+        sha1_final(&sha1, u);
+        sha1 = hmac.outer;
+        sha1_update(&sha1, u, sizeof(u));
+        sha1_final(&sha1, u);
+        memcpy(t, u, sizeof(t));
+
+        for (unsigned i = 1; i < iterations; i++) {
+            hmac_sha1(&hmac, u, sizeof(u), u);
+            for (int j = 0; j < SHA1_DIGEST_LENGTH; j++)
+                t[j] ^= u[j];
+        }
+
+        memcpy(key, t, count);
+        key += count;
+        keyLength -= count;
+    }
+}
+
+/*******************************************************************************
+ *      derive the WPA pre-shared key of a passphrase (IEEE 802.11i H.4)       *
+ *                                                                             *
+ * The key is written in hexadecimal, as expected by wpa_psk.                  *
+ ******************************************************************************/
+void deriveWpaPsk(const char *ssid,
+                  const char *passphrase,
+                  char psk[2 * WPA_PSK_LENGTH + 1])
+{
+    unsigned char key[WPA_PSK_LENGTH];
+
+    pbkdf2Sha1(passphrase, (const unsigned char *)ssid, strlen(ssid),
+               WPA_PSK_ITERATIONS, key, sizeof(key));
+    for (int i = 0; i < WPA_PSK_LENGTH; i++)
+        sprintf(&psk[2 * i], "%02x", key[i]);
+}
+
+/*******************************************************************************
+ *      set the directory where the derived key is kept between restarts       *
+ ******************************************************************************/
+void setWpaPskCacheDir(const char *cacheDir)
+{
+    pthread_mutex_lock(&psk_mutex);
+    free(pskCacheDir);
+    pskCacheDir = cacheDir == NULL ? NULL : strdup(cacheDir);
+    pthread_mutex_unlock(&psk_mutex);
+}
+
+/*******************************************************************************
+ *      read or write the derived key in <cacheDir>/psk                        *
+ *                                                                             *
+ * The file holds the key followed by the SSID and the passphrase it was       *
+ * derived from, which must match. It goes through the platform in use.        *
+ ******************************************************************************/
+static int get_cached_psk_path(char *path, size_t size)
+{
+    if (snprintf(path, size, "%s/%s", pskCacheDir, WPA_PSK_CACHE_FILE) >=
+        (int)size)
+        return -ENAMETOOLONG;
+    return 0;
+}
+
+static int read_cached_psk(const char *ssid, const char *passphrase, char *psk)
+{
+    char path[PATH_MAX];
+    char *content, *expected;
+    int rc;
+
+    rc = get_cached_psk_path(path, sizeof(path));
+    if (rc != 0)
+        return rc;
+    rc = readPlatformFile(path,
+                          WPA_PSK_HEX_LENGTH + 32 + strlen(ssid) +
+                              strlen(passphrase),
+                          &content);
+    if (rc != 0)
+        return rc;
+
+    rc = -EBADMSG;
+    if (strspn(content, "0123456789abcdef") == WPA_PSK_HEX_LENGTH) {
+        memcpy(psk, content, WPA_PSK_HEX_LENGTH);
+        psk[WPA_PSK_HEX_LENGTH] = '\0';
+        if (asprintf(&expected, WPA_PSK_CACHE_FORMAT, psk, strlen(ssid), ssid,
+                     passphrase) < 0) {
+            rc = -ENOMEM;
+        }
+        else {
+            if (strcmp(content, expected) == 0)
+                rc = 0;
+            free(expected);
+        }
+    }
+    free(content);
+    return rc;
+}
+
+static int write_cached_psk(const char *ssid,
+                            const char *passphrase,
+                            const char *psk)
+{
+    char path[PATH_MAX];
+    char *content;
+    int rc;
+
+    rc = getPlatform()->makeDirectory(pskCacheDir);
+    if (rc == 0)
+        rc = get_cached_psk_path(path, sizeof(path));
+    if (rc != 0)
+        return rc;
+    if (asprintf(&content, WPA_PSK_CACHE_FORMAT, psk, strlen(ssid), ssid,
+                 passphrase) < 0)
+        return -ENOMEM;
+    rc = getPlatform()->writeFile(path, content);
+    free(content);
+    return rc;
+}
+
+/*******************************************************************************
+ *      get the WPA pre-shared key of a passphrase                             *
+ *                                                                             *
+ * The 4096 iterations of PBKDF2 are only run when the SSID or the passphrase  *
+ * change: the last key is kept in memory and, when a cache directory is set,  *
+ * in <cacheDir>/psk for the next starts.                                      *
+ *                                                                             *
+ * @return                                                                     *
+ *      1 if the key was derived, 0 if it came from the cache                  *
+ ******************************************************************************/
+int getWpaPsk(const char *ssid,
+              const char *passphrase,
+              char psk[2 * WPA_PSK_LENGTH + 1])
+{
+    int derived = 0;
+
+    pthread_mutex_lock(&psk_mutex);
+    if (lastPsk.ssid == NULL || strcmp(lastPsk.ssid, ssid) != 0 ||
+        strcmp(lastPsk.passphrase, passphrase) != 0) {
+        if (pskCacheDir == NULL ||
+            read_cached_psk(ssid, passphrase, lastPsk.psk) != 0) {
+            deriveWpaPsk(ssid, passphrase, lastPsk.psk);
+            if (pskCacheDir != NULL)
+                write_cached_psk(ssid, passphrase, lastPsk.psk);
+            derived = 1;
+        }
+        free(lastPsk.ssid);
+        free(lastPsk.passphrase);
+        lastPsk.ssid = strdup(ssid);
+        lastPsk.passphrase = strdup(passphrase);
+        if (lastPsk.ssid == NULL || lastPsk.passphrase == NULL) {
+            free(lastPsk.ssid);
+            free(lastPsk.passphrase);
+            lastPsk.ssid = lastPsk.passphrase = NULL;
+        }
+    }
+    memcpy(psk, lastPsk.psk, sizeof(lastPsk.psk));
+    pthread_mutex_unlock(&psk_mutex);
+    return derived;
+}
@@ -0,0 +1,45 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef PSK_HEADER_FILE
+#define PSK_HEADER_FILE
+
+#include <stddef.h>
+
+// PBKDF2-SHA1 iterations of the WPA passphrase (IEEE 802.11i)
+#define WPA_PSK_ITERATIONS 4096
+
+// length of the derived key in bytes
+#define WPA_PSK_LENGTH 32
+
+// name of the file keeping the derived key in the cache directory
+#define WPA_PSK_CACHE_FILE "psk"
+
+//------------------------------------------------------------------------------
+
+void pbkdf2Sha1(const char *password,
+                const unsigned char *salt,
+                size_t saltLength,
+                unsigned iterations,
+                unsigned char *key,
+                size_t keyLength);
+void deriveWpaPsk(const char *ssid,
+                  const char *passphrase,
+                  char psk[2 * WPA_PSK_LENGTH + 1]);
+void setWpaPskCacheDir(const char *cacheDir);
+int getWpaPsk(const char *ssid,
+              const char *passphrase,
+              char psk[2 * WPA_PSK_LENGTH + 1]);
+#endif
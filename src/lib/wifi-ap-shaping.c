@@ -0,0 +1,97 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-shaping.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <strings.h>
+
+#include "wifi-ap-utilities.h"
+
+/*******************************************************************************
+ *      parse the output of "tc -s class show dev <iface>"                     *
+ *                                                                             *
+ * Only the classes of the root qdisc 1: are kept.                             *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of classes read, or -1 if input is invalid                  *
+ ******************************************************************************/
+int parseTcClassStats(FILE *input, wifiApTcStatsT *stats)
+{
+    char line[256];
+    wifiApTcClassT *entry = NULL;
+    unsigned major, minor;
+
+    if (input == NULL || stats == NULL)
+        return -1;
+
+    memset(stats, 0, sizeof(*stats));
+    while (fgets(line, sizeof(line), input) != NULL) {
+        if (sscanf(line, "class %*s %x:%x", &major, &minor) == 2) {
+            entry = major == 1 && stats->count < MAX_TC_CLASSES
+                        ? &stats->classes[stats->count++]
+                        : NULL;
+            if (entry != NULL)
+                entry->minor = minor;
+        }
+        else if (entry != NULL &&
+                 sscanf(line, " Sent %" SCNu64 " bytes %" SCNu64
+                              " pkt (dropped %" SCNu64,
+                        &entry->bytes, &entry->packets, &entry->drops) >= 2)
+            entry = NULL;
+    }
+    return (int)stats->count;
+}
+
+/*******************************************************************************
+ *      find the statistics of a class                                         *
+ ******************************************************************************/
+const wifiApTcClassT *findTcClass(const wifiApTcStatsT *stats, uint32_t minor)
+{
+    for (unsigned i = 0; i < stats->count; i++) {
+        if (stats->classes[i].minor == minor)
+            return &stats->classes[i];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ *      find the IP address leased to a MAC address in a dnsmasq lease file    *
+ *                                                                             *
+ * The lines are "<expiry> <mac> <ip> <hostname> <client id>".                 *
+ *                                                                             *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_NOT_FOUND if the MAC address has no lease                *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int findLeaseAddress(FILE *leases,
+                     const char *mac,
+                     char ip[MAX_IP_ADDRESS_LENGTH + 1])
+{
+    char line[256];
+    char leaseMac[MAC_ADDRESS_LENGTH + 1];
+    char leaseIp[MAX_IP_ADDRESS_LENGTH + 1];
+
+    while (leases != NULL && fgets(line, sizeof(line), leases) != NULL) {
+        if (sscanf(line, "%*s %17s %15s", leaseMac, leaseIp) == 2 &&
+            !strcasecmp(leaseMac, mac)) {
+            utf8_Copy(ip, leaseIp, MAX_IP_ADDRESS_LENGTH + 1, NULL);
+            return WIFIAP_NO_ERROR;
+        }
+    }
+    return WIFIAP_ERROR_NOT_FOUND;
+}
@@ -0,0 +1,55 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef SHAPING_HEADER_FILE
+#define SHAPING_HEADER_FILE
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "wifi-ap-data.h"
+
+// HTB classes of the interface: the access point, the stations without limit
+// and the limited stations (SHAPING_STATION_CLASS + index of the limit)
+#define SHAPING_SSID_CLASS    0x1
+#define SHAPING_DEFAULT_CLASS 0x2
+#define SHAPING_STATION_CLASS 0x10
+
+// max number of classes kept from the statistics
+#define MAX_TC_CLASSES (SHAPING_STATION_CLASS + MAX_STATION_LIMITS)
+
+// Statistics of one class (as reported by "tc -s class show dev <iface>")
+typedef struct
+{
+    uint32_t minor;  ///< minor of the class id (1:minor)
+    uint64_t bytes;
+    uint64_t packets;
+    uint64_t drops;
+} wifiApTcClassT;
+
+typedef struct
+{
+    unsigned count;
+    wifiApTcClassT classes[MAX_TC_CLASSES];
+} wifiApTcStatsT;
+
+//------------------------------------------------------------------------------
+
+int parseTcClassStats(FILE *input, wifiApTcStatsT *stats);
+const wifiApTcClassT *findTcClass(const wifiApTcStatsT *stats, uint32_t minor);
+int findLeaseAddress(FILE *leases,
+                     const char *mac,
+                     char ip[MAX_IP_ADDRESS_LENGTH + 1]);
+#endif
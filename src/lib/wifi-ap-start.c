@@ -0,0 +1,538 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+/*******************************************************************************
+ *      start and stop of the access point                                     *
+ *                                                                             *
+ * The sequence run by the binding and by wifiap-ctl: the commands of the      *
+ * adapter script and the generated files go through the platform in use.      *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include "wifi-ap-start.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/wait.h>
+
+#define AFB_BINDING_VERSION 4
+#include <afb/afb-binding.h>
+
+#include "wifi-ap-cache.h"
+#include "wifi-ap-config.h"
+#include "wifi-ap-json.h"
+#include "wifi-ap-metrics.h"
+#include "wifi-ap-survey.h"
+#include "wifi-ap-utilities.h"
+
+static const char *const stageNames[AP_STAGE_COUNT] = {
+    "cleanup",        "cache",    "dnsmasq", "survey", "network",
+    "hostapd-config", "hardware", "hostapd"};
+
+// the files kept by the cache, restored together
+static const char *const cachedFiles[] = {
+    WIFI_HOSTAPD_FILE, WIFI_DNSMASQ_FILE, WIFI_HOSTS_FILE,
+    WIFI_HOSTAPD_ACCEPT_FILE, WIFI_HOSTAPD_DENY_FILE};
+#define CACHED_FILES_COUNT (unsigned)(sizeof cachedFiles / sizeof *cachedFiles)
+
+/*******************************************************************************
+ *      the name of a stage, for the metrics and the traces                    *
+ ******************************************************************************/
+const char *getApStageName(apStageT stage)
+{
+    return stage < AP_STAGE_COUNT ? stageNames[stage] : "unknown";
+}
+
+/*******************************************************************************
+ *      run a command, through the hook of the caller if any                   *
+ *                                                                             *
+ * @return                                                                     *
+ *      the status of the command, as system() gives it                        *
+ ******************************************************************************/
+static int run_command(const apStartT *start,
+                       platformDomainT domain,
+                       const char *cmd)
+{
+    return start->runCommand != NULL ? start->runCommand(domain, cmd)
+                                     : getPlatform()->runCommand(domain, cmd);
+}
+
+static int run_script(const apStartT *start,
+                      platformDomainT domain,
+                      const char *command,
+                      const char *interfaceName,
+                      const char *argument)
+{
+    char cmd[PATH_MAX];
+
+    snprintf(cmd, sizeof(cmd), "%s %s %s%s%s", start->script, command,
+             interfaceName, argument == NULL ? "" : " ",
+             argument == NULL ? "" : argument);
+    return run_command(start, domain, cmd);
+}
+
+static bool succeeded(int status)
+{
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*******************************************************************************
+ *      end a stage, the next one starts now                                   *
+ ******************************************************************************/
+static void end_stage(const apStartT *start, apStageT stage, uint64_t *startUs)
+{
+    uint64_t nowUs = metricNowUs();
+
+    if (start->endStage != NULL)
+        start->endStage(stage, nowUs - *startUs);
+    *startUs = nowUs;
+}
+
+static void file_generated(const apStartT *start, apFileT file)
+{
+    if (start->fileGenerated != NULL)
+        start->fileGenerated(file);
+}
+
+/*******************************************************************************
+ *      Start the access point dnsmasq service                                 *
+ *                                                                             *
+ * The dnsmasq and hosts files are not generated again when restored from the  *
+ * cache (generate is false).                                                  *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, -1 if an address is not valid, -2 if dnsmasq failed      *
+ ******************************************************************************/
+int setApDnsmasq(const apStartT *start, wifiApT *wifiApData, bool generate)
+{
+    struct sockaddr_in saApPtr;
+    struct sockaddr_in saStartPtr;
+    struct sockaddr_in saStopPtr;
+    struct sockaddr_in saNetmaskPtr;
+    const char *parameterPtr = 0;
+    char ip_ap_cidr[128];
+    int systemResult;
+
+    // Check the parameters
+    if ((wifiApData->ip_ap[0] == '\0') || (wifiApData->ip_start[0] == '\0') ||
+        (wifiApData->ip_stop[0] == '\0') ||
+        (wifiApData->ip_netmask[0] == '\0')) {
+        return -2;
+    }
+
+    if (inet_pton(AF_INET, wifiApData->ip_ap, &saApPtr.sin_addr) <= 0) {
+        parameterPtr = "AP";
+    }
+    else if (inet_pton(AF_INET, wifiApData->ip_start, &saStartPtr.sin_addr) <=
+             0) {
+        parameterPtr = "start";
+    }
+    else if (inet_pton(AF_INET, wifiApData->ip_stop, &saStopPtr.sin_addr) <=
+             0) {
+        parameterPtr = "stop";
+    }
+    else if (inet_pton(AF_INET, wifiApData->ip_netmask,
+                       &saNetmaskPtr.sin_addr) <= 0) {
+        parameterPtr = "Netmask";
+    }
+
+    if (parameterPtr != NULL) {
+        AFB_ERROR("Invalid %s IP address", parameterPtr);
+        return -1;
+    }
+
+    // get ip address with CIDR annotation
+    snprintf(ip_ap_cidr, sizeof(ip_ap_cidr), "%s/%d", wifiApData->ip_ap,
+             toCidr(wifiApData->ip_netmask));
+
+    {
+        unsigned int ap = ntohl(saApPtr.sin_addr.s_addr);
+        unsigned int first = ntohl(saStartPtr.sin_addr.s_addr);
+        unsigned int last = ntohl(saStopPtr.sin_addr.s_addr);
+        unsigned int netmask = ntohl(saNetmaskPtr.sin_addr.s_addr);
+
+        AFB_INFO("@AP=%x, @APstart=%x, @APstop=%x, @APnetmask=%x  @AP_CIDR=%s",
+                 ap, first, last, netmask, ip_ap_cidr);
+
+        if (first > last) {
+            AFB_INFO("Need to swap start & stop IP addresses");
+            first = first ^ last;
+            last = last ^ first;
+            first = first ^ last;
+        }
+
+        if ((ap >= first) && (ap <= last)) {
+            AFB_ERROR("AP IP address is within the range");
+            return -2;
+        }
+    }
+
+    systemResult = run_script(start, PLATFORM_LINK, COMMAND_WIFIAP_WLAN_UP,
+                              wifiApData->interfaceName, wifiApData->ip_ap);
+    if (WEXITSTATUS(systemResult) != 0) {
+        AFB_ERROR("Unable to mount the network interface");
+        return -2;
+    }
+
+    if (generate) {
+        if (createHostsConfigFile(wifiApData->ip_ap, wifiApData->hostName)) {
+            AFB_ERROR("Unable to add a new hostname config file");
+            return -2;
+        }
+        file_generated(start, AP_FILE_HOSTS);
+
+        if (createDnsmasqConfigFile(wifiApData)) {
+            AFB_ERROR("Unable to create Dnsmasq config file");
+            return -2;
+        }
+        file_generated(start, AP_FILE_DNSMASQ);
+    }
+
+    AFB_INFO("@AP=%s, @APstart=%s, @APstop=%s", wifiApData->ip_ap,
+             wifiApData->ip_start, wifiApData->ip_stop);
+
+    systemResult = run_script(start, PLATFORM_DAEMON, COMMAND_DNSMASQ_RESTART,
+                              wifiApData->interfaceName, ip_ap_cidr);
+    if (WEXITSTATUS(systemResult) != 0) {
+        AFB_ERROR("Unable to restart the Dnsmasq.");
+        return -2;
+    }
+    AFB_INFO("Dnsmasq configuration file created successfully!");
+    return 0;
+}
+
+/*******************************************************************************
+ *      survey the channels and select the least loaded one                    *
+ *                                                                             *
+ * @return                                                                     *
+ *     * 0 if a channel has been selected                                      *
+ *     * WIFIAP_ERROR_NOT_FOUND if no channel of the survey is usable          *
+ *     * -1 if the survey failed                                               *
+ ******************************************************************************/
+int surveyApChannel(const apStartT *start,
+                    const wifiApT *wifiApData,
+                    bool apForce,
+                    uint16_t *channel,
+                    double *cost)
+{
+    wifiApSurveyT survey;
+    char cmd[PATH_MAX];
+    FILE *surveyPipePtr;
+    int count, status;
+
+    // the scan refreshes the survey data of every channel
+    snprintf(cmd, sizeof(cmd), "%s %s %s %s", start->script,
+             COMMAND_WIFI_SURVEY, wifiApData->interfaceName,
+             apForce ? "ap-force" : "");
+
+    surveyPipePtr = start->openCommand != NULL
+                        ? start->openCommand(PLATFORM_LINK, cmd)
+                        : getPlatform()->openCommand(PLATFORM_LINK, cmd);
+    if (NULL == surveyPipePtr) {
+        AFB_ERROR("Failed to run command:\"%s\" errno:%d %s",
+                  COMMAND_WIFI_SURVEY, errno, strerror(errno));
+        return -1;
+    }
+    count = parseSurveyDump(surveyPipePtr, &survey);
+    status = getPlatform()->closeCommand(surveyPipePtr);
+    if (!succeeded(status) || count <= 0) {
+        AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)", COMMAND_WIFI_SURVEY,
+                  status);
+        return -1;
+    }
+
+    return selectSurveyChannel(&survey, wifiApData, channel, cost);
+}
+
+/*******************************************************************************
+ *      NetworkManager and firewalld, their commands may fail                  *
+ ******************************************************************************/
+static void set_network(const apStartT *start, const wifiApT *wifiApData)
+{
+    // Check and resolve conflicts with Network Manager
+    AFB_INFO("Check if Network Manager is installed");
+    if (run_command(start, PLATFORM_NM, "nmcli -v >/dev/null") == 0) {
+        AFB_DEBUG("Network Manager is installed on system!");
+
+        // Disable Network Manager for interface
+        AFB_WARNING(
+            "interface %s WILL no longer be managed by Network Manager...",
+            wifiApData->interfaceName);
+        if (run_script(start, PLATFORM_NM, COMMAND_WIFI_NM_UNMANAGE,
+                       wifiApData->interfaceName, NULL) == 0)
+            AFB_DEBUG("Network Manager IS disabled for interface %s!",
+                      wifiApData->interfaceName);
+        else
+            AFB_ERROR("Unable to disable Network Manager for interface %s!",
+                      wifiApData->interfaceName);
+    }
+
+    // Check if firewalld is running and allow dhcp traffic
+    AFB_INFO("Check if firewalld service is enabled");
+    if (run_command(start, PLATFORM_FIREWALL, "pgrep firewalld >/dev/null") ==
+        0) {
+        AFB_DEBUG("Firewalld is enabled on target!");
+
+        // Allow DHCP traffic through
+        AFB_WARNING(
+            "DHCP traffic WILL be no longer be blocked by firewalld...");
+        if (run_script(start, PLATFORM_FIREWALL, COMMAND_WIFI_FIREWALLD_ALLOW,
+                       wifiApData->interfaceName, NULL) == 0)
+            AFB_DEBUG("DHCP traffic IS allowed through!");
+        else
+            AFB_ERROR("Unable to allow DHCP traffic through!");
+    }
+}
+
+/*******************************************************************************
+ *      hash of the settings the generated files depend on                     *
+ ******************************************************************************/
+static bool hash_settings(const wifiApT *wifiApData, uint64_t *hash)
+{
+    struct json_object *settingsJ = wifiApDataToJson(wifiApData);
+
+    if (settingsJ == NULL)
+        return false;
+    *hash = hashConfigCache(CONFIG_FILES_VERSION HOSTAPD_CONFIG_TEMPLATES,
+                            CONFIG_CACHE_HASH_INIT);
+    *hash = hashConfigCache(json_object_to_json_string(settingsJ), *hash);
+    json_object_put(settingsJ);
+    return true;
+}
+
+/*******************************************************************************
+ *      start the access point: dnsmasq, the radio and hostapd                 *
+ *                                                                             *
+ * The event thread and the services of the binding are started by the         *
+ * caller, once the access point is up.                                        *
+ *                                                                             *
+ * @return                                                                     *
+ *     * 0 if hostapd started                                                  *
+ *     * -1 if no SSID is set                                                  *
+ *     * -2 if the channel is not valid                                        *
+ *     * -3 if hostapd.conf could not be generated                             *
+ *     * -4 if the WiFi card is not inserted                                   *
+ *     * -5 if the WiFi card could not be reset                                *
+ *     * -6 if the WiFi hardware failed to start                               *
+ *     * -7 if hostapd failed to start                                         *
+ *     * -8 if dnsmasq failed to start                                         *
+ *     * -9 if the previous hostapd could not be stopped                       *
+ ******************************************************************************/
+int startWifiAp(const apStartT *start, wifiApT *wifiApData)
+{
+    uint64_t cacheHash = 0, stageUs = metricNowUs();
+    bool cached = false, store = false;
+    int systemResult, error;
+
+    if (checkFileExists(WIFI_DNSMASQ_FILE) ||
+        checkFileExists(WIFI_HOSTS_FILE)) {
+        AFB_WARNING("Need to clean previous configuration for AP!");
+        systemResult = run_script(start, PLATFORM_DAEMON,
+                                  COMMAND_WIFIAP_HOSTAPD_STOP,
+                                  wifiApData->interfaceName, NULL);
+        if (!succeeded(systemResult)) {
+            AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)",
+                      COMMAND_WIFIAP_HOSTAPD_STOP, systemResult);
+            return -9;
+        }
+    }
+    end_stage(start, AP_STAGE_CLEANUP, &stageUs);
+
+    // warm start: the files generated for the same settings are reused
+    if (start->cacheDir != NULL &&
+        wifiApData->autoChannel != WIFI_AP_AUTO_CHANNEL_SURVEY &&
+        hash_settings(wifiApData, &cacheHash)) {
+        error = getConfigCache(start->cacheDir, cacheHash, cachedFiles,
+                               CACHED_FILES_COUNT);
+        cached = error == 0;
+        store = error == -ENOENT;
+        AFB_INFO("Generated files %016" PRIx64 " %s", cacheHash,
+                 cached ? "restored from the cache" : "not in the cache");
+    }
+    end_stage(start, AP_STAGE_CACHE, &stageUs);
+
+    error = setApDnsmasq(start, wifiApData, !cached);
+    if (error) {
+        AFB_ERROR("Failed to set up Dnsmasq (error: %d). Checking system...",
+                  error);
+        return -8;
+    }
+    end_stage(start, AP_STAGE_DNSMASQ, &stageUs);
+
+    // Check that an SSID is provided before starting
+    if ('\0' == wifiApData->ssid[0]) {
+        AFB_ERROR("Unable to start AP because no valid SSID provided");
+        return -1;
+    }
+
+    // Select the least loaded channel, the configured one is the fallback
+    if (wifiApData->autoChannel == WIFI_AP_AUTO_CHANNEL_SURVEY) {
+        uint16_t channel;
+        double cost;
+
+        if (surveyApChannel(start, wifiApData, false, &channel, &cost) == 0) {
+            AFB_INFO("Channel %u selected by the survey (cost %.3f)",
+                     (unsigned)channel, cost);
+            wifiApData->channelNumber = channel;
+        }
+        else
+            AFB_WARNING("Channel survey failed, keeping channel %u",
+                        (unsigned)wifiApData->channelNumber);
+        end_stage(start, AP_STAGE_SURVEY, &stageUs);
+    }
+
+    // Check channel number is properly set before starting
+    if (wifiApData->autoChannel != WIFI_AP_AUTO_CHANNEL_HOSTAPD &&
+        ((wifiApData->channelNumber < wifiApData->channel.MIN_CHANNEL_VALUE) ||
+         (wifiApData->channelNumber > wifiApData->channel.MAX_CHANNEL_VALUE))) {
+        AFB_ERROR(
+            "Unable to start AP because no valid channel number provided");
+        return -2;
+    }
+
+    set_network(start, wifiApData);
+    end_stage(start, AP_STAGE_NETWORK, &stageUs);
+
+    // Create hostapd.conf file in /tmp
+    if (!cached) {
+        if (GenerateHostApConfFile(wifiApData) != 0) {
+            AFB_ERROR("Failed to generate hostapd.conf");
+            return -3;
+        }
+        file_generated(start, AP_FILE_HOSTAPD);
+    }
+    AFB_INFO("AP configuration file has been generated");
+    end_stage(start, AP_STAGE_HOSTAPD_CONFIG, &stageUs);
+
+    systemResult = run_script(start, PLATFORM_LINK, COMMAND_WIFI_HW_START,
+                              wifiApData->interfaceName, NULL);
+    /**
+     * Returned values:
+     *   0: if the interface is correctly mounted
+     *  50: if WiFi card is not inserted
+     * 127: if WiFi card may not work
+     * 100: if driver can not be installed
+     *  -1: if the fork() has failed (see man system)
+     */
+
+    if (0 == WEXITSTATUS(systemResult)) {
+        AFB_INFO("WiFi hardware started correctly");
+    }
+    // Return value of 50 means WiFi card is not inserted.
+    else if (WEXITSTATUS(systemResult) == 50) {
+        AFB_ERROR("WiFi card is not inserted");
+        return -4;
+    }
+    // Return value of 100 means WiFi card may not work.
+    else if (WEXITSTATUS(systemResult) == 100) {
+        AFB_ERROR("Unable to reset WiFi card");
+        return -5;
+    }
+    // WiFi card failed to start.
+    else {
+        AFB_WARNING("Failed to start WiFi AP command \"%s\" systemResult (%d)",
+                    COMMAND_WIFI_HW_START, systemResult);
+        return -6;
+    }
+
+    AFB_INFO("Started WiFi AP command \"%s\" successfully",
+             COMMAND_WIFI_HW_START);
+    end_stage(start, AP_STAGE_HARDWARE, &stageUs);
+
+    // Start Access Point cmd: /bin/hostapd /etc/hostapd.conf
+    systemResult = run_script(start, PLATFORM_DAEMON,
+                              COMMAND_WIFIAP_HOSTAPD_START,
+                              wifiApData->interfaceName, NULL);
+    if (!succeeded(systemResult)) {
+        AFB_ERROR("WiFi Client Command \"%s\" Failed: (%d)",
+                  COMMAND_WIFIAP_HOSTAPD_START, systemResult);
+        // Remove generated hostapd.conf file
+        getPlatform()->removeFile(WIFI_HOSTAPD_FILE);
+        return -7;
+    }
+    end_stage(start, AP_STAGE_HOSTAPD, &stageUs);
+
+    // keep the files for the next start, once hostapd accepted them
+    if (store && (error = putConfigCache(start->cacheDir, cacheHash,
+                                         cachedFiles, CACHED_FILES_COUNT)) != 0)
+        AFB_WARNING("Unable to store the generated files in %s: %s",
+                    start->cacheDir, strerror(-error));
+    return 0;
+}
+
+/*******************************************************************************
+ *      stop the access point: hostapd, then the radio                         *
+ *                                                                             *
+ * The event thread of the caller is stopped by the caller.                    *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if stopped, -1 if hostapd failed to stop, -2 if the radio failed to  *
+ *      stop, the status of the command that failed in *status (if not NULL)   *
+ ******************************************************************************/
+int stopWifiAp(const apStartT *start, const wifiApT *wifiApData, int *status)
+{
+    int systemResult;
+
+    systemResult = run_script(start, PLATFORM_DAEMON,
+                              COMMAND_WIFIAP_HOSTAPD_STOP,
+                              wifiApData->interfaceName, NULL);
+    if (!succeeded(systemResult)) {
+        AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)",
+                  COMMAND_WIFIAP_HOSTAPD_STOP, systemResult);
+        if (status != NULL)
+            *status = systemResult;
+        return -1;
+    }
+
+    systemResult = run_script(start, PLATFORM_LINK, COMMAND_WIFI_HW_STOP,
+                              wifiApData->interfaceName, NULL);
+    if (!succeeded(systemResult)) {
+        AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)", COMMAND_WIFI_HW_STOP,
+                  systemResult);
+        if (status != NULL)
+            *status = systemResult;
+        return -2;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ *      close the event source of the access point                             *
+ *                                                                             *
+ * "iw event" only exits on its next event, the close would wait for it: the   *
+ * monitor is killed by the script first.                                      *
+ *                                                                             *
+ * @return                                                                     *
+ *      the status of the close, 0 if events is NULL                           *
+ ******************************************************************************/
+int closeApEvents(const apStartT *start, FILE *events)
+{
+    int systemResult;
+    char cmd[PATH_MAX];
+
+    snprintf(cmd, sizeof(cmd), "%s %s", start->script,
+             COMMAND_WIFI_UNSET_EVENT);
+    systemResult = run_command(start, PLATFORM_LINK, cmd);
+    if (!succeeded(systemResult))
+        AFB_WARNING("Unable to kill the WIFI events script %d",
+                    WEXITSTATUS(systemResult));
+
+    return events == NULL ? 0 : getPlatform()->closeCommand(events);
+}
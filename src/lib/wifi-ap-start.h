@@ -0,0 +1,76 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef START_HEADER_FILE
+#define START_HEADER_FILE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "wifi-ap-data.h"
+#include "wifi-ap-platform.h"
+
+// Stages of the start of the access point, in their order
+typedef enum
+{
+    AP_STAGE_CLEANUP,         ///< hostapd and dnsmasq of a previous start
+    AP_STAGE_CACHE,           ///< generated files restored from the cache
+    AP_STAGE_DNSMASQ,         ///< interface, hosts and dnsmasq files, dnsmasq
+    AP_STAGE_SURVEY,          ///< channel selected by the survey (if used)
+    AP_STAGE_NETWORK,         ///< NetworkManager and firewalld
+    AP_STAGE_HOSTAPD_CONFIG,  ///< hostapd.conf
+    AP_STAGE_HARDWARE,        ///< radio
+    AP_STAGE_HOSTAPD,         ///< hostapd
+    AP_STAGE_COUNT,
+} apStageT;
+
+// Files generated by the start
+typedef enum
+{
+    AP_FILE_HOSTS,
+    AP_FILE_DNSMASQ,
+    AP_FILE_HOSTAPD,
+    AP_FILE_COUNT,
+} apFileT;
+
+// How to start the access point: the adapter script, the cache of the
+// generated files and the hooks of the caller. The commands go through the
+// platform when runCommand or openCommand is NULL, the other hooks are
+// optional.
+typedef struct
+{
+    const char *script;    ///< adapter script (wifi_setup.sh)
+    const char *cacheDir;  ///< cache of the generated files, NULL if none
+
+    int (*runCommand)(platformDomainT domain, const char *cmd);
+    FILE *(*openCommand)(platformDomainT domain, const char *cmd);
+    void (*endStage)(apStageT stage, uint64_t durationUs);
+    void (*fileGenerated)(apFileT file);
+} apStartT;
+
+//------------------------------------------------------------------------------
+
+const char *getApStageName(apStageT stage);
+int setApDnsmasq(const apStartT *start, wifiApT *wifiApData, bool generate);
+int surveyApChannel(const apStartT *start,
+                    const wifiApT *wifiApData,
+                    bool apForce,
+                    uint16_t *channel,
+                    double *cost);
+int startWifiAp(const apStartT *start, wifiApT *wifiApData);
+int stopWifiAp(const apStartT *start, const wifiApT *wifiApData, int *status);
+int closeApEvents(const apStartT *start, FILE *events);
+#endif
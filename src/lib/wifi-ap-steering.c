@@ -0,0 +1,211 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-steering.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// bit of the BSS transition in the extended capabilities (IEEE 802.11 9.4.2.26)
+#define EXT_CAPAB_BSS_TRANSITION 19
+
+/*******************************************************************************
+ *      read a station from the answer of hostapd to "STA-FIRST"/"STA-NEXT"    *
+ *                                                                             *
+ * The first line is the MAC address, followed by "<field>=<value>" lines.     *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if read, -1 if there is no station                                   *
+ ******************************************************************************/
+int parseStationInfo(const char *reply, wifiApStationT *station)
+{
+    char mac[MAC_ADDRESS_LENGTH + 1];
+    const char *field;
+    unsigned byte;
+
+    if (sscanf(reply, "%17s", mac) != 1 || !parseMacAddress(mac, &station->mac))
+        return -1;
+
+    station->signal = 0;
+    field = strstr(reply, "\nsignal=");
+    if (field != NULL)
+        station->signal = (int32_t)strtol(field + 8, NULL, 10);
+
+    // the capabilities are the bytes in hexadecimal, bit 0 first
+    station->btm = false;
+    field = strstr(reply, "\next_capab=");
+    if (field != NULL &&
+        strspn(field + 11, "0123456789abcdefABCDEF") >
+            EXT_CAPAB_BSS_TRANSITION / 8 * 2 + 1 &&
+        sscanf(field + 11 + EXT_CAPAB_BSS_TRANSITION / 8 * 2, "%2x", &byte) ==
+            1)
+        station->btm = (byte >> (EXT_CAPAB_BSS_TRANSITION % 8)) & 1;
+    return 0;
+}
+
+/*******************************************************************************
+ *      find a station asked to move                                           *
+ ******************************************************************************/
+static int find_pending(const wifiApSteeringStateT *state, uint64_t mac)
+{
+    for (uint32_t idx = 0; idx < state->pendingCount; idx++) {
+        if (state->pending[idx].mac == mac)
+            return (int)idx;
+    }
+    return -1;
+}
+
+static bool has_station(const wifiApStationT *stations,
+                        unsigned count,
+                        uint64_t mac)
+{
+    for (unsigned idx = 0; idx < count; idx++) {
+        if (stations[idx].mac == mac)
+            return true;
+    }
+    return false;
+}
+
+/*******************************************************************************
+ *      count the stations gone after a request, or still there at the end     *
+ *      of the cooldown, then forget them                                      *
+ ******************************************************************************/
+void updateSteeringState(wifiApSteeringStateT *state,
+                         const wifiApStationT *stations,
+                         unsigned count,
+                         uint32_t cooldownMs,
+                         int64_t nowMs)
+{
+    uint32_t idx = 0;
+
+    state->evaluations++;
+    state->clients = count;
+    while (idx < state->pendingCount) {
+        if (!has_station(stations, count, state->pending[idx].mac))
+            state->moved++;
+        else if (nowMs - state->pending[idx].sentMs >= (int64_t)cooldownMs)
+            state->stayed++;
+        else {
+            idx++;
+            continue;
+        }
+        state->pending[idx] = state->pending[--state->pendingCount];
+    }
+}
+
+/*******************************************************************************
+ *      select the stations to ask to move                                     *
+ *                                                                             *
+ * Only the stations supporting the BSS transition and not already asked are   *
+ * selected: the ones below the minimal signal, then the weakest ones while    *
+ * there are more than the max number of clients.                              *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of indexes of stations written to selected                  *
+ ******************************************************************************/
+unsigned selectSteeringStations(const wifiAp_Steering_t *settings,
+                                const wifiApSteeringStateT *state,
+                                const wifiApStationT *stations,
+                                unsigned count,
+                                unsigned *selected)
+{
+    unsigned candidates = 0, result = 0, excess, idx, pos;
+    unsigned order[MAX_STEERING_STATIONS];
+
+    if (count > MAX_STEERING_STATIONS)
+        count = MAX_STEERING_STATIONS;
+    excess = settings->maxClients != 0 && count > settings->maxClients
+                 ? count - settings->maxClients
+                 : 0;
+
+    // candidates by increasing signal (insertion sort, the count is small)
+    for (idx = 0; idx < count; idx++) {
+        if (!stations[idx].btm || find_pending(state, stations[idx].mac) >= 0)
+            continue;
+        for (pos = candidates;
+             pos > 0 && stations[order[pos - 1]].signal > stations[idx].signal;
+             pos--)
+            order[pos] = order[pos - 1];
+        order[pos] = idx;
+        candidates++;
+    }
+
+    for (pos = 0; pos < candidates; pos++) {
+        const wifiApStationT *station = &stations[order[pos]];
+        bool weak = settings->minSignal != 0 && station->signal != 0 &&
+                    station->signal < settings->minSignal;
+        if (!weak && excess == 0)
+            break;
+        if (result + state->pendingCount >= MAX_STEERING_PENDING)
+            break;
+        selected[result++] = order[pos];
+        if (excess > 0)
+            excess--;
+    }
+    return result;
+}
+
+/*******************************************************************************
+ *      remember a station asked to move, count the request                    *
+ ******************************************************************************/
+void recordSteeringRequest(wifiApSteeringStateT *state,
+                           uint64_t mac,
+                           int64_t nowMs,
+                           bool sent)
+{
+    if (!sent) {
+        state->failures++;
+        return;
+    }
+    state->requests++;
+    if (state->pendingCount < MAX_STEERING_PENDING) {
+        state->pending[state->pendingCount].mac = mac;
+        state->pending[state->pendingCount].sentMs = nowMs;
+        state->pendingCount++;
+    }
+}
+
+/*******************************************************************************
+ *      write the BSS transition request of a station for hostapd              *
+ *                                                                             *
+ * The neighbors are the preferred candidates; without disassociation timer    *
+ * the station is free to stay.                                                *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, -1 if the command does not fit                           *
+ ******************************************************************************/
+int formatBssTmRequest(char *command,
+                       size_t size,
+                       uint64_t mac,
+                       const wifiAp_Steering_t *settings)
+{
+    char text[MAC_ADDRESS_LENGTH + 1];
+    size_t length;
+
+    formatMacAddress(mac, text);
+    length = (size_t)snprintf(command, size, "BSS_TM_REQ %s pref=1 abridged=1",
+                              text);
+    for (uint32_t idx = 0; idx < settings->neighborCount && length < size;
+         idx++)
+        length += (size_t)snprintf(&command[length], size - length,
+                                   " neighbor=%s", settings->neighbors[idx]);
+    if (settings->disassocTimer != 0 && length < size)
+        length += (size_t)snprintf(&command[length], size - length,
+                                   " disassoc_imminent=1 disassoc_timer=%u",
+                                   (unsigned)settings->disassocTimer);
+    return length < size ? 0 : -1;
+}
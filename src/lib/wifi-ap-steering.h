@@ -0,0 +1,77 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef STEERING_HEADER_FILE
+#define STEERING_HEADER_FILE
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "wifi-ap-data.h"
+
+// max number of stations read from hostapd at each evaluation
+#define MAX_STEERING_STATIONS 256
+
+// max number of stations asked to move and not gone yet
+#define MAX_STEERING_PENDING 64
+
+// A station of the access point (as reported by "STA <mac>" of hostapd)
+typedef struct
+{
+    uint64_t mac;
+    int32_t signal;  ///< dBm, 0 if unknown
+    bool btm;        ///< supports the BSS transition management
+} wifiApStationT;
+
+// Counters and stations asked to move
+typedef struct
+{
+    uint64_t evaluations;  ///< evaluations of the stations
+    uint64_t requests;     ///< BSS transition requests sent
+    uint64_t failures;     ///< BSS transition requests refused by hostapd
+    uint64_t moved;        ///< stations gone after a request
+    uint64_t stayed;       ///< stations still there after the cooldown
+    uint32_t clients;      ///< stations at the last evaluation
+    uint32_t pendingCount;
+    struct
+    {
+        uint64_t mac;
+        int64_t sentMs;
+    } pending[MAX_STEERING_PENDING];
+} wifiApSteeringStateT;
+
+//------------------------------------------------------------------------------
+
+int parseStationInfo(const char *reply, wifiApStationT *station);
+void updateSteeringState(wifiApSteeringStateT *state,
+                         const wifiApStationT *stations,
+                         unsigned count,
+                         uint32_t cooldownMs,
+                         int64_t nowMs);
+unsigned selectSteeringStations(const wifiAp_Steering_t *settings,
+                                const wifiApSteeringStateT *state,
+                                const wifiApStationT *stations,
+                                unsigned count,
+                                unsigned *selected);
+void recordSteeringRequest(wifiApSteeringStateT *state,
+                           uint64_t mac,
+                           int64_t nowMs,
+                           bool sent);
+int formatBssTmRequest(char *command,
+                       size_t size,
+                       uint64_t mac,
+                       const wifiAp_Steering_t *settings);
+#endif
@@ -0,0 +1,242 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include "wifi-ap-survey.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+#include "wifi-ap-utilities.h"
+
+// busy ratio given to an idle channel so that its noise still counts
+#define SURVEY_IDLE_BUSY_RATIO 0.01
+
+// weights of the overlapping 2.4 GHz channels (one and two channels away)
+#define SURVEY_ADJ_WEIGHT      0.85
+#define SURVEY_NEXT_ADJ_WEIGHT 0.55
+
+/*******************************************************************************
+ *      read the numeric value following the ':' of a survey dump line         *
+ ******************************************************************************/
+static bool survey_value(const char *line, const char *key, const char *format,
+                         void *value)
+{
+    size_t length = strlen(key);
+
+    if (strncmp(line, key, length) || line[length] != ':')
+        return false;
+    return sscanf(&line[length + 1], format, value) == 1;
+}
+
+/*******************************************************************************
+ *      parse the output of "iw dev <iface> survey dump"                       *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of frequencies read, or -1 if input is invalid              *
+ ******************************************************************************/
+int parseSurveyDump(FILE *input, wifiApSurveyT *survey)
+{
+    char line[256];
+    wifiApSurveyEntryT *entry = NULL;
+    unsigned frequency;
+
+    if (input == NULL || survey == NULL)
+        return -1;
+
+    memset(survey, 0, sizeof(*survey));
+    while (fgets(line, sizeof(line), input) != NULL) {
+        const char *text = line + strspn(line, " \t");
+
+        if (survey_value(text, "frequency", "%u", &frequency)) {
+            if (survey->count >= MAX_SURVEY_ENTRIES) {
+                entry = NULL;
+                continue;
+            }
+            entry = &survey->entries[survey->count++];
+            entry->frequency = frequency;
+            entry->channel = frequencyToChannel(frequency);
+            entry->inUse = strstr(text, "[in use]") != NULL;
+        }
+        else if (entry == NULL)
+            continue;
+        else if (survey_value(text, "noise", "%d", &entry->noise))
+            entry->hasNoise = true;
+        else if (survey_value(text, "channel active time", "%" SCNu64,
+                              &entry->activeTime) ||
+                 survey_value(text, "channel busy time", "%" SCNu64,
+                              &entry->busyTime) ||
+                 survey_value(text, "channel receive time", "%" SCNu64,
+                              &entry->receiveTime) ||
+                 survey_value(text, "channel transmit time", "%" SCNu64,
+                              &entry->transmitTime))
+            continue;
+    }
+    return (int)survey->count;
+}
+
+/*******************************************************************************
+ *      compute the interference factor of one frequency                       *
+ *                                                                             *
+ * Same model as the hostapd ACS: the share of the time the channel was busy   *
+ * because of others, weighted by 2^(noise - lowest noise of the survey).      *
+ *                                                                             *
+ * @return                                                                     *
+ *      the interference factor (the lower, the better)                        *
+ ******************************************************************************/
+double getSurveyInterference(const wifiApSurveyT *survey,
+                             const wifiApSurveyEntryT *entry)
+{
+    double factor = SURVEY_IDLE_BUSY_RATIO;
+    int minNoise = entry->noise;
+
+    if (entry->activeTime > entry->transmitTime &&
+        entry->busyTime > entry->transmitTime)
+        factor += (double)(entry->busyTime - entry->transmitTime) /
+                  (double)(entry->activeTime - entry->transmitTime);
+
+    if (!entry->hasNoise)
+        return factor;
+
+    for (unsigned i = 0; i < survey->count; i++) {
+        if (survey->entries[i].hasNoise && survey->entries[i].noise < minNoise)
+            minNoise = survey->entries[i].noise;
+    }
+    for (int i = minNoise; i < entry->noise; i++)
+        factor *= 2;
+    return factor;
+}
+
+/*******************************************************************************
+ *      find the survey data of a channel                                      *
+ ******************************************************************************/
+static const wifiApSurveyEntryT *survey_find(const wifiApSurveyT *survey,
+                                             uint32_t stdMask,
+                                             int channel)
+{
+    uint32_t frequency;
+
+    if (channel <= 0 || channel > UINT16_MAX)
+        return NULL;
+
+    frequency = channelToFrequency((uint16_t)channel, stdMask);
+    for (unsigned i = 0; frequency != 0 && i < survey->count; i++) {
+        if (survey->entries[i].frequency == frequency)
+            return &survey->entries[i];
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ *      compute the cost of a channel for a channel width                      *
+ *                                                                             *
+ * The cost is the sum of the interference factors of all the 20 MHz           *
+ * channels covered by the channel width. In the 2.4 GHz band, the             *
+ * overlapping channels are added with a lower weight.                         *
+ *                                                                             *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_WIDTH if the width is not possible on the channel        *
+ *     * WIFIAP_ERROR_NOT_FOUND if a covered channel is not in the survey      *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int getSurveyChannelCost(const wifiApSurveyT *survey,
+                         uint32_t stdMask,
+                         uint16_t channel,
+                         uint16_t channelWidth,
+                         double *cost)
+{
+    uint16_t span[MAX_COVERED_CHANNELS];
+    unsigned spanCount;
+    const wifiApSurveyEntryT *entry;
+
+    if (channelToFrequency(channel, stdMask) == 0)
+        return WIFIAP_ERROR_WIDTH;
+
+    spanCount = getCoveredChannels(stdMask, channel, channelWidth, span);
+    if (spanCount == 0)
+        return WIFIAP_ERROR_WIDTH;
+
+    *cost = 0;
+    for (unsigned i = 0; i < spanCount; i++) {
+        entry = survey_find(survey, stdMask, span[i]);
+        if (entry == NULL)
+            return WIFIAP_ERROR_NOT_FOUND;
+        *cost += getSurveyInterference(survey, entry);
+    }
+
+    if ((stdMask & HARDWARE_MODE_MASK) == WIFI_AP_BITMASK_IEEE_STD_A ||
+        (stdMask & HARDWARE_MODE_MASK) == WIFI_AP_BITMASK_IEEE_STD_AD)
+        return WIFIAP_NO_ERROR;
+
+    // 2.4 GHz channels are 5 MHz apart but 20 MHz wide
+    for (unsigned i = 0; i < spanCount; i++) {
+        for (int distance = -2; distance <= 2; distance++) {
+            int neighbour = span[i] + distance;
+            bool covered = false;
+
+            for (unsigned j = 0; j < spanCount; j++)
+                covered = covered || span[j] == neighbour;
+            entry = covered ? NULL : survey_find(survey, stdMask, neighbour);
+            if (entry == NULL)
+                continue;
+            *cost += getSurveyInterference(survey, entry) *
+                     (distance == 1 || distance == -1 ? SURVEY_ADJ_WEIGHT
+                                                      : SURVEY_NEXT_ADJ_WEIGHT);
+        }
+    }
+    return WIFIAP_NO_ERROR;
+}
+
+/*******************************************************************************
+ *      select the least loaded channel of a survey                            *
+ *                                                                             *
+ * Only the channels of the hardware mode on which the channel width is        *
+ * possible and allowed by the radio are considered. On equal costs, the       *
+ * lowest channel wins.                                                        *
+ *                                                                             *
+ * @return                                                                     *
+ *     * WIFIAP_ERROR_NOT_FOUND if no channel of the survey is usable          *
+ *     * WIFIAP_NO_ERROR if function succeeded                                 *
+ ******************************************************************************/
+int selectSurveyChannel(const wifiApSurveyT *survey,
+                        const wifiApT *wifiApData,
+                        uint16_t *channel,
+                        double *cost)
+{
+    uint32_t stdMask = wifiApData->IeeeStdMask;
+    uint16_t channelWidth = wifiApData->radio.channelWidth;
+    int rc = WIFIAP_ERROR_NOT_FOUND;
+    double channelCost;
+
+    for (unsigned i = 0; i < survey->count; i++) {
+        const wifiApSurveyEntryT *entry = &survey->entries[i];
+
+        if (entry->channel == 0 ||
+            channelToFrequency(entry->channel, stdMask) != entry->frequency ||
+            checkChannelSettings(wifiApData, entry->channel, channelWidth) !=
+                WIFIAP_NO_ERROR)
+            continue;
+        if (getSurveyChannelCost(survey, stdMask, entry->channel, channelWidth,
+                                 &channelCost) != WIFIAP_NO_ERROR)
+            continue;
+        if (rc == WIFIAP_NO_ERROR && channelCost >= *cost &&
+            !(channelCost == *cost && entry->channel < *channel))
+            continue;
+        *channel = entry->channel;
+        *cost = channelCost;
+        rc = WIFIAP_NO_ERROR;
+    }
+    return rc;
+}
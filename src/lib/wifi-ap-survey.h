@@ -0,0 +1,63 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef SURVEY_HEADER_FILE
+#define SURVEY_HEADER_FILE
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "wifi-ap-data.h"
+
+// max number of frequencies kept from a survey dump
+#define MAX_SURVEY_ENTRIES 64
+
+// Survey data of one frequency (as reported by "iw dev <iface> survey dump")
+typedef struct
+{
+    uint32_t frequency;  ///< frequency in MHz
+    uint16_t channel;    ///< matching channel number
+    bool inUse;          ///< frequency currently used by the interface
+    bool hasNoise;
+    int noise;              ///< noise floor in dBm
+    uint64_t activeTime;    ///< time the radio was on the channel (ms)
+    uint64_t busyTime;      ///< time the channel was sensed busy (ms)
+    uint64_t receiveTime;   ///< time spent receiving (ms)
+    uint64_t transmitTime;  ///< time spent transmitting (ms)
+} wifiApSurveyEntryT;
+
+// Survey of all the frequencies of a radio
+typedef struct
+{
+    unsigned count;
+    wifiApSurveyEntryT entries[MAX_SURVEY_ENTRIES];
+} wifiApSurveyT;
+
+//------------------------------------------------------------------------------
+
+int parseSurveyDump(FILE *input, wifiApSurveyT *survey);
+double getSurveyInterference(const wifiApSurveyT *survey,
+                             const wifiApSurveyEntryT *entry);
+int getSurveyChannelCost(const wifiApSurveyT *survey,
+                         uint32_t stdMask,
+                         uint16_t channel,
+                         uint16_t channelWidth,
+                         double *cost);
+int selectSurveyChannel(const wifiApSurveyT *survey,
+                        const wifiApT *wifiApData,
+                        uint16_t *channel,
+                        double *cost);
+#endif
@@ -16,15 +16,20 @@
 # limitations under the License.
 *******************************************************************************/
 #define _GNU_SOURCE
+#define _LGPL_SOURCE  // inline the wfcqueue functions
 
 #include "wifi-ap-thread.h"
 
 #include <assert.h>
 #include <errno.h>
+#include <limits.h>
+#include <semaphore.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/resource.h>
 #include <unistd.h>
+#include <urcu/uatomic.h>
 
 #define AFB_BINDING_VERSION 4
 #include <afb/afb-binding.h>
@@ -32,9 +37,23 @@
 #include "wifi-ap-utilities.h"
 
 /*******************************************************************************
- * Pointer to  the head of threadList in service
+ * Thread table: a slot holds a thread object and the generation of the slot.
+ * The id of a thread is (generation << THREAD_INDEX_BITS) | index, the
+ * generation is incremented each time the slot is released so that a stale id
+ * never matches again. Free slots are chained through nextFree.
  *******************************************************************************/
-static struct cds_list_head threadList;
+#define THREAD_INDEX_MASK     (MAX_THREADS - 1)
+#define THREAD_MAX_GENERATION (INT_MAX >> THREAD_INDEX_BITS)
+
+static struct
+{
+    thread_Obj_t *threadPtr;
+    int generation;
+    int nextFree;
+} ThreadTable[MAX_THREADS];
+
+static int FirstFreeSlot = -1;
+static int UsedSlots = 0;  ///< slots [0, UsedSlots) have been used once
 
 /*******************************************************************************
  * Key under which the pointer to the Thread Object (thread_Obj_t) will be
@@ -43,6 +62,8 @@ static struct cds_list_head threadList;
  *******************************************************************************/
 static pthread_key_t ThreadLocalDataKey;
 
+static pthread_once_t ThreadLocalDataKeyOnce = PTHREAD_ONCE_INIT;
+
 /*******************************************************************************
  * Mutex used to protect data structures within this module from multithreaded
  * race conditions.
@@ -62,21 +83,81 @@ static inline void unlock()
     assert(rc == 0);
 }
 
+static void createThreadLocalDataKey(void)
+{
+    int rc = pthread_key_create(&ThreadLocalDataKey, NULL);
+    assert(rc == 0);
+}
+
 /*******************************************************************************
- * Get Thread struct from Global thread list using the thread id
+ * Get Thread struct from the thread table using the thread id (O(1))
+ *******************************************************************************
+ * The lock must be held.
+ *
+ * @return the thread object, or NULL if the id is not (or no more) valid
  *******************************************************************************/
+static thread_Obj_t *findThreadFromId(int id)
+{
+    int index = id & THREAD_INDEX_MASK;
 
-thread_Obj_t *findThreadFromIdInList(struct cds_list_head *listHead, int id)
+    if (id <= 0 || index >= UsedSlots ||
+        ThreadTable[index].generation != id >> THREAD_INDEX_BITS)
+        return NULL;
+    return ThreadTable[index].threadPtr;
+}
+
+/*******************************************************************************
+ * Put a thread object in a free slot of the thread table
+ *******************************************************************************
+ * The lock must be held.
+ *
+ * @return the id of the thread, or -1 if the table is full
+ *******************************************************************************/
+static int allocThreadId(thread_Obj_t *threadPtr)
 {
-    thread_Obj_t *threadPtr;
+    int index;
 
-    cds_list_for_each_entry(threadPtr, listHead, link)
-    {
-        // check for thread with the same id
-        if (threadPtr->threadId == id)
-            return threadPtr;
+    if (FirstFreeSlot >= 0) {
+        index = FirstFreeSlot;
+        FirstFreeSlot = ThreadTable[index].nextFree;
     }
-    return NULL;
+    else if (UsedSlots < MAX_THREADS) {
+        index = UsedSlots++;
+        ThreadTable[index].generation = 1;
+    }
+    else
+        return -1;
+
+    ThreadTable[index].threadPtr = threadPtr;
+    return (ThreadTable[index].generation << THREAD_INDEX_BITS) | index;
+}
+
+/*******************************************************************************
+ * Release the slot of a thread, invalidating its id
+ *******************************************************************************
+ * The lock must be held.
+ *******************************************************************************/
+static void releaseThreadId(int id)
+{
+    int index = id & THREAD_INDEX_MASK;
+
+    ThreadTable[index].threadPtr = NULL;
+    ThreadTable[index].generation =
+        ThreadTable[index].generation % THREAD_MAX_GENERATION + 1;
+    ThreadTable[index].nextFree = FirstFreeSlot;
+    FirstFreeSlot = index;
+}
+
+/*******************************************************************************
+ * Delete a thread object
+ *******************************************************************************/
+static void DeleteThread(thread_Obj_t *threadPtr)
+{
+    // Destruct the thread attributes structure.
+    pthread_attr_destroy(&(threadPtr->attr));
+
+    // Release the Thread object
+    free(threadPtr);
 }
 
 /*******************************************************************************
@@ -93,49 +174,59 @@ thread_Obj_t *findThreadFromIdInList(struct cds_list_head *listHead, int id)
  *******************************************************************************/
 int setThreadJoinable(int threadId)
 {
-    lock();
+    int rc = 0;
 
-    thread_Obj_t *threadPtr = findThreadFromIdInList(&threadList, threadId);
+    lock();
 
-    unlock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
 
     // if invalid thread reference
     if (!threadPtr)
-        return -1;
+        rc = -1;
 
     // if thread already running
-    if (threadPtr->state != THREAD_STATE_NEW)
-        return -2;
+    else if (threadPtr->state != THREAD_STATE_NEW)
+        rc = -2;
+
+    else if (pthread_attr_setdetachstate(&(threadPtr->attr),
+                                         PTHREAD_CREATE_JOINABLE) != 0)
+        rc = -3;
 
-    threadPtr->isJoinable = true;
-    if (pthread_attr_setdetachstate(&(threadPtr->attr),
-                                    PTHREAD_CREATE_JOINABLE) == 0)
-        return 0;
     else
-        return -3;
+        threadPtr->isJoinable = true;
+
+    unlock();
+
+    return rc;
 }
 
 /*******************************************************************************
  * Create a new Thread object and initializes it
  *******************************************************************************
- * @return A reference to the thread (doesn't return if failed).
+ * @return
+ *   - the id of the thread (greater than 0)
+ *   - -1 : if the thread object can't be allocated or initialized
+ *   - -2 : if the thread table is full
  *
  * @warning This function will also be called for the process's main thread
  * by the processes * main thread.  Keep that in mind when modifying this
  *function.
  *******************************************************************************/
 
-thread_Obj_t *CreateThread(
+int CreateThread(
     const char *name,            ///< [in] Name of the thread
     thread_MainFunc_t mainFunc,  ///< [in] The thread's main function.
     void *context  ///< [in] Value to pass to mainFunc when it is called.
 )
 {
-    // Create a new thread object.
-    thread_Obj_t *threadPtr = (thread_Obj_t *)calloc(1, sizeof(thread_Obj_t));
+    pthread_once(&ThreadLocalDataKeyOnce, createThreadLocalDataKey);
 
-    // And zero the whole object.
-    memset(threadPtr, 0, sizeof(thread_Obj_t));
+    // Create a new thread object (zeroed).
+    thread_Obj_t *threadPtr = (thread_Obj_t *)calloc(1, sizeof(thread_Obj_t));
+    if (threadPtr == NULL) {
+        AFB_ERROR("Could not allocate thread '%s'.", name);
+        return -1;
+    }
 
     // Get current thread as we may inherit some properties (if available).
     // Do not use  GetCurrentThreadPtr() as it's OK if this thread is being
@@ -162,17 +253,21 @@ thread_Obj_t *CreateThread(
         AFB_ERROR(
             "Could not set scheduling policy inheritance for thread '%s'.",
             name);
-        return NULL;
+        DeleteThread(threadPtr);
+        return -1;
     }
 
     // By default, threads are not joinable (they are detached).
     if (pthread_attr_setdetachstate(&(threadPtr->attr),
                                     PTHREAD_CREATE_DETACHED) != 0) {
         AFB_ERROR("Could not set the detached state for thread '%s'.", name);
-        return NULL;
+        DeleteThread(threadPtr);
+        return -1;
     }
 
     threadPtr->priority = DEFAULT_THREAD_PRIORITY;
+    threadPtr->rtPriority = DEFAULT_RT_PRIORITY;
+    threadPtr->hasAffinity = false;
     threadPtr->isJoinable = false;
     threadPtr->state = THREAD_STATE_NEW;
     threadPtr->mainFunc = mainFunc;
@@ -180,6 +275,7 @@ thread_Obj_t *CreateThread(
     threadPtr->threadHandle = 0;
     threadPtr->setPidOnStart = false;
     threadPtr->procId = 0;
+    threadPtr->tid = 0;
 
     CDS_INIT_LIST_HEAD(&threadPtr->destructorList);
 
@@ -189,19 +285,21 @@ thread_Obj_t *CreateThread(
         }
     }
 
-    // Create a safe reference for this object and put this object on the
-    // thread object list (for the Inspect tool).
+    // Give a unique id to this object in the thread table.
     lock();
-    CDS_INIT_LIST_HEAD(&threadList);
-    CDS_INIT_LIST_HEAD(&threadPtr->link);
-    threadPtr->ThreadObjListChangeCount++;
-    threadPtr->threadId++;
-    cds_list_add_tail(&threadPtr->link, &threadList);
+    threadPtr->threadId = allocThreadId(threadPtr);
     unlock();
 
-    AFB_INFO("DONE Creating thread");
+    if (threadPtr->threadId < 0) {
+        AFB_ERROR("Too many threads, can't create thread '%s'.", name);
+        DeleteThread(threadPtr);
+        return -2;
+    }
+
+    AFB_INFO("DONE Creating thread %s (id %d)", threadPtr->name,
+             threadPtr->threadId);
 
-    return threadPtr;
+    return threadPtr->threadId;
 }
 
 /*******************************************************************************
@@ -214,6 +312,8 @@ static Destructor_t *AddDestructor(thread_Obj_t *threadPtr,
     // Create the destructor object.
     Destructor_t *destructorObjPtr =
         (Destructor_t *)calloc(1, sizeof(Destructor_t));
+    if (destructorObjPtr == NULL)
+        return NULL;
 
     // Init the destructor object.
     CDS_INIT_LIST_HEAD(&destructorObjPtr->link);
@@ -221,9 +321,9 @@ static Destructor_t *AddDestructor(thread_Obj_t *threadPtr,
     destructorObjPtr->destructor = destructor;
     destructorObjPtr->context = context;
 
-    // Get a pointer to the calling thread's Thread Object and
-    // Add the destructor object to its list.
-    cds_list_add_tail(&destructorObjPtr->link, &threadPtr->destructorList);
+    // Add the destructor object at the head of the list of the thread, the
+    // destructors are run in the reverse order of their registration.
+    cds_list_add(&destructorObjPtr->link, &threadPtr->destructorList);
 
     AFB_INFO("Done adding destructor to thread");
 
@@ -241,36 +341,29 @@ int addDestructorToThread(int threadId,
                           thread_Destructor_t destructor,
                           void *context)
 {
+    int rc = 0;
+
     // Get a pointer to the thread's Thread Object.
     lock();
 
-    thread_Obj_t *threadPtr = findThreadFromIdInList(&threadList, threadId);
-
-    unlock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
 
     // if invalid thread reference
     if (!threadPtr)
-        return -1;
+        rc = -1;
 
     // if thread already running
-    if (threadPtr->state != THREAD_STATE_NEW)
-        return -2;
+    else if (threadPtr->state != THREAD_STATE_NEW)
+        rc = -2;
 
-    AddDestructor(threadPtr, destructor, context);
-    AFB_INFO("Done registring a destructor to thread");
-    return 0;
-}
+    else if (AddDestructor(threadPtr, destructor, context) == NULL)
+        rc = -3;
 
-/*******************************************************************************
- * Delete a thread object
- *******************************************************************************/
-static void DeleteThread(thread_Obj_t *threadPtr)
-{
-    // Destruct the thread attributes structure.
-    pthread_attr_destroy(&(threadPtr->attr));
+    unlock();
 
-    // Release the Thread object
-    free(threadPtr);
+    if (rc == 0)
+        AFB_INFO("Done registring a destructor to thread");
+    return rc;
 }
 
 int GetNumberOfNodesInList(struct cds_list_head *listHead)
@@ -300,30 +393,34 @@ static void CleanupThread(void *objPtr)
 
     threadObjPtr->state = THREAD_STATE_DYING;
 
-    cds_list_for_each_entry(destructorObjPtr, &threadObjPtr->destructorList,
-                            link)
-    {
-        // Call the destructor.
-        if (destructorObjPtr->destructor != NULL) {
-            // WARNING: This may change the destructor list (by deleting a
-            // destructor).
-            destructorObjPtr->destructor(destructorObjPtr->context);
-        }
+    // Call the destructors, the last registered first.
+    while (!cds_list_empty(&threadObjPtr->destructorList)) {
+        destructorObjPtr = cds_list_entry(threadObjPtr->destructorList.next,
+                                          Destructor_t, link);
         cds_list_del(&destructorObjPtr->link);
+        if (destructorObjPtr->destructor != NULL)
+            destructorObjPtr->destructor(destructorObjPtr->context);
         free(destructorObjPtr);
-        if (!GetNumberOfNodesInList(&threadObjPtr->destructorList))
-            break;
     }
 
-    // If this thread is NOT joinable, then immediately invalidate its safe
-    // reference, remove it from the thread object list, and free the thread
-    // object. Otherwise, wait until someone joins with it.
+    // Save the CPU time used by the thread, its clock dies with it.
+    lock();
+    if (threadObjPtr->hasCpuClock &&
+        clock_gettime(threadObjPtr->cpuClock, &threadObjPtr->cpuTime) != 0)
+        AFB_WARNING("Could not read the CPU time of thread '%s'.",
+                    threadObjPtr->name);
+    threadObjPtr->hasCpuClock = false;
+
+    // If this thread is NOT joinable, then immediately invalidate its id,
+    // remove it from the thread table, and free the thread object.
+    // Otherwise, wait until someone joins with it.
     if (!threadObjPtr->isJoinable) {
-        lock();
-        cds_list_del(&threadObjPtr->link);
+        releaseThreadId(threadObjPtr->threadId);
         unlock();
         DeleteThread(threadObjPtr);
     }
+    else
+        unlock();
 
     // Clear the thread info to prevent double-free errors and further thread
     // calls. Check if the key exists before cleaning it up
@@ -338,6 +435,104 @@ static void CleanupThread(void *objPtr)
     // Otherwise, data is already NULL, no need to clean it up
 }
 
+/*******************************************************************************
+ * Get the scheduling policy and the real-time priority of a priority
+ *******************************************************************************/
+static int getThreadPolicy(int priority, int rtPriority, int *schedPriority)
+{
+    *schedPriority = 0;
+    if (priority == THREAD_PRIORITY_RT_FIFO ||
+        priority == THREAD_PRIORITY_RT_RR) {
+        *schedPriority = rtPriority;
+        return priority == THREAD_PRIORITY_RT_FIFO ? SCHED_FIFO : SCHED_RR;
+    }
+#if LE_CONFIG_THREAD_REALTIME_ONLY
+    *schedPriority = priority + 1;
+    return SCHED_RR;
+#else
+    return priority == THREAD_PRIORITY_IDLE ? SCHED_IDLE : SCHED_OTHER;
+#endif
+}
+
+static bool isRealtimePolicy(int policy)
+{
+    return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+/*******************************************************************************
+ * Apply a priority to a thread
+ *******************************************************************************
+ * The idle priority switches the thread to SCHED_IDLE, the low, normal and
+ * high priorities set its nice level to 10, 0 and -10, the real-time
+ * priorities switch it to SCHED_FIFO or SCHED_RR. Failures are logged.
+ *
+ * @param tid kernel id of the thread, 0 for the calling thread
+ *
+ * @return 0 if successful, -1 otherwise
+ *******************************************************************************/
+static int applyThreadPriority(pid_t tid, int priority, int rtPriority)
+{
+    struct sched_param param;
+    int policy = getThreadPolicy(priority, rtPriority, &param.sched_priority);
+
+    // Switch the scheduling policy if needed (SCHED_OTHER is left for the
+    // nice level to be set).
+    if (policy != SCHED_OTHER || sched_getscheduler(tid) != SCHED_OTHER) {
+        if (sched_setscheduler(tid, policy, &param) != 0) {
+            AFB_ERROR("Failed to set scheduling policy to %d (error %d).",
+                      policy, errno);
+            return -1;
+        }
+        AFB_DEBUG("Set scheduling policy to %d (priority %d)", policy,
+                  param.sched_priority);
+    }
+
+    if (policy == SCHED_OTHER) {
+        int niceLevel = 0;
+
+        if (priority == THREAD_PRIORITY_LOW) {
+            niceLevel = 10;
+        }
+        else if (priority == THREAD_PRIORITY_HIGH) {
+            niceLevel = -10;
+        }
+
+        // Get this thread's tid.
+        if (tid == 0)
+            tid = gettid();
+
+        errno = 0;
+        if (setpriority(PRIO_PROCESS, (id_t)tid, niceLevel) == -1) {
+            AFB_ERROR("Could not set the nice level (error %d).", errno);
+            return -1;
+        }
+        AFB_DEBUG("Set nice level to %d.", niceLevel);
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Set the real-time scheduling of a thread in its attributes
+ *******************************************************************************
+ * Real-time threads are started with their policy, so that they never run
+ * with a wrong one. The lock must be held.
+ *******************************************************************************/
+static int setThreadSchedAttr(thread_Obj_t *threadPtr)
+{
+    struct sched_param param;
+    int policy = getThreadPolicy(threadPtr->priority, threadPtr->rtPriority,
+                                 &param.sched_priority);
+
+    if (!isRealtimePolicy(policy)) {
+        policy = SCHED_OTHER;
+        param.sched_priority = 0;
+    }
+    if (pthread_attr_setschedpolicy(&threadPtr->attr, policy) != 0 ||
+        pthread_attr_setschedparam(&threadPtr->attr, &param) != 0)
+        return -1;
+    return 0;
+}
+
 /*******************************************************************************
  * A pthread start routine function wrapper
  *******************************************************************************
@@ -358,61 +553,35 @@ void *PThreadStartRoutine(void *threadObjPtr)
 
     int result;
 
-    if ((result = pthread_setname_np(threadPtr->threadHandle,
-                                     threadPtr->name)) != 0) {
+    if ((result = pthread_setname_np(pthread_self(), threadPtr->name)) != 0) {
         AFB_WARNING("Failed to set thread name for %s (%d).", threadPtr->name,
                     result);
     }
 
+    // Keep the thread object in thread-local storage.
+    pthread_setspecific(ThreadLocalDataKey, threadPtr);
+
     // Push the default destructor onto the thread's cleanup stack.
     pthread_cleanup_push(CleanupThread, threadPtr);
 
     // Set scheduler and nice value now, if thread is not a realtime thread.
     // Real-time thread priorities are set before thread is started.
-#if !LE_CONFIG_THREAD_REALTIME_ONLY
-    // If the thread is supposed to run in the background (at IDLE priority),
-    // then switch to that scheduling policy now.
-
-    if (threadPtr->priority == 0) {
-        struct sched_param param;
-        memset(&param, 0, sizeof(param));
-        if (sched_setscheduler(0, SCHED_IDLE, &param) != 0) {
-            AFB_ERROR(
-                "Failed to set scheduling policy to SCHED_IDLE (error %d).",
-                errno);
-        }
-        else {
-            AFB_DEBUG("Set scheduling policy to SCHED_IDLE");
-        }
-    }
-    else if ((threadPtr->priority == 2) || (threadPtr->priority == 1) ||
-             (threadPtr->priority == 3)) {
-        int niceLevel = 0;
-
-        if (threadPtr->priority == 1) {
-            niceLevel = 10;
-        }
-        else if (threadPtr->priority == 3) {
-            niceLevel = -10;
-        }
+    int priority, rtPriority, schedPriority;
 
-        // Get this thread's tid.
-        pid_t tid = gettid();
+    lock();
+    threadPtr->tid = gettid();
+    priority = threadPtr->priority;
+    rtPriority = threadPtr->rtPriority;
+    unlock();
 
-        errno = 0;
-        if (setpriority(PRIO_PROCESS, (id_t)tid, niceLevel) == -1) {
-            AFB_ERROR("Could not set the nice level (error %d).", errno);
-        }
-        else {
-            AFB_DEBUG("Set nice level to %d.", niceLevel);
-        }
-    }
+    if (!isRealtimePolicy(getThreadPolicy(priority, rtPriority,
+                                          &schedPriority)))
+        applyThreadPriority(0, priority, rtPriority);
 
-#endif /* end !LE_CONFIG_THREAD_REALTIME_ONLY */
     // Set the thread ID as a proc ID if configured
 
     if (threadPtr->setPidOnStart) {
-        threadPtr->procId = (pid_t)threadPtr->threadHandle;
+        threadPtr->procId = gettid();
     }
 
     // Call the user's main function.
@@ -449,7 +618,7 @@ int JoinThread(int threadId, void **resultValuePtr)
 
     lock();
 
-    thread_Obj_t *threadPtr = findThreadFromIdInList(&threadList, threadId);
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
     if (threadPtr == NULL) {
         unlock();
 
@@ -477,8 +646,7 @@ int JoinThread(int threadId, void **resultValuePtr)
                 // reference, remove it from the list of thread objects, and
                 // release the Thread Object.
                 lock();
-                threadPtr->ThreadObjListChangeCount++;
-                cds_list_del(&threadPtr->link);
+                releaseThreadId(threadId);
                 unlock();
                 DeleteThread(threadPtr);
 
@@ -513,9 +681,11 @@ int JoinThread(int threadId, void **resultValuePtr)
 int cancelThread(int threadId)
 {
     lock();
-    thread_Obj_t *threadPtr = findThreadFromIdInList(&threadList, threadId);
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
 
-    if ((threadPtr == NULL) || (pthread_cancel(threadPtr->threadHandle) != 0)) {
+    if ((threadPtr == NULL) || (threadPtr->state == THREAD_STATE_NEW) ||
+        (pthread_cancel(threadPtr->threadHandle) != 0)) {
+        unlock();
         AFB_ERROR("Can't cancel thread: thread doesn't exist!");
         return -1;
     }
@@ -524,6 +694,45 @@ int cancelThread(int threadId)
     return 0;
 }
 
+/*******************************************************************************
+ * Delete a thread that was never started
+ *******************************************************************************
+ * Its slot in the thread table is released and its destructors are freed
+ * without being called.
+ *
+ * @return
+ *      -  0 if successful.
+ *      - -1 if the thread doesn't exist.
+ *      - -2 if the thread has been started (it must be joined or cancelled).
+ *******************************************************************************/
+int deleteThread(int threadId)
+{
+    Destructor_t *destructorObjPtr;
+
+    lock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
+
+    if (threadPtr == NULL) {
+        unlock();
+        return -1;
+    }
+    if (threadPtr->state != THREAD_STATE_NEW) {
+        unlock();
+        return -2;
+    }
+    releaseThreadId(threadId);
+    unlock();
+
+    while (!cds_list_empty(&threadPtr->destructorList)) {
+        destructorObjPtr = cds_list_entry(threadPtr->destructorList.next,
+                                          Destructor_t, link);
+        cds_list_del(&destructorObjPtr->link);
+        free(destructorObjPtr);
+    }
+    DeleteThread(threadPtr);
+    return 0;
+}
+
 /*******************************************************************************
  * Start a new thread of execution
  *******************************************************************************
@@ -535,26 +744,58 @@ int startThread(int threadId)
 {
     // Get a pointer to the thread's Thread Object.
     lock();
-    thread_Obj_t *threadPtr = findThreadFromIdInList(&threadList, threadId);
-
-    unlock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
 
     // if invalid thread reference
-    if (!threadPtr)
+    if (!threadPtr) {
+        unlock();
         return -1;
+    }
 
     // if thread already running
-    if (threadPtr->state != THREAD_STATE_NEW)
+    if (threadPtr->state != THREAD_STATE_NEW) {
+        unlock();
         return -2;
+    }
 
     // Start the thread with the default function PThreadStartRoutine, passing
     // the PThreadStartRoutine the thread object. PThreadStartRoutine will then
-    // start the user's main function.
+    // start the user's main function. The lock is held so that the handle is
+    // set before the thread looks at it.
 
     threadPtr->state = THREAD_STATE_RUNNING;
 
-    int result = pthread_create(&(threadPtr->threadHandle), &(threadPtr->attr),
-                                PThreadStartRoutine, threadPtr);
+    int schedPriority;
+    bool realtime = isRealtimePolicy(getThreadPolicy(
+        threadPtr->priority, threadPtr->rtPriority, &schedPriority));
+    int result = setThreadSchedAttr(threadPtr) != 0
+                     ? EINVAL
+                     : pthread_create(&(threadPtr->threadHandle),
+                                      &(threadPtr->attr), PThreadStartRoutine,
+                                      threadPtr);
+
+    // Without the privilege of real-time scheduling, fall back to the default
+    // priority instead of not running at all.
+    if (result == EPERM && realtime) {
+        AFB_WARNING("No permission for the real-time priority of thread '%s', "
+                    "using the default priority.",
+                    threadPtr->name);
+        threadPtr->priority = DEFAULT_THREAD_PRIORITY;
+        result = setThreadSchedAttr(threadPtr) != 0
+                     ? EINVAL
+                     : pthread_create(&(threadPtr->threadHandle),
+                                      &(threadPtr->attr), PThreadStartRoutine,
+                                      threadPtr);
+    }
+    if (result != 0)
+        threadPtr->state = THREAD_STATE_NEW;
+    else
+        // The thread can't end before the lock is released, its CPU-time
+        // clock is still valid.
+        threadPtr->hasCpuClock =
+            pthread_getcpuclockid(threadPtr->threadHandle,
+                                  &threadPtr->cpuClock) == 0;
+    unlock();
 
     if (result != 0) {
         errno = result;
@@ -573,3 +814,494 @@ int startThread(int threadId)
 
     return 0;
 }
+
+/*******************************************************************************
+ * Get the CPU time used by a thread
+ *******************************************************************************
+ * The CPU time is read from the CPU-time clock of the thread while it runs,
+ * and is the CPU time used until its end once it has ended (joinable threads
+ * are kept until joined).
+ *
+ * @return
+ *      -  0 if successful.
+ *      - -1 if the thread doesn't exist.
+ *      - -2 if the CPU time can't be read.
+ *******************************************************************************/
+int getThreadCpuTime(int threadId, struct timespec *cpuTime)
+{
+    int rc = 0;
+
+    lock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
+
+    if (threadPtr == NULL)
+        rc = -1;
+    else if (!threadPtr->hasCpuClock)
+        *cpuTime = threadPtr->cpuTime;
+    else if (clock_gettime(threadPtr->cpuClock, cpuTime) != 0)
+        rc = -2;
+    unlock();
+
+    return rc;
+}
+
+/*******************************************************************************
+ * Set the priority of a thread
+ *******************************************************************************
+ * The priority of a thread not started yet is applied when it starts (the
+ * real-time ones through its attributes), the one of a running thread is
+ * applied immediately. rtPriority is only used by THREAD_PRIORITY_RT_FIFO and
+ * THREAD_PRIORITY_RT_RR.
+ *
+ * @return
+ *      -  0 if successful.
+ *      - -1 if the thread doesn't exist.
+ *      - -2 if the priority is invalid.
+ *      - -3 if the priority can't be applied to the running thread.
+ *******************************************************************************/
+int setThreadPriority(int threadId, int priority, int rtPriority)
+{
+    int rc = 0;
+    pid_t tid = 0;
+    int min, max;
+
+    if (priority < THREAD_PRIORITY_IDLE || priority > THREAD_PRIORITY_RT_RR)
+        return -2;
+    if (priority == THREAD_PRIORITY_RT_FIFO ||
+        priority == THREAD_PRIORITY_RT_RR) {
+        min = sched_get_priority_min(SCHED_FIFO);
+        max = sched_get_priority_max(SCHED_FIFO);
+        if (rtPriority < min || rtPriority > max)
+            return -2;
+    }
+    else
+        rtPriority = DEFAULT_RT_PRIORITY;
+
+    lock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
+    if (threadPtr == NULL)
+        rc = -1;
+    else {
+        threadPtr->priority = priority;
+        threadPtr->rtPriority = rtPriority;
+        // a started thread without tid applies its priority itself
+        if (threadPtr->state == THREAD_STATE_RUNNING)
+            tid = threadPtr->tid;
+    }
+    unlock();
+
+    if (tid != 0 && applyThreadPriority(tid, priority, rtPriority) != 0)
+        rc = -3;
+    return rc;
+}
+
+/*******************************************************************************
+ * Set the CPUs a thread may run on
+ *******************************************************************************
+ * @return
+ *      -  0 if successful.
+ *      - -1 if the thread doesn't exist.
+ *      - -2 if the affinity can't be set (no CPU of the set is available).
+ *******************************************************************************/
+int setThreadAffinity(int threadId, const cpu_set_t *cpus)
+{
+    int rc = 0;
+
+    lock();
+    thread_Obj_t *threadPtr = findThreadFromId(threadId);
+    if (threadPtr == NULL)
+        rc = -1;
+    else if (threadPtr->state == THREAD_STATE_NEW
+                 ? pthread_attr_setaffinity_np(&threadPtr->attr,
+                                               sizeof(*cpus), cpus) != 0
+                 : pthread_setaffinity_np(threadPtr->threadHandle,
+                                          sizeof(*cpus), cpus) != 0)
+        rc = -2;
+    else {
+        threadPtr->hasAffinity = true;
+        threadPtr->affinity = *cpus;
+    }
+    unlock();
+
+    return rc;
+}
+
+/*******************************************************************************
+ * Get the priority matching a name
+ *******************************************************************************
+ * The names are "idle", "low", "normal", "high", "fifo" and "rr".
+ *
+ * @return the THREAD_PRIORITY_xxx value, or -1 if the name is unknown
+ *******************************************************************************/
+int parseThreadPriority(const char *name)
+{
+    static const char *const names[] = {"idle", "low",  "normal",
+                                        "high", "fifo", "rr"};
+
+    for (int priority = 0; priority < (int)(sizeof names / sizeof *names);
+         priority++) {
+        if (strcasecmp(name, names[priority]) == 0)
+            return priority;
+    }
+    return -1;
+}
+
+/*******************************************************************************
+ * Read a list of CPUs like "0-1,3"
+ *******************************************************************************
+ * @return 0 if successful, -1 if the list is invalid or empty
+ *******************************************************************************/
+int parseThreadCpuList(const char *list, cpu_set_t *cpus)
+{
+    const char *cursor = list;
+    unsigned long first, last;
+    char *end;
+
+    CPU_ZERO(cpus);
+    while (*cursor != '\0') {
+        first = strtoul(cursor, &end, 10);
+        if (end == cursor)
+            return -1;
+        last = first;
+        if (*end == '-') {
+            cursor = end + 1;
+            last = strtoul(cursor, &end, 10);
+            if (end == cursor)
+                return -1;
+        }
+        if (first > last || last >= CPU_SETSIZE)
+            return -1;
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, cpus);
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return -1;
+        cursor = end;
+    }
+    return CPU_COUNT(cpus) == 0 ? -1 : 0;
+}
+
+/*******************************************************************************
+ * Worker pool
+ *******************************************************************************
+ * The jobs are queued in one wait-free queue per priority, the workers take
+ * them from the highest priority first. The semaphore counts the queued jobs,
+ * plus one token per worker when the pool is stopping.
+ *******************************************************************************/
+struct threadPool
+{
+    char name[MAX_THREAD_NAME_SIZE];  ///< name of the pool
+    struct cds_wfcq_head head[THREAD_PRIORITY_COUNT];  ///< queues heads
+    struct cds_wfcq_tail tail[THREAD_PRIORITY_COUNT];  ///< queues tails
+    sem_t pending;          ///< number of jobs to take
+    unsigned queueSize;     ///< max number of queued jobs
+    unsigned queued;        ///< number of queued jobs (atomic)
+    int stopping;           ///< the pool is being destroyed (atomic)
+    unsigned workerCount;   ///< number of workers
+    int workers[MAX_POOL_WORKERS];  ///< thread ids of the workers
+};
+
+static uint64_t elapsedNs(const struct timespec *from,
+                          const struct timespec *to)
+{
+    int64_t ns = (int64_t)(to->tv_sec - from->tv_sec) * 1000000000 +
+                 (to->tv_nsec - from->tv_nsec);
+    return ns > 0 ? (uint64_t)ns : 0;
+}
+
+/*******************************************************************************
+ * Take the next job of the pool, the highest priority first
+ *
+ * @return the job, or NULL if all the queues are empty
+ *******************************************************************************/
+static threadJob_t *takeThreadJob(threadPool_t *pool)
+{
+    struct cds_wfcq_node *node;
+
+    for (int priority = THREAD_PRIORITY_COUNT - 1; priority >= 0; priority--) {
+        node = cds_wfcq_dequeue_blocking(&pool->head[priority],
+                                         &pool->tail[priority]);
+        if (node != NULL) {
+            uatomic_dec(&pool->queued);
+            return caa_container_of(node, threadJob_t, node);
+        }
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Call the completion function of a job that was not run
+ *******************************************************************************
+ * The job has been removed from the queue, it may be posted again.
+ *******************************************************************************/
+static void dropThreadJob(threadPool_t *pool, threadJob_t *job)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    job->waitNs = elapsedNs(&job->postTime, &now);
+    job->runNs = 0;
+    uatomic_set(&job->state, THREAD_JOB_CANCELLED);
+    AFB_DEBUG("%s: job %p cancelled after %llu us", pool->name, (void *)job,
+              (unsigned long long)(job->waitNs / 1000));
+    if (job->done != NULL)
+        job->done(job, THREAD_JOB_CANCELLED);
+}
+
+/*******************************************************************************
+ * Main function of the workers
+ *******************************************************************************/
+static void *poolWorkerMain(void *context)
+{
+    threadPool_t *pool = context;
+    int priority = THREAD_PRIORITY_NORMAL;
+    unsigned failed = 0;  // priorities that could not be applied
+    struct timespec start, end;
+    threadJob_t *job;
+
+    for (;;) {
+        while (sem_wait(&pool->pending) != 0 && errno == EINTR)
+            ;
+
+        job = takeThreadJob(pool);
+        if (job == NULL) {
+            // only the stop tokens find the queues empty
+            if (uatomic_read(&pool->stopping))
+                break;
+            continue;
+        }
+
+        // a job cancelled while queued is only reported
+        if (uatomic_read(&pool->stopping) ||
+            uatomic_cmpxchg(&job->state, THREAD_JOB_QUEUED,
+                            THREAD_JOB_RUNNING) != THREAD_JOB_QUEUED) {
+            dropThreadJob(pool, job);
+            continue;
+        }
+
+        // raising the nice level back needs CAP_SYS_NICE: a priority that
+        // failed is not tried again, the jobs run at the current one
+        if (job->priority != priority && !(failed & (1u << job->priority))) {
+            if (applyThreadPriority(0, job->priority, 0) == 0) {
+                priority = job->priority;
+            }
+            else {
+                failed |= 1u << job->priority;
+                AFB_WARNING("%s: jobs of priority %d run at priority %d",
+                            pool->name, job->priority, priority);
+            }
+        }
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        job->waitNs = elapsedNs(&job->postTime, &start);
+        job->func(job);
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        job->runNs = elapsedNs(&start, &end);
+
+        AFB_DEBUG("%s: job %p waited %llu us, ran %llu us", pool->name,
+                  (void *)job, (unsigned long long)(job->waitNs / 1000),
+                  (unsigned long long)(job->runNs / 1000));
+        uatomic_set(&job->state, THREAD_JOB_DONE);
+        if (job->done != NULL)
+            job->done(job, THREAD_JOB_DONE);
+    }
+    return NULL;
+}
+
+/*******************************************************************************
+ * Create a pool of workers
+ *******************************************************************************
+ * The workers are named "<name>-<n>" and start with the normal priority, they
+ * take the priority of the job they run. A worker that fails to take a
+ * priority (e.g. raising its nice level without CAP_SYS_NICE) keeps its own
+ * for the jobs of that priority.
+ *
+ * @return the pool, or NULL on error
+ *******************************************************************************/
+threadPool_t *createThreadPool(const char *name,
+                               unsigned workerCount,
+                               unsigned queueSize)
+{
+    char workerName[MAX_THREAD_NAME_SIZE + 8];
+    threadPool_t *pool;
+    thread_Obj_t *threadPtr;
+
+    if (workerCount == 0 || workerCount > MAX_POOL_WORKERS || queueSize == 0)
+        return NULL;
+
+    pool = calloc(1, sizeof(*pool));
+    if (pool == NULL)
+        return NULL;
+
+    utf8_Copy(pool->name, name, sizeof(pool->name), NULL);
+    for (int priority = 0; priority < THREAD_PRIORITY_COUNT; priority++)
+        cds_wfcq_init(&pool->head[priority], &pool->tail[priority]);
+    if (sem_init(&pool->pending, 0, 0) != 0) {
+        free(pool);
+        return NULL;
+    }
+    pool->queueSize = queueSize;
+
+    for (unsigned i = 0; i < workerCount; i++) {
+        snprintf(workerName, sizeof(workerName), "%s-%u", pool->name, i);
+        int id = CreateThread(workerName, poolWorkerMain, pool);
+        if (id <= 0)
+            break;
+
+        lock();
+        threadPtr = findThreadFromId(id);
+        threadPtr->priority = THREAD_PRIORITY_NORMAL;
+        unlock();
+
+        if (setThreadJoinable(id) != 0 || startThread(id) != 0) {
+            // never started, the thread object is still owned by the table
+            lock();
+            releaseThreadId(id);
+            unlock();
+            DeleteThread(threadPtr);
+            break;
+        }
+        pool->workers[pool->workerCount++] = id;
+    }
+
+    if (pool->workerCount != workerCount) {
+        AFB_ERROR("Could not start the workers of pool '%s'.", name);
+        destroyThreadPool(pool);
+        return NULL;
+    }
+    return pool;
+}
+
+/*******************************************************************************
+ * Stop the workers and free a pool
+ *******************************************************************************
+ * The running jobs are completed, the queued ones are cancelled (their
+ * completion function is called with THREAD_JOB_CANCELLED). No job may be
+ * posted to the pool while or after it is destroyed.
+ *******************************************************************************/
+void destroyThreadPool(threadPool_t *pool)
+{
+    threadJob_t *job;
+
+    if (pool == NULL)
+        return;
+
+    uatomic_set(&pool->stopping, 1);
+    for (unsigned i = 0; i < pool->workerCount; i++)
+        sem_post(&pool->pending);
+    for (unsigned i = 0; i < pool->workerCount; i++)
+        JoinThread(pool->workers[i], NULL);
+
+    while ((job = takeThreadJob(pool)) != NULL)
+        dropThreadJob(pool, job);
+
+    sem_destroy(&pool->pending);
+    free(pool);
+}
+
+/*******************************************************************************
+ * Initialize a job
+ *******************************************************************************
+ * An invalid priority is replaced by THREAD_PRIORITY_NORMAL.
+ *******************************************************************************/
+void initThreadJob(threadJob_t *job,
+                   threadJob_Func_t func,
+                   threadJob_DoneFunc_t done,
+                   void *context,
+                   int priority)
+{
+    memset(job, 0, sizeof(*job));
+    cds_wfcq_node_init(&job->node);
+    job->func = func;
+    job->done = done;
+    job->context = context;
+    job->priority = priority >= 0 && priority < THREAD_PRIORITY_COUNT
+                        ? priority
+                        : THREAD_PRIORITY_NORMAL;
+    job->state = THREAD_JOB_IDLE;
+}
+
+/*******************************************************************************
+ * Post a job to a pool
+ *******************************************************************************
+ * The job must not be queued, running or cancelled but still in the queue.
+ * It can be posted again from its completion function.
+ *
+ * @return
+ *      -  0 if successful.
+ *      - -1 if the job is invalid or already posted.
+ *      - -2 if the queue of the pool is full.
+ *      - -3 if the pool is stopping.
+ *******************************************************************************/
+int postThreadJob(threadPool_t *pool, threadJob_t *job)
+{
+    unsigned queued;
+    int state;
+
+    if (pool == NULL || job == NULL || job->func == NULL)
+        return -1;
+
+    if (uatomic_read(&pool->stopping))
+        return -3;
+
+    state = uatomic_read(&job->state);
+    if (state == THREAD_JOB_QUEUED || state == THREAD_JOB_RUNNING ||
+        state == THREAD_JOB_CANCELLING)
+        return -1;
+
+    // reserve a place in the queue
+    do {
+        queued = uatomic_read(&pool->queued);
+        if (queued >= pool->queueSize)
+            return -2;
+    } while (uatomic_cmpxchg(&pool->queued, queued, queued + 1) != queued);
+
+    cds_wfcq_node_init(&job->node);
+    job->waitNs = 0;
+    job->runNs = 0;
+    clock_gettime(CLOCK_MONOTONIC, &job->postTime);
+    uatomic_set(&job->state, THREAD_JOB_QUEUED);
+
+    cds_wfcq_enqueue(&pool->head[job->priority], &pool->tail[job->priority],
+                     &job->node);
+    sem_post(&pool->pending);
+    return 0;
+}
+
+/*******************************************************************************
+ * Cancel a queued job
+ *******************************************************************************
+ * The job stays in the queue (THREAD_JOB_CANCELLING) until a worker takes it,
+ * the worker then calls its completion function with THREAD_JOB_CANCELLED
+ * instead of running it. Until then, the job can't be posted again: its node
+ * is still linked in the queue.
+ *
+ * @return
+ *      -  0 if successful.
+ *      - -1 if the job is not queued (running, done or not posted).
+ *******************************************************************************/
+int cancelThreadJob(threadJob_t *job)
+{
+    if (job == NULL || uatomic_cmpxchg(&job->state, THREAD_JOB_QUEUED,
+                                       THREAD_JOB_CANCELLING) !=
+                           THREAD_JOB_QUEUED)
+        return -1;
+    return 0;
+}
+
+/*******************************************************************************
+ * Set the CPUs the workers of a pool may run on
+ *******************************************************************************
+ * @return 0 if successful, -1 if the affinity of a worker can't be set
+ *******************************************************************************/
+int setThreadPoolAffinity(threadPool_t *pool, const cpu_set_t *cpus)
+{
+    int rc = 0;
+
+    for (unsigned i = 0; i < pool->workerCount; i++) {
+        if (setThreadAffinity(pool->workers[i], cpus) != 0)
+            rc = -1;
+    }
+    return rc;
+}
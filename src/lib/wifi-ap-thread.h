@@ -19,9 +19,13 @@
 #define THREAD_HEADER_FILE
 
 #include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <time.h>
 #include <urcu/list.h>
+#include <urcu/wfcqueue.h>
 
 //------------------------------------------------------------------------------
 /**
@@ -30,7 +34,40 @@
 //------------------------------------------------------------------------------
 #define MAX_THREAD_NAME_SIZE 24
 
-#define DEFAULT_THREAD_PRIORITY 0;
+//------------------------------------------------------------------------------
+/**
+ * Thread priorities: idle runs with SCHED_IDLE, the others with SCHED_OTHER
+ * and a nice level of 10 (low), 0 (normal) or -10 (high). The jobs of the
+ * worker pools use these THREAD_PRIORITY_COUNT levels.
+ *
+ * The real-time priorities (threads only) run with SCHED_FIFO or SCHED_RR and
+ * a real-time priority between 1 and 99.
+ *
+ * When LE_CONFIG_THREAD_REALTIME_ONLY is set, all the threads are real-time:
+ * idle, low, normal and high run with SCHED_RR and a real-time priority of
+ * 1, 2, 3 and 4.
+ **/
+//------------------------------------------------------------------------------
+#define THREAD_PRIORITY_IDLE    0
+#define THREAD_PRIORITY_LOW     1
+#define THREAD_PRIORITY_NORMAL  2
+#define THREAD_PRIORITY_HIGH    3
+#define THREAD_PRIORITY_COUNT   4
+#define THREAD_PRIORITY_RT_FIFO 4
+#define THREAD_PRIORITY_RT_RR   5
+
+#define DEFAULT_THREAD_PRIORITY THREAD_PRIORITY_NORMAL
+#define DEFAULT_RT_PRIORITY     1
+
+//------------------------------------------------------------------------------
+/**
+ * Thread registry: thread ids are handles made of an index in the thread table
+ * and of the generation of the slot, so that the id of a deleted thread is
+ * never valid again.
+ **/
+//------------------------------------------------------------------------------
+#define THREAD_INDEX_BITS 6
+#define MAX_THREADS       (1 << THREAD_INDEX_BITS)
 
 //------------------------------------------------------------------------------
 /**
@@ -68,11 +105,13 @@ typedef void (*thread_Destructor_t)(
 //------------------------------------------------------------------------------
 typedef struct thread_Obj
 {
-    struct cds_list_head link;
-    int threadId;
+    int threadId;                     ///< Handle in the thread table.
     char name[MAX_THREAD_NAME_SIZE];  ///< The name of the thread.
     pthread_attr_t attr;              ///< The thread's attributes.
     int priority;                     ///< The thread's priority.
+    int rtPriority;                   ///< Level of the RT priorities, 1 to 99.
+    bool hasAffinity;                 ///< true = affinity is set.
+    cpu_set_t affinity;               ///< CPUs the thread may run on.
     bool isJoinable;                  ///< true = joinable, false = detached.
 
     /// Thread state.
@@ -86,9 +125,12 @@ typedef struct thread_Obj
     void *context;               ///< Context value to be passed to mainFunc
     struct cds_list_head destructorList;  ///< destructors list for this thread
     pthread_t threadHandle;               ///< The pthreads thread handle.
-    size_t ThreadObjListChangeCount;
     bool setPidOnStart;  ///< Set PID on start flag
     pid_t procId;        ///< The main process ID for this thread
+    pid_t tid;           ///< Kernel id of the thread, once started
+    bool hasCpuClock;    ///< cpuClock is valid (thread started)
+    clockid_t cpuClock;  ///< CPU-time clock of the thread
+    struct timespec cpuTime;  ///< CPU time used, saved when the thread ends
 } thread_Obj_t;
 
 //------------------------------------------------------------------------------
@@ -105,6 +147,66 @@ typedef struct le_thread_Destructor
     void *context;                   ///< context for destructor function.
 } Destructor_t;
 
+//------------------------------------------------------------------------------
+/**
+ * Worker pool: a fixed number of worker threads running the jobs posted to a
+ * bounded queue (one lock-free wfcqueue per priority).
+ **/
+//------------------------------------------------------------------------------
+#define MAX_POOL_WORKERS 8
+
+struct threadJob;
+typedef struct threadPool threadPool_t;
+
+//------------------------------------------------------------------------------
+/**
+ * Job functions:
+ *
+ * @param job [IN] The job being run, its context is job->context.
+ */
+//------------------------------------------------------------------------------
+typedef void (*threadJob_Func_t)(struct threadJob *job);
+
+//------------------------------------------------------------------------------
+/**
+ * Completion functions, called by the worker once the job has been run or
+ * once a cancelled job has been removed from the queue. The job may be freed
+ * or posted again from there.
+ *
+ * @param job    [IN] The job, with its latencies filled.
+ * @param status [IN] THREAD_JOB_DONE or THREAD_JOB_CANCELLED.
+ */
+//------------------------------------------------------------------------------
+typedef void (*threadJob_DoneFunc_t)(struct threadJob *job, int status);
+
+enum {
+    THREAD_JOB_IDLE,       ///< Not posted.
+    THREAD_JOB_QUEUED,     ///< Waiting for a worker.
+    THREAD_JOB_RUNNING,    ///< Being run by a worker.
+    THREAD_JOB_CANCELLING, ///< Cancelled, still in the queue.
+    THREAD_JOB_CANCELLED,  ///< Cancelled and removed from the queue.
+    THREAD_JOB_DONE        ///< Run.
+};
+
+//------------------------------------------------------------------------------
+/**
+ * A job, owned by the caller. It must stay valid until its completion
+ * function has been called.
+ **/
+//------------------------------------------------------------------------------
+typedef struct threadJob
+{
+    struct cds_wfcq_node node;  ///< link in the queue of the pool
+    threadJob_Func_t func;      ///< function run by the worker
+    threadJob_DoneFunc_t done;  ///< completion function (may be NULL)
+    void *context;              ///< context of the job
+    int priority;               ///< THREAD_PRIORITY_xxx of the job
+    int state;                  ///< THREAD_JOB_xxx, changed atomically
+    struct timespec postTime;   ///< time the job was posted (monotonic)
+    uint64_t waitNs;            ///< time spent in the queue
+    uint64_t runNs;             ///< time spent running
+} threadJob_t;
+
 //******************************************************************************
 
 // thread functions
@@ -114,11 +216,30 @@ int startThread(int threadId);
 int addDestructorToThread(int threadId,
                           thread_Destructor_t destructor,
                           void *context);
-thread_Obj_t *CreateThread(const char *name,
-                           thread_MainFunc_t mainFunc,
-                           void *context);
+int CreateThread(const char *name, thread_MainFunc_t mainFunc, void *context);
 int GetNumberOfNodesInList(struct cds_list_head *listHead);
 int JoinThread(int threadId, void **resultValuePtr);
 int cancelThread(int threadId);
+int deleteThread(int threadId);
+int getThreadCpuTime(int threadId, struct timespec *cpuTime);
+int setThreadPriority(int threadId, int priority, int rtPriority);
+int setThreadAffinity(int threadId, const cpu_set_t *cpus);
+int parseThreadPriority(const char *name);
+int parseThreadCpuList(const char *list, cpu_set_t *cpus);
+
+// worker pool functions
+
+threadPool_t *createThreadPool(const char *name,
+                               unsigned workerCount,
+                               unsigned queueSize);
+void destroyThreadPool(threadPool_t *pool);
+void initThreadJob(threadJob_t *job,
+                   threadJob_Func_t func,
+                   threadJob_DoneFunc_t done,
+                   void *context,
+                   int priority);
+int postThreadJob(threadPool_t *pool, threadJob_t *job);
+int cancelThreadJob(threadJob_t *job);
+int setThreadPoolAffinity(threadPool_t *pool, const cpu_set_t *cpus);
 
 #endif
@@ -0,0 +1,42 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef TRACE_HEADER_FILE
+#define TRACE_HEADER_FILE
+
+// Static tracepoints of the provider "wifiap" (USDT), built with the cmake
+// option WITH_USDT. They are a nop instruction until a tracer attaches to
+// them (bpftrace, perf, systemtap), and are removed when the option is off:
+// their arguments are then not evaluated.
+
+#ifdef WIFIAP_WITH_USDT
+#include <sys/sdt.h>
+
+#define WIFIAP_TRACE1(name, a)       DTRACE_PROBE1(wifiap, name, a)
+#define WIFIAP_TRACE2(name, a, b)    DTRACE_PROBE2(wifiap, name, a, b)
+#define WIFIAP_TRACE3(name, a, b, c) DTRACE_PROBE3(wifiap, name, a, b, c)
+#else
+#define WIFIAP_TRACE1(name, a) \
+    do {                       \
+    } while (0)
+#define WIFIAP_TRACE2(name, a, b) \
+    do {                          \
+    } while (0)
+#define WIFIAP_TRACE3(name, a, b, c) \
+    do {                             \
+    } while (0)
+#endif
+
+#endif
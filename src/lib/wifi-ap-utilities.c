@@ -18,9 +18,18 @@
 
 #include "wifi-ap-utilities.h"
 
+#include "wifi-ap-data.h"
+#include "wifi-ap-platform.h"
+
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <limits.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 //------------------------------------------------------------------------------
 /**
@@ -199,7 +208,7 @@ int utf8_Append(
 
 //------------------------------------------------------------------------------
 /**
- * Check if a file exists.
+ * Check if a file exists on the platform in use.
  *
  * @return
  *      1 if file exists, or 0 if not.
@@ -209,13 +218,70 @@ int checkFileExists(const char *fileName)
 {
     /*open file to read*/
     FILE *file;
-    if ((file = fopen(fileName, "r")) != NULL) {
+    if ((file = getPlatform()->openFile(fileName)) != NULL) {
         fclose(file);
         return 1;
     }
     return 0;
 }
 
+//------------------------------------------------------------------------------
+/**
+ * Replace the content of a file atomically.
+ *
+ * The content is written to "<fileName>.tmp", flushed to the disk and renamed
+ * over the file, so that a reader (or a reboot) sees either the old or the new
+ * content, never a partial one.
+ *
+ * @return
+ *      0 on success, or -errno on failure.
+ */
+//------------------------------------------------------------------------------
+int writeFileAtomically(const char *fileName, const char *content)
+{
+    char tmpName[PATH_MAX];
+    char dirName[PATH_MAX];
+    size_t length = strlen(content);
+    int fd, rc = 0;
+
+    if (snprintf(tmpName, sizeof(tmpName), "%s.tmp", fileName) >=
+        (int)sizeof(tmpName))
+        return -ENAMETOOLONG;
+
+    fd = open(tmpName, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0)
+        return -errno;
+
+    while (length > 0 && rc == 0) {
+        ssize_t count = write(fd, content, length);
+        if (count >= 0) {
+            content += count;
+            length -= (size_t)count;
+        }
+        else if (errno != EINTR)
+            rc = -errno;
+    }
+    if (rc == 0 && fsync(fd) != 0)
+        rc = -errno;
+    if (close(fd) != 0 && rc == 0)
+        rc = -errno;
+    if (rc == 0 && rename(tmpName, fileName) != 0)
+        rc = -errno;
+    if (rc != 0) {
+        unlink(tmpName);
+        return rc;
+    }
+
+    // make the rename itself durable
+    utf8_Copy(dirName, fileName, sizeof(dirName), NULL);
+    fd = open(dirname(dirName), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+    return 0;
+}
+
 //------------------------------------------------------------------------------
 /**
  * Convert Netmask ip address to CIDR annotation.
@@ -275,3 +341,62 @@ int toCidr(const char *ipAddress)
     }
     return netmask_cidr;
 }
+
+//------------------------------------------------------------------------------
+/**
+ * Convert a frequency (in MHz) to an IEEE 802.11 channel number.
+ *
+ * @return
+ *      The channel number, or 0 if the frequency is not a WiFi channel.
+ */
+//------------------------------------------------------------------------------
+uint16_t frequencyToChannel(uint32_t frequency)
+{
+    if (frequency == 2484)
+        return 14;
+    if (frequency >= 2412 && frequency <= 2472)
+        return (uint16_t)((frequency - 2407) / 5);
+    if (frequency >= 4915 && frequency <= 4980)
+        return (uint16_t)((frequency - 4000) / 5);
+    if (frequency >= 5035 && frequency <= 5885)
+        return (uint16_t)((frequency - 5000) / 5);
+    if (frequency >= 5955 && frequency <= 7115)
+        return (uint16_t)((frequency - 5950) / 5);
+    if (frequency >= 58320 && frequency <= 69120)
+        return (uint16_t)((frequency - 56160) / 2160);
+    return 0;
+}
+
+//------------------------------------------------------------------------------
+/**
+ * Convert an IEEE 802.11 channel number to a frequency (in MHz) for the
+ * hardware mode of the IEEE standard mask.
+ *
+ * @return
+ *      The frequency in MHz, or 0 if the channel is not valid.
+ */
+//------------------------------------------------------------------------------
+uint32_t channelToFrequency(uint16_t channel, uint32_t stdMask)
+{
+    switch (stdMask & HARDWARE_MODE_MASK) {
+    case WIFI_AP_BITMASK_IEEE_STD_B:
+    case WIFI_AP_BITMASK_IEEE_STD_G:
+        if (channel == 14)
+            return 2484;
+        if (channel >= 1 && channel <= 13)
+            return 2407 + 5 * (uint32_t)channel;
+        return 0;
+    case WIFI_AP_BITMASK_IEEE_STD_A:
+        if (channel >= 183 && channel <= 196)
+            return 4000 + 5 * (uint32_t)channel;
+        if (channel >= 7 && channel <= 177)
+            return 5000 + 5 * (uint32_t)channel;
+        return 0;
+    case WIFI_AP_BITMASK_IEEE_STD_AD:
+        if (channel >= 1 && channel <= 6)
+            return 56160 + 2160 * (uint32_t)channel;
+        return 0;
+    default:
+        return 0;
+    }
+}
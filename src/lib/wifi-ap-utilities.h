@@ -17,6 +17,7 @@
 #ifndef UTILITIES_HEADER_FILE
 #define UTILITIES_HEADER_FILE
 
+#include <stdint.h>
 #include <stdio.h>
 
 int utf8_Copy(char *destStr,
@@ -29,6 +30,9 @@ int utf8_Append(char *destStr,
                 size_t *destStrLenPtr);
 size_t utf8_NumBytesInChar(const char firstByte);
 int checkFileExists(const char *fileName);
+int writeFileAtomically(const char *fileName, const char *content);
 int toCidr(const char *ipAddress);
+uint16_t frequencyToChannel(uint32_t frequency);
+uint32_t channelToFrequency(uint16_t channel, uint32_t stdMask);
 
 #endif
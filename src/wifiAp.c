@@ -18,7 +18,11 @@
 
 #include <arpa/inet.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <poll.h>
 #include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
 
 #include <json-c/json.h>
 
@@ -29,33 +33,57 @@
 #include <afb-helpers4/afb-req-utils.h>
 #include <afb/afb-binding.h>
 
+#include "lib/wifi-ap-cache.h"
 #include "lib/wifi-ap-config.h"
 #include "lib/wifi-ap-data.h"
+#include "lib/wifi-ap-diag.h"
+#include "lib/wifi-ap-events.h"
+#include "lib/wifi-ap-fake.h"
+#include "lib/wifi-ap-hostapd.h"
+#include "lib/wifi-ap-json.h"
+#include "lib/wifi-ap-metrics.h"
+#include "lib/wifi-ap-platform.h"
+#include "lib/wifi-ap-psk.h"
+#include "lib/wifi-ap-shaping.h"
+#include "lib/wifi-ap-start.h"
+#include "lib/wifi-ap-steering.h"
+#include "lib/wifi-ap-survey.h"
 #include "lib/wifi-ap-thread.h"
+#include "lib/wifi-ap-trace.h"
 #include "lib/wifi-ap-utilities.h"
 
-// Set of commands to drive the WiFi features.
-#define COMMAND_WIFI_HW_START        " WIFI_START"
-#define COMMAND_WIFI_HW_STOP         " WIFI_STOP"
-#define COMMAND_WIFI_SET_EVENT       " WIFI_SET_EVENT"
-#define COMMAND_WIFI_UNSET_EVENT     " WIFI_UNSET_EVENT"
-#define COMMAND_WIFI_FIREWALLD_ALLOW " WIFI_FIREWALLD_ALLOW"
-#define COMMAND_WIFI_NM_UNMANAGE     " WIFI_NM_UNMANAGE"
-#define COMMAND_WIFIAP_HOSTAPD_START " WIFIAP_HOSTAPD_START"
-#define COMMAND_WIFIAP_HOSTAPD_STOP  " WIFIAP_HOSTAPD_STOP"
-#define COMMAND_WIFIAP_WLAN_UP       " WIFIAP_WLAN_UP"
-#define COMMAND_DNSMASQ_RESTART      " DNSMASQ_RESTART"
-
 #ifdef TEST_MODE
 #define COMMAND_GET_VIRTUAL_INTERFACE_NAME "GET_VIRTUAL_INTERFACE_NAME"
 #endif
 
 #define MAX_IP_ADDRESS_LENGTH      15
-#define WIFI_MAX_EVENT_INFO_LENGTH 512
 
 #define HARDWARE_MODE_MASK 0x000F  // Hardware mode mask
 #define PATH_MAX           8192
 
+// quiet time after a change of the config file before reloading it (ms)
+#define CONFIG_RELOAD_DELAY_MS 500
+
+// quiet time after a runtime change before writing the state file (ms)
+#define STATE_SAVE_DELAY_MS 1000
+
+// max size of the state file
+#define STATE_FILE_SIZE 65536
+
+// polling of hostapd until it sends the beacons (ms)
+#define AP_READY_POLL_MS    100
+#define AP_READY_TIMEOUT_MS 15000
+
+// delay after a new station before its limit is set, to let it get a lease
+#define SHAPING_REFRESH_DELAY_MS 5000
+
+// default duration above which a verb call is logged (key "slowVerbMs")
+#define DEFAULT_SLOW_VERB_MS 500
+
+// workers running the long requests (surveys) in the background
+#define WIFIAP_POOL_WORKERS    2
+#define WIFIAP_POOL_QUEUE_SIZE 16
+
 // path to Wifi platform adapter shell script
 #ifdef TEST_MODE
 #define WIFI_SCRIPT      APP_DIR_ "/var/wifi_setup_test.sh"
@@ -66,12 +94,15 @@
 #endif
 
 static const char status_init[] = "initializing";
+static const char status_starting[] = "starting";
 static const char status_started[] = "started";
 static const char status_stopped[] = "stopped";
 static const char status_fail[] = "failure";
 
 static const char client_state_event_name[] = "client-state";
 static afb_event_t client_state_event;
+static const char ap_ready_event_name[] = "ap-ready";
+static afb_event_t ap_ready_event;
 
 static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -79,477 +110,886 @@ static pthread_mutex_t status_mutex = PTHREAD_MUTEX_INITIALIZER;
  *        The handle of the input pipe used to be notified of the WiFi events  *
  ******************************************************************************/
 static FILE *IwThreadPipePtr = NULL;
-thread_Obj_t *wifiApThreadPtr = NULL;
+static int wifiApThreadId = 0;
 
 /*******************************************************************************
- *                    Function to push event                                   *
+ *        The cache of the generated files (key "cacheDir")                    *
  ******************************************************************************/
-static int push_json_event(struct json_object *args, afb_event_t event)
-{
-    afb_data_t data = afb_data_json_c_hold(args);
-    return data == NULL ? AFB_ERRNO_OUT_OF_MEMORY
-                        : afb_event_push(event, 1, &data);
-}
+static char *cacheDir = NULL;
 
 /*******************************************************************************
- *                                                 WiFi Client Thread Function *
+ *        Start times, to report when the access point sends its beacons       *
+ *                                                                             *
+ * Protected by status_mutex. apStartCount tells the polls of an older start   *
+ * to give up; bootApiReadyMs is -1 once the start of the boot is reported.    *
  ******************************************************************************/
-static void *WifiApThreadMainFunc(void *contextPtr)
+static struct timespec bootStartTime;
+static int64_t bootApiReadyMs = -1;
+static struct timespec apStartTime;
+static unsigned apStartCount = 0;
+static wifiApT *apStartData = NULL;
+
+/*******************************************************************************
+ *        The band steering: its counters and the generation of its jobs       *
+ *                                                                             *
+ * Protected by steering_mutex. The jobs of an older generation give up.       *
+ ******************************************************************************/
+static wifiApSteeringStateT steeringState;
+static unsigned steeringGeneration = 0;
+static pthread_mutex_t steering_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *        Serializes the changes of the traffic control of the interface       *
+ ******************************************************************************/
+static pthread_mutex_t shaping_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *        The pool of workers running the background jobs                      *
+ ******************************************************************************/
+static threadPool_t *wifiApPool = NULL;
+
+/*******************************************************************************
+ *        The configuration file, replaced by $WIFIAP_CONFIG_FILE if set       *
+ ******************************************************************************/
+static const char *configFile = PATH_CONFIG_FILE;
+
+/*******************************************************************************
+ *        Serializes the reloads of the configuration file                     *
+ *                                                                             *
+ * A reload replaces the settings of wifiApData: the verbs (but the ones of    *
+ * unlockedVerbs), the fast boot and the jobs using the settings hold it too.  *
+ ******************************************************************************/
+static pthread_mutex_t reload_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *        The state file keeping the runtime changes (key "stateFile")         *
+ ******************************************************************************/
+static char *stateFile = NULL;
+static bool stateSavePending = false;
+static pthread_mutex_t state_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*******************************************************************************
+ *        The metrics of the binding (verb getMetrics)                         *
+ *                                                                             *
+ * Created at pre-init, updated without lock (see wifi-ap-metrics.h). The      *
+ * durations of the verbs are kept with their table entry (meteredVerbT).      *
+ ******************************************************************************/
+// the stages of startWifiAp, then the services started by the binding
+enum
 {
-    char path[PATH_MAX];
-    char *ret;
-    char *pathReentrant;
-    int numberOfClientsConnected = 0;
-    char eventInfo[WIFI_MAX_EVENT_INFO_LENGTH];
-    char cmd[PATH_MAX];
+    START_PHASE_SERVICES = AP_STAGE_COUNT,
+    START_PHASE_COUNT
+};
+static metricT *startPhaseMetrics[START_PHASE_COUNT];
 
-    AFB_INFO("wifiAp event report thread started on interface %s !",
-             (char *)contextPtr);
-    snprintf(cmd, sizeof(cmd), "iw event");
+static const char *start_phase_name(unsigned phase)
+{
+    return phase == START_PHASE_SERVICES ? "services"
+                                         : getApStageName((apStageT)phase);
+}
+static metricT *apReadyMetric;
 
-    AFB_INFO(" %s !", cmd);
-    IwThreadPipePtr = popen(cmd, "r");
+enum
+{
+    EVENT_CLIENT_STATE,
+    EVENT_AP_READY,
+    EVENT_COUNT
+};
+static const char *const eventNames[EVENT_COUNT] = {client_state_event_name,
+                                                    ap_ready_event_name};
+static metricT *eventPublishedMetrics[EVENT_COUNT];
+static metricT *eventDroppedMetrics[EVENT_COUNT];
 
-    if (NULL == IwThreadPipePtr) {
-        AFB_ERROR("Failed to run command:\"iw event\" errno:%d %s", errno,
-                  strerror(errno));
-        return NULL;
-    }
+enum
+{
+    CONFIG_FILE_HOSTS = AP_FILE_HOSTS,
+    CONFIG_FILE_DNSMASQ = AP_FILE_DNSMASQ,
+    CONFIG_FILE_HOSTAPD = AP_FILE_HOSTAPD,
+    CONFIG_FILE_STATE = AP_FILE_COUNT,
+    CONFIG_FILE_COUNT
+};
+static const char *const configFileNames[CONFIG_FILE_COUNT] = {
+    "hosts", "dnsmasq", "hostapd", "state"};
+static metricT *configWriteMetrics[CONFIG_FILE_COUNT];
 
-    // Read the output one line at a time - output it.
-    while (NULL != fgets(path, sizeof(path) - 1, IwThreadPipePtr)) {
-        AFB_DEBUG("PARSING:%s: len:%d", path,
-                  (int)strnlen(path, sizeof(path) - 1));
-        if (NULL != (ret = strstr(path, "del station"))) {
-            pathReentrant = path;
-            ret = strtok_r(pathReentrant, ":", &pathReentrant);
-            if (NULL == ret) {
-                AFB_WARNING("Failed to retrieve WLAN interface");
-            }
-            else {
-                if (NULL != strstr(ret, (char *)contextPtr)) {
-                    numberOfClientsConnected--;
-                    memcpy(eventInfo, "WiFi client disconnected", 22);
-                    eventInfo[22] = '\0';
+static metricT *systemSpawnMetric;
+static metricT *popenSpawnMetric;
+static metricT *stationConnectMetric;
+static metricT *stationDisconnectMetric;
 
-                    json_object *eventResponseJ;
-                    rp_jsonc_pack(&eventResponseJ, "{ss,si}", "Event",
-                                  eventInfo, "number-client",
-                                  numberOfClientsConnected);
+typedef struct
+{
+    const afb_verb_t *verb;
+    metricT *duration;
+    metricT *errors;
+    bool locked;  // the callback runs under reload_mutex
+} meteredVerbT;
 
-                    push_json_event(eventResponseJ, client_state_event);
-                }
-            }
-        }
-        else if (NULL != (ret = strstr(path, "new station"))) {
-            pathReentrant = path;
-            ret = strtok_r(pathReentrant, ":", &pathReentrant);
-            if (NULL == ret) {
-                AFB_WARNING("Failed to retrieve WLAN interface");
-            }
-            else {
-                if (NULL != strstr(ret, (char *)contextPtr)) {
-                    numberOfClientsConnected++;
-                    memcpy(eventInfo, "WiFi client connected", 22);
-                    eventInfo[22] = '\0';
+static meteredVerbT *meteredVerbs = NULL;
 
-                    json_object *eventResponseJ;
-                    rp_jsonc_pack(&eventResponseJ, "{ss,si}", "Event",
-                                  eventInfo, "number-client",
-                                  numberOfClientsConnected);
+/*******************************************************************************
+ *        The calls of the verbs longer than slowVerbMs are logged             *
+ *                                                                             *
+ * The call run by a thread records its reply, if done before returning. The   *
+ * arguments of the secret verbs, and the secret keys of the objects, are      *
+ * redacted from the logs.                                                     *
+ ******************************************************************************/
+typedef struct
+{
+    afb_req_t request;
+    int status;
+    bool replied;
+} verbCallT;
 
-                    push_json_event(eventResponseJ, client_state_event);
-                }
-            }
-        }
-    }
+static unsigned slowVerbMs = DEFAULT_SLOW_VERB_MS;
+static __thread verbCallT *currentVerbCall = NULL;
+static const char *const secretVerbs[] = {"setPassPhrase", "setPreSharedKey"};
+static const char *const secretKeys[] = {"passphrase", "preSharedKey"};
+#define REDACTED "***"
 
-    return NULL;
-}
+// the verbs answering while the access point starts, without the settings
+// (reloadConfig and rescanChannel take reload_mutex themselves)
+static const char *const unlockedVerbs[] = {
+    "reloadConfig",    "rescanChannel", "subscribe",      "unsubscribe",
+    "getWifiApStatus", "getMetrics",    "getDiagnostics", "info"};
 
 /*******************************************************************************
- *                                                  Thread destructor Function *
+ *        Scheduling settings of the threads (key "threads" of the config)     *
  ******************************************************************************/
-static void threadDestructorFunc(void *contextPtr)
+typedef struct
 {
-    int systemResult;
-    char cmd[PATH_MAX];
+    int priority;    // THREAD_PRIORITY_xxx
+    int rtPriority;  // real-time priority of fifo and rr
+    bool hasCpus;    // cpus is set
+    cpu_set_t cpus;  // CPUs the threads may run on
+} threadSettingsT;
 
-    snprintf(cmd, sizeof(cmd), "%s %s", (char *)contextPtr,
-             COMMAND_WIFI_UNSET_EVENT);
+static threadSettingsT eventThreadSettings = {
+    .priority = THREAD_PRIORITY_NORMAL, .rtPriority = DEFAULT_RT_PRIORITY};
+static threadSettingsT workerThreadSettings = {
+    .priority = THREAD_PRIORITY_LOW, .rtPriority = DEFAULT_RT_PRIORITY};
 
-    // Kill the script launched by popen() in Client thread
-    systemResult = system(cmd);
+/*******************************************************************************
+ *        reply to a request, counting the errors of its verb                  *
+ *                                                                             *
+ * The verbs of this file reply through these functions, not afb_req_reply,    *
+ * so that the error codes are counted by verb.                                *
+ ******************************************************************************/
+static void record_reply(afb_req_t request, int status)
+{
+    const meteredVerbT *metered = afb_req_get_vcbdata(request);
 
-    if ((!WIFEXITED(systemResult)) || (0 != WEXITSTATUS(systemResult))) {
-        AFB_WARNING("Unable to kill the WIFI events script %d",
-                    WEXITSTATUS(systemResult));
+    if (status < 0 && metered != NULL)
+        metricAdd(metered->errors, 1);
+    if (currentVerbCall != NULL && currentVerbCall->request == request) {
+        currentVerbCall->status = status;
+        currentVerbCall->replied = true;
     }
+}
 
-    if (IwThreadPipePtr) {
-        // And close FP used in created thread
-        pclose(IwThreadPipePtr);
-        IwThreadPipePtr = NULL;
-    }
+static void reply_request(afb_req_t request,
+                          int status,
+                          unsigned nreplies,
+                          afb_data_t const *replies)
+{
+    record_reply(request, status);
+    afb_req_reply(request, status, nreplies, replies);
+}
+
+static void reply_request_string(afb_req_t request,
+                                 int status,
+                                 const char *text)
+{
+    record_reply(request, status);
+    afb_req_reply_string(request, status, text);
 }
 
 /*******************************************************************************
- *             Check and resolve conflict with NM if exists                    *
+ *                    Function to push event                                   *
  ******************************************************************************/
-static void check_and_resolve_conflicts_with_NM(wifiApT *wifiApData)
+static int push_json_event(struct json_object *args, afb_event_t event)
 {
-    AFB_INFO("Check if Network Manager is installed");
+    unsigned index = event == ap_ready_event ? EVENT_AP_READY
+                                             : EVENT_CLIENT_STATE;
+    afb_data_t data = afb_data_json_c_hold(args);
+    int rc;
+
+    WIFIAP_TRACE1(event_push_begin, eventNames[index]);
+    rc = data == NULL ? AFB_ERRNO_OUT_OF_MEMORY
+                      : afb_event_push(event, 1, &data);
+    WIFIAP_TRACE2(event_push_end, eventNames[index], rc);
+    if (rc < 0)
+        diagRecord(DIAG_SUBSYSTEM_EVENT, DIAG_CODE_PUSH_FAILED, rc, "%s",
+                   eventNames[index]);
+
+    // dropped: no subscriber received it
+    metricAdd(rc > 0 ? eventPublishedMetrics[index]
+                     : eventDroppedMetrics[index],
+              1);
+    return rc;
+}
 
-    int systemResult = 0;
+/*******************************************************************************
+ *        run a command (system) or open its output (popen), counted           *
+ *                                                                             *
+ * The diagnostics keep the command without the path of the script, and its    *
+ * exit code (128 + signal if killed, -errno if not run).                      *
+ ******************************************************************************/
+static const char *command_name(const char *cmd)
+{
+    if (strncmp(cmd, WIFI_SCRIPT, sizeof(WIFI_SCRIPT) - 1) == 0)
+        cmd += sizeof(WIFI_SCRIPT) - 1;
+    return cmd + strspn(cmd, " ");
+}
 
-    char cmd[PATH_MAX];
+static int run_command(platformDomainT domain, const char *cmd)
+{
+    int status, exitCode;
+
+    metricAdd(systemSpawnMetric, 1);
+    WIFIAP_TRACE1(command_begin, cmd);
+    status = getPlatform()->runCommand(domain, cmd);
+    WIFIAP_TRACE2(command_end, cmd, status);
+
+    exitCode = status == -1          ? -errno
+               : WIFEXITED(status)   ? WEXITSTATUS(status)
+               : WIFSIGNALED(status) ? 128 + WTERMSIG(status)
+                                     : status;
+    diagRecord(DIAG_SUBSYSTEM_COMMAND, DIAG_CODE_EXIT, exitCode, "%s",
+               command_name(cmd));
+    return status;
+}
 
-    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
-             COMMAND_WIFI_NM_UNMANAGE, wifiApData->interfaceName);
+static FILE *open_command(platformDomainT domain, const char *cmd)
+{
+    FILE *pipe;
+
+    metricAdd(popenSpawnMetric, 1);
+    WIFIAP_TRACE1(command_open, cmd);
+    pipe = getPlatform()->openCommand(domain, cmd);
+    diagRecord(DIAG_SUBSYSTEM_COMMAND, DIAG_CODE_OPEN,
+               pipe == NULL ? -errno : 0, "%s", command_name(cmd));
+    return pipe;
+}
 
-    // Check if nmcli installed
-    int ret = system("nmcli -v >/dev/null");
-    if (ret == 0) {
-        AFB_DEBUG("Network Manager is installed on system!");
+// the lines of "iw event"
+static FILE *open_events(const char *interfaceName)
+{
+    FILE *pipe;
+
+    metricAdd(popenSpawnMetric, 1);
+    WIFIAP_TRACE1(command_open, "iw event");
+    pipe = getPlatform()->openEvents(interfaceName);
+    diagRecord(DIAG_SUBSYSTEM_COMMAND, DIAG_CODE_OPEN,
+               pipe == NULL ? -errno : 0, "iw event");
+    return pipe;
+}
 
-        // Disable Network Manager for interface
-        AFB_WARNING(
-            "interface %s WILL no longer be managed by Network Manager...",
-            wifiApData->interfaceName);
-        systemResult = system(cmd);
-        if (systemResult == 0)
-            AFB_DEBUG("Network Manager IS disabled for interface %s!",
-                      wifiApData->interfaceName);
-        else
-            AFB_ERROR("Unable to disable Network Manager for interface %s!",
-                      wifiApData->interfaceName);
-    }
+static int close_command(FILE *pipe)
+{
+    return getPlatform()->closeCommand(pipe);
 }
 
 /*******************************************************************************
- *          Allow DHCP traffic through if firewalld is running                 *
+ *        record the duration of a phase of startAp                            *
  ******************************************************************************/
-static void check_if_firewalld_running_and_allow_dhcp_traffic(
-    wifiApT *wifiApData)
+static void record_start_phase(unsigned phase, uint64_t durationUs)
 {
-    AFB_INFO("Check if firewalld service is enabled");
-
-    int systemResult = 0;
+    WIFIAP_TRACE2(start_phase, start_phase_name(phase), durationUs);
+    metricObserve(startPhaseMetrics[phase], durationUs);
+    diagRecord(DIAG_SUBSYSTEM_AP, DIAG_CODE_PHASE,
+               (int32_t)(durationUs / 1000), "%s", start_phase_name(phase));
+}
 
-    char cmd[PATH_MAX];
+static void end_start_stage(apStageT stage, uint64_t durationUs)
+{
+    record_start_phase(stage, durationUs);
+}
 
-    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
-             COMMAND_WIFI_FIREWALLD_ALLOW, wifiApData->interfaceName);
+static void count_generated_file(apFileT file)
+{
+    metricAdd(configWriteMetrics[file], 1);
+}
 
-    int ret = system("pgrep firewalld >/dev/null");
-    if (ret == 0) {
-        AFB_DEBUG("Firewalld is enabled on target!");
+/*******************************************************************************
+ *        The start and stop of the library, through the hooks of the binding  *
+ *                                                                             *
+ * cacheDir is set at init.                                                    *
+ ******************************************************************************/
+static apStartT apStart = {
+    .script = WIFI_SCRIPT,
+    .runCommand = run_command,
+    .openCommand = open_command,
+    .endStage = end_start_stage,
+    .fileGenerated = count_generated_file,
+};
 
-        // Allow DHCP traffic through
-        AFB_WARNING(
-            "DHCP traffic WILL be no longer be blocked by firewalld...");
-        systemResult = system(cmd);
-        if (systemResult == 0)
-            AFB_DEBUG("DHCP traffic IS allowed through!");
-        else
-            AFB_ERROR("Unable to allow DHCP traffic through!");
+/*******************************************************************************
+ *        get the IP address of a station: its static lease, else its lease    *
+ ******************************************************************************/
+static int get_station_address(const wifiApT *wifiApData,
+                               FILE *leases,
+                               const char *mac,
+                               char ip[MAX_IP_ADDRESS_LENGTH + 1])
+{
+    for (uint32_t i = 0; i < wifiApData->dhcp.staticLeaseCount; i++) {
+        if (!strcasecmp(wifiApData->dhcp.staticLeases[i].mac, mac)) {
+            utf8_Copy(ip, wifiApData->dhcp.staticLeases[i].ip,
+                      MAX_IP_ADDRESS_LENGTH + 1, NULL);
+            return WIFIAP_NO_ERROR;
+        }
     }
+    if (leases == NULL)
+        return WIFIAP_ERROR_NOT_FOUND;
+    rewind(leases);
+    return findLeaseAddress(leases, mac, ip);
 }
 
 /*******************************************************************************
- *                Start the access point dnsmasq service                       *
+ *        set the traffic shaping of the interface                             *
+ *                                                                             *
+ * The queues are rebuilt: an HTB class for the access point, one per limited  *
+ * station (downlink) with a policer on the ingress (uplink). The stations     *
+ * without address yet are set by the refresh following their connection.      *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if applied, -1 if a command failed                                   *
  ******************************************************************************/
-static int setDnsmasqService(wifiApT *wifiApData)
+static int applyShaping(wifiApT *wifiApData)
 {
-    struct sockaddr_in saApPtr;
-    struct sockaddr_in saStartPtr;
-    struct sockaddr_in saStopPtr;
-    struct sockaddr_in saNetmaskPtr;
-    const char *parameterPtr = 0;
+    char cmd[PATH_MAX];
+    char ip[MAX_IP_ADDRESS_LENGTH + 1];
+    const wifiAp_StationLimit_t *limit;
+    FILE *leases;
+    int status, error = 0;
 
-    // Check the parameters
-    if ((wifiApData->ip_ap[0] == '\0') || (wifiApData->ip_start[0] == '\0') ||
-        (wifiApData->ip_stop[0] == '\0') ||
-        (wifiApData->ip_netmask[0] == '\0')) {
-        goto OnErrorExit;
-    }
+    pthread_mutex_lock(&shaping_mutex);
 
-    if (inet_pton(AF_INET, wifiApData->ip_ap, &saApPtr.sin_addr) <= 0) {
-        parameterPtr = "AP";
-    }
-    else if (inet_pton(AF_INET, wifiApData->ip_start, &saStartPtr.sin_addr) <=
-             0) {
-        parameterPtr = "start";
-    }
-    else if (inet_pton(AF_INET, wifiApData->ip_stop, &saStopPtr.sin_addr) <=
-             0) {
-        parameterPtr = "stop";
-    }
-    else if (inet_pton(AF_INET, wifiApData->ip_netmask,
-                       &saNetmaskPtr.sin_addr) <= 0) {
-        parameterPtr = "Netmask";
+    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
+             COMMAND_WIFIAP_TC_CLEAR, wifiApData->interfaceName);
+    run_command(PLATFORM_FIREWALL, cmd);
+    if (wifiApData->shaping.ssidKbps == 0 &&
+        wifiApData->shaping.stationCount == 0) {
+        pthread_mutex_unlock(&shaping_mutex);
+        return 0;
     }
 
-    // get ip address with CIDR annotation
-    int netmask_cidr = toCidr(wifiApData->ip_netmask);
-    char ip_ap_cidr[128];
-    snprintf(ip_ap_cidr, sizeof(ip_ap_cidr), "%s/%d", wifiApData->ip_ap,
-             netmask_cidr);
-
-    if (parameterPtr != NULL) {
-        AFB_ERROR("Invalid %s IP address", parameterPtr);
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
+    snprintf(cmd, sizeof(cmd), "%s %s %s %u", WIFI_SCRIPT,
+             COMMAND_WIFIAP_TC_SETUP, wifiApData->interfaceName,
+             (unsigned)(wifiApData->shaping.ssidKbps != 0
+                            ? wifiApData->shaping.ssidKbps
+                            : MAX_RATE_LIMIT));
+    status = run_command(PLATFORM_FIREWALL, cmd);
+    if ((!WIFEXITED(status)) || (0 != WEXITSTATUS(status))) {
+        AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)",
+                  COMMAND_WIFIAP_TC_SETUP, status);
+        pthread_mutex_unlock(&shaping_mutex);
         return -1;
     }
-    else {
-        unsigned int ap = ntohl(saApPtr.sin_addr.s_addr);
-        unsigned int start = ntohl(saStartPtr.sin_addr.s_addr);
-        unsigned int stop = ntohl(saStopPtr.sin_addr.s_addr);
-        unsigned int netmask = ntohl(saNetmaskPtr.sin_addr.s_addr);
 
-        AFB_INFO("@AP=%x, @APstart=%x, @APstop=%x, @APnetmask=%x  @AP_CIDR=%s",
-                 ap, start, stop, netmask, ip_ap_cidr);
-
-        if (start > stop) {
-            AFB_INFO("Need to swap start & stop IP addresses");
-            start = start ^ stop;
-            stop = stop ^ start;
-            start = start ^ stop;
+    leases = getPlatform()->openFile(WIFI_DNSMASQ_LEASE_FILE);
+    for (uint32_t i = 0; i < wifiApData->shaping.stationCount; i++) {
+        limit = &wifiApData->shaping.stations[i];
+        if (get_station_address(wifiApData, leases, limit->mac, ip) !=
+            WIFIAP_NO_ERROR) {
+            AFB_DEBUG("No address yet to limit the station %s", limit->mac);
+            continue;
         }
-
-        if ((ap >= start) && (ap <= stop)) {
-            AFB_ERROR("AP IP address is within the range");
-            goto OnErrorExit;
+        snprintf(cmd, sizeof(cmd), "%s %s %s %x %s %u", WIFI_SCRIPT,
+                 COMMAND_WIFIAP_TC_STATION, wifiApData->interfaceName,
+                 (unsigned)(SHAPING_STATION_CLASS + i), ip,
+                 (unsigned)limit->kbps);
+        status = run_command(PLATFORM_FIREWALL, cmd);
+        if ((!WIFEXITED(status)) || (0 != WEXITSTATUS(status))) {
+            AFB_WARNING("Unable to limit the station %s (%s): (%d)",
+                        limit->mac, ip, status);
+            error = -1;
         }
     }
+    if (leases != NULL)
+        fclose(leases);
 
-    {
-        char cmd[PATH_MAX];
-        int systemResult;
-
-        snprintf(cmd, sizeof(cmd), "%s %s %s %s", WIFI_SCRIPT,
-                 COMMAND_WIFIAP_WLAN_UP, wifiApData->interfaceName,
-                 wifiApData->ip_ap);
-
-        systemResult = system(cmd);
-        if (WEXITSTATUS(systemResult) != 0) {
-            AFB_ERROR("Unable to mount the network interface");
-            goto OnErrorExit;
-        }
-        else {
-            int error =
-                createHostsConfigFile(wifiApData->ip_ap, wifiApData->hostName);
-            if (error) {
-                AFB_ERROR("Unable to add a new hostname config file");
-                goto OnErrorExit;
-            }
-
-            error = createDnsmasqConfigFile(
-                wifiApData->ip_ap, wifiApData->ip_start, wifiApData->ip_stop,
-                wifiApData->domainName);
-            if (error) {
-                AFB_ERROR("Unable to create Dnsmasq config file");
-                goto OnErrorExit;
-            }
-
-            AFB_INFO("@AP=%s, @APstart=%s, @APstop=%s", wifiApData->ip_ap,
-                     wifiApData->ip_start, wifiApData->ip_stop);
+    pthread_mutex_unlock(&shaping_mutex);
+    return error;
+}
 
-            char cmd[PATH_MAX];
+/*******************************************************************************
+ *        set the traffic shaping again once a new station got its address     *
+ ******************************************************************************/
+static void shapingRefreshJob(int signum, void *arg)
+{
+    wifiApT *wifiApData;
 
-            snprintf(cmd, sizeof(cmd), "%s %s %s %s", WIFI_SCRIPT,
-                     COMMAND_DNSMASQ_RESTART, wifiApData->interfaceName,
-                     ip_ap_cidr);
+    if (signum != 0)
+        return;
 
-            systemResult = system(cmd);
-            if (WEXITSTATUS(systemResult) != 0) {
-                AFB_ERROR("Unable to restart the Dnsmasq.");
-                goto OnErrorExit;
-            }
-        }
-    }
-    AFB_INFO("Dnsmasq configuration file created successfully!");
-    return 0;
-OnErrorExit:
+    // the limits of the stations may be reloaded meanwhile
+    pthread_mutex_lock(&reload_mutex);
     pthread_mutex_lock(&status_mutex);
-    wifiApData->status = status_fail;
+    wifiApData = apStartData;
+    if (wifiApData != NULL && wifiApData->status != status_started)
+        wifiApData = NULL;
     pthread_mutex_unlock(&status_mutex);
 
-    return -2;
+    if (wifiApData != NULL && wifiApData->shaping.stationCount != 0 &&
+        applyShaping(wifiApData) != 0)
+        AFB_WARNING("Unable to refresh the traffic shaping of %s",
+                    wifiApData->interfaceName);
+    pthread_mutex_unlock(&reload_mutex);
 }
 
 /*******************************************************************************
- *                      start access point function                            *
+ *                                      publish a station event of "iw event"  *
  ******************************************************************************/
-int startAp(wifiApT *wifiApData)
+static void handle_station_event(const char *line,
+                                 const stationEventT *event,
+                                 void *closure)
 {
-    int systemResult;
-    AFB_INFO("Starting AP ...");
-
-    const char *DnsmasqConfigFileName = "/tmp/dnsmasq.wlan.conf";
-    const char *HostConfigFileName = "/tmp/add_hosts";
-    if (checkFileExists(DnsmasqConfigFileName) ||
-        checkFileExists(HostConfigFileName)) {
-        AFB_WARNING("Need to clean previous configuration for AP!");
-        char cmd[PATH_MAX];
-
-        snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
-                 COMMAND_WIFIAP_HOSTAPD_STOP, wifiApData->interfaceName);
-
-        systemResult = system(cmd);
-        if ((!WIFEXITED(systemResult)) || (0 != WEXITSTATUS(systemResult))) {
-            AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)",
-                      COMMAND_WIFIAP_HOSTAPD_STOP, systemResult);
-            pthread_mutex_lock(&status_mutex);
-            wifiApData->status = status_fail;
-            pthread_mutex_unlock(&status_mutex);
-            return -9;
-        }
+    int *numberOfClientsConnected = closure;
+    json_object *eventResponseJ;
+
+    AFB_DEBUG("PARSING:%s: len:%d", line, (int)strlen(line));
+    WIFIAP_TRACE1(event_line, line);
+
+    if (event->type == STATION_EVENT_DEL) {
+        (*numberOfClientsConnected)--;
+        metricAdd(stationDisconnectMetric, 1);
+        WIFIAP_TRACE2(station_event, 0, *numberOfClientsConnected);
+        diagRecord(DIAG_SUBSYSTEM_STATION, DIAG_CODE_DISCONNECTED,
+                   *numberOfClientsConnected, "%s", event->mac);
+        rp_jsonc_pack(&eventResponseJ, "{ss,si}", "Event",
+                      "WiFi client disconnected", "number-client",
+                      *numberOfClientsConnected);
+
+        push_json_event(eventResponseJ, client_state_event);
     }
+    else if (event->type == STATION_EVENT_NEW) {
+        (*numberOfClientsConnected)++;
+        metricAdd(stationConnectMetric, 1);
+        WIFIAP_TRACE2(station_event, 1, *numberOfClientsConnected);
+        diagRecord(DIAG_SUBSYSTEM_STATION, DIAG_CODE_CONNECTED,
+                   *numberOfClientsConnected, "%s", event->mac);
+        rp_jsonc_pack(&eventResponseJ, "{ss,si}", "Event",
+                      "WiFi client connected", "number-client",
+                      *numberOfClientsConnected);
+
+        push_json_event(eventResponseJ, client_state_event);
+
+        // its rate limit needs the address it is leasing
+        afb_job_post(SHAPING_REFRESH_DELAY_MS, 0, shapingRefreshJob, NULL,
+                     NULL);
+    }
+}
 
-    int error = setDnsmasqService(wifiApData);
-    if (error) {
-        AFB_ERROR("Failed to set up Dnsmasq (error: %d). Checking system...",
-                  error);
+/*******************************************************************************
+ *                                                 WiFi Client Thread Function *
+ ******************************************************************************/
+static void *WifiApThreadMainFunc(void *contextPtr)
+{
+    int numberOfClientsConnected = 0;
 
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -8;
-    }
+    AFB_INFO("wifiAp event report thread started on interface %s !",
+             (char *)contextPtr);
+    IwThreadPipePtr = open_events((char *)contextPtr);
 
-    // Check that an SSID is provided before starting
-    if ('\0' == wifiApData->ssid[0]) {
-        AFB_ERROR("Unable to start AP because no valid SSID provided");
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -1;
+    if (NULL == IwThreadPipePtr) {
+        AFB_ERROR("Failed to run command:\"iw event\" errno:%d %s", errno,
+                  strerror(errno));
+        return NULL;
     }
 
-    // Check channel number is properly set before starting
-    if ((wifiApData->channelNumber < wifiApData->channel.MIN_CHANNEL_VALUE) ||
-        (wifiApData->channelNumber > wifiApData->channel.MAX_CHANNEL_VALUE)) {
-        AFB_ERROR(
-            "Unable to start AP because no valid channel number provided");
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -2;
-    }
+    // Read the output one line at a time, the parsing does not depend on it
+    readStationEvents(IwThreadPipePtr, (char *)contextPtr,
+                      handle_station_event, &numberOfClientsConnected);
 
-    // Check and resolve conflicts with Network Manager
-    check_and_resolve_conflicts_with_NM(wifiApData);
+    return NULL;
+}
 
-    // Check if firewalld is running and allow dhcp traffic
-    check_if_firewalld_running_and_allow_dhcp_traffic(wifiApData);
+/*******************************************************************************
+ *                                                  Thread destructor Function *
+ ******************************************************************************/
+static void threadDestructorFunc(void *contextPtr)
+{
+    // Kill the script launched by popen() in Client thread, and close FP
+    closeApEvents(&apStart, IwThreadPipePtr);
+    IwThreadPipePtr = NULL;
+}
 
-    // Create hostapd.conf file in /tmp
-    if (GenerateHostApConfFile(wifiApData) != 0) {
-        AFB_ERROR("Failed to generate hostapd.conf");
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -3;
+/*******************************************************************************
+ *           move the running access point to another channel                  *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if success, or -1 if not.                                            *
+ ******************************************************************************/
+static int switchChannel(wifiApT *wifiApData, uint16_t channel)
+{
+    uint32_t stdMask = wifiApData->IeeeStdMask;
+    uint16_t width = wifiApData->radio.channelWidth;
+    char command[HOSTAPD_REPLY_SIZE];
+    int length, rc;
+
+    // the clients are told 5 beacons before the switch
+    length = snprintf(command, sizeof(command), "CHAN_SWITCH 5 %u",
+                      (unsigned)channelToFrequency(channel, stdMask));
+    if (width >= CHANNEL_WIDTH_40) {
+        int offset = getHt40SecondaryOffset(stdMask, channel);
+        uint16_t center = width == CHANNEL_WIDTH_40
+                              ? (uint16_t)(channel + 2 * offset)
+                              : getVhtCenterChannel(channel, width);
+        snprintf(command + length, sizeof(command) - (size_t)length,
+                 " sec_channel_offset=%d center_freq1=%u bandwidth=%u ht%s",
+                 offset, (unsigned)channelToFrequency(center, stdMask),
+                 (unsigned)width, width >= CHANNEL_WIDTH_80 ? " vht" : "");
     }
-    else
-        AFB_INFO("AP configuration file has been generated");
 
-    char cmd[PATH_MAX];
-    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT, COMMAND_WIFI_HW_START,
-             wifiApData->interfaceName);
-
-    systemResult = system(cmd);
-    /**
-     * Returned values:
-     *   0: if the interface is correctly mounted
-     *  50: if WiFi card is not inserted
-     * 127: if WiFi card may not work
-     * 100: if driver can not be installed
-     *  -1: if the fork() has failed (see man system)
-     */
-
-    if (0 == WEXITSTATUS(systemResult)) {
-        AFB_INFO("WiFi hardware started correctly");
-    }
-    // Return value of 50 means WiFi card is not inserted.
-    else if (WEXITSTATUS(systemResult) == 50) {
-        AFB_ERROR("WiFi card is not inserted");
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -4;
-    }
-    // Return value of 100 means WiFi card may not work.
-    else if (WEXITSTATUS(systemResult) == 100) {
-        AFB_ERROR("Unable to reset WiFi card");
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -5;
-    }
-    // WiFi card failed to start.
-    else {
-        AFB_WARNING("Failed to start WiFi AP command \"%s\" systemResult (%d)",
-                    COMMAND_WIFI_HW_START, systemResult);
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -6;
+    rc = hostapdRequest(wifiApData->interfaceName, command);
+    if (rc != 0) {
+        AFB_ERROR("hostapd failed to switch to channel %u (%d)",
+                  (unsigned)channel, rc);
+        return -1;
     }
+    return 0;
+}
 
-    AFB_INFO("Started WiFi AP command \"%s\" successfully",
-             COMMAND_WIFI_HW_START);
+/*******************************************************************************
+ *        milliseconds elapsed since a time of the monotonic clock             *
+ ******************************************************************************/
+static int64_t elapsedMs(const struct timespec *since)
+{
+    struct timespec now;
 
-    // Start Access Point cmd: /bin/hostapd /etc/hostapd.conf
-    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
-             COMMAND_WIFIAP_HOSTAPD_START, wifiApData->interfaceName);
-
-    systemResult = system(cmd);
-    if ((!WIFEXITED(systemResult)) || (0 != WEXITSTATUS(systemResult))) {
-        AFB_ERROR("WiFi Client Command \"%s\" Failed: (%d)",
-                  COMMAND_WIFIAP_HOSTAPD_START, systemResult);
-        // Remove generated hostapd.conf file
-        remove(WIFI_HOSTAPD_FILE);
-        pthread_mutex_lock(&status_mutex);
-        wifiApData->status = status_fail;
-        pthread_mutex_unlock(&status_mutex);
-        return -7;
-    }
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - since->tv_sec) * 1000 +
+           (now.tv_nsec - since->tv_nsec) / 1000000;
+}
 
-    // create WiFi-ap event thread
-    wifiApThreadPtr = CreateThread("WifiApThread", WifiApThreadMainFunc,
-                                   wifiApData->interfaceName);
-    if (!wifiApThreadPtr)
-        AFB_ERROR("Unable to create thread!");
+/*******************************************************************************
+ *        poll hostapd until it is enabled, then push the ap-ready event       *
+ *                                                                             *
+ * Runs as a delayed job, posted again every AP_READY_POLL_MS until hostapd    *
+ * reports "state=ENABLED" (beacons sent) or AP_READY_TIMEOUT_MS elapsed.      *
+ * The argument is the apStartCount of the start being watched.                *
+ ******************************************************************************/
+static void apReadyJob(int signum, void *arg)
+{
+    char reply[HOSTAPD_REPLY_SIZE];
+    wifiApT *wifiApData;
+    struct json_object *eventJ;
+    const char *channel;
+    int64_t startMs, bootMs = -1, apiReadyMs;
+    bool current;
 
-    // set thread to joinable
-    error = setThreadJoinable(wifiApThreadPtr->threadId);
-    if (error)
-        AFB_ERROR("Unable to set wifiAp thread as joinable!");
+    pthread_mutex_lock(&status_mutex);
+    wifiApData = apStartData;
+    current = (unsigned)(uintptr_t)arg == apStartCount &&
+              wifiApData->status == status_started;
+    startMs = elapsedMs(&apStartTime);
+    pthread_mutex_unlock(&status_mutex);
 
-    // add thread destructor
-    error = addDestructorToThread(wifiApThreadPtr->threadId,
-                                  threadDestructorFunc, WIFI_SCRIPT);
-    if (error)
-        AFB_ERROR("Unable to add a destructor to the wifiAp thread!");
+    // stopped or started again meanwhile
+    if (signum != 0 || !current)
+        return;
 
-    // start thread
-    error = startThread(wifiApThreadPtr->threadId);
-    if (error)
-        AFB_ERROR("Unable to start wifiAp thread!");
+    if (hostapdCommand(wifiApData->interfaceName, "STATUS", reply,
+                       sizeof(reply)) < 0 ||
+        strstr(reply, "state=ENABLED\n") == NULL) {
+        if (startMs < AP_READY_TIMEOUT_MS &&
+            afb_job_post(AP_READY_POLL_MS, 0, apReadyJob, arg, NULL) >= 0)
+            return;
+        AFB_WARNING("hostapd of %s not enabled after %lld ms",
+                    wifiApData->interfaceName, (long long)startMs);
+        diagRecord(DIAG_SUBSYSTEM_AP, DIAG_CODE_NOT_READY, (int32_t)startMs,
+                   "%s", wifiApData->interfaceName);
+        return;
+    }
 
     pthread_mutex_lock(&status_mutex);
-    wifiApData->status = status_started;
+    apiReadyMs = bootApiReadyMs;
+    if (apiReadyMs >= 0) {
+        bootMs = elapsedMs(&bootStartTime);
+        bootApiReadyMs = -1;
+    }
     pthread_mutex_unlock(&status_mutex);
-    AFB_INFO("WiFi AP started correctly");
-    return 0;
+
+    // the channel may have been selected by hostapd
+    channel = strstr(reply, "\nchannel=");
+    rp_jsonc_pack(&eventJ, "{ss,si,sI}", "interface",
+                  wifiApData->interfaceName, "channel",
+                  channel == NULL ? 0 : atoi(channel + 9), "startMs", startMs);
+    if (bootMs >= 0) {
+        AFB_NOTICE("Boot: API ready after %lld ms, beacons after %lld ms",
+                   (long long)apiReadyMs, (long long)bootMs);
+        json_object_object_add(eventJ, "bootApiReadyMs",
+                               json_object_new_int64(apiReadyMs));
+        json_object_object_add(eventJ, "bootBeaconMs",
+                               json_object_new_int64(bootMs));
+    }
+    AFB_INFO("WiFi AP %s sends beacons %lld ms after its start",
+             wifiApData->interfaceName, (long long)startMs);
+    metricObserve(apReadyMetric, (uint64_t)startMs * 1000);
+    WIFIAP_TRACE2(ap_ready, wifiApData->interfaceName, startMs);
+    diagRecord(DIAG_SUBSYSTEM_AP, DIAG_CODE_READY, (int32_t)startMs, "%s",
+               wifiApData->interfaceName);
+    push_json_event(eventJ, ap_ready_event);
 }
 
 /*******************************************************************************
- * Get wifiApT instance of the request
+ *        read the stations of the access point from hostapd                   *
+ ******************************************************************************/
+static unsigned read_stations(const char *interfaceName,
+                              wifiApStationT *stations)
+{
+    char reply[HOSTAPD_REPLY_SIZE];
+    char command[32];
+    char mac[MAC_ADDRESS_LENGTH + 1];
+    unsigned count = 0;
+    int rc;
+
+    rc = hostapdCommand(interfaceName, "STA-FIRST", reply, sizeof(reply));
+    while (rc > 0 && count < MAX_STEERING_STATIONS &&
+           parseStationInfo(reply, &stations[count]) == 0) {
+        formatMacAddress(stations[count++].mac, mac);
+        snprintf(command, sizeof(command), "STA-NEXT %s", mac);
+        rc = hostapdCommand(interfaceName, command, reply, sizeof(reply));
+    }
+    return count;
+}
+
+/*******************************************************************************
+ *        ask the stations to move to the neighbors when needed                *
+ *                                                                             *
+ * Runs every intervalMs of the settings, while the access point runs and the  *
+ * steering is not started again.                                              *
+ ******************************************************************************/
+static void steeringJob(int signum, void *arg)
+{
+    char command[HOSTAPD_REPLY_SIZE];
+    char mac[MAC_ADDRESS_LENGTH + 1];
+    unsigned selected[MAX_STEERING_PENDING];
+    wifiApStationT *stations;
+    wifiAp_Steering_t settings;
+    wifiApT *wifiApData;
+    struct timespec now;
+    unsigned count, number;
+    int64_t nowMs;
+    bool current, sent;
+
+    pthread_mutex_lock(&status_mutex);
+    wifiApData = apStartData;
+    current = wifiApData != NULL && wifiApData->status == status_started;
+    if (current)
+        settings = wifiApData->steering;
+    pthread_mutex_unlock(&status_mutex);
+
+    pthread_mutex_lock(&steering_mutex);
+    current = current && (unsigned)(uintptr_t)arg == steeringGeneration;
+    pthread_mutex_unlock(&steering_mutex);
+
+    // stopped, disabled or started again meanwhile
+    if (signum != 0 || !current || !settings.enabled)
+        return;
+
+    stations = malloc(MAX_STEERING_STATIONS * sizeof(*stations));
+    if (stations != NULL) {
+        count = read_stations(wifiApData->interfaceName, stations);
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        nowMs = (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+
+        pthread_mutex_lock(&steering_mutex);
+        updateSteeringState(&steeringState, stations, count,
+                            settings.cooldownMs, nowMs);
+        number = selectSteeringStations(&settings, &steeringState, stations,
+                                        count, selected);
+        pthread_mutex_unlock(&steering_mutex);
+
+        for (unsigned idx = 0; idx < number; idx++) {
+            const wifiApStationT *station = &stations[selected[idx]];
+            formatMacAddress(station->mac, mac);
+            sent = formatBssTmRequest(command, sizeof(command), station->mac,
+                                      &settings) == 0 &&
+                   hostapdRequest(wifiApData->interfaceName, command) == 0;
+            if (sent)
+                AFB_INFO("Station %s (%d dBm) asked to move", mac,
+                         (int)station->signal);
+            else
+                AFB_WARNING("hostapd failed to ask the station %s to move",
+                            mac);
+
+            pthread_mutex_lock(&steering_mutex);
+            recordSteeringRequest(&steeringState, station->mac, nowMs, sent);
+            pthread_mutex_unlock(&steering_mutex);
+        }
+        free(stations);
+    }
+
+    if (afb_job_post(settings.intervalMs, 0, steeringJob, arg, NULL) < 0)
+        AFB_WARNING("Unable to schedule the band steering of %s",
+                    wifiApData->interfaceName);
+}
+
+/*******************************************************************************
+ *        start the band steering again, with the current settings             *
+ *                                                                             *
+ * The jobs of the previous start give up at their next run.                   *
+ ******************************************************************************/
+static void startSteering(wifiApT *wifiApData)
+{
+    wifiAp_Steering_t settings;
+    unsigned generation;
+
+    pthread_mutex_lock(&status_mutex);
+    settings = wifiApData->steering;
+    pthread_mutex_unlock(&status_mutex);
+
+    pthread_mutex_lock(&steering_mutex);
+    generation = ++steeringGeneration;
+    steeringState.pendingCount = 0;
+    pthread_mutex_unlock(&steering_mutex);
+
+    if (settings.enabled &&
+        afb_job_post(settings.intervalMs, 0, steeringJob,
+                     (void *)(uintptr_t)generation, NULL) < 0)
+        AFB_WARNING("Unable to start the band steering of %s",
+                    wifiApData->interfaceName);
+}
+
+/*******************************************************************************
+ *                      generate hostapd.conf, counted                         *
+ ******************************************************************************/
+static int generate_hostapd_conf(wifiApT *wifiApData)
+{
+    int rc = GenerateHostApConfFile(wifiApData);
+
+    if (rc == 0)
+        metricAdd(configWriteMetrics[CONFIG_FILE_HOSTAPD], 1);
+    return rc;
+}
+
+/*******************************************************************************
+ *                      start access point function                            *
+ ******************************************************************************/
+static int start_ap(wifiApT *wifiApData)
+{
+    unsigned startCount;
+    uint64_t phaseUs;
+    int error;
+    AFB_INFO("Starting AP ...");
+    WIFIAP_TRACE1(start_begin, wifiApData->interfaceName);
+
+    pthread_mutex_lock(&status_mutex);
+    clock_gettime(CLOCK_MONOTONIC, &apStartTime);
+    startCount = ++apStartCount;
+    apStartData = wifiApData;
+    pthread_mutex_unlock(&status_mutex);
+
+    error = startWifiAp(&apStart, wifiApData);
+    if (error < 0) {
+        pthread_mutex_lock(&status_mutex);
+        wifiApData->status = status_fail;
+        pthread_mutex_unlock(&status_mutex);
+        return error;
+    }
+    phaseUs = metricNowUs();
+
+    // create WiFi-ap event thread
+    wifiApThreadId = CreateThread("WifiApThread", WifiApThreadMainFunc,
+                                  wifiApData->interfaceName);
+    if (wifiApThreadId <= 0) {
+        AFB_ERROR("Unable to create thread!");
+        wifiApThreadId = 0;
+    }
+    else {
+        // set thread to joinable
+        error = setThreadJoinable(wifiApThreadId);
+        if (error)
+            AFB_ERROR("Unable to set wifiAp thread as joinable!");
+
+        // add thread destructor
+        error = addDestructorToThread(wifiApThreadId, threadDestructorFunc,
+                                      WIFI_SCRIPT);
+        if (error)
+            AFB_ERROR("Unable to add a destructor to the wifiAp thread!");
+
+        // set thread scheduling
+        if (setThreadPriority(wifiApThreadId, eventThreadSettings.priority,
+                              eventThreadSettings.rtPriority))
+            AFB_ERROR("Unable to set the priority of the wifiAp thread!");
+        if (eventThreadSettings.hasCpus &&
+            setThreadAffinity(wifiApThreadId, &eventThreadSettings.cpus))
+            AFB_ERROR("Unable to set the CPU affinity of the wifiAp thread!");
+
+        // start thread
+        error = startThread(wifiApThreadId);
+        if (error)
+            AFB_ERROR("Unable to start wifiAp thread!");
+    }
+
+    if (applyShaping(wifiApData) != 0)
+        AFB_WARNING("Unable to set the traffic shaping of %s",
+                    wifiApData->interfaceName);
+    record_start_phase(START_PHASE_SERVICES, metricNowUs() - phaseUs);
+
+    pthread_mutex_lock(&status_mutex);
+    wifiApData->status = status_started;
+    pthread_mutex_unlock(&status_mutex);
+    AFB_INFO("WiFi AP started correctly");
+    WIFIAP_TRACE1(start_end, wifiApData->interfaceName);
+
+    // report when hostapd really sends the beacons
+    if (afb_job_post(AP_READY_POLL_MS, 0, apReadyJob,
+                     (void *)(uintptr_t)startCount, NULL) < 0)
+        AFB_WARNING("Unable to watch for the ap-ready of %s",
+                    wifiApData->interfaceName);
+
+    startSteering(wifiApData);
+    return 0;
+}
+
+/*******************************************************************************
+ *        start the access point, the diagnostics keep the outcome             *
+ *                                                                             *
+ * The failing step is the one after the last phase recorded.                  *
+ ******************************************************************************/
+int startAp(wifiApT *wifiApData)
+{
+    int rc;
+
+    diagRecord(DIAG_SUBSYSTEM_AP, DIAG_CODE_START, 0, "%s",
+               wifiApData->interfaceName);
+    rc = start_ap(wifiApData);
+    diagRecord(DIAG_SUBSYSTEM_AP,
+               rc < 0 ? DIAG_CODE_START_FAILED : DIAG_CODE_STARTED, rc, "%s",
+               wifiApData->interfaceName);
+    return rc;
+}
+
+/*******************************************************************************
+ *        stop the thread reading the WiFi events                              *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if stopped (or not running), -1 if it could not be joined            *
+ ******************************************************************************/
+static int stopEventThread(void)
+{
+    if (wifiApThreadId > 0) {
+        /* Terminate the created thread */
+        if (0 != cancelThread(wifiApThreadId)) {
+            // never started, its slot is released, or already ended (the
+            // cancel fails once it exited), it is joined
+            if (deleteThread(wifiApThreadId) == -2 &&
+                0 != JoinThread(wifiApThreadId, NULL))
+                return -1;
+        }
+        else if (0 != JoinThread(wifiApThreadId, NULL)) {
+            return -1;
+        }
+        wifiApThreadId = 0;
+    }
+    return 0;
+}
+
+/*******************************************************************************
+ * Get wifiApT instance of the request
  ******************************************************************************/
 static inline wifiApT *get_wifi(afb_req_t request)
 {
@@ -562,7 +1002,7 @@ static inline wifiApT *get_wifi(afb_req_t request)
 static bool reply_invalid_params(afb_req_t request, const char *info)
 {
     AFB_REQ_WARNING(request, "Invalid parameters, expects %s", info);
-    afb_req_reply(request, AFB_ERRNO_INVALID_REQUEST, 0, NULL);
+    reply_request(request, AFB_ERRNO_INVALID_REQUEST, 0, NULL);
     return false;
 }
 
@@ -693,6 +1133,69 @@ static bool get_single_uint32(afb_req_t request,
     return reply_invalid_params(request, "single natural number");
 }
 
+/*******************************************************************************
+ *        write the current settings to the state file                         *
+ ******************************************************************************/
+static void saveStateJob(int signum, void *arg)
+{
+    afb_api_t api = arg;
+    wifiApT *wifiApData = afb_api_get_userdata(api);
+    struct json_object *stateJ;
+    int rc;
+
+    // the changes made from now on need a new write
+    pthread_mutex_lock(&state_mutex);
+    stateSavePending = false;
+    pthread_mutex_unlock(&state_mutex);
+
+    if (signum != 0) {
+        AFB_API_ERROR(api, "Saving the state file interrupted (signal %d)",
+                      signum);
+        return;
+    }
+
+    pthread_mutex_lock(&reload_mutex);
+    stateJ = wifiApDataToJson(wifiApData);
+    pthread_mutex_unlock(&reload_mutex);
+    if (stateJ == NULL) {
+        AFB_API_ERROR(api, "Unable to serialize the state");
+        return;
+    }
+
+    rc = getPlatform()->writeFile(
+        stateFile, json_object_to_json_string_ext(stateJ,
+                                                  JSON_C_TO_STRING_PRETTY));
+    json_object_put(stateJ);
+    if (rc < 0)
+        AFB_API_ERROR(api, "Unable to write the state file %s: %s", stateFile,
+                      strerror(-rc));
+    else {
+        metricAdd(configWriteMetrics[CONFIG_FILE_STATE], 1);
+        AFB_API_DEBUG(api, "State saved to %s", stateFile);
+    }
+}
+
+/*******************************************************************************
+ *        schedule a write of the state file after a runtime change            *
+ *                                                                             *
+ * The write is delayed by STATE_SAVE_DELAY_MS, so that a burst of changes     *
+ * leads to a single write. Does nothing when no state file is configured.     *
+ ******************************************************************************/
+static void scheduleStateSave(afb_api_t api)
+{
+    if (stateFile == NULL)
+        return;
+
+    pthread_mutex_lock(&state_mutex);
+    if (!stateSavePending) {
+        stateSavePending = afb_job_post(STATE_SAVE_DELAY_MS, 0, saveStateJob,
+                                        api, NULL) >= 0;
+        if (!stateSavePending)
+            AFB_API_ERROR(api, "Unable to schedule the save of the state");
+    }
+    pthread_mutex_unlock(&state_mutex);
+}
+
 /*******************************************************************************
  * Get single string parameter and use it to set a wifi ap value
  ******************************************************************************/
@@ -709,6 +1212,7 @@ static void single_string_set(afb_req_t request,
         switch (sts) {
         case WIFIAP_NO_ERROR:
             AFB_REQ_INFO(request, "%s set successfully to '%s'", tag, str);
+            scheduleStateSave(afb_req_get_api(request));
             break;
         case WIFIAP_ERROR_TOO_SMALL:
             AFB_REQ_WARNING(request, "%s too small '%s'", tag, str);
@@ -718,13 +1222,25 @@ static void single_string_set(afb_req_t request,
             AFB_REQ_WARNING(request, "%s too large '%s'", tag, str);
             sts = AFB_ERRNO_INVALID_REQUEST;
             break;
+        case WIFIAP_ERROR_INVALID:
+            AFB_REQ_WARNING(request, "%s invalid '%s'", tag, str);
+            sts = AFB_ERRNO_INVALID_REQUEST;
+            break;
+        case WIFIAP_ERROR_NOT_FOUND:
+            AFB_REQ_WARNING(request, "%s not found '%s'", tag, str);
+            sts = AFB_USER_ERRNO(-sts);
+            break;
+        case WIFIAP_ERROR_PMF:
+            AFB_REQ_WARNING(request, "%s '%s' needs ieee80211w=1", tag, str);
+            sts = AFB_USER_ERRNO(-sts);
+            break;
         default:
             AFB_REQ_ERROR(request, "internal error while setting %s '%s'", tag,
                           str);
             sts = AFB_ERRNO_INTERNAL_ERROR;
             break;
         }
-        afb_req_reply(request, sts, 0, NULL);
+        reply_request(request, sts, 0, NULL);
     }
 }
 
@@ -743,6 +1259,7 @@ static void single_uint32_set(afb_req_t request,
         int sts = set(wifi_ap_data, u32);
         if (sts == WIFIAP_NO_ERROR) {
             AFB_REQ_INFO(request, "%s set to %u", tag, (unsigned)u32);
+            scheduleStateSave(afb_req_get_api(request));
             sts = 0;
         }
         else {
@@ -754,6 +1271,18 @@ static void single_uint32_set(afb_req_t request,
             case WIFIAP_ERROR_TOO_LARGE:
                 msg = "too large";
                 break;
+            case WIFIAP_ERROR_NOT_FOUND:
+                msg = "not found";
+                break;
+            case WIFIAP_ERROR_WIDTH:
+                msg = "not possible with the IEEE standard and channel";
+                break;
+            case WIFIAP_ERROR_UNSUPPORTED:
+                msg = "not allowed by the radio or the regulatory domain";
+                break;
+            case WIFIAP_ERROR_STD_H:
+                msg = "radar detection needs ieee80211h=1";
+                break;
             default:
                 msg = "internal error";
                 break;
@@ -762,7 +1291,36 @@ static void single_uint32_set(afb_req_t request,
                             (unsigned)u32, msg);
             sts = AFB_USER_ERRNO(-sts);
         }
-        afb_req_reply(request, sts, 0, NULL);
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ * Get single boolean parameter and use it to set a wifi ap value
+ ******************************************************************************/
+static void single_boolean_set(afb_req_t request,
+                               unsigned nparams,
+                               afb_data_t const *params,
+                               const char *tag,
+                               int (*set)(wifiApT *, bool))
+{
+    bool value;
+    if (get_single_boolean(request, nparams, params, &value)) {
+        wifiApT *wifi_ap_data = get_wifi(request);
+        int sts = set(wifi_ap_data, value);
+        if (sts == WIFIAP_NO_ERROR) {
+            AFB_REQ_INFO(request, "%s set to %s", tag,
+                         value ? "true" : "false");
+            scheduleStateSave(afb_req_get_api(request));
+        }
+        else {
+            AFB_REQ_WARNING(request, "can't set %s: %s", tag,
+                            sts == WIFIAP_ERROR_WMM
+                                ? "WMM is needed by ieee80211n/ac/ax"
+                                : "internal error");
+            sts = AFB_USER_ERRNO(-sts);
+        }
+        reply_request(request, sts, 0, NULL);
     }
 }
 
@@ -781,11 +1339,11 @@ static void reply_single_key_uint32(afb_req_t request,
         sts = afb_create_data_copy(&data, AFB_PREDEFINED_TYPE_JSON, buffer,
                                    1 + (size_t)sts);
         if (sts == 0) {
-            afb_req_reply(request, 0, 1, &data);
+            reply_request(request, 0, 1, &data);
             return;
         }
     }
-    afb_req_reply(request, AFB_ERRNO_INTERNAL_ERROR, 0, NULL);
+    reply_request(request, AFB_ERRNO_INTERNAL_ERROR, 0, NULL);
 }
 
 /*******************************************************************************
@@ -802,11 +1360,11 @@ static void reply_single_key_string(afb_req_t request,
         sts = afb_create_data_copy(&data, AFB_PREDEFINED_TYPE_JSON, buffer,
                                    1 + (size_t)sts);
         if (sts == 0) {
-            afb_req_reply(request, 0, 1, &data);
+            reply_request(request, 0, 1, &data);
             return;
         }
     }
-    afb_req_reply(request, AFB_ERRNO_INTERNAL_ERROR, 0, NULL);
+    reply_request(request, AFB_ERRNO_INTERNAL_ERROR, 0, NULL);
 }
 
 /*******************************************************************************
@@ -815,7 +1373,7 @@ static void reply_single_key_string(afb_req_t request,
 static void start(afb_req_t request, unsigned nparams, afb_data_t const *params)
 {
     const char *errtxt;
-    int started, sts;
+    int started, starting, sts;
     wifiApT *wifiApData = get_wifi(request);
 
     AFB_INFO("WiFi access point start verb function");
@@ -826,25 +1384,34 @@ static void start(afb_req_t request, unsigned nparams, afb_data_t const *params)
     snprintf(cmd, sizeof(cmd), "%s %s", WIFI_SCRIPT,
              COMMAND_GET_VIRTUAL_INTERFACE_NAME);
 
-    FILE *cmdPipePtr = popen(cmd, "r");
-    char *interfaceName = malloc(PATH_MAX);
-    if (NULL != fgets(interfaceName, PATH_MAX - 1, cmdPipePtr)) {
-        size_t interfaceSize = strlen(interfaceName);
-        if (interfaceName[interfaceSize - 1] == '\n') {
-            interfaceSize--;
+    FILE *cmdPipePtr = open_command(PLATFORM_LINK, cmd);
+    char interfaceName[PATH_MAX];
+    if (NULL != cmdPipePtr) {
+        if (NULL != fgets(interfaceName, sizeof(interfaceName), cmdPipePtr)) {
+            interfaceName[strcspn(interfaceName, "\n")] = '\0';
+            if (interfaceName[0] != '\0' &&
+                strcmp(interfaceName, wifiApData->interfaceName) != 0 &&
+                setInterfaceNameParameter(wifiApData, interfaceName) ==
+                    WIFIAP_NO_ERROR)
+                AFB_DEBUG("IFACE : %s", wifiApData->interfaceName);
         }
-        memcpy(wifiApData->interfaceName, interfaceName, interfaceSize);
-        free(interfaceName);
-        AFB_DEBUG("IFACE : %s", wifiApData->interfaceName);
+        close_command(cmdPipePtr);
     }
 
 #endif
 
     pthread_mutex_lock(&status_mutex);  // status lock for reading
     started = wifiApData->status == status_started;
+    starting = wifiApData->status == status_starting;
     pthread_mutex_unlock(&status_mutex);  // status lock for other writing
 
     errtxt = NULL;
+    if (starting) {
+        AFB_INFO("WiFi AP is being started by the fast boot");
+        reply_request_string(request, AFB_ERRNO_BAD_STATE,
+                             "WiFi AP is starting");
+        return;
+    }
     if (started) {
         AFB_INFO("WiFi AP already started");
         sts = 0;
@@ -888,9 +1455,9 @@ static void start(afb_req_t request, unsigned nparams, afb_data_t const *params)
         }
     }
     if (errtxt == NULL)
-        afb_req_reply(request, sts, 0, NULL);
+        reply_request(request, sts, 0, NULL);
     else
-        afb_req_reply_string(request, AFB_USER_ERRNO(-sts), errtxt);
+        reply_request_string(request, AFB_USER_ERRNO(-sts), errtxt);
 }
 /*******************************************************************************
  *               stop access point verb function                               *
@@ -902,51 +1469,44 @@ static void stop(afb_req_t request, unsigned nparams, afb_data_t const *params)
 
     wifiApT *wifiApData = get_wifi(request);
 
-    char cmd[PATH_MAX];
-
-    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
-             COMMAND_WIFIAP_HOSTAPD_STOP, wifiApData->interfaceName);
+    pthread_mutex_lock(&status_mutex);
+    status = wifiApData->status == status_starting;
+    pthread_mutex_unlock(&status_mutex);
+    if (status) {
+        reply_request_string(request, AFB_ERRNO_BAD_STATE,
+                             "WiFi AP is starting");
+        return;
+    }
 
-    status = system(cmd);
-    if ((!WIFEXITED(status)) || (0 != WEXITSTATUS(status))) {
-        AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)",
-                  COMMAND_WIFIAP_HOSTAPD_STOP, status);
+    // the exit code of the script, above 1000 for the radio
+    switch (stopWifiAp(&apStart, wifiApData, &status)) {
+    case 0:
+        break;
+    case -1:
         status = AFB_USER_ERRNO(WEXITSTATUS(status));
         goto onErrorExit;
-    }
-
-    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT, COMMAND_WIFI_HW_STOP,
-             wifiApData->interfaceName);
-
-    status = system(cmd);
-    if ((!WIFEXITED(status)) || (0 != WEXITSTATUS(status))) {
-        AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)", COMMAND_WIFI_HW_STOP,
-                  status);
+    default:
         status = AFB_USER_ERRNO(1000 + WEXITSTATUS(status));
         goto onErrorExit;
     }
 
-    if (wifiApThreadPtr) {
-        /* Terminate the created thread */
-        if (0 != cancelThread(wifiApThreadPtr->threadId)) {
-            AFB_ERROR("No WiFi client event thread found\n");
-        }
-        else if (0 != JoinThread(wifiApThreadPtr->threadId, NULL)) {
-            status = AFB_USER_ERRNO(2000);
-            goto onErrorExit;
-        }
+    if (stopEventThread() != 0) {
+        status = AFB_USER_ERRNO(2000);
+        goto onErrorExit;
     }
     pthread_mutex_lock(&status_mutex);
     wifiApData->status = status_stopped;
     pthread_mutex_unlock(&status_mutex);
-    afb_req_reply(request, 0, 0, NULL);
+    diagRecord(DIAG_SUBSYSTEM_AP, DIAG_CODE_STOPPED, 0, "%s",
+               wifiApData->interfaceName);
+    reply_request(request, 0, 0, NULL);
     return;
 
 onErrorExit:
     pthread_mutex_lock(&status_mutex);
     wifiApData->status = status_fail;
     pthread_mutex_unlock(&status_mutex);
-    afb_req_reply(request, status, 0, NULL);
+    reply_request(request, status, 0, NULL);
 }
 
 /*******************************************************************************
@@ -961,8 +1521,8 @@ static void restart(afb_req_t request,
 
     wifiApT *wifi_ap_data = get_wifi(request);
 
-    const char *DnsmasqConfigFileName = "/tmp/dnsmasq.wlan.conf";
-    const char *HostConfigFileName = "/tmp/add_hosts";
+    const char *DnsmasqConfigFileName = WIFI_DNSMASQ_FILE;
+    const char *HostConfigFileName = WIFI_HOSTS_FILE;
 
     if (checkFileExists(DnsmasqConfigFileName) ||
         checkFileExists(HostConfigFileName)) {
@@ -971,7 +1531,7 @@ static void restart(afb_req_t request,
         snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
                  COMMAND_WIFIAP_HOSTAPD_STOP, wifi_ap_data->interfaceName);
         // stop WiFi Access Point
-        systemResult = system(cmd);
+        systemResult = run_command(PLATFORM_DAEMON, cmd);
         if ((!WIFEXITED(systemResult)) || (0 != WEXITSTATUS(systemResult))) {
             AFB_ERROR("WiFi AP Command \"%s\" Failed: (%d)",
                       COMMAND_WIFIAP_HOSTAPD_STOP, systemResult);
@@ -979,126 +1539,621 @@ static void restart(afb_req_t request,
             pthread_mutex_lock(&status_mutex);
             wifi_ap_data->status = status_fail;
             pthread_mutex_unlock(&status_mutex);
+            reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                                 "Failed to stop the WiFi AP");
+            return;
+        }
+        // startAp creates the event thread and its pipe again
+        if (stopEventThread() != 0) {
+            AFB_ERROR("Unable to stop the WiFi event thread");
+            pthread_mutex_lock(&status_mutex);
+            wifi_ap_data->status = status_fail;
+            pthread_mutex_unlock(&status_mutex);
+            reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                                 "Failed to stop the WiFi event thread");
             return;
         }
         // Start WiFi Access Point
         if (startAp(wifi_ap_data) < 0) {
             AFB_ERROR("Failed to start Wifi Access Point correctly!");
+            reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                                 "Failed to start the WiFi AP");
+            return;
         }
     }
+    reply_request(request, 0, 0, NULL);
 }
 
+// defined with the descriptor table of the configuration, below the verbs
+static wifiApT *createWifiApData(afb_api_t api, struct json_object *obj);
+
 /*******************************************************************************
- *                Subscribes for the event of name                             *
+ *        read the "config" section of the configuration file                  *
+ *                                                                             *
+ * @return                                                                     *
+ *      the section (owned by *root, to be released), or NULL on error         *
  ******************************************************************************/
-static void subscribe(afb_req_t request,
-                      unsigned nparams,
-                      afb_data_t const *params)
+static struct json_object *read_config_file(afb_api_t api,
+                                            struct json_object **root)
 {
-    const char *name;
-    if (get_single_string(request, nparams, params, &name)) {
-        int sts = afb_req_subscribe(request, client_state_event);
-        afb_req_reply(request, sts < 0 ? AFB_ERRNO_INTERNAL_ERROR : 0, 0, NULL);
+    struct json_object *config;
+
+    // Reading the JSON file
+    *root = json_object_from_file(configFile);
+    if (!*root) {
+        AFB_API_ERROR(api, "Failed to read config file %s", configFile);
+        return NULL;
     }
-}
 
-/*******************************************************************************
- *                 Unsubscribes of the event of name                           *
- ******************************************************************************/
-static void unsubscribe(afb_req_t request,
-                        unsigned nparams,
-                        afb_data_t const *params)
-{
-    const char *name;
-    if (get_single_string(request, nparams, params, &name)) {
-        int sts = afb_req_unsubscribe(request, client_state_event);
-        afb_req_reply(request, sts < 0 ? AFB_ERRNO_INTERNAL_ERROR : 0, 0, NULL);
+    // Accessing the config section
+    if (!json_object_object_get_ex(*root, "config", &config)) {
+        AFB_API_ERROR(api, "No 'config' section in JSON file");
+        json_object_put(*root);
+        *root = NULL;
+        return NULL;
     }
+    return config;
 }
 
 /*******************************************************************************
- *           get the IEEE standard used for the access point                   *
+ *        apply a staged configuration to the running access point             *
+ *                                                                             *
+ * The staged settings replace the current ones. When the access point runs,   *
+ * each group of changes is applied the cheapest way: hostapd SET and          *
+ * UPDATE_BEACON, channel switch, reload of hostapd.conf by hostapd, restart   *
+ * of dnsmasq. The access point is only restarted when a setting needs it or   *
+ * when one of these steps fails.                                              *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if applied, -1 if the access point failed to restart                 *
  ******************************************************************************/
-
-static void getIeeeStandard(afb_req_t request,
-                            unsigned nparams,
-                            afb_data_t const *params)
+static int applyStagedConfig(wifiApT *wifiApData,
+                             wifiApT *staged,
+                             unsigned *changes)
 {
-    wifiApT *wifi_ap_data = get_wifi(request);
-    reply_single_key_uint32(request, "stdMask", wifi_ap_data->IeeeStdMask);
-}
-
-/*******************************************************************************
- *                     Get the number of clients connected to the access point *
- *******************************************************************************
- * @return success if the function succeeded
- * @return failed request if there is no more AP:s found or the function failed
- ******************************************************************************/
+    char maxClients[16];
+    bool started;
+    int status;
 
-static void getAPnumberClients(afb_req_t request,
-                               unsigned nparams,
-                               afb_data_t const *params)
-{
-    static FILE *IwStationPipePtr = NULL;
-    int numberClientsConnectedAP = 0;
-    char line[PATH_MAX];
+    // from now, staged holds the previous settings (steeringJob reads them
+    // under the same lock)
+    pthread_mutex_lock(&status_mutex);
+    started = wifiApData->status == status_started;
+    swapWifiApData(wifiApData, staged);
+    pthread_mutex_unlock(&status_mutex);
+    if (!started || *changes == 0)
+        return 0;
 
-    wifiApT *wifi_ap_data = get_wifi(request);
+    // keep hostapd.conf up to date for the reloads and the next start
+    if ((*changes & (WIFIAP_CHANGE_HOSTAPD_SET | WIFIAP_CHANGE_CHANNEL |
+                     WIFIAP_CHANGE_HOSTAPD_RELOAD)) &&
+        !(*changes & WIFIAP_CHANGE_RESTART) &&
+        generate_hostapd_conf(wifiApData) != 0)
+        *changes |= WIFIAP_CHANGE_RESTART;
 
-    AFB_INFO("Getting the number of clients of the access point ...");
+    if (*changes & WIFIAP_CHANGE_RESTART)
+        ;
+    else if (*changes & WIFIAP_CHANGE_HOSTAPD_RELOAD) {
+        // the reloaded file also holds the SSID and the channel
+        if (hostapdRequest(wifiApData->interfaceName, "RELOAD") != 0) {
+            AFB_WARNING("hostapd failed to reload its configuration");
+            *changes |= WIFIAP_CHANGE_RESTART;
+        }
+    }
+    else {
+        snprintf(maxClients, sizeof(maxClients), "%u",
+                 (unsigned)wifiApData->maxNumberClient);
+        if ((*changes & WIFIAP_CHANGE_HOSTAPD_SET) &&
+            (hostapdSet(wifiApData->interfaceName, "ssid", wifiApData->ssid) ||
+             hostapdSet(wifiApData->interfaceName, "ignore_broadcast_ssid",
+                        wifiApData->discoverable ? "0" : "1") ||
+             hostapdSet(wifiApData->interfaceName, "max_num_sta",
+                        maxClients) ||
+             hostapdRequest(wifiApData->interfaceName, "UPDATE_BEACON"))) {
+            AFB_WARNING("hostapd failed to change its settings");
+            *changes |= WIFIAP_CHANGE_RESTART;
+        }
+        else if ((*changes & WIFIAP_CHANGE_CHANNEL) &&
+                 switchChannel(wifiApData, wifiApData->channelNumber) != 0) {
+            *changes |= WIFIAP_CHANGE_RESTART;
+        }
+    }
 
-    char cmd[PATH_MAX];
-    snprintf(cmd, sizeof(cmd), "iw dev %s station dump",
-             wifi_ap_data->interfaceName);
+    if (!(*changes & WIFIAP_CHANGE_RESTART) &&
+        (*changes & WIFIAP_CHANGE_DHCP) &&
+        setApDnsmasq(&apStart, wifiApData, true) != 0)
+        *changes |= WIFIAP_CHANGE_RESTART;
 
-    IwStationPipePtr = popen(cmd, "r");
+    if (!(*changes & WIFIAP_CHANGE_RESTART) &&
+        (*changes & WIFIAP_CHANGE_SHAPING) && applyShaping(wifiApData) != 0)
+        AFB_WARNING("Unable to set the traffic shaping of %s",
+                    wifiApData->interfaceName);
 
-    if (NULL == IwStationPipePtr) {
-        AFB_ERROR("Failed to run command:\"%s\" errno:%d %s",
-                  COMMAND_WIFI_SET_EVENT, errno, strerror(errno));
-        afb_req_reply_string(request, AFB_ERRNO_INVALID_REQUEST,
-                             "Failed to get the number of clients connected to "
-                             "an access point!");
-        return;
-    }
+    if (!(*changes & WIFIAP_CHANGE_RESTART) &&
+        (*changes & WIFIAP_CHANGE_STEERING))
+        startSteering(wifiApData);
 
-    // Read the output one line at a time - output it.
-    while (NULL != fgets(line, sizeof(line) - 1, IwStationPipePtr)) {
-        AFB_DEBUG("PARSING:%s: len:%d", line,
-                  (int)strnlen(line, sizeof(line) - 1));
-        if (NULL != strstr(line, "Station ")) {
-            numberClientsConnectedAP++;
-        }
-    }
+    if (!(*changes & WIFIAP_CHANGE_RESTART))
+        return 0;
 
-    reply_single_key_uint32(request, "clients-number",
-                            (uint32_t)numberClientsConnectedAP);
+    // last resort: restart the access point (on the previous interface)
+    AFB_NOTICE("Restarting the access point to apply the configuration");
+    char cmd[PATH_MAX];
+    snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
+             COMMAND_WIFIAP_HOSTAPD_STOP, staged->interfaceName);
+    status = run_command(PLATFORM_DAEMON, cmd);
+    if ((!WIFEXITED(status)) || (0 != WEXITSTATUS(status)))
+        AFB_WARNING("WiFi AP Command \"%s\" Failed: (%d)",
+                    COMMAND_WIFIAP_HOSTAPD_STOP, status);
+    if (stopEventThread() != 0)
+        AFB_WARNING("Unable to stop the WiFi event thread");
+    return startAp(wifiApData) < 0 ? -1 : 0;
 }
 
 /*******************************************************************************
- *                                     Get the status of the Wifi access point *
- *******************************************************************************
- * @return the status of the WiFi access point
- * @return failed request if there is no status variable
+ *        reload the configuration file and apply what changed                 *
+ *                                                                             *
+ * The file is parsed with the descriptor table of the binding init into a     *
+ * staged configuration, compared to the current one, and applied. The state   *
+ * file, if any, is then rewritten from the result. Nothing is reloaded while  *
+ * the fast boot starts the access point.                                      *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if reloaded, -1 if the file is invalid, -2 if applying failed, -3 if *
+ *      the access point is starting                                           *
  ******************************************************************************/
-
-static void getWifiApStatus(afb_req_t request,
-                            unsigned nparams,
-                            afb_data_t const *params)
+static int reloadConfiguration(afb_api_t api, unsigned *changes)
 {
-    const char *status;
-    wifiApT *wifi_ap_data = get_wifi(request);
+    wifiApT *wifiApData = afb_api_get_userdata(api);
+    struct json_object *root, *config;
+    wifiApT *staged;
+    bool starting;
+    int rc = 0;
+
+    pthread_mutex_lock(&reload_mutex);
 
     pthread_mutex_lock(&status_mutex);
-    status = wifi_ap_data->status;
+    starting = wifiApData->status == status_starting;
     pthread_mutex_unlock(&status_mutex);
+    if (starting) {
+        pthread_mutex_unlock(&reload_mutex);
+        return -3;
+    }
 
-    reply_single_key_string(request, "status", status);
-}
+    config = read_config_file(api, &root);
+    staged = config == NULL ? NULL : createWifiApData(api, config);
+    json_object_put(root);
 
-/*******************************************************************************
- *               set the WiFi access point's host name                         *
- ******************************************************************************/
+    if (staged == NULL) {
+        AFB_API_ERROR(api, "Invalid configuration, keeping the current one");
+        rc = -1;
+    }
+    else {
+        *changes = compareWifiApData(wifiApData, staged);
+        AFB_API_NOTICE(api, "Configuration reloaded (changes 0x%x)", *changes);
+        if (applyStagedConfig(wifiApData, staged, changes) != 0)
+            rc = -2;
+        deleteWifiApData(staged);
+    }
+
+    pthread_mutex_unlock(&reload_mutex);
+    diagRecord(DIAG_SUBSYSTEM_CONFIG, DIAG_CODE_RELOADED, rc, "changes 0x%x",
+               rc == -1 ? 0 : *changes);
+
+    // the edited file now wins over the previous runtime changes
+    if (rc != -1 && *changes != 0)
+        scheduleStateSave(api);
+    return rc;
+}
+
+/*******************************************************************************
+ *        thread reloading the configuration file when it changes              *
+ *                                                                             *
+ * The directory is watched so that the files replaced by a rename (as most    *
+ * editors do) are seen too. The reload waits for the file to be quiet.        *
+ ******************************************************************************/
+static void *configWatcherMain(void *context)
+{
+    afb_api_t api = context;
+    char buffer[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+    char directory[PATH_MAX];
+    const char *name;
+    struct pollfd pfd;
+    unsigned changes;
+    ssize_t length;
+    bool changed;
+    int fd;
+
+    name = strrchr(configFile, '/');
+    if (name == NULL)
+        snprintf(directory, sizeof(directory), ".");
+    else
+        snprintf(directory, sizeof(directory), "%.*s",
+                 (int)(name - configFile), configFile);
+    name = name == NULL ? configFile : name + 1;
+
+    fd = inotify_init1(IN_CLOEXEC);
+    if (fd < 0 || inotify_add_watch(fd, directory,
+                                    IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        AFB_API_ERROR(api, "Unable to watch %s (error %d)", directory, errno);
+        if (fd >= 0)
+            close(fd);
+        return NULL;
+    }
+
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    for (;;) {
+        // wait for a change of the file, then for the end of the changes
+        changed = false;
+        do {
+            length = read(fd, buffer, sizeof(buffer));
+            for (ssize_t offset = 0; offset < length;) {
+                const struct inotify_event *event =
+                    (const struct inotify_event *)&buffer[offset];
+                changed = changed ||
+                          (event->len != 0 && strcmp(event->name, name) == 0);
+                offset += (ssize_t)(sizeof(*event) + event->len);
+            }
+        } while (length < 0 ? errno == EINTR
+                            : !changed ||
+                                  poll(&pfd, 1, CONFIG_RELOAD_DELAY_MS) > 0);
+
+        if (length < 0) {
+            AFB_API_ERROR(api, "Stop watching %s (error %d)", configFile,
+                          errno);
+            break;
+        }
+        // the fast boot is given the time to start the access point
+        while (reloadConfiguration(api, &changes) == -3)
+            poll(NULL, 0, CONFIG_RELOAD_DELAY_MS);
+    }
+    close(fd);
+    return NULL;
+}
+
+/*******************************************************************************
+ *        reload the configuration file verb function                          *
+ ******************************************************************************/
+static void reloadConfig(afb_req_t request,
+                         unsigned nparams,
+                         afb_data_t const *params)
+{
+    static const struct
+    {
+        unsigned change;
+        const char *name;
+    } groups[] = {
+        {WIFIAP_CHANGE_HOSTAPD_SET, "hostapd-set"},
+        {WIFIAP_CHANGE_CHANNEL, "channel"},
+        {WIFIAP_CHANGE_HOSTAPD_RELOAD, "hostapd-reload"},
+        {WIFIAP_CHANGE_DHCP, "dhcp"},
+        {WIFIAP_CHANGE_SHAPING, "shaping"},
+        {WIFIAP_CHANGE_STEERING, "steering"},
+        {WIFIAP_CHANGE_RESTART, "restart"},
+    };
+    struct json_object *responseJ, *changesJ;
+    unsigned changes = 0;
+    int sts;
+
+    sts = reloadConfiguration(afb_req_get_api(request), &changes);
+    if (sts == -1) {
+        reply_request_string(request, AFB_ERRNO_INVALID_REQUEST,
+                             "Invalid configuration file");
+        return;
+    }
+    if (sts == -3) {
+        reply_request_string(request, AFB_ERRNO_BAD_STATE,
+                             "WiFi AP is starting");
+        return;
+    }
+
+    changesJ = json_object_new_array();
+    for (unsigned idx = 0; idx < sizeof groups / sizeof *groups; idx++) {
+        if (changes & groups[idx].change)
+            json_object_array_add(changesJ,
+                                  json_object_new_string(groups[idx].name));
+    }
+    rp_jsonc_pack(&responseJ, "{so,sb}", "changes", changesJ, "applied",
+                  sts == 0);
+    afb_data_t data = afb_data_json_c_hold(responseJ);
+    reply_request(request, sts == 0 ? 0 : AFB_ERRNO_INTERNAL_ERROR, 1, &data);
+}
+
+/*******************************************************************************
+ *        survey the channels and move to the least loaded one                 *
+ *                                                                             *
+ * The survey takes seconds, it runs without lock: the channel is changed      *
+ * under reload_mutex, as a setter does.                                       *
+ ******************************************************************************/
+static void replyRescanChannel(afb_req_t request)
+{
+    struct json_object *responseJ;
+    wifiApT *wifiApData = get_wifi(request);
+    bool started, switched = false, changed = false;
+    uint32_t frequency;
+    uint16_t channel;
+    double cost;
+    int sts;
+
+    pthread_mutex_lock(&status_mutex);
+    started = wifiApData->status == status_started;
+    pthread_mutex_unlock(&status_mutex);
+
+    sts = surveyApChannel(&apStart, wifiApData, started, &channel, &cost);
+    if (sts != 0) {
+        reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                             sts == WIFIAP_ERROR_NOT_FOUND
+                                 ? "No usable channel found by the survey"
+                                 : "Failed to survey the channels");
+        return;
+    }
+
+    pthread_mutex_lock(&reload_mutex);
+    if (channel != wifiApData->channelNumber) {
+        // stopped or started meanwhile
+        pthread_mutex_lock(&status_mutex);
+        started = wifiApData->status == status_started;
+        pthread_mutex_unlock(&status_mutex);
+
+        if (started) {
+            if (switchChannel(wifiApData, channel) != 0) {
+                pthread_mutex_unlock(&reload_mutex);
+                reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                                     "Failed to switch channel");
+                return;
+            }
+            switched = true;
+        }
+        AFB_REQ_INFO(request, "channel %u selected by the survey (cost %.3f)",
+                     (unsigned)channel, cost);
+        wifiApData->channelNumber = channel;
+        changed = true;
+    }
+    frequency = channelToFrequency(channel, wifiApData->IeeeStdMask);
+    pthread_mutex_unlock(&reload_mutex);
+
+    if (changed)
+        scheduleStateSave(afb_req_get_api(request));
+
+    rp_jsonc_pack(&responseJ, "{si,si,sf,sb}", "channel", (int)channel,
+                  "frequency", (int)frequency, "cost", cost, "switched",
+                  switched);
+    afb_data_t data = afb_data_json_c_hold(responseJ);
+    reply_request(request, 0, 1, &data);
+}
+
+/*******************************************************************************
+ *        rescan job: the survey takes seconds, it runs in the worker pool     *
+ ******************************************************************************/
+typedef struct
+{
+    threadJob_t job;
+    afb_req_t request;
+} rescanJobT;
+
+static void rescanChannelJob(threadJob_t *job)
+{
+    rescanJobT *rescan = job->context;
+    replyRescanChannel(rescan->request);
+}
+
+static void rescanChannelDone(threadJob_t *job, int status)
+{
+    rescanJobT *rescan = job->context;
+
+    if (status == THREAD_JOB_CANCELLED)
+        reply_request_string(rescan->request, AFB_ERRNO_NOT_AVAILABLE,
+                             "Rescan cancelled");
+    else
+        AFB_REQ_DEBUG(rescan->request, "rescan waited %llu us, ran %llu us",
+                      (unsigned long long)(job->waitNs / 1000),
+                      (unsigned long long)(job->runNs / 1000));
+    afb_req_unref(rescan->request);
+    free(rescan);
+}
+
+static void rescanChannel(afb_req_t request,
+                          unsigned nparams,
+                          afb_data_t const *params)
+{
+    rescanJobT *rescan;
+    int sts;
+
+    if (wifiApPool == NULL) {
+        replyRescanChannel(request);
+        return;
+    }
+
+    rescan = malloc(sizeof(*rescan));
+    if (rescan == NULL) {
+        reply_request_string(request, AFB_ERRNO_OUT_OF_MEMORY,
+                             "Out of memory");
+        return;
+    }
+    rescan->request = afb_req_addref(request);
+    initThreadJob(&rescan->job, rescanChannelJob, rescanChannelDone, rescan,
+                  workerThreadSettings.priority);
+
+    sts = postThreadJob(wifiApPool, &rescan->job);
+    if (sts != 0) {
+        reply_request_string(request, AFB_ERRNO_NOT_AVAILABLE,
+                             sts == -2 ? "Too many pending requests"
+                                       : "Worker pool not available");
+        afb_req_unref(rescan->request);
+        free(rescan);
+    }
+}
+
+/*******************************************************************************
+ *                Subscribes for the event of name                             *
+ ******************************************************************************/
+static void subscribe(afb_req_t request,
+                      unsigned nparams,
+                      afb_data_t const *params)
+{
+    const char *name;
+    if (get_single_string(request, nparams, params, &name)) {
+        int sts = afb_req_subscribe(request, client_state_event);
+        if (sts >= 0)
+            sts = afb_req_subscribe(request, ap_ready_event);
+        reply_request(request, sts < 0 ? AFB_ERRNO_INTERNAL_ERROR : 0, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *                 Unsubscribes of the event of name                           *
+ ******************************************************************************/
+static void unsubscribe(afb_req_t request,
+                        unsigned nparams,
+                        afb_data_t const *params)
+{
+    const char *name;
+    if (get_single_string(request, nparams, params, &name)) {
+        int sts = afb_req_unsubscribe(request, client_state_event);
+        if (sts >= 0)
+            sts = afb_req_unsubscribe(request, ap_ready_event);
+        reply_request(request, sts < 0 ? AFB_ERRNO_INTERNAL_ERROR : 0, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *           get the IEEE standard used for the access point                   *
+ ******************************************************************************/
+
+static void getIeeeStandard(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    wifiApT *wifi_ap_data = get_wifi(request);
+    reply_single_key_uint32(request, "stdMask", wifi_ap_data->IeeeStdMask);
+}
+
+/*******************************************************************************
+ *           get the capabilities of the radio read from nl80211               *
+ ******************************************************************************/
+static void getRadioCapabilities(afb_req_t request,
+                                 unsigned nparams,
+                                 afb_data_t const *params)
+{
+    static const char *const bandNames[WIFI_AP_BAND_COUNT] = {"2.4GHz", "5GHz",
+                                                              "60GHz", "6GHz"};
+    const wifiAp_RadioCapabilities_t *capabilities =
+        &get_wifi(request)->radioCapabilities;
+    struct json_object *responseJ, *bandsJ, *bandJ, *channelsJ, *channelJ;
+
+    if (!capabilities->valid) {
+        reply_request_string(request, AFB_ERRNO_NOT_AVAILABLE,
+                             "No nl80211 capabilities for the interface");
+        return;
+    }
+
+    bandsJ = json_object_new_array();
+    for (unsigned band = 0; band < WIFI_AP_BAND_COUNT; band++) {
+        if (!capabilities->bands[band].present)
+            continue;
+
+        channelsJ = json_object_new_array();
+        for (uint32_t i = 0; i < capabilities->channelCount; i++) {
+            const wifiAp_RadioChannel_t *channel = &capabilities->channels[i];
+            if (channel->band != band)
+                continue;
+            rp_jsonc_pack(&channelJ, "{si,si,sb,sb,sb,si}", "channel",
+                          (int)channel->channel, "frequency",
+                          (int)channel->frequency, "disabled",
+                          channel->disabled, "noIr", channel->noIr, "radar",
+                          channel->radar, "maxPower", (int)channel->maxPower);
+            json_object_array_add(channelsJ, channelJ);
+        }
+
+        rp_jsonc_pack(&bandJ, "{ss,sb,si,sb,si,sb,so}", "band",
+                      bandNames[band], "ht", capabilities->bands[band].ht,
+                      "htCapa", (int)capabilities->bands[band].htCapa, "vht",
+                      capabilities->bands[band].vht, "vhtCapa",
+                      (int)capabilities->bands[band].vhtCapa, "he",
+                      capabilities->bands[band].he, "channels", channelsJ);
+        json_object_array_add(bandsJ, bandJ);
+    }
+
+    rp_jsonc_pack(&responseJ, "{si,so}", "wiphy", (int)capabilities->wiphy,
+                  "bands", bandsJ);
+    afb_data_t data = afb_data_json_c_hold(responseJ);
+    reply_request(request, 0, 1, &data);
+}
+
+/*******************************************************************************
+ *                     Get the number of clients connected to the access point *
+ *******************************************************************************
+ * @return success if the function succeeded
+ * @return failed request if there is no more AP:s found or the function failed
+ ******************************************************************************/
+
+static void getAPnumberClients(afb_req_t request,
+                               unsigned nparams,
+                               afb_data_t const *params)
+{
+    FILE *IwStationPipePtr;
+    int numberClientsConnectedAP = 0;
+    char line[PATH_MAX];
+
+    wifiApT *wifi_ap_data = get_wifi(request);
+
+    AFB_INFO("Getting the number of clients of the access point ...");
+
+    char cmd[PATH_MAX];
+    snprintf(cmd, sizeof(cmd), "iw dev %s station dump",
+             wifi_ap_data->interfaceName);
+
+    IwStationPipePtr = open_command(PLATFORM_LINK, cmd);
+
+    if (NULL == IwStationPipePtr) {
+        AFB_ERROR("Failed to run command:\"%s\" errno:%d %s",
+                  COMMAND_WIFI_SET_EVENT, errno, strerror(errno));
+        reply_request_string(request, AFB_ERRNO_INVALID_REQUEST,
+                             "Failed to get the number of clients connected to "
+                             "an access point!");
+        return;
+    }
+
+    // Read the output one line at a time - output it.
+    while (NULL != fgets(line, sizeof(line) - 1, IwStationPipePtr)) {
+        AFB_DEBUG("PARSING:%s: len:%d", line,
+                  (int)strnlen(line, sizeof(line) - 1));
+        if (NULL != strstr(line, "Station ")) {
+            numberClientsConnectedAP++;
+        }
+    }
+    close_command(IwStationPipePtr);
+
+    reply_single_key_uint32(request, "clients-number",
+                            (uint32_t)numberClientsConnectedAP);
+}
+
+/*******************************************************************************
+ *                                     Get the status of the Wifi access point *
+ *******************************************************************************
+ * @return the status of the WiFi access point
+ * @return failed request if there is no status variable
+ ******************************************************************************/
+
+static void getWifiApStatus(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    const char *status;
+    wifiApT *wifi_ap_data = get_wifi(request);
+
+    pthread_mutex_lock(&status_mutex);
+    status = wifi_ap_data->status;
+    pthread_mutex_unlock(&status_mutex);
+
+    reply_single_key_string(request, "status", status);
+}
+
+/*******************************************************************************
+ *               set the WiFi access point's host name                         *
+ ******************************************************************************/
 static void setHostName(afb_req_t request,
                         unsigned nparams,
                         afb_data_t const *params)
@@ -1163,7 +2218,8 @@ static void setDiscoverable(afb_req_t request,
         setDiscoverableParameter(wifi_ap_data, discoverable);
         AFB_REQ_INFO(request, "set discoverable %s",
                      discoverable ? "true" : "false");
-        afb_req_reply(request, 0, 0, NULL);
+        scheduleStateSave(afb_req_get_api(request));
+        reply_request(request, 0, 0, NULL);
     }
 }
 
@@ -1181,6 +2237,7 @@ static void setIeeeStandard(afb_req_t request,
         if (sts == WIFIAP_NO_ERROR) {
             AFB_REQ_INFO(request, "IeeeStdBitMask set to 0x%X",
                          (unsigned)value);
+            scheduleStateSave(afb_req_get_api(request));
             sts = 0;
         }
         else {
@@ -1198,6 +2255,15 @@ static void setIeeeStandard(afb_req_t request,
             case WIFIAP_ERROR_STD_H:
                 msg = "ieee80211h=1 only works with ieee80211d=1";
                 break;
+            case WIFIAP_ERROR_WMM:
+                msg = "ieee80211n/ac/ax=1 only works with wmm_enabled=1";
+                break;
+            case WIFIAP_ERROR_UNSUPPORTED:
+                msg = "not supported by the radio";
+                break;
+            case WIFIAP_ERROR_PMF:
+                msg = "WPA3 needs ieee80211w=1";
+                break;
             default:
                 msg = "internal error";
                 break;
@@ -1206,7 +2272,7 @@ static void setIeeeStandard(afb_req_t request,
                             (unsigned)value, msg);
             sts = AFB_USER_ERRNO(-sts);
         }
-        afb_req_reply(request, sts, 0, NULL);
+        reply_request(request, sts, 0, NULL);
     }
 }
 
@@ -1233,84 +2299,816 @@ static void setSecurityProtocol(afb_req_t request,
 }
 
 /*******************************************************************************
- *                     set access point pre-shared key                         *
+ *                     set access point pre-shared key                         *
+ ******************************************************************************/
+static void SetPreSharedKey(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    single_string_set(request, nparams, params, "preshared key",
+                      setPreSharedKeyParameter);
+}
+
+/*******************************************************************************
+ *               set the country code to use for access point                  *
+ ******************************************************************************/
+
+static void setCountryCode(afb_req_t request,
+                           unsigned nparams,
+                           afb_data_t const *params)
+{
+    single_string_set(request, nparams, params, "country code",
+                      setCountryCodeParameter);
+}
+
+/*******************************************************************************
+ *               set the max number of clients of access point                 *
+ ******************************************************************************/
+
+static void SetMaxNumberClients(afb_req_t request,
+                                unsigned nparams,
+                                afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "maximum number of clients",
+                      setMaxNumberClients);
+}
+
+/*******************************************************************************
+ *     Set the access point IP address and client IP  addresses rang           *
+ ******************************************************************************/
+static void setIpRange(afb_req_t request,
+                       unsigned nparams,
+                       afb_data_t const *params)
+{
+    json_object *obj;
+    if (get_single_jsonc(request, nparams, params, &obj)) {
+        const char *ip_ap, *ip_start, *ip_stop, *ip_netmask;
+        int sts = rp_jsonc_unpack(obj, "{ss,ss,ss,ss !}", "ip_ap", &ip_ap,
+                                  "ip_start", &ip_start, "ip_stop", &ip_stop,
+                                  "ip_netmask", &ip_netmask);
+        if (sts != 0) {
+            AFB_REQ_WARNING(request, "unexpected schema %s",
+                            rp_jsonc_get_error_string(sts));
+            sts = AFB_ERRNO_INVALID_REQUEST;
+        }
+        else {
+            wifiApT *wifi_ap_data = get_wifi(request);
+            sts = setIpRangeParameters(wifi_ap_data, ip_ap, ip_start, ip_stop,
+                                       ip_netmask);
+            if (sts == WIFIAP_NO_ERROR) {
+                AFB_REQ_INFO(request, "IP range set successfully");
+                scheduleStateSave(afb_req_get_api(request));
+                sts = 0;
+            }
+            else {
+                switch (sts) {
+                case WIFIAP_ERROR_TOO_SMALL:
+                case WIFIAP_ERROR_TOO_LARGE:
+                    AFB_REQ_WARNING(
+                        request, "one of IP range value is too %s",
+                        sts == WIFIAP_ERROR_TOO_SMALL ? "small" : "large");
+                    break;
+                default:
+                    AFB_REQ_WARNING(request,
+                                    "can't set IP range, internal error");
+                    break;
+                }
+                sts = AFB_USER_ERRNO(-sts);
+            }
+        }
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *               set the beacon interval (in Time Units)                       *
+ ******************************************************************************/
+static void setBeaconInterval(afb_req_t request,
+                              unsigned nparams,
+                              afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "beacon interval",
+                      setBeaconIntervalParameter);
+}
+
+/*******************************************************************************
+ *               set the DTIM period (in number of beacons)                    *
+ ******************************************************************************/
+static void setDtimPeriod(afb_req_t request,
+                          unsigned nparams,
+                          afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "DTIM period",
+                      setDtimPeriodParameter);
+}
+
+/*******************************************************************************
+ *               set the RTS/CTS threshold                                     *
+ ******************************************************************************/
+static void setRtsThreshold(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "RTS threshold",
+                      setRtsThresholdParameter);
+}
+
+/*******************************************************************************
+ *               set the fragmentation threshold                               *
+ ******************************************************************************/
+static void setFragmThreshold(afb_req_t request,
+                              unsigned nparams,
+                              afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "fragmentation threshold",
+                      setFragmThresholdParameter);
+}
+
+/*******************************************************************************
+ *               set if WMM (QoS) is enabled                                   *
+ ******************************************************************************/
+static void setWmmEnabled(afb_req_t request,
+                          unsigned nparams,
+                          afb_data_t const *params)
+{
+    single_boolean_set(request, nparams, params, "WMM",
+                       setWmmEnabledParameter);
+}
+
+/*******************************************************************************
+ *       set the automatic channel selection (off, acs_survey or survey)       *
+ ******************************************************************************/
+static void setAutoChannel(afb_req_t request,
+                           unsigned nparams,
+                           afb_data_t const *params)
+{
+    single_string_set(request, nparams, params, "automatic channel",
+                      setAutoChannelParameter);
+}
+
+/*******************************************************************************
+ *               set the channel width (20, 40, 80 or 160 MHz)                 *
+ ******************************************************************************/
+static void setChannelWidth(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "channel width",
+                      setChannelWidthParameter);
+}
+
+/*******************************************************************************
+ *               set the extra HT capabilities                                 *
+ ******************************************************************************/
+static void setHtCapab(afb_req_t request,
+                       unsigned nparams,
+                       afb_data_t const *params)
+{
+    single_string_set(request, nparams, params, "HT capabilities",
+                      setHtCapabParameter);
+}
+
+/*******************************************************************************
+ *               set the extra VHT capabilities                                *
+ ******************************************************************************/
+static void setVhtCapab(afb_req_t request,
+                        unsigned nparams,
+                        afb_data_t const *params)
+{
+    single_string_set(request, nparams, params, "VHT capabilities",
+                      setVhtCapabParameter);
+}
+
+/*******************************************************************************
+ *               set the DHCP lease time (in seconds)                          *
+ ******************************************************************************/
+static void setDhcpLeaseTime(afb_req_t request,
+                             unsigned nparams,
+                             afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "DHCP lease time",
+                      setDhcpLeaseTimeParameter);
+}
+
+/*******************************************************************************
+ *               set if the DHCP server is authoritative                       *
+ ******************************************************************************/
+static void setDhcpAuthoritative(afb_req_t request,
+                                 unsigned nparams,
+                                 afb_data_t const *params)
+{
+    single_boolean_set(request, nparams, params, "DHCP authoritative",
+                       setDhcpAuthoritativeParameter);
+}
+
+/*******************************************************************************
+ *               set if the DHCP server uses rapid commit                      *
+ ******************************************************************************/
+static void setDhcpRapidCommit(afb_req_t request,
+                               unsigned nparams,
+                               afb_data_t const *params)
+{
+    single_boolean_set(request, nparams, params, "DHCP rapid commit",
+                       setDhcpRapidCommitParameter);
+}
+
+/*******************************************************************************
+ *               set the size of the DNS cache                                 *
+ ******************************************************************************/
+static void setDnsCacheSize(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "DNS cache size",
+                      setDnsCacheSizeParameter);
+}
+
+/*******************************************************************************
+ *               add a DHCP static lease (MAC to IP reservation)               *
+ ******************************************************************************/
+static void addDhcpStaticLease(afb_req_t request,
+                               unsigned nparams,
+                               afb_data_t const *params)
+{
+    json_object *obj;
+    if (get_single_jsonc(request, nparams, params, &obj)) {
+        const char *mac, *ip, *hostname = NULL;
+        int sts = rp_jsonc_unpack(obj, "{ss,ss,s?s !}", "mac", &mac, "ip", &ip,
+                                  "hostname", &hostname);
+        if (sts != 0) {
+            AFB_REQ_WARNING(request, "unexpected schema %s",
+                            rp_jsonc_get_error_string(sts));
+            sts = AFB_ERRNO_INVALID_REQUEST;
+        }
+        else {
+            wifiApT *wifi_ap_data = get_wifi(request);
+            sts = addDhcpStaticLeaseParameter(wifi_ap_data, mac, ip, hostname);
+            switch (sts) {
+            case WIFIAP_NO_ERROR:
+                AFB_REQ_INFO(request, "static lease %s -> %s added", mac, ip);
+                scheduleStateSave(afb_req_get_api(request));
+                break;
+            case WIFIAP_ERROR_FULL:
+                AFB_REQ_WARNING(request, "static lease table is full");
+                sts = AFB_USER_ERRNO(-sts);
+                break;
+            default:
+                AFB_REQ_WARNING(request, "invalid static lease %s -> %s", mac,
+                                ip);
+                sts = AFB_ERRNO_INVALID_REQUEST;
+                break;
+            }
+        }
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *               remove the DHCP static lease of a MAC address                 *
+ ******************************************************************************/
+static void removeDhcpStaticLease(afb_req_t request,
+                                  unsigned nparams,
+                                  afb_data_t const *params)
+{
+    single_string_set(request, nparams, params, "static lease",
+                      removeDhcpStaticLeaseParameter);
+}
+
+/*******************************************************************************
+ *               add or replace a DHCP option                                  *
+ ******************************************************************************/
+static void setDhcpOption(afb_req_t request,
+                          unsigned nparams,
+                          afb_data_t const *params)
+{
+    json_object *obj;
+    if (get_single_jsonc(request, nparams, params, &obj)) {
+        const char *value;
+        int code;
+        int sts = rp_jsonc_unpack(obj, "{si,ss !}", "code", &code, "value",
+                                  &value);
+        if (sts != 0) {
+            AFB_REQ_WARNING(request, "unexpected schema %s",
+                            rp_jsonc_get_error_string(sts));
+            sts = AFB_ERRNO_INVALID_REQUEST;
+        }
+        else {
+            wifiApT *wifi_ap_data = get_wifi(request);
+            sts = code < 0 ? WIFIAP_ERROR_TOO_SMALL
+                           : setDhcpOptionParameter(wifi_ap_data,
+                                                    (uint32_t)code, value);
+            switch (sts) {
+            case WIFIAP_NO_ERROR:
+                AFB_REQ_INFO(request, "DHCP option %d set to '%s'", code,
+                             value);
+                scheduleStateSave(afb_req_get_api(request));
+                break;
+            case WIFIAP_ERROR_FULL:
+                AFB_REQ_WARNING(request, "DHCP option table is full");
+                sts = AFB_USER_ERRNO(-sts);
+                break;
+            default:
+                AFB_REQ_WARNING(request, "invalid DHCP option %d '%s'", code,
+                                value);
+                sts = AFB_ERRNO_INVALID_REQUEST;
+                break;
+            }
+        }
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *               remove a DHCP option                                          *
+ ******************************************************************************/
+static void removeDhcpOption(afb_req_t request,
+                             unsigned nparams,
+                             afb_data_t const *params)
+{
+    single_uint32_set(request, nparams, params, "DHCP option",
+                      removeDhcpOptionParameter);
+}
+
+/*******************************************************************************
+ *        apply a change of the MAC access control to the running hostapd      *
+ *                                                                             *
+ * hostapd.conf and the lists are rewritten for the next reloads. The change   *
+ * is kept even if hostapd refuses it, it is then used at the next start.      *
+ ******************************************************************************/
+static void reply_mac_acl_change(afb_req_t request,
+                                 wifiApT *wifiApData,
+                                 const char *command)
+{
+    bool started;
+
+    pthread_mutex_lock(&status_mutex);
+    started = wifiApData->status == status_started;
+    pthread_mutex_unlock(&status_mutex);
+
+    if (started && (generate_hostapd_conf(wifiApData) != 0 ||
+                    hostapdRequest(wifiApData->interfaceName, command) != 0)) {
+        AFB_REQ_WARNING(request, "hostapd failed to apply '%s'", command);
+        reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                             "saved, but not applied");
+        return;
+    }
+    reply_request(request, 0, 0, NULL);
+}
+
+/*******************************************************************************
+ *               set the MAC access control policy ("deny" or "allow")         *
+ ******************************************************************************/
+static void setMacAclPolicy(afb_req_t request,
+                            unsigned nparams,
+                            afb_data_t const *params)
+{
+    const char *policy;
+    char command[32];
+
+    if (get_single_string(request, nparams, params, &policy)) {
+        wifiApT *wifi_ap_data = get_wifi(request);
+        if (setMacAclPolicyParameter(wifi_ap_data, policy) !=
+            WIFIAP_NO_ERROR) {
+            AFB_REQ_WARNING(request, "MAC access control policy invalid '%s'",
+                            policy);
+            reply_request(request, AFB_ERRNO_INVALID_REQUEST, 0, NULL);
+            return;
+        }
+        AFB_REQ_INFO(request, "MAC access control policy set to '%s'", policy);
+        scheduleStateSave(afb_req_get_api(request));
+
+        snprintf(command, sizeof(command), "SET macaddr_acl %d",
+                 (int)wifi_ap_data->acl.policy);
+        reply_mac_acl_change(request, wifi_ap_data, command);
+    }
+}
+
+/*******************************************************************************
+ *               add or remove a MAC address of an access control list         *
+ ******************************************************************************/
+static void change_mac_acl(afb_req_t request,
+                           unsigned nparams,
+                           afb_data_t const *params,
+                           bool add)
+{
+    json_object *obj;
+    const char *list, *mac;
+    char command[64];
+
+    if (get_single_jsonc(request, nparams, params, &obj)) {
+        int sts =
+            rp_jsonc_unpack(obj, "{ss,ss !}", "list", &list, "mac", &mac);
+        if (sts != 0) {
+            AFB_REQ_WARNING(request, "unexpected schema %s",
+                            rp_jsonc_get_error_string(sts));
+            reply_request(request, AFB_ERRNO_INVALID_REQUEST, 0, NULL);
+            return;
+        }
+
+        wifiApT *wifi_ap_data = get_wifi(request);
+        sts = add ? addMacAclParameter(wifi_ap_data, list, mac)
+                  : removeMacAclParameter(wifi_ap_data, list, mac);
+        switch (sts) {
+        case WIFIAP_NO_ERROR:
+            AFB_REQ_INFO(request, "MAC address %s %s the %s list", mac,
+                         add ? "added to" : "removed from", list);
+            scheduleStateSave(afb_req_get_api(request));
+            // hostapd also disconnects the stations no more allowed
+            snprintf(command, sizeof(command), "%s_ACL %s_MAC %s",
+                     strcasecmp(list, "allow") ? "DENY" : "ACCEPT",
+                     add ? "ADD" : "DEL", mac);
+            reply_mac_acl_change(request, wifi_ap_data, command);
+            return;
+        case WIFIAP_ERROR_FULL:
+            AFB_REQ_WARNING(request, "MAC %s list is full", list);
+            sts = AFB_USER_ERRNO(-sts);
+            break;
+        case WIFIAP_ERROR_NOT_FOUND:
+            AFB_REQ_WARNING(request, "MAC address %s not in the %s list", mac,
+                            list);
+            sts = AFB_USER_ERRNO(-sts);
+            break;
+        default:
+            AFB_REQ_WARNING(request, "invalid MAC list '%s' or address '%s'",
+                            list, mac);
+            sts = AFB_ERRNO_INVALID_REQUEST;
+            break;
+        }
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+static void addMacAcl(afb_req_t request,
+                      unsigned nparams,
+                      afb_data_t const *params)
+{
+    change_mac_acl(request, nparams, params, true);
+}
+
+static void removeMacAcl(afb_req_t request,
+                         unsigned nparams,
+                         afb_data_t const *params)
+{
+    change_mac_acl(request, nparams, params, false);
+}
+
+/*******************************************************************************
+ *               get the MAC access control policy and lists                   *
+ ******************************************************************************/
+static void getMacAcl(afb_req_t request,
+                      unsigned nparams,
+                      afb_data_t const *params)
+{
+    wifiApT *wifi_ap_data = get_wifi(request);
+    struct json_object *responseJ;
+
+    rp_jsonc_pack(&responseJ, "{ss,so,so}", "policy",
+                  wifi_ap_data->acl.policy == WIFI_AP_MAC_ACL_ALLOW ? "allow"
+                                                                    : "deny",
+                  "allow", macSetToJson(&wifi_ap_data->acl.allow), "deny",
+                  macSetToJson(&wifi_ap_data->acl.deny));
+    afb_data_t data = afb_data_json_c_hold(responseJ);
+    reply_request(request, 0, 1, &data);
+}
+
+/*******************************************************************************
+ *        set the rate limit of a station, or of the access point without mac  *
+ ******************************************************************************/
+static void setRateLimit(afb_req_t request,
+                         unsigned nparams,
+                         afb_data_t const *params)
+{
+    json_object *obj;
+    const char *mac = NULL;
+    bool started;
+    int kbps;
+
+    if (get_single_jsonc(request, nparams, params, &obj)) {
+        int sts =
+            rp_jsonc_unpack(obj, "{s?s,si !}", "mac", &mac, "kbps", &kbps);
+        if (sts != 0) {
+            AFB_REQ_WARNING(request, "unexpected schema %s",
+                            rp_jsonc_get_error_string(sts));
+            reply_request(request, AFB_ERRNO_INVALID_REQUEST, 0, NULL);
+            return;
+        }
+
+        wifiApT *wifi_ap_data = get_wifi(request);
+        sts = kbps < 0 ? WIFIAP_ERROR_TOO_SMALL
+                       : setRateLimitParameter(wifi_ap_data, mac,
+                                               (uint32_t)kbps);
+        switch (sts) {
+        case WIFIAP_NO_ERROR:
+            AFB_REQ_INFO(request, "rate limit of %s set to %d kbit/s",
+                         mac == NULL ? "the access point" : mac, kbps);
+            scheduleStateSave(afb_req_get_api(request));
+            pthread_mutex_lock(&status_mutex);
+            started = wifi_ap_data->status == status_started;
+            pthread_mutex_unlock(&status_mutex);
+            if (started && applyShaping(wifi_ap_data) != 0) {
+                reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                                     "saved, but not applied");
+                return;
+            }
+            break;
+        case WIFIAP_ERROR_FULL:
+            AFB_REQ_WARNING(request, "station rate limit table is full");
+            sts = AFB_USER_ERRNO(-sts);
+            break;
+        case WIFIAP_ERROR_NOT_FOUND:
+            AFB_REQ_WARNING(request, "station %s has no rate limit", mac);
+            sts = AFB_USER_ERRNO(-sts);
+            break;
+        default:
+            AFB_REQ_WARNING(request, "invalid rate limit %d for %s", kbps,
+                            mac == NULL ? "the access point" : mac);
+            sts = AFB_ERRNO_INVALID_REQUEST;
+            break;
+        }
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *        get the rate limits and the counters of their queues                 *
+ *                                                                             *
+ * The counters are the downlink ones (bytes, packets and drops of the HTB     *
+ * classes), they are given while the access point runs.                       *
+ ******************************************************************************/
+static void add_tc_counters(struct json_object *obj,
+                            const wifiApTcStatsT *stats,
+                            uint32_t minor)
+{
+    const wifiApTcClassT *tcClass =
+        stats == NULL ? NULL : findTcClass(stats, minor);
+
+    if (tcClass != NULL) {
+        json_object_object_add(obj, "bytes",
+                               json_object_new_int64((int64_t)tcClass->bytes));
+        json_object_object_add(
+            obj, "packets", json_object_new_int64((int64_t)tcClass->packets));
+        json_object_object_add(obj, "drops",
+                               json_object_new_int64((int64_t)tcClass->drops));
+    }
+}
+
+static void getRateLimits(afb_req_t request,
+                          unsigned nparams,
+                          afb_data_t const *params)
+{
+    wifiApT *wifi_ap_data = get_wifi(request);
+    struct json_object *responseJ, *stationsJ, *itemJ;
+    wifiApTcStatsT *stats = NULL;
+    char cmd[PATH_MAX];
+    bool started;
+    FILE *pipe;
+
+    pthread_mutex_lock(&status_mutex);
+    started = wifi_ap_data->status == status_started;
+    pthread_mutex_unlock(&status_mutex);
+
+    if (started && (wifi_ap_data->shaping.ssidKbps != 0 ||
+                    wifi_ap_data->shaping.stationCount != 0)) {
+        snprintf(cmd, sizeof(cmd), "%s %s %s", WIFI_SCRIPT,
+                 COMMAND_WIFIAP_TC_STATS, wifi_ap_data->interfaceName);
+        stats = malloc(sizeof(*stats));
+        pipe = stats == NULL ? NULL : open_command(PLATFORM_FIREWALL, cmd);
+        if (pipe == NULL || parseTcClassStats(pipe, stats) < 0) {
+            AFB_REQ_WARNING(request, "Unable to read the traffic counters");
+            free(stats);
+            stats = NULL;
+        }
+        if (pipe != NULL)
+            close_command(pipe);
+    }
+
+    rp_jsonc_pack(&responseJ, "{si}", "rateLimitKbps",
+                  (int)wifi_ap_data->shaping.ssidKbps);
+    add_tc_counters(responseJ, stats, SHAPING_SSID_CLASS);
+
+    stationsJ = json_object_new_array();
+    for (uint32_t i = 0; i < wifi_ap_data->shaping.stationCount; i++) {
+        const wifiAp_StationLimit_t *limit = &wifi_ap_data->shaping.stations[i];
+        rp_jsonc_pack(&itemJ, "{ss,si}", "mac", limit->mac, "kbps",
+                      (int)limit->kbps);
+        add_tc_counters(itemJ, stats, SHAPING_STATION_CLASS + i);
+        json_object_array_add(stationsJ, itemJ);
+    }
+    json_object_object_add(responseJ, "stations", stationsJ);
+    free(stats);
+
+    afb_data_t data = afb_data_json_c_hold(responseJ);
+    reply_request(request, 0, 1, &data);
+}
+
+/*******************************************************************************
+ *               set the band steering (keys not given are kept)               *
+ ******************************************************************************/
+static void setSteering(afb_req_t request,
+                        unsigned nparams,
+                        afb_data_t const *params)
+{
+    json_object *obj;
+    bool started, wasEnabled, enabled;
+    int sts;
+
+    if (get_single_jsonc(request, nparams, params, &obj)) {
+        wifiApT *wifi_ap_data = get_wifi(request);
+        // steeringJob copies the settings under the same lock
+        pthread_mutex_lock(&status_mutex);
+        wasEnabled = wifi_ap_data->steering.enabled;
+        sts = setSteeringFromJson(wifi_ap_data, obj);
+        enabled = wifi_ap_data->steering.enabled;
+        started = wifi_ap_data->status == status_started;
+        pthread_mutex_unlock(&status_mutex);
+        switch (sts) {
+        case WIFIAP_NO_ERROR:
+            AFB_REQ_INFO(request, "band steering %s",
+                         enabled ? "set" : "disabled");
+            scheduleStateSave(afb_req_get_api(request));
+            if (!started)
+                break;
+            startSteering(wifi_ap_data);
+            // the BSS transition is advertised from hostapd.conf
+            if (wasEnabled != enabled &&
+                (hostapdSet(wifi_ap_data->interfaceName, "bss_transition",
+                            enabled ? "1" : "0") ||
+                 hostapdRequest(wifi_ap_data->interfaceName,
+                                "UPDATE_BEACON"))) {
+                reply_request_string(request, AFB_ERRNO_INTERNAL_ERROR,
+                                     "saved, but not applied");
+                return;
+            }
+            break;
+        default:
+            AFB_REQ_WARNING(request, "invalid band steering settings");
+            sts = AFB_ERRNO_INVALID_REQUEST;
+            break;
+        }
+        reply_request(request, sts, 0, NULL);
+    }
+}
+
+/*******************************************************************************
+ *               get the band steering settings and counters                   *
  ******************************************************************************/
-static void SetPreSharedKey(afb_req_t request,
-                            unsigned nparams,
-                            afb_data_t const *params)
+static void getSteering(afb_req_t request,
+                        unsigned nparams,
+                        afb_data_t const *params)
 {
-    single_string_set(request, nparams, params, "preshared key",
-                      setPreSharedKeyParameter);
+    wifiApT *wifi_ap_data = get_wifi(request);
+    struct json_object *responseJ, *countersJ;
+
+    pthread_mutex_lock(&steering_mutex);
+    rp_jsonc_pack(&countersJ, "{sI,sI,sI,sI,sI,si,si}", "evaluations",
+                  (int64_t)steeringState.evaluations, "requests",
+                  (int64_t)steeringState.requests, "failures",
+                  (int64_t)steeringState.failures, "moved",
+                  (int64_t)steeringState.moved, "stayed",
+                  (int64_t)steeringState.stayed, "clients",
+                  (int)steeringState.clients, "pending",
+                  (int)steeringState.pendingCount);
+    pthread_mutex_unlock(&steering_mutex);
+
+    pthread_mutex_lock(&status_mutex);
+    responseJ = steeringToJson(&wifi_ap_data->steering);
+    pthread_mutex_unlock(&status_mutex);
+    json_object_object_add(responseJ, "counters", countersJ);
+    afb_data_t data = afb_data_json_c_hold(responseJ);
+    reply_request(request, 0, 1, &data);
 }
 
 /*******************************************************************************
- *               set the country code to use for access point                  *
+ *        serialize the metrics: an object per family, by label value          *
+ *                                                                             *
+ * A counter is its value, a histogram is its count, sum, max and quantiles    *
+ * in microseconds.                                                            *
  ******************************************************************************/
+static struct json_object *metric_to_json(const metricT *metric)
+{
+    metricSummaryT summary;
+    struct json_object *valueJ;
+
+    summarizeMetric(metric, &summary);
+    if (metric->type == METRIC_COUNTER)
+        return json_object_new_int64((int64_t)summary.count);
+    rp_jsonc_pack(&valueJ, "{sI,sI,sI,sI,sI,sI}", "count",
+                  (int64_t)summary.count, "sumUs", (int64_t)summary.sumUs,
+                  "maxUs", (int64_t)summary.maxUs, "p50Us",
+                  (int64_t)summary.p50Us, "p90Us", (int64_t)summary.p90Us,
+                  "p99Us", (int64_t)summary.p99Us);
+    return valueJ;
+}
 
-static void setCountryCode(afb_req_t request,
-                           unsigned nparams,
-                           afb_data_t const *params)
+static struct json_object *metrics_to_json(void)
 {
-    single_string_set(request, nparams, params, "country code",
-                      setCountryCodeParameter);
+    struct json_object *metricsJ = json_object_new_object(), *familyJ;
+
+    for (const metricT *metric = listMetrics(); metric != NULL;
+         metric = nextMetric(metric)) {
+        if (metric->labelName == NULL) {
+            json_object_object_add(metricsJ, metric->name,
+                                   metric_to_json(metric));
+            continue;
+        }
+        if (!json_object_object_get_ex(metricsJ, metric->name, &familyJ)) {
+            familyJ = json_object_new_object();
+            json_object_object_add(metricsJ, metric->name, familyJ);
+        }
+        json_object_object_add(familyJ, metric->labelValue,
+                               metric_to_json(metric));
+    }
+    return metricsJ;
 }
 
 /*******************************************************************************
- *               set the max number of clients of access point                 *
+ *        get the metrics, as JSON (default) or as OpenMetrics text            *
  ******************************************************************************/
-
-static void SetMaxNumberClients(afb_req_t request,
-                                unsigned nparams,
-                                afb_data_t const *params)
+static void getMetrics(afb_req_t request,
+                       unsigned nparams,
+                       afb_data_t const *params)
 {
-    single_uint32_set(request, nparams, params, "maximum number of clients",
-                      setMaxNumberClients);
+    const char *format = "json";
+    afb_data_t data;
+    char *text = NULL;
+    size_t length = 0;
+    FILE *output;
+
+    if (nparams != 0 && !get_single_string(request, nparams, params, &format))
+        return;
+
+    if (strcasecmp(format, "json") == 0) {
+        data = afb_data_json_c_hold(metrics_to_json());
+        reply_request(request, 0, 1, &data);
+        return;
+    }
+    if (strcasecmp(format, "openmetrics") != 0) {
+        reply_invalid_params(request, "\"json\" or \"openmetrics\"");
+        return;
+    }
+
+    output = open_memstream(&text, &length);
+    if (output == NULL || writeOpenMetrics(output) != 0) {
+        if (output != NULL)
+            fclose(output);
+        free(text);
+        reply_request_string(request, AFB_ERRNO_OUT_OF_MEMORY,
+                             "Out of memory");
+        return;
+    }
+    fclose(output);
+    afb_create_data_raw(&data, AFB_PREDEFINED_TYPE_STRINGZ, text, length + 1,
+                        free, text);
+    reply_request(request, 0, 1, &data);
 }
 
 /*******************************************************************************
- *     Set the access point IP address and client IP  addresses rang           *
+ *        get the last records of the diagnostics, the oldest first            *
+ *                                                                             *
+ * The optional parameter is the number of records (all by default).           *
  ******************************************************************************/
-static void setIpRange(afb_req_t request,
-                       unsigned nparams,
-                       afb_data_t const *params)
+static void getDiagnostics(afb_req_t request,
+                           unsigned nparams,
+                           afb_data_t const *params)
 {
-    json_object *obj;
-    if (get_single_jsonc(request, nparams, params, &obj)) {
-        const char *ip_ap, *ip_start, *ip_stop, *ip_netmask;
-        int sts = rp_jsonc_unpack(obj, "{ss,ss,ss,ss !}", "ip_ap", &ip_ap,
-                                  "ip_start", &ip_start, "ip_stop", &ip_stop,
-                                  "ip_netmask", &ip_netmask);
-        if (sts != 0) {
-            AFB_REQ_WARNING(request, "unexpected schema %s",
-                            rp_jsonc_get_error_string(sts));
-            sts = AFB_ERRNO_INVALID_REQUEST;
-        }
-        else {
-            wifiApT *wifi_ap_data = get_wifi(request);
-            sts = setIpRangeParameters(wifi_ap_data, ip_ap, ip_start, ip_stop,
-                                       ip_netmask);
-            if (sts == WIFIAP_NO_ERROR) {
-                AFB_REQ_INFO(request, "IP range set successfully");
-                sts = 0;
-            }
-            else {
-                switch (sts) {
-                case WIFIAP_ERROR_TOO_SMALL:
-                case WIFIAP_ERROR_TOO_LARGE:
-                    AFB_REQ_WARNING(
-                        request, "one of IP range value is too %s",
-                        sts == WIFIAP_ERROR_TOO_SMALL ? "small" : "large");
-                    break;
-                default:
-                    AFB_REQ_WARNING(request,
-                                    "can't set IP range, internal error");
-                    break;
-                }
-                sts = AFB_USER_ERRNO(-sts);
-            }
-        }
-        afb_req_reply(request, sts, 0, NULL);
+    uint32_t count = DIAG_RING_SIZE;
+    struct json_object *recordsJ, *recordJ;
+    diagRecordT *records;
+    char date[40];
+    struct tm tm;
+    time_t seconds;
+    unsigned copied;
+
+    if (nparams != 0 && !get_single_uint32(request, nparams, params, &count))
+        return;
+
+    records = malloc(DIAG_RING_SIZE * sizeof(*records));
+    if (records == NULL) {
+        reply_request_string(request, AFB_ERRNO_OUT_OF_MEMORY,
+                             "Out of memory");
+        return;
     }
+    copied = readDiagRecords(records, count);
+
+    recordsJ = json_object_new_array();
+    for (unsigned i = 0; i < copied; i++) {
+        seconds = (time_t)(records[i].timeUs / 1000000);
+        gmtime_r(&seconds, &tm);
+        snprintf(date, sizeof(date), "%04d-%02d-%02dT%02d:%02d:%02d.%06uZ",
+                 tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour,
+                 tm.tm_min, tm.tm_sec,
+                 (unsigned)(records[i].timeUs % 1000000));
+        rp_jsonc_pack(&recordJ, "{sI,ss,ss,ss,si,ss}", "sequence",
+                      (int64_t)records[i].sequence, "time", date, "subsystem",
+                      getDiagSubsystemName(records[i].subsystem), "code",
+                      getDiagCodeName(records[i].code), "status",
+                      (int)records[i].status, "payload", records[i].payload);
+        json_object_array_add(recordsJ, recordJ);
+    }
+    free(records);
+
+    afb_data_t data = afb_data_json_c_hold(recordsJ);
+    reply_request(request, 0, 1, &data);
 }
 
 /*******************************************************************************
@@ -1327,7 +3125,7 @@ static void info(afb_req_t request, unsigned nparams, afb_data_t const *params)
     afb_create_data_raw(&repldata, AFB_PREDEFINED_TYPE_JSON, info, sizeof info,
                         NULL, NULL);
 
-    afb_req_reply(request, 0, 1, &repldata);
+    reply_request(request, 0, 1, &repldata);
 }
 
 /*******************************************************************************
@@ -1346,6 +3144,12 @@ static const afb_verb_t verbs[] = {
     }, {
             .verb = "restart", .callback = restart,
             .info = "restart the WiFi access point service"
+    }, {
+            .verb = "rescanChannel", .callback = rescanChannel,
+            .info = "survey the channels and move to the least loaded one"
+    }, {
+            .verb = "reloadConfig", .callback = reloadConfig,
+            .info = "reload the configuration file and apply what changed"
     },
     /************* SUBSCRIPTION *****************/
     {
@@ -1365,6 +3169,9 @@ static const afb_verb_t verbs[] = {
     }, {
             .verb = "getWifiApStatus", .callback = getWifiApStatus,
             .info = "Get the status of the Wifi access point"
+    }, {
+            .verb = "getRadioCapabilities", .callback = getRadioCapabilities,
+            .info = "Get the bands, channels and capabilities of the radio"
     },
     /************* SETTERS *****************/
     {
@@ -1407,6 +3214,95 @@ static const afb_verb_t verbs[] = {
             .verb = "SetMaxNumberClients", .callback = SetMaxNumberClients,
             .info = "Set the maximum number of clients connected at the same time"
     },
+    /************* RADIO SETTERS *****************/
+    {
+            .verb = "setAutoChannel", .callback = setAutoChannel,
+            .info = "set the automatic channel selection (off, acs_survey, survey)"
+    }, {
+            .verb = "setBeaconInterval", .callback = setBeaconInterval,
+            .info = "set the beacon interval in time units (1.024 ms)"
+    }, {
+            .verb = "setDtimPeriod", .callback = setDtimPeriod,
+            .info = "set the DTIM period in number of beacons"
+    }, {
+            .verb = "setRtsThreshold", .callback = setRtsThreshold,
+            .info = "set the RTS/CTS threshold in octets"
+    }, {
+            .verb = "setFragmThreshold", .callback = setFragmThreshold,
+            .info = "set the fragmentation threshold in octets"
+    }, {
+            .verb = "setWmmEnabled", .callback = setWmmEnabled,
+            .info = "set if WMM (QoS) is enabled"
+    }, {
+            .verb = "setChannelWidth", .callback = setChannelWidth,
+            .info = "set the channel width in MHz (20, 40, 80 or 160)"
+    }, {
+            .verb = "setHtCapab", .callback = setHtCapab,
+            .info = "set the extra HT capabilities"
+    }, {
+            .verb = "setVhtCapab", .callback = setVhtCapab,
+            .info = "set the extra VHT capabilities"
+    },
+    /************* DHCP SETTERS *****************/
+    {
+            .verb = "setDhcpLeaseTime", .callback = setDhcpLeaseTime,
+            .info = "set the DHCP lease time in seconds"
+    }, {
+            .verb = "setDhcpAuthoritative", .callback = setDhcpAuthoritative,
+            .info = "set if the DHCP server is the only one on the network"
+    }, {
+            .verb = "setDhcpRapidCommit", .callback = setDhcpRapidCommit,
+            .info = "set if the DHCP server answers with rapid commit"
+    }, {
+            .verb = "setDnsCacheSize", .callback = setDnsCacheSize,
+            .info = "set the size of the DNS cache"
+    }, {
+            .verb = "addDhcpStaticLease", .callback = addDhcpStaticLease,
+            .info = "reserve an IP address for a MAC address"
+    }, {
+            .verb = "removeDhcpStaticLease", .callback = removeDhcpStaticLease,
+            .info = "remove the IP address reservation of a MAC address"
+    }, {
+            .verb = "setDhcpOption", .callback = setDhcpOption,
+            .info = "add or replace a DHCP option sent to the clients"
+    }, {
+            .verb = "removeDhcpOption", .callback = removeDhcpOption,
+            .info = "remove a DHCP option"
+    },
+    /************* ADMISSION AND SHAPING *****************/
+    {
+            .verb = "setMacAclPolicy", .callback = setMacAclPolicy,
+            .info = "accept the stations of the allow list only, or all but the deny list"
+    }, {
+            .verb = "addMacAcl", .callback = addMacAcl,
+            .info = "add a MAC address to the allow or deny list"
+    }, {
+            .verb = "removeMacAcl", .callback = removeMacAcl,
+            .info = "remove a MAC address from the allow or deny list"
+    }, {
+            .verb = "getMacAcl", .callback = getMacAcl,
+            .info = "get the MAC access control policy and lists"
+    }, {
+            .verb = "setRateLimit", .callback = setRateLimit,
+            .info = "set the rate limit of a station, or of the access point"
+    }, {
+            .verb = "getRateLimits", .callback = getRateLimits,
+            .info = "get the rate limits and their traffic counters"
+    }, {
+            .verb = "setSteering", .callback = setSteering,
+            .info = "set the band steering of the stations to the other radios"
+    }, {
+            .verb = "getSteering", .callback = getSteering,
+            .info = "get the band steering settings and counters"
+    },
+    /************* METRICS *****************/
+    {
+            .verb = "getMetrics", .callback = getMetrics,
+            .info = "get the counters and latency histograms, as json or openmetrics"
+    }, {
+            .verb = "getDiagnostics", .callback = getDiagnostics,
+            .info = "get the last records of the diagnostics, the oldest first"
+    },
     /************ INFO *****************/
     {
             .verb = "info", .callback = info,
@@ -1419,44 +3315,182 @@ static const afb_verb_t verbs[] = {
 };
 // clang-format on
 
+/*******************************************************************************
+ *        redact the secrets of the arguments of a call                        *
+ ******************************************************************************/
+static bool is_listed(const char *name, const char *const *names, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (strcmp(name, names[i]) == 0)
+            return true;
+    }
+    return false;
+}
+
+static void redact_secrets(struct json_object *obj)
+{
+    if (json_object_is_type(obj, json_type_array)) {
+        for (size_t i = 0; i < json_object_array_length(obj); i++)
+            redact_secrets(json_object_array_get_idx(obj, i));
+    }
+    else if (json_object_is_type(obj, json_type_object)) {
+        json_object_object_foreach(obj, key, value)
+        {
+            if (is_listed(key, secretKeys,
+                          sizeof secretKeys / sizeof *secretKeys))
+                json_object_object_add(obj, key,
+                                       json_object_new_string(REDACTED));
+            else
+                redact_secrets(value);
+        }
+    }
+}
+
+/*******************************************************************************
+ *        log a slow call of a verb, with its arguments and its reply          *
+ ******************************************************************************/
+static void log_slow_call(afb_req_t request,
+                          const afb_verb_t *verb,
+                          unsigned nparams,
+                          const verbCallT *call,
+                          uint64_t durationUs)
+{
+    bool secret = is_listed(verb->verb, secretVerbs,
+                            sizeof secretVerbs / sizeof *secretVerbs);
+    struct json_object *argsJ = json_object_new_array(), *argJ;
+    char status[32];
+    afb_data_t data;
+
+    for (unsigned i = 0; i < nparams; i++) {
+        argJ = NULL;
+        if (secret)
+            argJ = json_object_new_string(REDACTED);
+        else if (afb_req_param_convert(request, i, AFB_PREDEFINED_TYPE_JSON_C,
+                                       &data) == 0 &&
+                 json_object_deep_copy(
+                     (struct json_object *)afb_data_ro_pointer(data), &argJ,
+                     NULL) == 0)
+            redact_secrets(argJ);
+        json_object_array_add(argsJ, argJ);
+    }
+
+    if (call->replied)
+        snprintf(status, sizeof(status), "status %d", call->status);
+    else
+        snprintf(status, sizeof(status), "reply pending");
+    AFB_REQ_WARNING(request, "slow call of %s: %llu ms (%s), arguments %s",
+                    verb->verb, (unsigned long long)(durationUs / 1000), status,
+                    json_object_to_json_string(argsJ));
+    json_object_put(argsJ);
+}
+
+/*******************************************************************************
+ *        call a verb of the table, measuring the duration of its callback     *
+ *                                                                             *
+ * The verbs replying later (from a job) are measured until they return, their *
+ * errors are counted when they reply.                                         *
+ ******************************************************************************/
+static void metered_verb(afb_req_t request,
+                         unsigned nparams,
+                         afb_data_t const *params)
+{
+    const meteredVerbT *metered = afb_req_get_vcbdata(request);
+    verbCallT call = {.request = request}, *outerCall = currentVerbCall;
+    uint64_t startUs = metricNowUs(), durationUs;
+
+    currentVerbCall = &call;
+    if (metered->locked)
+        pthread_mutex_lock(&reload_mutex);
+    metered->verb->callback(request, nparams, params);
+    if (metered->locked)
+        pthread_mutex_unlock(&reload_mutex);
+    currentVerbCall = outerCall;
+
+    durationUs = metricNowUs() - startUs;
+    metricObserve(metered->duration, durationUs);
+    if (slowVerbMs != 0 && durationUs >= (uint64_t)slowVerbMs * 1000)
+        log_slow_call(request, metered->verb, nparams, &call, durationUs);
+}
+
+/*******************************************************************************
+ *        create the metrics and add the verbs of the table, metered           *
+ ******************************************************************************/
+static int create_metrics(afb_api_t api)
+{
+    unsigned count = 0;
+
+    for (unsigned i = 0; i < START_PHASE_COUNT; i++)
+        startPhaseMetrics[i] = createMetric(
+            METRIC_HISTOGRAM, "wifiap_start_phase_duration_seconds",
+            "Duration of the phases of the starts of the access point.",
+            "phase", start_phase_name(i));
+    apReadyMetric = createMetric(
+        METRIC_HISTOGRAM, "wifiap_ap_ready_duration_seconds",
+        "Duration from the start of the access point to its beacons.", NULL,
+        NULL);
+    for (unsigned i = 0; i < EVENT_COUNT; i++) {
+        eventPublishedMetrics[i] =
+            createMetric(METRIC_COUNTER, "wifiap_events_published",
+                         "Events received by subscribers.", "event",
+                         eventNames[i]);
+        eventDroppedMetrics[i] =
+            createMetric(METRIC_COUNTER, "wifiap_events_dropped",
+                         "Events without subscriber or not pushed.", "event",
+                         eventNames[i]);
+    }
+    systemSpawnMetric =
+        createMetric(METRIC_COUNTER, "wifiap_subprocess_spawns",
+                     "Commands run by the binding.", "call", "system");
+    popenSpawnMetric =
+        createMetric(METRIC_COUNTER, "wifiap_subprocess_spawns",
+                     "Commands run by the binding.", "call", "popen");
+    for (unsigned i = 0; i < CONFIG_FILE_COUNT; i++)
+        configWriteMetrics[i] = createMetric(
+            METRIC_COUNTER, "wifiap_config_writes",
+            "Configuration and state files written.", "file",
+            configFileNames[i]);
+    stationConnectMetric =
+        createMetric(METRIC_COUNTER, "wifiap_station_connects",
+                     "Stations connected to the access point.", NULL, NULL);
+    stationDisconnectMetric = createMetric(
+        METRIC_COUNTER, "wifiap_station_disconnects",
+        "Stations disconnected from the access point.", NULL, NULL);
+
+    while (verbs[count].verb != NULL)
+        count++;
+    meteredVerbs = calloc(count, sizeof(*meteredVerbs));
+    if (meteredVerbs == NULL)
+        return -1;
+
+    for (unsigned i = 0; i < count; i++) {
+        const afb_verb_t *verb = &verbs[i];
+
+        meteredVerbs[i].verb = verb;
+        meteredVerbs[i].locked =
+            !is_listed(verb->verb, unlockedVerbs,
+                       sizeof unlockedVerbs / sizeof *unlockedVerbs);
+        meteredVerbs[i].duration = createMetric(
+            METRIC_HISTOGRAM, "wifiap_verb_duration_seconds",
+            "Duration of the verb callbacks.", "verb", verb->verb);
+        meteredVerbs[i].errors =
+            createMetric(METRIC_COUNTER, "wifiap_verb_errors",
+                         "Replies of the verbs with an error.", "verb",
+                         verb->verb);
+        if (afb_api_add_verb(api, verb->verb, verb->info, metered_verb,
+                             &meteredVerbs[i], verb->auth, verb->session,
+                             verb->glob) < 0) {
+            AFB_API_ERROR(api, "Unable to add the verb %s", verb->verb);
+            return -1;
+        }
+    }
+    return 0;
+}
+
 /*******************************************************************************
  *                                             Create a wifiApData from JSON-C *
  ******************************************************************************/
 static wifiApT *createWifiApData(afb_api_t api, struct json_object *obj)
 {
-    static struct
-    {
-        const char *key;
-        bool mandatory;
-        char type;
-        union {
-            int (*set_s)(wifiApT *, const char *);
-            int (*set_u)(wifiApT *, uint32_t);
-            int (*set_b)(wifiApT *, bool);
-        };
-    }
-    // clang-format off
-    descs[] = {
-        { "interfaceName",     true, 's', { .set_s = setInterfaceNameParameter }},
-        { "domaine_name",      true, 's', { .set_s = setDomainNameParameter }},
-        { "hostname",          true, 's', { .set_s = setHostNameParameter }},
-        { "ssid",              true, 's', { .set_s = setSsidParameter }},
-        { "passphrase",        true, 's', { .set_s = setPassPhraseParameter }},
-        { "preSharedKey",     false, 's', { .set_s = setPassPhraseParameter }},
-        { "countryCode",       true, 's', { .set_s = setCountryCodeParameter }},
-        { "securityProtocol",  true, 's', { .set_s = setSecurityProtocolParameter }},
-        { "ip_ap",             true, 's', { .set_s = setIpApParameter }},
-        { "ip_start",          true, 's', { .set_s = setIpStartParameter }},
-        { "ip_stop",           true, 's', { .set_s = setIpStopParameter }},
-        { "ip_netmask",        true, 's', { .set_s = setIpNetMaskParameter }},
-        { "discoverable",      true, 'b', { .set_b = setDiscoverableParameter }},
-        { "maxNumberClient",   true, 'u', { .set_u = setMaxNumberClients }},
-        { "IeeeStdMask",       true, 'u', { .set_u = setIeeeStandardParameter }},
-        { "channelNumber",     true, 'u', { .set_u = setChannelParameter }}
-    };
-    // clang-format on
-
-    int idx, err;
     wifiApT *wifiApData;
 
     wifiApData = (wifiApT *)calloc(1, sizeof(wifiApT));
@@ -1466,90 +3500,130 @@ static wifiApT *createWifiApData(afb_api_t api, struct json_object *obj)
     }
 
     /* init */
-    err = 0;
     wifiApData->status = status_init;
+    initWifiApData(wifiApData);
 
     /* set */
-    for (idx = 0; idx < (int)(sizeof descs / sizeof *descs); idx++) {
-        struct json_object *val;
-        const char *key = descs[idx].key;
-        if (!json_object_object_get_ex(obj, key, &val)) {
-            if (descs[idx].mandatory) {
-                AFB_API_ERROR(api, "can't find key '%s' in config", key);
-                err++;
-            }
+    if (setWifiApDataFromJson(wifiApData, obj) == 0) {
+        // the events are created once, the configuration may be reloaded
+        if ((client_state_event != NULL ||
+             afb_api_new_event(api, client_state_event_name,
+                               &client_state_event) >= 0) &&
+            (ap_ready_event != NULL ||
+             afb_api_new_event(api, ap_ready_event_name, &ap_ready_event) >=
+                 0))
+            return wifiApData;
+        AFB_API_ERROR(api, "creation of event failed");
+    }
+
+    deleteWifiApData(wifiApData);
+    return NULL;
+}
+
+/*******************************************************************************
+ *        read the scheduling settings of a kind of threads from the config    *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if the settings are valid or absent, -1 otherwise                    *
+ ******************************************************************************/
+static int read_thread_settings(afb_api_t api,
+                                struct json_object *threads,
+                                const char *key,
+                                bool realtime,
+                                threadSettingsT *settings)
+{
+    struct json_object *subsystem, *obj;
+
+    if (!json_object_object_get_ex(threads, key, &subsystem))
+        return 0;
+
+    if (json_object_object_get_ex(subsystem, "priority", &obj)) {
+        int priority = json_object_is_type(obj, json_type_string)
+                           ? parseThreadPriority(json_object_get_string(obj))
+                           : -1;
+        if (priority < 0 || (!realtime && priority >= THREAD_PRIORITY_COUNT)) {
+            AFB_API_ERROR(api, "invalid priority for the %s threads", key);
+            return -1;
         }
-        else {
-            switch (descs[idx].type) {
-            case 's':
-                if (!json_object_is_type(val, json_type_string)) {
-                    AFB_API_ERROR(api, "key '%s' in config should be a string",
-                                  key);
-                    err++;
-                }
-                else {
-                    const char *s = json_object_get_string(val);
-                    int sts = descs[idx].set_s(wifiApData, s);
-                    if (sts != WIFIAP_NO_ERROR) {
-                        AFB_API_ERROR(
-                            api, "invalid value for key '%s' in config", key);
-                        err++;
-                    }
-                }
-                break;
+        settings->priority = priority;
+    }
 
-            case 'b':
-                if (!json_object_is_type(val, json_type_boolean)) {
-                    AFB_API_ERROR(api, "key '%s' in config should be a boolean",
-                                  key);
-                    err++;
-                }
-                else {
-                    bool b = json_object_get_boolean(val);
-                    int sts = descs[idx].set_b(wifiApData, b);
-                    if (sts != WIFIAP_NO_ERROR) {
-                        AFB_API_ERROR(
-                            api, "invalid value for key '%s' in config", key);
-                        err++;
-                    }
-                }
-                break;
+    if (json_object_object_get_ex(subsystem, "rtPriority", &obj)) {
+        if (!json_object_is_type(obj, json_type_int) ||
+            json_object_get_int(obj) < sched_get_priority_min(SCHED_FIFO) ||
+            json_object_get_int(obj) > sched_get_priority_max(SCHED_FIFO)) {
+            AFB_API_ERROR(api, "invalid rtPriority for the %s threads", key);
+            return -1;
+        }
+        settings->rtPriority = json_object_get_int(obj);
+    }
 
-            case 'u':
-                if (!json_object_is_type(val, json_type_int)) {
-                    AFB_API_ERROR(
-                        api, "key '%s' in config should be an integer", key);
-                    err++;
-                }
-                else {
-                    int64_t x = json_object_get_int64(val);
-                    int sts = x < 0 ? WIFIAP_ERROR_TOO_SMALL
-                              : x > UINT32_MAX
-                                  ? WIFIAP_ERROR_TOO_LARGE
-                                  : descs[idx].set_u(wifiApData, (uint32_t)x);
-                    if (sts != WIFIAP_NO_ERROR) {
-                        AFB_API_ERROR(
-                            api, "invalid value for key '%s' in config", key);
-                        err++;
-                    }
-                }
-                break;
-            }
+    if (json_object_object_get_ex(subsystem, "cpus", &obj)) {
+        if (!json_object_is_type(obj, json_type_string) ||
+            (json_object_get_string_len(obj) != 0 &&
+             parseThreadCpuList(json_object_get_string(obj),
+                                &settings->cpus) != 0)) {
+            AFB_API_ERROR(api, "invalid cpus for the %s threads", key);
+            return -1;
         }
+        settings->hasCpus = json_object_get_string_len(obj) != 0;
     }
+    return 0;
+}
 
-    if (err == 0) {
-        if (afb_api_new_event(api, client_state_event_name,
-                              &client_state_event) >= 0)
-            return wifiApData;
-        AFB_API_ERROR(api, "creation of event failed");
+/*******************************************************************************
+ *        load the state file over the settings of the configuration file      *
+ *                                                                             *
+ * @return                                                                     *
+ *      true if settings were read from the state file                         *
+ ******************************************************************************/
+static bool merge_state_file(afb_api_t api, struct json_object *config)
+{
+    struct json_object *stateJ;
+    char *content;
+    int rc;
+
+    // a missing state file is normal on the first boot
+    rc = readPlatformFile(stateFile, STATE_FILE_SIZE, &content);
+    if (rc == -ENOENT)
+        return false;
+
+    stateJ = rc == 0 ? json_tokener_parse(content) : NULL;
+    if (rc == 0)
+        free(content);
+    if (stateJ == NULL || !json_object_is_type(stateJ, json_type_object)) {
+        AFB_API_WARNING(api, "Ignoring the invalid state file %s", stateFile);
+        json_object_put(stateJ);
+        return false;
     }
 
-    free(wifiApData->interfaceName);
-    free(wifiApData->domainName);
-    free(wifiApData->hostName);
-    free(wifiApData);
-    return NULL;
+    json_object_object_foreach(stateJ, key, val)
+        json_object_object_add(config, key, json_object_get(val));
+    json_object_put(stateJ);
+    AFB_API_NOTICE(api, "Settings restored from %s", stateFile);
+    return true;
+}
+
+/*******************************************************************************
+ *        start the access point in the background (fastBoot)                  *
+ ******************************************************************************/
+static void fastBootJob(int signum, void *arg)
+{
+    wifiApT *wifiApData = arg;
+
+    if (signum != 0) {
+        AFB_ERROR("Fast boot interrupted (signal %d)", signum);
+        pthread_mutex_lock(&status_mutex);
+        wifiApData->status = status_fail;
+        pthread_mutex_unlock(&status_mutex);
+        return;
+    }
+
+    // no reload of the configuration while starting
+    pthread_mutex_lock(&reload_mutex);
+    if (startAp(wifiApData) < 0)
+        AFB_ERROR("Fast boot failed to start the WiFi AP");
+    pthread_mutex_unlock(&reload_mutex);
 }
 
 /*******************************************************************************
@@ -1561,44 +3635,160 @@ static int binding_ctl(afb_api_t api,
                        void *userdata)
 {
     switch (ctlid) {
+    case afb_ctlid_Pre_Init:
+        // the verbs of the table are added with their metrics
+        if (create_metrics(api) != 0)
+            return -1;
+        break;
+
     case afb_ctlid_Init: {
         wifiApT *wifiApData;
-        bool start;
+        bool start, fastBoot, watch, restored;
         struct json_object *root, *config, *obj;
 
         AFB_API_NOTICE(api, "Binding start ...");
+        clock_gettime(CLOCK_MONOTONIC, &bootStartTime);
 
-        // Reading the JSON file
-        root = json_object_from_file(PATH_CONFIG_FILE);
-        if (!root) {
-            AFB_API_ERROR(api, "Failed to read config file %s",
-                          PATH_CONFIG_FILE);
-            return -1;
-        }
+        // another configuration file (tests, several instances)
+        const char *file = getenv("WIFIAP_CONFIG_FILE");
+        if (file != NULL && *file != '\0')
+            configFile = file;
 
-        // Accessing the config section
-        if (!json_object_object_get_ex(root, "config", &config)) {
-            AFB_API_ERROR(api, "No 'config' section in JSON file");
-            json_object_put(root);
+        // Reading the config section of the JSON file
+        config = read_config_file(api, &root);
+        if (config == NULL)
             return -1;
-        }
 
         // retrieve startAtInit value
         start = json_object_object_get_ex(config, "startAtInit", &obj) &&
                 json_object_is_type(obj, json_type_boolean) &&
                 json_object_get_boolean(obj);
 
+        // retrieve fastBoot value: start in the background (default false)
+        fastBoot = json_object_object_get_ex(config, "fastBoot", &obj) &&
+                   json_object_is_type(obj, json_type_boolean) &&
+                   json_object_get_boolean(obj);
+
+        // retrieve watchConfig value (default true)
+        watch = !json_object_object_get_ex(config, "watchConfig", &obj) ||
+                !json_object_is_type(obj, json_type_boolean) ||
+                json_object_get_boolean(obj);
+
+        // retrieve the duration of the calls to log (0 disables it)
+        if (json_object_object_get_ex(config, "slowVerbMs", &obj)) {
+            if (!json_object_is_type(obj, json_type_int) ||
+                json_object_get_int64(obj) < 0 ||
+                json_object_get_int64(obj) > UINT32_MAX) {
+                AFB_API_ERROR(api, "Invalid slowVerbMs");
+                json_object_put(root);
+                return -1;
+            }
+            slowVerbMs = (unsigned)json_object_get_int64(obj);
+        }
+
+        // retrieve the scheduling settings of the threads
+        if (json_object_object_get_ex(config, "threads", &obj) &&
+            (read_thread_settings(api, obj, "events", true,
+                                  &eventThreadSettings) ||
+             read_thread_settings(api, obj, "workers", false,
+                                  &workerThreadSettings))) {
+            json_object_put(root);
+            return -1;
+        }
+
+        // retrieve the platform: "system" (default) or "fake", in memory
+        if (json_object_object_get_ex(config, "platform", &obj)) {
+            const char *platform = json_object_get_string(obj);
+
+            if (platform != NULL && strcmp(platform, "fake") == 0) {
+                AFB_API_WARNING(api, "Fake platform: nothing is configured");
+                setPlatform(getFakePlatform());
+            }
+            else if (platform == NULL || strcmp(platform, "system") != 0) {
+                AFB_API_ERROR(api, "Invalid platform");
+                json_object_put(root);
+                return -1;
+            }
+        }
+
+        // retrieve the cache of the generated files (optional), in memory
+        // with the fake platform
+        if (json_object_object_get_ex(config, "cacheDir", &obj) &&
+            json_object_is_type(obj, json_type_string) &&
+            json_object_get_string_len(obj) != 0) {
+            cacheDir = strdup(json_object_get_string(obj));
+            if (cacheDir == NULL) {
+                json_object_put(root);
+                return -1;
+            }
+            apStart.cacheDir = cacheDir;
+            // the key derived from the passphrase is kept there too
+            setWpaPskCacheDir(cacheDir);
+        }
+
+        // retrieve the state file keeping the runtime changes (optional)
+        if (json_object_object_get_ex(config, "stateFile", &obj) &&
+            json_object_is_type(obj, json_type_string) &&
+            json_object_get_string_len(obj) != 0) {
+            stateFile = strdup(json_object_get_string(obj));
+            if (stateFile == NULL) {
+                json_object_put(root);
+                return -1;
+            }
+        }
+
+        restored = stateFile != NULL && merge_state_file(api, config);
         wifiApData = createWifiApData(api, config);
         json_object_put(root);  // Free the JSON memory
+        if (wifiApData == NULL && restored) {
+            // the state may be from an older release, fallback to the file
+            AFB_API_WARNING(api, "Invalid state file %s, not used", stateFile);
+            config = read_config_file(api, &root);
+            if (config == NULL)
+                return -1;
+            wifiApData = createWifiApData(api, config);
+            json_object_put(root);
+        }
         if (wifiApData == NULL)
             return -1;
 
         afb_api_set_userdata(api, wifiApData);
-        AFB_API_NOTICE(api, "Initialization finished");
 
-        if (start && startAp(wifiApData) < 0)
+        wifiApPool = createThreadPool("WifiApWorker", WIFIAP_POOL_WORKERS,
+                                      WIFIAP_POOL_QUEUE_SIZE);
+        if (wifiApPool == NULL)
+            AFB_API_WARNING(api, "No worker pool, long requests will block");
+        else if (workerThreadSettings.hasCpus &&
+                 setThreadPoolAffinity(wifiApPool, &workerThreadSettings.cpus))
+            AFB_API_WARNING(api, "Unable to set the CPU affinity of the workers");
+
+        if (start && fastBoot) {
+            // the settings are valid, hostapd is started after the init
+            pthread_mutex_lock(&status_mutex);
+            wifiApData->status = status_starting;
+            pthread_mutex_unlock(&status_mutex);
+            if (afb_job_post(0, 0, fastBootJob, wifiApData, NULL) < 0) {
+                AFB_API_ERROR(api, "Unable to post the fast boot");
+                return -1;
+            }
+        }
+        else if (start && startAp(wifiApData) < 0)
             return -1;
 
+        // reload the configuration file when it changes, once the status
+        // of the start is set
+        if (watch) {
+            int watcherId =
+                CreateThread("WifiApConfig", configWatcherMain, api);
+            if (watcherId <= 0 || startThread(watcherId) != 0)
+                AFB_API_WARNING(api, "Unable to watch the configuration file");
+        }
+
+        pthread_mutex_lock(&status_mutex);
+        if (start)
+            bootApiReadyMs = elapsedMs(&bootStartTime);
+        pthread_mutex_unlock(&status_mutex);
+        AFB_API_NOTICE(api, "Initialization finished");
         break;
     }
     default:
@@ -1611,7 +3801,7 @@ static int binding_ctl(afb_api_t api,
 const afb_binding_t afbBindingExport = {
     .api = "wifiAp",
     .specification = NULL,
-    .verbs = verbs,
+    .verbs = NULL,
     .mainctl = binding_ctl,
     .userdata = NULL,
     .provide_class = NULL,
@@ -0,0 +1,408 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+/*******************************************************************************
+ *      harness of the wifiap-utilities library, without the binder            *
+ *                                                                             *
+ * The "config" section of the configuration file of the binding is loaded,    *
+ * then the access point is started and stopped by the code of the binding     *
+ * (wifi-ap-start), through the platform layer, and each stage is timed. With  *
+ * -r, the files are only rendered and printed (fake platform) or written      *
+ * (system).                                                                   *
+ *                                                                             *
+ * Usage: wifiap-ctl [-c config] [-e events] [-n cycles] [-p fake|system]      *
+ *                   [-r] [-s script] [-v]                                     *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <inttypes.h>
+#include <json-c/json.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define AFB_BINDING_VERSION 4
+#include <afb/afb-binding.h>
+
+#include "lib/wifi-ap-config.h"
+#include "lib/wifi-ap-data.h"
+#include "lib/wifi-ap-events.h"
+#include "lib/wifi-ap-fake.h"
+#include "lib/wifi-ap-json.h"
+#include "lib/wifi-ap-metrics.h"
+#include "lib/wifi-ap-platform.h"
+#include "lib/wifi-ap-start.h"
+
+#define DEFAULT_CONFIG_FILE APP_DIR_ "/etc/wifiap-config.json"
+#define DEFAULT_SCRIPT      APP_DIR_ "/var/wifi_setup.sh"
+
+// syslog level of the messages of the library up to the notices, each -v
+// adds the next one (info, then debug)
+#define DEFAULT_LOG_LEVEL 5
+
+// stages of a cycle: the configuration, the ones of startWifiAp, the events
+// and the stop
+enum
+{
+    STAGE_CONFIG,
+    STAGE_START,  ///< first of the AP_STAGE_COUNT stages of startWifiAp
+    STAGE_EVENTS = STAGE_START + AP_STAGE_COUNT,
+    STAGE_STOP,
+    STAGE_COUNT,
+};
+
+static metricT *stageMetrics[STAGE_COUNT];
+static metricT *cycleMetric;
+
+static char *eventLines = NULL;
+static int logLevel = DEFAULT_LOG_LEVEL;
+
+/*******************************************************************************
+ *      logging of the library (AFB_* macros) on the standard error            *
+ ******************************************************************************/
+static int log_mask(afb_api_t api)
+{
+    return (2 << logLevel) - 1;
+}
+
+static void log_verbose(afb_api_t api,
+                        int level,
+                        const char *file,
+                        int line,
+                        const char *function,
+                        const char *fmt,
+                        va_list args)
+{
+    static const char *const levelNames[] = {
+        "EMERGENCY", "ALERT", "CRITICAL", "ERROR",
+        "WARNING",   "NOTICE", "INFO",    "DEBUG"};
+
+    fprintf(stderr, "%s: ", levelNames[level & 7]);
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+}
+
+static const struct afb_binding_x4r1_itf logItf = {
+    .api_logmask = log_mask,
+    .api_vverbose = log_verbose,
+};
+
+// what the binder gives to a binding, the library logs through them
+afb_api_t afbBindingV4root = NULL;
+const struct afb_binding_x4r1_itf *afbBindingV4r1_itfptr = &logItf;
+
+/*******************************************************************************
+ *      time a stage, from *startUs, and start the next one                    *
+ ******************************************************************************/
+static const char *stage_name(unsigned stage)
+{
+    return stage == STAGE_CONFIG   ? "config"
+           : stage == STAGE_EVENTS ? "events"
+           : stage == STAGE_STOP   ? "stop"
+                                   : getApStageName(stage - STAGE_START);
+}
+
+static void end_stage(unsigned stage, uint64_t *startUs)
+{
+    uint64_t now = metricNowUs();
+
+    metricObserve(stageMetrics[stage], now - *startUs);
+    *startUs = now;
+}
+
+static void end_start_stage(apStageT stage, uint64_t durationUs)
+{
+    metricObserve(stageMetrics[STAGE_START + stage], durationUs);
+}
+
+// the start of the binding, its commands go through the platform
+static apStartT apStart = {
+    .script = DEFAULT_SCRIPT,
+    .endStage = end_start_stage,
+};
+
+/*******************************************************************************
+ *      read the file of the lines of "iw event" given to the fake platform    *
+ ******************************************************************************/
+static int read_event_lines(const char *fileName)
+{
+    FILE *file = fopen(fileName, "re");
+    size_t size = 0;
+
+    if (file == NULL) {
+        fprintf(stderr, "Unable to open %s: %s\n", fileName, strerror(errno));
+        return -1;
+    }
+    if (getdelim(&eventLines, &size, '\0', file) < 0) {
+        free(eventLines);
+        eventLines = strdup("");
+    }
+    fclose(file);
+    return eventLines == NULL ? -1 : 0;
+}
+
+/*******************************************************************************
+ *      load the settings of the "config" section of a configuration file      *
+ *                                                                             *
+ * @return                                                                     *
+ *      the settings (to free with deleteWifiApData), or NULL on error         *
+ ******************************************************************************/
+static wifiApT *load_config(const char *fileName)
+{
+    struct json_object *root, *config;
+    wifiApT *wifiApData;
+    int errors;
+
+    root = json_object_from_file(fileName);
+    if (root == NULL) {
+        AFB_ERROR("Failed to read config file %s", fileName);
+        return NULL;
+    }
+    if (!json_object_object_get_ex(root, "config", &config)) {
+        AFB_ERROR("No 'config' section in %s", fileName);
+        json_object_put(root);
+        return NULL;
+    }
+
+    wifiApData = calloc(1, sizeof(*wifiApData));
+    if (wifiApData != NULL) {
+        initWifiApData(wifiApData);
+        errors = setWifiApDataFromJson(wifiApData, config);
+        if (errors != 0) {
+            AFB_ERROR("%d invalid keys in %s", errors, fileName);
+            deleteWifiApData(wifiApData);
+            wifiApData = NULL;
+        }
+    }
+    json_object_put(root);
+    return wifiApData;
+}
+
+/*******************************************************************************
+ *      render the files of dnsmasq and hostapd                                *
+ ******************************************************************************/
+static int render(wifiApT *wifiApData)
+{
+    if (createHostsConfigFile(wifiApData->ip_ap, wifiApData->hostName) != 0 ||
+        createDnsmasqConfigFile(wifiApData) != 0 ||
+        GenerateHostApConfFile(wifiApData) != 0) {
+        AFB_ERROR("Unable to render the configuration files");
+        return -1;
+    }
+    return 0;
+}
+
+static void print_rendered(void)
+{
+    static const char *const fileNames[] = {
+        WIFI_HOSTS_FILE, WIFI_DNSMASQ_FILE, WIFI_HOSTAPD_FILE,
+        WIFI_HOSTAPD_ACCEPT_FILE, WIFI_HOSTAPD_DENY_FILE};
+    char *content;
+
+    for (size_t i = 0; i < sizeof(fileNames) / sizeof(*fileNames); i++) {
+        if (getPlatform() != getFakePlatform())
+            printf("%s written\n", fileNames[i]);
+        else if ((content = getFakeFile(fileNames[i])) != NULL) {
+            printf("==> %s <==\n%s\n", fileNames[i], content);
+            free(content);
+        }
+    }
+}
+
+/*******************************************************************************
+ *      count the station events, as the event thread of the binding does      *
+ ******************************************************************************/
+static void count_station_event(const char *line,
+                                const stationEventT *event,
+                                void *closure)
+{
+    int *stations = closure;
+
+    if (event->type == STATION_EVENT_NEW)
+        (*stations)++;
+    else if (event->type == STATION_EVENT_DEL && *stations > 0)
+        (*stations)--;
+}
+
+/*******************************************************************************
+ *      start and stop the access point once, timing the stages                *
+ *                                                                             *
+ * The start and the stop are the ones of the binding, without the cache of    *
+ * the generated files and the event thread: the events are read to their end  *
+ * with the fake platform, the source of the system one is only opened, then   *
+ * closed as the binding does, its "iw event" killed first.                    *
+ *                                                                             *
+ * @return                                                                     *
+ *      0 if the access point started and stopped, -1 otherwise                *
+ ******************************************************************************/
+static int run_cycle(const char *configFile)
+{
+    uint64_t cycleUs, stageUs;
+    wifiApT *wifiApData;
+    FILE *events;
+    int stations = 0, rc = -1;
+
+    if (getPlatform() == getFakePlatform()) {
+        // the log of the calls would grow over the cycles
+        resetFakePlatform();
+        if (eventLines != NULL && setFakeEvents(eventLines) != 0)
+            return -1;
+    }
+
+    cycleUs = stageUs = metricNowUs();
+    wifiApData = load_config(configFile);
+    if (wifiApData == NULL)
+        return -1;
+    end_stage(STAGE_CONFIG, &stageUs);
+
+    if (startWifiAp(&apStart, wifiApData) != 0)
+        goto end;
+    stageUs = metricNowUs();
+
+    events = getPlatform()->openEvents(wifiApData->interfaceName);
+    if (events == NULL) {
+        AFB_ERROR("Unable to open the events: %s", strerror(errno));
+        goto end;
+    }
+    if (getPlatform() == getFakePlatform())
+        readStationEvents(events, wifiApData->interfaceName,
+                          count_station_event, &stations);
+    closeApEvents(&apStart, events);
+    AFB_DEBUG("%d stations after the events", stations);
+    end_stage(STAGE_EVENTS, &stageUs);
+
+    if (stopWifiAp(&apStart, wifiApData, NULL) != 0)
+        goto end;
+    end_stage(STAGE_STOP, &stageUs);
+
+    metricObserve(cycleMetric, stageUs - cycleUs);
+    rc = 0;
+end:
+    deleteWifiApData(wifiApData);
+    return rc;
+}
+
+/*******************************************************************************
+ *      print the durations of the stages                                      *
+ ******************************************************************************/
+static void print_metric(const char *name, const metricT *metric)
+{
+    metricSummaryT summary;
+
+    summarizeMetric(metric, &summary);
+    printf("%-16s %8" PRIu64 " %10" PRIu64 " %10" PRIu64 " %10" PRIu64
+           " %10" PRIu64 "\n",
+           name, summary.count,
+           summary.count == 0 ? 0 : summary.sumUs / summary.count,
+           summary.p50Us, summary.p99Us, summary.maxUs);
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "Usage: %s [-c config] [-e events] [-n cycles] [-p fake|system] "
+            "[-r] [-s script] [-v]\n"
+            "  -c  configuration file (default %s)\n"
+            "  -e  file of \"iw event\" lines read by the fake platform\n"
+            "  -n  start/stop cycles (default 1)\n"
+            "  -p  platform (default fake)\n"
+            "  -r  only render the configuration files\n"
+            "  -s  adapter script (default %s)\n"
+            "  -v  more messages of the library, twice for the debug ones\n",
+            name, DEFAULT_CONFIG_FILE, DEFAULT_SCRIPT);
+}
+
+int main(int argc, char **argv)
+{
+    const char *configFile = DEFAULT_CONFIG_FILE;
+    const char *platformName = "fake";
+    unsigned long cycles = 1, failures = 0;
+    bool renderOnly = false;
+    wifiApT *wifiApData;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "c:e:n:p:rs:v")) != -1) {
+        switch (opt) {
+        case 'c':
+            configFile = optarg;
+            break;
+        case 'e':
+            if (read_event_lines(optarg) != 0)
+                return 1;
+            break;
+        case 'n':
+            cycles = strtoul(optarg, NULL, 0);
+            break;
+        case 'p':
+            platformName = optarg;
+            break;
+        case 'r':
+            renderOnly = true;
+            break;
+        case 's':
+            apStart.script = optarg;
+            break;
+        case 'v':
+            logLevel++;
+            break;
+        default:
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if (strcmp(platformName, "fake") == 0)
+        setPlatform(getFakePlatform());
+    else if (strcmp(platformName, "system") != 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (renderOnly) {
+        wifiApData = load_config(configFile);
+        if (wifiApData == NULL || render(wifiApData) != 0)
+            return 1;
+        print_rendered();
+        deleteWifiApData(wifiApData);
+        return 0;
+    }
+
+    for (unsigned i = 0; i < STAGE_COUNT; i++)
+        stageMetrics[i] = createMetric(METRIC_HISTOGRAM, "wifiap_ctl_stage",
+                                       "Duration of a stage of a cycle.",
+                                       "stage", stage_name(i));
+    cycleMetric = createMetric(METRIC_HISTOGRAM, "wifiap_ctl_cycle",
+                               "Duration of a start/stop cycle.", NULL, NULL);
+
+    for (unsigned long i = 0; i < cycles; i++) {
+        if (run_cycle(configFile) != 0)
+            failures++;
+    }
+
+    printf("%lu cycles on the %s platform, %lu failed\n", cycles,
+           getPlatform()->name, failures);
+    printf("%-16s %8s %10s %10s %10s %10s\n", "stage", "count", "mean(us)",
+           "p50(us)", "p99(us)", "max(us)");
+    for (unsigned i = 0; i < STAGE_COUNT; i++)
+        print_metric(stage_name(i), stageMetrics[i]);
+    print_metric("cycle", cycleMetric);
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+import base64
+import json
+import os
+import shutil
+import socket
+import struct
+import subprocess
+import sys
+import time
+import unittest
+
+# Tests of the binding run by its own afb-binder, called over websockets
+# (x-afb-ws-json1): the load test, and the tests needing another
+# configuration file than the installed one (WIFIAP_CONFIG_FILE)
+
+
+class AfbWebSocket:
+    """Client of the x-afb-ws-json1 protocol of afb-binder, one call at a time"""
+
+    def __init__(self, port):
+        self.sock = socket.create_connection(("localhost", port), timeout=30)
+        key = base64.b64encode(os.urandom(16)).decode()
+        self.sock.sendall((f"GET /api HTTP/1.1\r\nHost: localhost:{port}\r\n"
+                           "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+                           f"Sec-WebSocket-Key: {key}\r\nSec-WebSocket-Version: 13\r\n"
+                           "Sec-WebSocket-Protocol: x-afb-ws-json1\r\n\r\n").encode())
+        response = b""
+        while b"\r\n\r\n" not in response:
+            chunk = self.sock.recv(4096)
+            if not chunk:
+                raise ConnectionError("websocket handshake closed")
+            response += chunk
+        if b" 101 " not in response.split(b"\r\n", 1)[0]:
+            raise ConnectionError(response.split(b"\r\n", 1)[0].decode())
+        self.buffer = response.split(b"\r\n\r\n", 1)[1]
+        self.callId = 0
+        self.events = []
+
+    def read(self, size):
+        while len(self.buffer) < size:
+            chunk = self.sock.recv(65536)
+            if not chunk:
+                raise ConnectionError("websocket closed")
+            self.buffer += chunk
+        data, self.buffer = self.buffer[:size], self.buffer[size:]
+        return data
+
+    def send(self, opcode, payload):
+        mask = os.urandom(4)
+        header = bytes([0x80 | opcode])
+        if len(payload) < 126:
+            header += bytes([0x80 | len(payload)])
+        elif len(payload) < 65536:
+            header += bytes([0x80 | 126]) + struct.pack("!H", len(payload))
+        else:
+            header += bytes([0x80 | 127]) + struct.pack("!Q", len(payload))
+        masked = bytes(b ^ mask[i % 4] for i, b in enumerate(payload))
+        self.sock.sendall(header + mask + masked)
+
+    def receive(self):
+        """The next text message, answering the pings"""
+        message = b""
+        while True:
+            first, second = self.read(2)
+            length = second & 0x7f
+            if length == 126:
+                length = struct.unpack("!H", self.read(2))[0]
+            elif length == 127:
+                length = struct.unpack("!Q", self.read(8))[0]
+            payload = self.read(length)
+            opcode = first & 0x0f
+            if opcode == 0x9:
+                self.send(0xa, payload)
+            elif opcode == 0x8:
+                raise ConnectionError("websocket closed by the binder")
+            elif opcode in (0x0, 0x1):
+                message += payload
+                if first & 0x80:
+                    return json.loads(message)
+
+    def request(self, api, verb, arg):
+        """Call a verb, its reply: (True if it succeeded, the response)"""
+        self.callId += 1
+        callId = str(self.callId)
+        self.send(0x1, json.dumps([2, callId, f"{api}/{verb}", arg]).encode())
+        while True:
+            reply = self.receive()
+            # replies are 3 (success) or 4 (error), events are 5
+            if reply[0] == 5:
+                self.events.append((reply[1], reply[2].get("data")))
+            elif reply[0] in (3, 4) and reply[1] == callId:
+                return reply[0] == 3, reply[2].get("response")
+
+    def call(self, api, verb, arg):
+        """Call a verb, True if it succeeded"""
+        return self.request(api, verb, arg)[0]
+
+    def wait_event(self, name, timeout):
+        """The data of the next event whose name ends with name, or None"""
+        deadline = time.monotonic() + timeout
+        while True:
+            for index, (event, data) in enumerate(self.events):
+                if event.endswith(name):
+                    del self.events[index]
+                    return data
+            if time.monotonic() > deadline:
+                return None
+            self.sock.settimeout(max(0.1, deadline - time.monotonic()))
+            try:
+                message = self.receive()
+            except socket.timeout:
+                return None
+            finally:
+                self.sock.settimeout(30)
+            if message[0] == 5:
+                self.events.append((message[1], message[2].get("data")))
+
+    def close(self):
+        self.sock.close()
+
+
+def binding_path(binding):
+    """The binding, found in LD_LIBRARY_PATH if not a path"""
+    if os.path.sep in binding:
+        return binding
+    for directory in os.environ.get("LD_LIBRARY_PATH", "").split(":") + ["."]:
+        if directory and os.path.exists(os.path.join(directory, binding)):
+            return os.path.join(directory, binding)
+    return binding
+
+
+def start_binder(binding, port, config=None):
+    """Start afb-binder with the binding, once it accepts websockets
+
+    config is the configuration file given to the binding, the installed
+    one if None. The test is skipped if the binder can't start."""
+    if shutil.which("afb-binder") is None:
+        raise unittest.SkipTest("afb-binder not found")
+    env = dict(os.environ)
+    if config is not None:
+        env["WIFIAP_CONFIG_FILE"] = config
+    binder = subprocess.Popen(["afb-binder", f"--binding={binding_path(binding)}",
+                               f"--port={port}"], env=env,
+                              stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+    deadline = time.monotonic() + 30
+    while True:
+        try:
+            AfbWebSocket(port).close()
+            return binder
+        except OSError:
+            if time.monotonic() > deadline or binder.poll() is not None:
+                binder.kill()
+                binder.wait()
+                raise unittest.SkipTest("afb-binder did not start")
+            time.sleep(0.2)
+
+
+def stop_binder(binder):
+    binder.terminate()
+    binder.wait()
+
+
+def write_config(directory, **settings):
+    """Write the default configuration with settings changed in its "config"
+    section to directory, its path
+
+    The default configuration is installed next to the tests, or found in
+    the source tree."""
+    here = os.path.dirname(os.path.abspath(__file__))
+    for default in (os.path.join(here, "wifiap-config.json"),
+                    os.path.join(here, "..", "config", "wifi-wifiap-binding-default-config.json")):
+        if os.path.exists(default):
+            break
+    else:
+        raise unittest.SkipTest("default configuration not found")
+    with open(default) as source:
+        config = json.load(source)
+    config["config"].update(settings)
+    path = os.path.join(directory, "wifiap-config.json")
+    with open(path, "w") as output:
+        json.dump(config, output, indent=2)
+    return path
+
+
+
+def run_tap(testCase):
+    """Run the tests of a case, printing their results in TAP for redtest"""
+    suite = unittest.defaultTestLoader.loadTestsFromTestCase(testCase)
+    result = unittest.TextTestRunner(stream=sys.stderr, verbosity=2).run(suite)
+    failed = {test.id(): reason for test, reason in result.failures + result.errors}
+    skipped = dict((test.id(), reason) for test, reason in result.skipped)
+    tests = [test.id() for test in suite]
+    # a skip of setUpClass skips all the tests
+    for test, reason in result.skipped:
+        if "setUpClass" in test.id():
+            skipped.update((name, reason) for name in tests)
+    print(f"1..{len(tests)}")
+    for number, test in enumerate(tests, 1):
+        if test in failed:
+            print(f"not ok {number} {test}")
+            print("\n".join("# " + line for line in failed[test].splitlines()))
+        elif test in skipped:
+            print(f"ok {number} {test} # SKIP {skipped[test]}")
+        else:
+            print(f"ok {number} {test}")
+    return result.wasSuccessful()
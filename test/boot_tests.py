@@ -0,0 +1,94 @@
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+import unittest
+
+from afb_ws import AfbWebSocket, run_tap, start_binder, stop_binder, write_config
+
+# The fast boot: the binding starts the access point at its init, in the
+# background, on a radio of mac80211_hwsim
+PORT = int(os.environ.get("WIFIAP_BOOT_PORT", "21236"))
+BINDING = os.environ.get("WIFIAP_BOOT_BINDING", "wifiap-binding.so")
+# time given to hostapd to send its beacons
+READY_TIMEOUT = float(os.environ.get("WIFIAP_BOOT_TIMEOUT", "30"))
+
+
+def setUpModule():
+    try:
+        subprocess.run(["modprobe", "mac80211_hwsim"], check=True)
+    except (OSError, subprocess.CalledProcessError) as e:
+        raise unittest.SkipTest(f"Fail to load mac80211_hwsim: {e}")
+
+
+class TestWifiApBoot(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp(prefix="wifiap-boot-")
+        self.config = write_config(self.directory, startAtInit=True, fastBoot=True,
+                                   watchConfig=False)
+        self.binder = None
+
+    def tearDown(self):
+        if self.binder is not None:
+            try:
+                ws = AfbWebSocket(PORT)
+                ws.call("wifiAp", "stop", None)
+                ws.close()
+            finally:
+                stop_binder(self.binder)
+        shutil.rmtree(self.directory)
+
+    def test_fast_boot_ap_ready(self):
+        """Test the API is ready before the beacons, and the ap-ready event of the boot"""
+        launched = time.monotonic()
+        self.binder = start_binder(BINDING, PORT, self.config)
+        ws = AfbWebSocket(PORT)
+        try:
+            assert ws.call("wifiAp", "subscribe", "ap-ready")
+
+            # the init did not wait for hostapd
+            ok, reply = ws.request("wifiAp", "getWifiApStatus", None)
+            assert ok
+            assert reply["status"] in ("starting", "started")
+
+            data = ws.wait_event("ap-ready", READY_TIMEOUT)
+            elapsedMs = (time.monotonic() - launched) * 1000
+            assert data is not None, "no ap-ready event after the fast boot"
+
+            ok, reply = ws.request("wifiAp", "getWifiApStatus", None)
+            assert ok
+            assert reply["status"] == "started"
+        finally:
+            ws.close()
+
+        assert data["channel"] > 0
+        assert data["startMs"] >= 0
+        apiReadyMs, beaconMs = data["bootApiReadyMs"], data["bootBeaconMs"]
+        assert 0 <= apiReadyMs < beaconMs, f"API ready {apiReadyMs} ms, beacons {beaconMs} ms"
+        # measured from the init of the binding, within the life of the binder
+        assert beaconMs <= elapsedMs
+        assert data["startMs"] <= beaconMs
+
+    def test_restart_ap_ready(self):
+        """Test the ap-ready of a start after the boot has no boot times"""
+        self.binder = start_binder(BINDING, PORT, self.config)
+        ws = AfbWebSocket(PORT)
+        try:
+            assert ws.call("wifiAp", "subscribe", "ap-ready")
+            assert ws.wait_event("ap-ready", READY_TIMEOUT) is not None
+
+            assert ws.call("wifiAp", "stop", None)
+            assert ws.call("wifiAp", "start", None)
+            data = ws.wait_event("ap-ready", READY_TIMEOUT)
+            assert data is not None, "no ap-ready event after the start"
+            assert "bootApiReadyMs" not in data
+            assert "bootBeaconMs" not in data
+        finally:
+            ws.close()
+
+if __name__ == "__main__":
+    if "--tap" in sys.argv:
+        sys.exit(0 if run_tap(TestWifiApBoot) else 1)
+    unittest.main()
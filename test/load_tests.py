@@ -0,0 +1,118 @@
+import json
+import os
+import random
+import sys
+import threading
+import time
+import unittest
+
+from afb_ws import AfbWebSocket, run_tap, start_binder, stop_binder
+
+# The load: clients calling the verbs over websockets for a duration, a part
+# of the calls are setters
+CLIENTS = int(os.environ.get("WIFIAP_LOAD_CLIENTS", "32"))
+SECONDS = float(os.environ.get("WIFIAP_LOAD_SECONDS", "10"))
+SETTERS = float(os.environ.get("WIFIAP_LOAD_SETTERS", "0.2"))
+PORT = int(os.environ.get("WIFIAP_LOAD_PORT", "21234"))
+BINDING = os.environ.get("WIFIAP_LOAD_BINDING", "wifiap-binding.so")
+RESULTS = os.environ.get("WIFIAP_LOAD_RESULTS", "/tmp/wifiap-load.json")
+# regression gate: results of a previous run, and the degradation tolerated
+BASELINE = os.environ.get("WIFIAP_LOAD_BASELINE")
+TOLERANCE = float(os.environ.get("WIFIAP_LOAD_TOLERANCE", "0.2"))
+
+GETTERS = (("getWifiApStatus", None), ("getIeeeStandard", None),
+           ("getAPclientsNumber", None))
+SETTER_VERBS = (("setSsid", lambda n: f"load-{n % 100}"), ("setChannel", lambda n: 1 + n % 11),
+                ("setDiscoverable", lambda n: n % 2 == 0),
+                ("SetMaxNumberClients", lambda n: 10 + n % 90))
+
+
+def percentile(values, p):
+    return values[min(len(values) - 1, int(len(values) * p / 100))] if values else None
+
+
+def summarize(latencies, errors, seconds):
+    latencies = sorted(latencies)
+    return {"calls": len(latencies), "errors": errors,
+            "rps": round(len(latencies) / seconds, 1),
+            "p50Ms": percentile(latencies, 50), "p90Ms": percentile(latencies, 90),
+            "p99Ms": percentile(latencies, 99), "maxMs": latencies[-1] if latencies else None}
+
+
+class TestWifiApLoad(unittest.TestCase):
+    @classmethod
+    def setUpClass(cls):
+        cls.binder = start_binder(BINDING, PORT)
+
+    @classmethod
+    def tearDownClass(cls):
+        stop_binder(cls.binder)
+
+    def client(self, index, deadline, samples, lock):
+        """Call the verbs until the deadline, timing each call (ms)"""
+        local = {}
+        rng = random.Random(index)
+        ws = AfbWebSocket(PORT)
+        try:
+            n = 0
+            while time.monotonic() < deadline:
+                if rng.random() < SETTERS:
+                    verb, arg = rng.choice(SETTER_VERBS)
+                    arg = arg(n)
+                else:
+                    verb, arg = rng.choice(GETTERS)
+                start = time.perf_counter()
+                ok = ws.call("wifiAp", verb, arg)
+                latency = (time.perf_counter() - start) * 1000
+                latencies, errors = local.setdefault(verb, ([], [0]))
+                latencies.append(latency)
+                errors[0] += 0 if ok else 1
+                n += 1
+        finally:
+            ws.close()
+        with lock:
+            for verb, (latencies, errors) in local.items():
+                merged = samples.setdefault(verb, ([], [0]))
+                merged[0].extend(latencies)
+                merged[1][0] += errors[0]
+
+    def test_load_verbs(self):
+        """Report the throughput and the latencies of the verbs under load"""
+        samples, lock = {}, threading.Lock()
+        deadline = time.monotonic() + SECONDS
+        threads = [threading.Thread(target=self.client, args=(i, deadline, samples, lock))
+                   for i in range(CLIENTS)]
+        start = time.monotonic()
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        seconds = time.monotonic() - start
+
+        results = {"clients": CLIENTS, "seconds": round(seconds, 3), "setters": SETTERS,
+                   "verbs": {verb: summarize(latencies, errors[0], seconds)
+                             for verb, (latencies, errors) in sorted(samples.items())}}
+        results["total"] = summarize([l for latencies, _ in samples.values() for l in latencies],
+                                     sum(errors[0] for _, errors in samples.values()), seconds)
+        with open(RESULTS, "w") as output:
+            json.dump(results, output, indent=2)
+        print(json.dumps(results["total"]))
+        assert results["total"]["calls"] > 0
+
+        if BASELINE:
+            # redtest gives the baseline shipped with the tests, the gate
+            # must not pass silently when it was not recorded
+            assert os.path.exists(BASELINE), \
+                f"no baseline {BASELINE}, record it with WIFIAP_LOAD_RESULTS={BASELINE}"
+            with open(BASELINE) as baseline:
+                before = json.load(baseline)["total"]
+            now = results["total"]
+            assert now["rps"] >= before["rps"] * (1 - TOLERANCE), \
+                f"throughput {now['rps']} req/s, was {before['rps']}"
+            assert now["p99Ms"] <= before["p99Ms"] * (1 + TOLERANCE), \
+                f"p99 {now['p99Ms']:.2f} ms, was {before['p99Ms']:.2f}"
+
+if __name__ == "__main__":
+    if "--tap" in sys.argv:
+        sys.exit(0 if run_tap(TestWifiApLoad) else 1)
+    unittest.main()
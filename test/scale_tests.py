@@ -0,0 +1,239 @@
+from afb_test import AFBTestCase, configure_afb_binding_tests, run_afb_binding_tests
+import libafb
+import json
+import os
+import re
+import shutil
+import subprocess
+import threading
+import time
+import unittest
+from concurrent.futures import ThreadPoolExecutor
+
+bindings = {"wifiAp": f"wifiap-binding.so"}
+
+# Scale of the test, the stations are spread over the radios (one network
+# namespace per radio, a radio moves to a namespace with all its interfaces)
+STATIONS = int(os.environ.get("WIFIAP_SCALE_STATIONS", "200"))
+RADIOS = int(os.environ.get("WIFIAP_SCALE_RADIOS", "20"))
+WAVE = int(os.environ.get("WIFIAP_SCALE_WAVE", "50"))
+RESULTS = os.environ.get("WIFIAP_SCALE_RESULTS", "/tmp/wifiap-scale.json")
+
+SSID = "wifiap-scale"
+PASSPHRASE = "wifiap-scale-1234"
+RUN_DIR = "/tmp/wifiap-scale"
+TIMEOUT = 60
+SETTLE_TIMEOUT = 15
+
+# the AP radio and the stations: {"ns", "iface", "mac"}
+apInterface = None
+stations = []
+
+
+def run(*args, ns=None, check=True, timeout=TIMEOUT):
+    """Run a command, in a network namespace if given"""
+    if ns is not None:
+        args = ("ip", "netns", "exec", ns) + args
+    return subprocess.run(args, check=check, timeout=timeout,
+                          stdout=subprocess.PIPE, stderr=subprocess.STDOUT, text=True)
+
+
+def hwsim_radios():
+    """The phys of mac80211_hwsim with their interface, by index"""
+    radios = []
+    for phy in os.listdir("/sys/class/ieee80211"):
+        device = f"/sys/class/ieee80211/{phy}/device"
+        if os.path.realpath(f"{device}/driver").endswith("mac80211_hwsim"):
+            radios.append((int(phy[3:]), phy, sorted(os.listdir(f"{device}/net"))[0]))
+    return [(phy, iface) for _, phy, iface in sorted(radios)]
+
+
+def dhcp_client(iface, release=False):
+    """Command getting a lease once, returning when leased; the address is
+    not configured (the stations of a namespace share its routes and files)"""
+    if shutil.which("dhclient"):
+        return ("dhclient", "-r" if release else "-1", "-sf", "/bin/true",
+                "-pf", f"{RUN_DIR}/{iface}.dhclient.pid",
+                "-lf", f"{RUN_DIR}/{iface}.leases", iface)
+    return ("udhcpc", "-i", iface, "-s", "/bin/true", "-n", "-q", "-t", "10")
+
+
+def setUpModule():
+    global apInterface
+    for tool in ("iw", "ip", "wpa_supplicant", "wpa_cli"):
+        if shutil.which(tool) is None:
+            raise unittest.SkipTest(f"{tool} not found")
+    if shutil.which("dhclient") is None and shutil.which("udhcpc") is None:
+        raise unittest.SkipTest("no DHCP client (dhclient or udhcpc)")
+
+    try:
+        subprocess.run(["modprobe", "-r", "mac80211_hwsim"], check=False)
+        subprocess.run(["modprobe", "mac80211_hwsim", f"radios={RADIOS + 1}"], check=True)
+    except subprocess.CalledProcessError as e:
+        raise unittest.SkipTest(f"Fail to load mac80211_hwsim: {e}")
+
+    os.makedirs(RUN_DIR, exist_ok=True)
+    radios = hwsim_radios()
+    apInterface = radios[0][1]
+    with open(f"{RUN_DIR}/wpa_supplicant.conf", "w") as conf:
+        conf.write(f'ctrl_interface={RUN_DIR}/ctrl\nnetwork={{\n\tssid="{SSID}"\n'
+                   f'\tpsk="{PASSPHRASE}"\n\tkey_mgmt=WPA-PSK\n\tscan_ssid=1\n}}\n')
+
+    # the stations of a radio: its interface and the ones added
+    for index in range(STATIONS):
+        phy, iface = radios[1 + index % RADIOS]
+        ns = f"wifiap-{phy}"
+        if index >= RADIOS:
+            iface = f"{phy}sta{index // RADIOS}"
+            run("iw", "phy", phy, "interface", "add", iface, "type", "managed")
+        mac = "02:5c:%02x:%02x:%02x:00" % (index >> 16 & 0xff, index >> 8 & 0xff, index & 0xff)
+        run("ip", "link", "set", iface, "address", mac)
+        stations.append({"ns": ns, "iface": iface, "mac": mac})
+    for phy, _ in radios[1:]:
+        ns = f"wifiap-{phy}"
+        run("ip", "netns", "add", ns)
+        run("iw", "phy", phy, "set", "netns", "name", ns)
+        run("ip", "link", "set", "lo", "up", ns=ns)
+
+    configure_afb_binding_tests(bindings=bindings)
+
+
+def tearDownModule():
+    for ns in sorted({station["ns"] for station in stations}):
+        for pid in run("ip", "netns", "pids", ns, check=False).stdout.split():
+            run("kill", pid, check=False)
+        run("ip", "netns", "del", ns, check=False)
+    shutil.rmtree(RUN_DIR, ignore_errors=True)
+    # back to the radios of test/tests.py
+    subprocess.run(["modprobe", "-r", "mac80211_hwsim"], check=False)
+    subprocess.run(["modprobe", "mac80211_hwsim"], check=False)
+
+
+def process_usage():
+    """CPU seconds and RSS (kB) of this process, which runs the binder"""
+    with open("/proc/self/stat") as stat:
+        fields = stat.read().rsplit(")", 1)[1].split()
+    with open("/proc/self/status") as status:
+        rss = int(re.search(r"VmRSS:\s+(\d+)", status.read()).group(1))
+    return (int(fields[11]) + int(fields[12])) / os.sysconf("SC_CLK_TCK"), rss
+
+
+def percentile(values, p):
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))] if values else None
+
+
+class TestWifiApScale(AFBTestCase):
+    def setUp(self):
+        self.lock = threading.Lock()
+        self.eventCount = None
+        self.events = 0
+
+    def on_event(self, evt, name, userdata, *args):
+        if args and isinstance(args[0], dict) and "number-client" in args[0]:
+            with self.lock:
+                self.eventCount = args[0]["number-client"]
+                self.events += 1
+
+    def connect(self, station):
+        """Associate a station and get its lease, timing both"""
+        ctrl = f"{RUN_DIR}/ctrl"
+        start = time.monotonic()
+        run("wpa_supplicant", "-B", "-D", "nl80211", "-i", station["iface"],
+            "-c", f"{RUN_DIR}/wpa_supplicant.conf",
+            "-P", f"{RUN_DIR}/{station['iface']}.wpa.pid", ns=station["ns"])
+        while "wpa_state=COMPLETED" not in run("wpa_cli", "-p", ctrl, "-i", station["iface"],
+                                               "status", ns=station["ns"], check=False).stdout:
+            if time.monotonic() - start > TIMEOUT:
+                return {"mac": station["mac"], "error": "association timeout"}
+            time.sleep(0.05)
+        associated = time.monotonic()
+        try:
+            run(*dhcp_client(station["iface"]), ns=station["ns"])
+        except (subprocess.CalledProcessError, subprocess.TimeoutExpired):
+            return {"mac": station["mac"], "error": "no lease"}
+        return {"mac": station["mac"], "association": associated - start,
+                "lease": time.monotonic() - associated}
+
+    def disconnect(self, station):
+        if shutil.which("dhclient"):
+            run(*dhcp_client(station["iface"], release=True), ns=station["ns"], check=False)
+        run("wpa_cli", "-p", f"{RUN_DIR}/ctrl", "-i", station["iface"], "terminate",
+            ns=station["ns"], check=False)
+
+    def real_count(self):
+        return run("iw", "dev", apInterface, "station", "dump").stdout.count("Station ")
+
+    def settle(self, expected):
+        """Wait for the events to reach the expected count, compare with reality"""
+        deadline = time.monotonic() + SETTLE_TIMEOUT
+        while True:
+            realCount = self.real_count()
+            with self.lock:
+                eventCount = self.eventCount
+            if (eventCount == expected and realCount == expected) or \
+                    time.monotonic() > deadline:
+                return eventCount, realCount
+            time.sleep(0.2)
+
+    def run_wave(self, name, pool, action, wave, expected):
+        cpu, _ = process_usage()
+        start = time.monotonic()
+        results = list(pool.map(action, wave))
+        eventCount, realCount = self.settle(expected)
+        cpuEnd, rssEnd = process_usage()
+        report = {"wave": name, "stations": len(wave), "expected": expected,
+                  "eventCount": eventCount, "realCount": realCount,
+                  "seconds": round(time.monotonic() - start, 3),
+                  "cpuSeconds": round(cpuEnd - cpu, 3), "rssKb": rssEnd}
+        timed = [r for r in results if r and "association" in r]
+        if results and results[0] is not None:
+            report["errors"] = [r for r in results if "error" in r]
+            for key in ("association", "lease"):
+                values = [r[key] for r in timed]
+                report[key] = {"p50": percentile(values, 50), "p99": percentile(values, 99),
+                               "max": max(values) if values else None}
+        print(json.dumps(report))
+        return report
+
+    def test_scale_stations(self):
+        """Connect and disconnect the stations in waves, checking the events"""
+        libafb.evthandler(self.binder, {"uid": "wifiap-scale", "pattern": "wifiAp/*",
+                                        "callback": self.on_event})
+        r = libafb.callsync(self.binder, "wifiAp", "subscribe", "client-state")
+        assert r.status == 0
+        for verb, arg in (("setInterfaceName", apInterface), ("setSsid", SSID),
+                          ("setSecurityProtocol", "WPA2"), ("setPassPhrase", PASSPHRASE),
+                          ("SetMaxNumberClients", STATIONS)):
+            r = libafb.callsync(self.binder, "wifiAp", verb, arg)
+            assert r.status == 0
+
+        reports = []
+        r = libafb.callsync(self.binder, "wifiAp", "start")
+        assert r.status == 0
+        try:
+            with ThreadPoolExecutor(max_workers=WAVE) as pool:
+                connected = 0
+                for first in range(0, STATIONS, WAVE):
+                    wave = stations[first:first + WAVE]
+                    connected += len(wave)
+                    reports.append(self.run_wave(f"connect-{first // WAVE}", pool,
+                                                 self.connect, wave, connected))
+                for first in range(0, STATIONS, WAVE):
+                    wave = stations[first:first + WAVE]
+                    connected -= len(wave)
+                    reports.append(self.run_wave(f"disconnect-{first // WAVE}", pool,
+                                                 self.disconnect, wave, connected))
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "stop")
+            with open(RESULTS, "w") as results:
+                json.dump({"stations": STATIONS, "radios": RADIOS, "events": self.events,
+                           "waves": reports}, results, indent=2)
+
+        for report in reports:
+            assert not report.get("errors"), report
+            assert report["realCount"] == report["expected"], report
+            assert report["eventCount"] == report["realCount"], report
+
+if __name__ == "__main__":
+    run_afb_binding_tests(bindings)
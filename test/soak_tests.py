@@ -0,0 +1,103 @@
+from afb_test import AFBTestCase, configure_afb_binding_tests, run_afb_binding_tests
+import libafb
+import csv
+import os
+import re
+import subprocess
+import time
+import unittest
+
+bindings = {"wifiAp": f"wifiap-binding.so"}
+
+# Length of the soak: the cycles of verbs, sampled every batch
+CYCLES = int(os.environ.get("WIFIAP_SOAK_CYCLES", "20000"))
+BATCH = int(os.environ.get("WIFIAP_SOAK_BATCH", "100"))
+RESULTS = os.environ.get("WIFIAP_SOAK_RESULTS", "/tmp/wifiap-soak.csv")
+# batches ignored before checking the growth (caches, first allocations)
+WARMUP = 2
+# growth of the RSS tolerated (kB), the allocator keeps some memory
+RSS_SLACK_KB = int(os.environ.get("WIFIAP_SOAK_RSS_SLACK_KB", "1024"))
+# rises of the open files or children between batches taken as a leak
+LEAK_STEPS = int(os.environ.get("WIFIAP_SOAK_LEAK_STEPS", "3"))
+
+# a cycle of the soak: the verbs and their argument
+CYCLE = (("start", None), ("getWifiApStatus", None), ("getIeeeStandard", None),
+         ("getAPclientsNumber", None), ("restart", None), ("getAPclientsNumber", None),
+         ("getMetrics", None), ("stop", None))
+
+
+def setUpModule():
+    try:
+        subprocess.run(
+            ["modprobe", "mac80211_hwsim"],
+            check=True
+        )
+    except subprocess.CalledProcessError as e:
+        raise unittest.SkipTest(f"Fail to load mac80211_hwsim: {e}")
+
+    configure_afb_binding_tests(bindings=bindings)
+
+
+def sample():
+    """Open files, RSS (kB) and child processes (zombies included) of this
+    process, which runs the binder"""
+    pid = os.getpid()
+    with open("/proc/self/status") as status:
+        rss = int(re.search(r"VmRSS:\s+(\d+)", status.read()).group(1))
+    children = 0
+    for entry in os.listdir("/proc"):
+        try:
+            with open(f"/proc/{entry}/stat") as stat:
+                if int(stat.read().rsplit(")", 1)[1].split()[1]) == pid:
+                    children += 1
+        except (OSError, ValueError, IndexError):
+            pass
+    return {"fds": len(os.listdir("/proc/self/fd")), "rss_kb": rss, "children": children}
+
+
+def leaks(samples):
+    """The resources growing over the batches after the warm-up"""
+    samples = samples[WARMUP:]
+    if len(samples) < 2:
+        return []
+    found = []
+    for key in ("fds", "children"):
+        # the floor of the later batches ignores the transient ones (a pipe
+        # being closed, dnsmasq respawning), it leaks if it rises several times
+        floor = [min(s[key] for s in samples[i:]) for i in range(len(samples))]
+        steps = sum(1 for a, b in zip(floor, floor[1:]) if b > a)
+        if steps >= LEAK_STEPS:
+            found.append(f"{key}: {floor[0]} -> {floor[-1]} in {steps} steps")
+    # the RSS leaks if it never decreases over the last half and grows
+    tail = [s["rss_kb"] for s in samples[len(samples) // 2:]]
+    if all(b >= a for a, b in zip(tail, tail[1:])) and tail[-1] - tail[0] > RSS_SLACK_KB:
+        found.append(f"rss_kb: {tail[0]} -> {tail[-1]}")
+    return found
+
+
+class TestWifiApSoak(AFBTestCase):
+    def test_soak_start_stop(self):
+        """Run the start/stop cycles and check that nothing leaks"""
+        samples = []
+        start = time.monotonic()
+        with open(RESULTS, "w", newline="") as results:
+            writer = csv.DictWriter(results, ["batch", "cycles", "seconds", "fds",
+                                              "rss_kb", "children"])
+            writer.writeheader()
+            for cycle in range(1, CYCLES + 1):
+                for verb, arg in CYCLE:
+                    args = () if arg is None else (arg,)
+                    r = libafb.callsync(self.binder, "wifiAp", verb, *args)
+                    assert r.status == 0, verb
+                if cycle % BATCH == 0 or cycle == CYCLES:
+                    row = {"batch": len(samples), "cycles": cycle,
+                           "seconds": round(time.monotonic() - start, 3), **sample()}
+                    samples.append(row)
+                    writer.writerow(row)
+                    results.flush()
+
+        found = leaks(samples)
+        assert not found, f"growing over {len(samples)} batches: {', '.join(found)}"
+
+if __name__ == "__main__":
+    run_afb_binding_tests(bindings)
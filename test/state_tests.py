@@ -0,0 +1,115 @@
+import json
+import os
+import shutil
+import sys
+import tempfile
+import threading
+import time
+import unittest
+
+from afb_ws import AfbWebSocket, run_tap, start_binder, stop_binder, write_config
+
+# The state file: the binding runs with its own configuration file (the
+# access point is not started, neither root nor a radio is needed)
+PORT = int(os.environ.get("WIFIAP_STATE_PORT", "21235"))
+BINDING = os.environ.get("WIFIAP_STATE_BINDING", "wifiap-binding.so")
+# the state file is written about 1 s after the last change
+SAVE_DELAY = 1.0
+
+
+class TestWifiApState(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp(prefix="wifiap-state-")
+        self.stateFile = os.path.join(self.directory, "state.json")
+        self.config = write_config(self.directory, stateFile=self.stateFile,
+                                   watchConfig=False, startAtInit=False)
+        self.binder = None
+
+    def tearDown(self):
+        if self.binder is not None:
+            stop_binder(self.binder)
+        shutil.rmtree(self.directory)
+
+    def start(self):
+        """Start the binder, a websocket to it"""
+        self.binder = start_binder(BINDING, PORT, self.config)
+        return AfbWebSocket(PORT)
+
+    def write_state(self, text):
+        with open(self.stateFile, "w") as state:
+            state.write(text)
+
+    def watch_writes(self, stop, writes):
+        """Record each new version of the state file (it is replaced by a rename)"""
+        while not stop.is_set():
+            try:
+                info = os.stat(self.stateFile)
+                version = (info.st_ino, info.st_mtime_ns)
+                if not writes or writes[-1] != version:
+                    writes.append(version)
+            except FileNotFoundError:
+                pass
+            time.sleep(0.01)
+
+    def test_debounce(self):
+        """Test a burst of setters gives a single write of the state file"""
+        ws = self.start()
+        stop, writes = threading.Event(), []
+        watcher = threading.Thread(target=self.watch_writes, args=(stop, writes))
+        watcher.start()
+        try:
+            for n in range(10):
+                assert ws.call("wifiAp", "setSsid", f"burst-{n}")
+            assert ws.call("wifiAp", "setRateLimit", {"kbps": 2000})
+            time.sleep(SAVE_DELAY * 3)
+        finally:
+            stop.set()
+            watcher.join()
+            ws.close()
+
+        assert len(writes) == 1, f"{len(writes)} writes of the state file"
+        with open(self.stateFile) as state:
+            saved = json.load(state)
+        assert saved["ssid"] == "burst-9"
+        assert saved["rateLimitKbps"] == 2000
+
+    def test_state_merged(self):
+        """Test the state file is loaded over the configuration file"""
+        self.write_state(json.dumps({"ssid": "restored", "rateLimitKbps": 3000}))
+        ws = self.start()
+        try:
+            ok, limits = ws.request("wifiAp", "getRateLimits", None)
+            assert ok
+            assert limits["rateLimitKbps"] == 3000
+
+            # only the settings of the state file differ from the defaults
+            # (the SSID of WPA2 reloads hostapd)
+            ok, reply = ws.request("wifiAp", "reloadConfig", None)
+            assert ok
+            assert sorted(reply["changes"]) == ["hostapd-reload", "shaping"]
+        finally:
+            ws.close()
+
+    def test_invalid_state(self):
+        """Test an invalid state file falls back to the configuration file"""
+        for text in ('{"rateLimitKbps": "fast"}', "{not json", "[]"):
+            with self.subTest(state=text):
+                self.write_state(text)
+                ws = self.start()
+                try:
+                    ok, limits = ws.request("wifiAp", "getRateLimits", None)
+                    assert ok
+                    assert limits["rateLimitKbps"] == 0
+
+                    ok, reply = ws.request("wifiAp", "reloadConfig", None)
+                    assert ok
+                    assert reply["changes"] == []
+                finally:
+                    ws.close()
+                    stop_binder(self.binder)
+                    self.binder = None
+
+if __name__ == "__main__":
+    if "--tap" in sys.argv:
+        sys.exit(0 if run_tap(TestWifiApState) else 1)
+    unittest.main()
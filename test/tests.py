@@ -1,5 +1,6 @@
 from afb_test import AFBTestCase, configure_afb_binding_tests, run_afb_binding_tests
 import libafb
+import os
 import pdb
 import subprocess
 import unittest
@@ -8,6 +9,15 @@ from time import sleep
 
 bindings = {"wifiAp": f"wifiap-binding.so"}
 
+GOLDEN_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "golden")
+
+# keys of hostapd.conf compared to the golden files of the security protocols
+SECURITY_KEYS = ("wpa", "wpa_key_mgmt", "rsn_pairwise", "sae_pwe", "sae_anti_clogging_threshold",
+                 "sae_require_mfp", "disable_pmksa_caching", "okc", "ieee80211w")
+
+# keys of dnsmasq.wlan.conf compared to the golden files of the DHCP settings
+DHCP_KEYS = ("dhcp-range", "dhcp-host", "dhcp-option", "dhcp-authoritative", "dhcp-rapid-commit")
+
 def setUpModule():
     try:
         subprocess.run(
@@ -50,6 +60,32 @@ class TestWifiAp(AFBTestCase):
         r = libafb.callsync(self.binder, "wifiAp", "setPassPhrase", "passwordtest")
         assert r.status == 0
 
+    def test_set_pre_shared_key(self):
+        """Test the PSK is 64 hexadecimal characters"""
+        r = libafb.callsync(self.binder, "wifiAp", "setPreSharedKey", "0123456789abcdef" * 4)
+        assert r.status == 0
+        for psk in ("0123456789abcdef", "0123456789abcdeg" * 4):
+            with self.assertRaises(RuntimeError):
+                libafb.callsync(self.binder, "wifiAp", "setPreSharedKey", psk)
+        r = libafb.callsync(self.binder, "wifiAp", "setPreSharedKey", "")
+        assert r.status == 0
+
+    def test_wpa_psk_derived(self):
+        """Test the WPA2 PSK is derived from the passphrase (IEEE 802.11i H.4 vector)"""
+        libafb.callsync(self.binder, "wifiAp", "setSsid", "IEEE")
+        libafb.callsync(self.binder, "wifiAp", "setPassPhrase", "password")
+        try:
+            r = libafb.callsync(self.binder, "wifiAp", "start")
+            assert r.status == 0
+            with open("/tmp/hostapd.conf") as conf:
+                lines = conf.read().splitlines()
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "stop")
+            libafb.callsync(self.binder, "wifiAp", "setSsid", "IOTBZH-Datahub")
+            libafb.callsync(self.binder, "wifiAp", "setPassPhrase", "default1234")
+        assert "wpa_psk=f42c6fc52df0ebef9ebb4b90b38a5f902e83fe1b135a70e23aed762e9710a12e" in lines
+        assert not any(line.startswith("wpa_passphrase=") for line in lines)
+
     def test_set_discoverable(self):
         """Test setting discoverable flag"""
         # Test with true
@@ -80,6 +116,249 @@ class TestWifiAp(AFBTestCase):
         r = libafb.callsync(self.binder, "wifiAp", "SetMaxNumberClients", 4)
         assert r.status == 0
     
+    def test_set_radio_parameters(self):
+        """Test setting beacon interval, DTIM period and thresholds"""
+        r = libafb.callsync(self.binder, "wifiAp", "setBeaconInterval", 200)
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "setDtimPeriod", 1)
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "setRtsThreshold", 2347)
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "setFragmThreshold", 2346)
+        assert r.status == 0
+
+    def test_set_channel_width(self):
+        """Test setting the channel width"""
+        # 802.11g + 802.11n on channel 6: 40 MHz is possible
+        r = libafb.callsync(self.binder, "wifiAp", "setIeeeStandard", 0x44)
+        assert r.status == 0
+        r = libafb.callsync(self.binder, "wifiAp", "setChannel", 6)
+        assert r.status == 0
+        r = libafb.callsync(self.binder, "wifiAp", "setChannelWidth", 40)
+        assert r.status == 0
+
+        # 80 MHz needs 802.11ac in the 5 GHz band
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "setChannelWidth", 80)
+
+        r = libafb.callsync(self.binder, "wifiAp", "setChannelWidth", 20)
+        assert r.status == 0
+
+    def test_radio_capabilities(self):
+        """Test the validation against the mac80211_hwsim capabilities"""
+        r = libafb.callsync(self.binder, "wifiAp", "setInterfaceName", "wlan0")
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "getRadioCapabilities")
+        assert r.status == 0
+        bands = {band["band"]: band for band in r.args[0]["bands"]}
+        assert "2.4GHz" in bands
+        assert any(c["channel"] == 1 for c in bands["2.4GHz"]["channels"])
+
+        # mac80211_hwsim has no 60 GHz band
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "setIeeeStandard", 0x8)
+
+    def test_rescan_channel(self):
+        """Test selecting the least loaded channel from a mac80211_hwsim survey"""
+        r = libafb.callsync(self.binder, "wifiAp", "setIeeeStandard", 0x4)
+        assert r.status == 0
+        r = libafb.callsync(self.binder, "wifiAp", "setAutoChannel", "survey")
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "rescanChannel")
+        assert r.status == 0
+        channel = r.args[0]["channel"]
+        assert 1 <= channel <= 14
+        assert r.args[0]["frequency"] == (2484 if channel == 14 else 2407 + 5 * channel)
+
+        # Unknown selection mode
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "setAutoChannel", "random")
+
+        r = libafb.callsync(self.binder, "wifiAp", "setAutoChannel", "off")
+        assert r.status == 0
+
+    def check_dhcp_config(self, golden):
+        """Start the AP and compare the DHCP lines of dnsmasq.wlan.conf to a golden file"""
+        try:
+            r = libafb.callsync(self.binder, "wifiAp", "start")
+            assert r.status == 0
+            with open("/tmp/dnsmasq.wlan.conf") as conf:
+                lines = [line for line in conf.read().splitlines()
+                         if line.split("=", 1)[0] in DHCP_KEYS]
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "stop")
+        with open(os.path.join(GOLDEN_DIR, golden)) as expected:
+            assert lines == expected.read().splitlines()
+
+    def test_set_dhcp_lease_time(self):
+        """Test setting the DHCP lease time"""
+        r = libafb.callsync(self.binder, "wifiAp", "setDhcpLeaseTime", 3600)
+        assert r.status == 0
+        try:
+            self.check_dhcp_config("dnsmasq-lease-time.conf")
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "setDhcpLeaseTime", 86400)
+
+        # Below dnsmasq minimum lease time
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "setDhcpLeaseTime", 60)
+
+    def test_dhcp_static_lease(self):
+        """Test adding and removing a DHCP static lease"""
+        lease = {"mac": "02:00:00:00:01:00", "ip": "192.168.7.10", "hostname": "kiosk"}
+        r = libafb.callsync(self.binder, "wifiAp", "addDhcpStaticLease", lease)
+        assert r.status == 0
+        try:
+            self.check_dhcp_config("dnsmasq-static-lease.conf")
+        finally:
+            r = libafb.callsync(self.binder, "wifiAp", "removeDhcpStaticLease", "02:00:00:00:01:00")
+            assert r.status == 0
+        self.check_dhcp_config("dnsmasq-default.conf")
+
+        # Invalid MAC address
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "addDhcpStaticLease",
+                            {"mac": "02:00:00", "ip": "192.168.7.10"})
+
+    def test_dhcp_option(self):
+        """Test setting and removing a DHCP option"""
+        r = libafb.callsync(self.binder, "wifiAp", "setDhcpOption", {"code": 42, "value": "192.168.7.1"})
+        assert r.status == 0
+        try:
+            self.check_dhcp_config("dnsmasq-option.conf")
+        finally:
+            r = libafb.callsync(self.binder, "wifiAp", "removeDhcpOption", 42)
+            assert r.status == 0
+        self.check_dhcp_config("dnsmasq-default.conf")
+
+    def test_mac_acl(self):
+        """Test adding, listing and removing a MAC address of a list"""
+        acl = {"list": "deny", "mac": "02:00:00:00:02:00"}
+        r = libafb.callsync(self.binder, "wifiAp", "addMacAcl", acl)
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "getMacAcl")
+        assert r.status == 0
+        assert "02:00:00:00:02:00" in r.args[0]["deny"]
+
+        r = libafb.callsync(self.binder, "wifiAp", "removeMacAcl", acl)
+        assert r.status == 0
+
+        # Unknown list
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "addMacAcl",
+                            {"list": "other", "mac": "02:00:00:00:02:00"})
+
+    def test_rate_limit(self):
+        """Test setting and removing the rate limit of a station"""
+        limit = {"mac": "02:00:00:00:03:00", "kbps": 2000}
+        r = libafb.callsync(self.binder, "wifiAp", "setRateLimit", limit)
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "getRateLimits")
+        assert r.status == 0
+        assert {"mac": "02:00:00:00:03:00", "kbps": 2000} in r.args[0]["stations"]
+
+        r = libafb.callsync(self.binder, "wifiAp", "setRateLimit",
+                            {"mac": "02:00:00:00:03:00", "kbps": 0})
+        assert r.status == 0
+
+    def test_steering(self):
+        """Test setting the band steering and reading its counters"""
+        r = libafb.callsync(self.binder, "wifiAp", "setSteering",
+                            {"maxClients": 10, "neighbors": ["02:00:00:00:05:00,0x0000,115,36,9"]})
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "getSteering")
+        assert r.status == 0
+        assert r.args[0]["maxClients"] == 10
+        assert "moved" in r.args[0]["counters"]
+
+        # Invalid neighbor
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "setSteering", {"neighbors": ["02:00:00:00:05:00"]})
+
+    def check_security_config(self, protocol, golden):
+        """Start the AP with a security protocol and compare hostapd.conf to a golden file"""
+        r = libafb.callsync(self.binder, "wifiAp", "setSecurityProtocol", protocol)
+        assert r.status == 0
+        try:
+            r = libafb.callsync(self.binder, "wifiAp", "start")
+            assert r.status == 0
+            with open("/tmp/hostapd.conf") as conf:
+                lines = [line for line in conf.read().splitlines()
+                         if line.split("=", 1)[0] in SECURITY_KEYS]
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "stop")
+            libafb.callsync(self.binder, "wifiAp", "setSecurityProtocol", "WPA2")
+        with open(os.path.join(GOLDEN_DIR, golden)) as expected:
+            assert lines == expected.read().splitlines()
+
+    def test_security_wpa3(self):
+        """Test the hostapd.conf of WPA3 and WPA2/WPA3 against golden files"""
+        # WPA3 needs IEEE 802.11w
+        r = libafb.callsync(self.binder, "wifiAp", "setIeeeStandard", 4)
+        assert r.status == 0
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "setSecurityProtocol", "WPA3")
+
+        r = libafb.callsync(self.binder, "wifiAp", "setIeeeStandard", 4 | 0x200)
+        assert r.status == 0
+        try:
+            self.check_security_config("WPA3", "hostapd-wpa3.conf")
+            self.check_security_config("WPA2-WPA3", "hostapd-wpa2-wpa3.conf")
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "setIeeeStandard", 4)
+
+    def test_metrics(self):
+        """Test the metrics in JSON and OpenMetrics"""
+        r = libafb.callsync(self.binder, "wifiAp", "setSsid", "metrics-test")
+        assert r.status == 0
+        r = libafb.callsync(self.binder, "wifiAp", "getMetrics")
+        assert r.status == 0
+        calls = r.args[0]["wifiap_verb_duration_seconds"]["setSsid"]
+        assert calls["count"] >= 1
+        assert calls["p50Us"] <= calls["maxUs"]
+        assert "client-state" in r.args[0]["wifiap_events_published"]
+
+        r = libafb.callsync(self.binder, "wifiAp", "getMetrics", "openmetrics")
+        assert r.status == 0
+        assert '# TYPE wifiap_verb_duration_seconds histogram' in r.args[0]
+        assert 'wifiap_verb_duration_seconds_count{verb="setSsid"}' in r.args[0]
+        assert r.args[0].endswith("# EOF\n")
+
+        with self.assertRaises(RuntimeError):
+            libafb.callsync(self.binder, "wifiAp", "getMetrics", "xml")
+        r = libafb.callsync(self.binder, "wifiAp", "getMetrics")
+        assert r.args[0]["wifiap_verb_errors"]["getMetrics"] >= 1
+        libafb.callsync(self.binder, "wifiAp", "setSsid", "IOTBZH-Datahub")
+
+    def test_diagnostics(self):
+        """Test the diagnostics keep the steps of a start"""
+        try:
+            r = libafb.callsync(self.binder, "wifiAp", "start")
+            assert r.status == 0
+        finally:
+            libafb.callsync(self.binder, "wifiAp", "stop")
+        r = libafb.callsync(self.binder, "wifiAp", "getDiagnostics")
+        assert r.status == 0
+        codes = [(record["subsystem"], record["code"]) for record in r.args[0]]
+        assert ("ap", "start") in codes
+        assert ("command", "exit") in codes
+        assert ("ap", "stopped") in codes
+        sequences = [record["sequence"] for record in r.args[0]]
+        assert sequences == sorted(sequences)
+
+        r = libafb.callsync(self.binder, "wifiAp", "getDiagnostics", 2)
+        assert r.status == 0
+        assert len(r.args[0]) == 2
+        assert r.args[0][-1]["code"] == "stopped"
+
     def test_start_stop_ap(self):
         """Test starting and stopping the access point"""
         # Start AP
@@ -91,6 +370,38 @@ class TestWifiAp(AFBTestCase):
         r = libafb.callsync(self.binder, "wifiAp", "stop")
         assert r.status == 0
 
+    def test_reload_config(self):
+        """Test reloading the configuration file while the AP is stopped"""
+        r = libafb.callsync(self.binder, "wifiAp", "SetMaxNumberClients", 4)
+        assert r.status == 0
+
+        r = libafb.callsync(self.binder, "wifiAp", "reloadConfig")
+        assert r.status == 0
+        assert r.args[0]["applied"]
+        assert "hostapd-set" in r.args[0]["changes"]
+
+        # Nothing changed since the reload
+        r = libafb.callsync(self.binder, "wifiAp", "reloadConfig")
+        assert r.status == 0
+        assert r.args[0]["changes"] == []
+
+    def test_reload_config_wpa2_ssid(self):
+        """Test the SSID of a WPA2 network is applied by a reload of hostapd"""
+        r = libafb.callsync(self.binder, "wifiAp", "setSsid", "reload-test")
+        assert r.status == 0
+
+        # the PSK derived from the SSID changes too
+        r = libafb.callsync(self.binder, "wifiAp", "reloadConfig")
+        assert r.status == 0
+        assert r.args[0]["applied"]
+        assert "hostapd-reload" in r.args[0]["changes"]
+        assert "hostapd-set" not in r.args[0]["changes"]
+
+        # Nothing changed since the reload
+        r = libafb.callsync(self.binder, "wifiAp", "reloadConfig")
+        assert r.status == 0
+        assert r.args[0]["changes"] == []
+
     def test_get_ap_clients_number(self):
         """Test getting current number of clients"""
         r = libafb.callsync(self.binder, "wifiAp", "getAPclientsNumber")
@@ -0,0 +1,59 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+/*******************************************************************************
+ *      unit tests of the configurations of wifi-ap-data                       *
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/wifi-ap-data.h"
+#include "unit-test.h"
+
+/*******************************************************************************
+ *      a changed SSID is set in an open network, reloaded in a secured one    *
+ *                                                                             *
+ * The PSK of WPA is derived from the passphrase and the SSID, hostapd must    *
+ * load it again.                                                              *
+ ******************************************************************************/
+static void test_compare_ssid(void)
+{
+    wifiApT *current = calloc(1, sizeof(*current));
+    wifiApT *staged = calloc(1, sizeof(*staged));
+
+    CHECK(current != NULL && staged != NULL);
+    strcpy(current->ssid, "before");
+    strcpy(staged->ssid, "after");
+
+    CHECK(compareWifiApData(current, staged) == WIFIAP_CHANGE_HOSTAPD_SET);
+
+    current->securityProtocol = WIFI_AP_SECURITY_WPA2;
+    staged->securityProtocol = WIFI_AP_SECURITY_WPA2;
+    CHECK(compareWifiApData(current, staged) == WIFIAP_CHANGE_HOSTAPD_RELOAD);
+
+    strcpy(staged->ssid, "before");
+    CHECK(compareWifiApData(current, staged) == 0);
+
+    free(current);
+    free(staged);
+}
+
+int main(void)
+{
+    runUnitTest("compare-ssid", test_compare_ssid);
+    return unitTestFailures == 0 ? 0 : 1;
+}
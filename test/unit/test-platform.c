@@ -0,0 +1,261 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+
+/*******************************************************************************
+ *      unit tests of the side effects going through the fake platform         *
+ *                                                                             *
+ * Nothing is written to the disk and no radio is needed: the files, the       *
+ * caches and the nl80211 queries stay in memory.                              *
+ ******************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "lib/wifi-ap-cache.h"
+#include "lib/wifi-ap-config.h"
+#include "lib/wifi-ap-fake.h"
+#include "lib/wifi-ap-nl80211.h"
+#include "lib/wifi-ap-platform.h"
+#include "lib/wifi-ap-psk.h"
+#include "lib/wifi-ap-start.h"
+#include "lib/wifi-ap-utilities.h"
+#include "unit-test.h"
+
+#define CACHE_DIR "/fake/cache"
+#define SCRIPT    "/fake/wifi_setup.sh"
+
+/*******************************************************************************
+ *      check the content of a file written in memory                          *
+ ******************************************************************************/
+static int fake_file_is(const char *fileName, const char *content)
+{
+    char *written = getFakeFile(fileName);
+    int same = written != NULL && strcmp(written, content) == 0;
+
+    free(written);
+    return same;
+}
+
+/*******************************************************************************
+ *      the files are written, read, found and removed in memory               *
+ ******************************************************************************/
+static void test_files(void)
+{
+    char *content = NULL;
+
+    resetFakePlatform();
+    CHECK(!checkFileExists("/fake/file"));
+    CHECK(readPlatformFile("/fake/file", 16, &content) == -ENOENT);
+
+    CHECK(getPlatform()->writeFile("/fake/file", "content\n") == 0);
+    CHECK(checkFileExists("/fake/file"));
+    CHECK(readPlatformFile("/fake/file", 16, &content) == 0);
+    CHECK(content != NULL && strcmp(content, "content\n") == 0);
+    free(content);
+    CHECK(readPlatformFile("/fake/file", 4, &content) == -EFBIG);
+
+    CHECK(getPlatform()->makeDirectory("/fake") == 0);
+    CHECK(getPlatform()->removeFile("/fake/file") == 0);
+    CHECK(!checkFileExists("/fake/file"));
+    CHECK(getPlatform()->removeFile("/fake/file") == -ENOENT);
+}
+
+/*******************************************************************************
+ *      the configuration of hostapd is generated in memory                    *
+ ******************************************************************************/
+static void test_hostapd_file(void)
+{
+    wifiApT *wifiApData = calloc(1, sizeof(*wifiApData));
+    char *content;
+
+    resetFakePlatform();
+    CHECK(wifiApData != NULL);
+    strcpy(wifiApData->ssid, "fake-ssid");
+    strcpy(wifiApData->countryCode, "FR");
+    wifiApData->IeeeStdMask = WIFI_AP_BITMASK_IEEE_STD_G;
+    wifiApData->channelNumber = 6;
+    wifiApData->radio.channelWidth = 20;
+
+    CHECK(GenerateHostApConfFile(wifiApData) == 0);
+    content = getFakeFile(WIFI_HOSTAPD_FILE);
+    CHECK(content != NULL && strstr(content, "ssid=fake-ssid\n") != NULL &&
+          strstr(content, "channel=6\n") != NULL);
+    free(content);
+    free(wifiApData);
+}
+
+/*******************************************************************************
+ *      the derived key is kept in the cache directory in memory               *
+ ******************************************************************************/
+static void test_psk_cache(void)
+{
+    char psk[2 * WPA_PSK_LENGTH + 1], cached[2 * WPA_PSK_LENGTH + 1];
+    char *first;
+
+    resetFakePlatform();
+    setWpaPskCacheDir(CACHE_DIR);
+
+    CHECK(getWpaPsk("first", "passphrase", psk) == 1);
+    first = getFakeFile(CACHE_DIR "/psk");
+    CHECK(first != NULL && strstr(first, psk) != NULL);
+
+    // another key replaces it in memory and in the file, the first one is
+    // then read back from the file
+    CHECK(getWpaPsk("second", "passphrase", cached) == 1);
+    CHECK(first != NULL &&
+          getPlatform()->writeFile(CACHE_DIR "/psk", first) == 0);
+    CHECK(getWpaPsk("first", "passphrase", cached) == 0);
+    CHECK(strcmp(cached, psk) == 0);
+
+    // the key of another passphrase is not taken from the file
+    CHECK(getWpaPsk("first", "other passphrase", cached) == 1);
+    CHECK(strcmp(cached, psk) != 0);
+
+    free(first);
+    setWpaPskCacheDir(NULL);
+}
+
+/*******************************************************************************
+ *      the generated files are restored from the cache, the entries used last *
+ *      are kept                                                               *
+ ******************************************************************************/
+static void test_config_cache(void)
+{
+    static const char *const files[] = {"/fake/hostapd.conf",
+                                        "/fake/dnsmasq.conf"};
+    const unsigned count = sizeof(files) / sizeof(*files);
+
+    resetFakePlatform();
+    CHECK(getConfigCache(CACHE_DIR, 1, files, count) == -ENOENT);
+
+    getPlatform()->writeFile(files[0], "ssid=cached\n");
+    getPlatform()->writeFile(files[1], "");
+    CHECK(putConfigCache(CACHE_DIR, 1, files, count) == 0);
+
+    getPlatform()->writeFile(files[0], "ssid=other\n");
+    getPlatform()->writeFile(files[1], "interface=other\n");
+    CHECK(getConfigCache(CACHE_DIR, 1, files, count) == 0);
+    CHECK(fake_file_is(files[0], "ssid=cached\n"));
+    CHECK(fake_file_is(files[1], ""));
+
+    // an entry of other files is not restored
+    CHECK(getConfigCache(CACHE_DIR, 1, &files[1], 1) == -EBADMSG);
+
+    // the entry 1, used before the others, is the one removed
+    getPlatform()->writeFile(files[0], "ssid=other\n");
+    for (uint64_t hash = 2; hash <= CONFIG_CACHE_ENTRIES + 1; hash++)
+        CHECK(putConfigCache(CACHE_DIR, hash, files, count) == 0);
+    CHECK(getConfigCache(CACHE_DIR, 1, files, count) == -ENOENT);
+    CHECK(getConfigCache(CACHE_DIR, 2, files, count) == 0);
+    CHECK(fake_file_is(files[0], "ssid=other\n"));
+}
+
+/*******************************************************************************
+ *      there is no radio to query with nl80211                                *
+ ******************************************************************************/
+static void test_radio(void)
+{
+    wifiAp_RadioCapabilities_t capabilities;
+    platformDomainT domain = PLATFORM_DOMAIN_COUNT;
+    const char *call;
+
+    resetFakePlatform();
+    CHECK(loadRadioCapabilities("wlan0", &capabilities) == -ENODEV);
+    CHECK(!capabilities.valid);
+
+    CHECK(getFakeCallCount() == 1);
+    call = getFakeCall(0, &domain);
+    CHECK(call != NULL && strcmp(call, "nl80211 wlan0") == 0);
+    CHECK(domain == PLATFORM_LINK);
+}
+
+/*******************************************************************************
+ *      the number of calls logged starting with a prefix                      *
+ ******************************************************************************/
+static unsigned count_calls(const char *prefix)
+{
+    unsigned count = 0;
+    const char *call;
+
+    for (unsigned i = 0; (call = getFakeCall(i, NULL)) != NULL; i++)
+        count += strncmp(call, prefix, strlen(prefix)) == 0;
+    return count;
+}
+
+/*******************************************************************************
+ *      the access point is started and stopped by the code of the binding     *
+ ******************************************************************************/
+static void test_start_stop(void)
+{
+    const apStartT start = {.script = SCRIPT};
+    wifiApT *wifiApData = calloc(1, sizeof(*wifiApData));
+    FILE *events;
+
+    resetFakePlatform();
+    CHECK(wifiApData != NULL);
+    initWifiApData(wifiApData);
+    CHECK(setInterfaceNameParameter(wifiApData, "wlan0") == 0);
+    CHECK(setHostNameParameter(wifiApData, "fake-host") == 0);
+    CHECK(setDomainNameParameter(wifiApData, "fake.lan") == 0);
+    strcpy(wifiApData->ssid, "fake-ssid");
+    strcpy(wifiApData->countryCode, "FR");
+    strcpy(wifiApData->ip_ap, "192.168.5.1");
+    strcpy(wifiApData->ip_start, "192.168.5.10");
+    strcpy(wifiApData->ip_stop, "192.168.5.100");
+    strcpy(wifiApData->ip_netmask, "255.255.255.0");
+    wifiApData->IeeeStdMask = WIFI_AP_BITMASK_IEEE_STD_G;
+    wifiApData->channel.MIN_CHANNEL_VALUE = 1;
+    wifiApData->channel.MAX_CHANNEL_VALUE = 14;
+    wifiApData->channelNumber = 6;
+
+    CHECK(startWifiAp(&start, wifiApData) == 0);
+    CHECK(checkFileExists(WIFI_HOSTAPD_FILE));
+    CHECK(checkFileExists(WIFI_DNSMASQ_FILE));
+    CHECK(count_calls(SCRIPT " " COMMAND_WIFIAP_HOSTAPD_START " wlan0") == 1);
+    CHECK(stopWifiAp(&start, wifiApData, NULL) == 0);
+    CHECK(count_calls(SCRIPT " " COMMAND_WIFI_HW_STOP " wlan0") == 1);
+
+    // the monitor of the events is killed before they are closed
+    events = getPlatform()->openEvents("wlan0");
+    CHECK(events != NULL);
+    CHECK(closeApEvents(&start, events) == 0);
+    CHECK(count_calls(SCRIPT " " COMMAND_WIFI_UNSET_EVENT) == 1);
+
+    // the files left clean the previous start, hostapd.conf is removed when
+    // hostapd fails
+    setFakeReply(PLATFORM_DAEMON, SCRIPT " " COMMAND_WIFIAP_HOSTAPD_START, 1,
+                 NULL);
+    CHECK(startWifiAp(&start, wifiApData) == -7);
+    CHECK(count_calls(SCRIPT " " COMMAND_WIFIAP_HOSTAPD_STOP " wlan0") == 2);
+    CHECK(!checkFileExists(WIFI_HOSTAPD_FILE));
+
+    deleteWifiApData(wifiApData);
+}
+
+int main(void)
+{
+    setPlatform(getFakePlatform());
+    runUnitTest("fake-files", test_files);
+    runUnitTest("fake-hostapd-file", test_hostapd_file);
+    runUnitTest("fake-psk-cache", test_psk_cache);
+    runUnitTest("fake-config-cache", test_config_cache);
+    runUnitTest("fake-radio", test_radio);
+    runUnitTest("fake-start-stop", test_start_stop);
+    resetFakePlatform();
+    return unitTestFailures == 0 ? 0 : 1;
+}
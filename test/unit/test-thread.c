@@ -0,0 +1,179 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+/*******************************************************************************
+ *      unit tests of the worker pool of wifi-ap-thread                        *
+ ******************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <semaphore.h>
+
+#include "lib/wifi-ap-thread.h"
+#include "unit-test.h"
+
+typedef struct
+{
+    threadJob_t job;
+    sem_t started; ///< posted when the job is run
+    sem_t done;    ///< posted by the completion function
+    int status;    ///< status given to the completion function
+    int runs;      ///< number of times the job was run
+    sem_t *block;  ///< waited by the job before it returns (may be NULL)
+} testJobT;
+
+static void test_job_run(threadJob_t *job)
+{
+    testJobT *testJob = job->context;
+
+    testJob->runs++;
+    sem_post(&testJob->started);
+    if (testJob->block != NULL)
+        while (sem_wait(testJob->block) != 0 && errno == EINTR)
+            ;
+}
+
+static void test_job_done(threadJob_t *job, int status)
+{
+    testJobT *testJob = job->context;
+
+    testJob->status = status;
+    sem_post(&testJob->done);
+}
+
+static void init_test_job(testJobT *testJob, sem_t *block)
+{
+    initThreadJob(&testJob->job, test_job_run, test_job_done, testJob,
+                  THREAD_PRIORITY_NORMAL);
+    sem_init(&testJob->started, 0, 0);
+    sem_init(&testJob->done, 0, 0);
+    testJob->status = -1;
+    testJob->runs = 0;
+    testJob->block = block;
+}
+
+static void wait_test_job(testJobT *testJob)
+{
+    while (sem_wait(&testJob->done) != 0 && errno == EINTR)
+        ;
+}
+
+static void wait_test_job_started(testJobT *testJob)
+{
+    while (sem_wait(&testJob->started) != 0 && errno == EINTR)
+        ;
+}
+
+/*******************************************************************************
+ *      a job posted then run                                                  *
+ ******************************************************************************/
+static void test_post(void)
+{
+    threadPool_t *pool = createThreadPool("test", 1, 4);
+    testJobT job;
+
+    CHECK(pool != NULL);
+    init_test_job(&job, NULL);
+    CHECK(postThreadJob(pool, &job.job) == 0);
+    wait_test_job(&job);
+    CHECK(job.status == THREAD_JOB_DONE);
+    CHECK(job.runs == 1);
+
+    // done, it can be posted again
+    CHECK(postThreadJob(pool, &job.job) == 0);
+    wait_test_job(&job);
+    CHECK(job.runs == 2);
+    destroyThreadPool(pool);
+}
+
+/*******************************************************************************
+ *      a job cancelled while queued, then posted again                        *
+ *                                                                             *
+ * The cancelled job stays linked in the queue until the worker takes it, it   *
+ * can't be posted again before: it would be linked twice.                     *
+ ******************************************************************************/
+static void test_cancel_then_post(void)
+{
+    threadPool_t *pool = createThreadPool("test", 1, 4);
+    testJobT blocker, job, other;
+    sem_t block;
+
+    CHECK(pool != NULL);
+    sem_init(&block, 0, 0);
+    init_test_job(&blocker, &block);
+    init_test_job(&job, NULL);
+    init_test_job(&other, NULL);
+
+    // the worker is busy, the job waits in the queue
+    CHECK(postThreadJob(pool, &blocker.job) == 0);
+    wait_test_job_started(&blocker);
+    CHECK(postThreadJob(pool, &job.job) == 0);
+    CHECK(cancelThreadJob(&job.job) == 0);
+    CHECK(job.job.state == THREAD_JOB_CANCELLING);
+    CHECK(cancelThreadJob(&job.job) == -1);
+    CHECK(postThreadJob(pool, &job.job) == -1);
+    CHECK(postThreadJob(pool, &other.job) == 0);
+
+    sem_post(&block);
+    wait_test_job(&blocker);
+    wait_test_job(&job);
+    wait_test_job(&other);
+    CHECK(job.status == THREAD_JOB_CANCELLED);
+    CHECK(job.runs == 0);
+    CHECK(other.status == THREAD_JOB_DONE);
+
+    // removed from the queue, it is posted and run once
+    CHECK(postThreadJob(pool, &job.job) == 0);
+    wait_test_job(&job);
+    CHECK(job.status == THREAD_JOB_DONE);
+    CHECK(job.runs == 1);
+
+    destroyThreadPool(pool);
+    sem_destroy(&block);
+}
+
+/*******************************************************************************
+ *      every job is completed, run or cancelled, when the pool is destroyed   *
+ ******************************************************************************/
+static void test_destroy(void)
+{
+    threadPool_t *pool = createThreadPool("test", 1, 4);
+    testJobT blocker, job;
+    sem_t block;
+
+    CHECK(pool != NULL);
+    sem_init(&block, 0, 0);
+    init_test_job(&blocker, &block);
+    init_test_job(&job, NULL);
+
+    CHECK(postThreadJob(pool, &blocker.job) == 0);
+    wait_test_job_started(&blocker);
+    CHECK(postThreadJob(pool, &job.job) == 0);
+    sem_post(&block);
+    destroyThreadPool(pool);
+    CHECK(blocker.status == THREAD_JOB_DONE);
+    CHECK(job.status == THREAD_JOB_DONE || job.status == THREAD_JOB_CANCELLED);
+    sem_destroy(&block);
+}
+
+int main(void)
+{
+    runUnitTest("post", test_post);
+    runUnitTest("cancel-then-post", test_cancel_then_post);
+    runUnitTest("destroy", test_destroy);
+    return unitTestFailures == 0 ? 0 : 1;
+}
@@ -0,0 +1,69 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+
+#include <stdarg.h>
+
+#define AFB_BINDING_VERSION 4
+#include <afb/afb-binding.h>
+
+#include "unit-test.h"
+
+int unitTestFailures = 0;
+
+/*******************************************************************************
+ *      logging of the library (AFB_* macros), the errors and warnings only    *
+ ******************************************************************************/
+static int log_mask(afb_api_t api)
+{
+    return (2 << 4) - 1;
+}
+
+static void log_verbose(afb_api_t api,
+                        int level,
+                        const char *file,
+                        int line,
+                        const char *function,
+                        const char *fmt,
+                        va_list args)
+{
+    fprintf(stderr, "  lib: ");
+    vfprintf(stderr, fmt, args);
+    fputc('\n', stderr);
+}
+
+static const struct afb_binding_x4r1_itf logItf = {
+    .api_logmask = log_mask,
+    .api_vverbose = log_verbose,
+};
+
+// what the binder gives to a binding, the library logs through them
+afb_api_t afbBindingV4root = NULL;
+const struct afb_binding_x4r1_itf *afbBindingV4r1_itfptr = &logItf;
+
+/*******************************************************************************
+ *      run a test case and print its result                                   *
+ *                                                                             *
+ * @return                                                                     *
+ *      the number of failed checks so far                                     *
+ ******************************************************************************/
+int runUnitTest(const char *name, void (*test)(void))
+{
+    int failures = unitTestFailures;
+
+    test();
+    printf("%s %s\n", unitTestFailures == failures ? "ok" : "FAILED", name);
+    return unitTestFailures;
+}
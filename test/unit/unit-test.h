@@ -0,0 +1,38 @@
+/*******************************************************************************
+# Copyright 2026 IoT.bzh
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+*******************************************************************************/
+#ifndef UNIT_TEST_HEADER_FILE
+#define UNIT_TEST_HEADER_FILE
+
+#include <stdio.h>
+
+// The unit tests of the library are plain programs run by ctest: a failed
+// CHECK is printed and counted, the test fails when the count is not 0.
+
+//------------------------------------------------------------------------------
+
+#define CHECK(cond)                                                   \
+    do {                                                              \
+        if (!(cond)) {                                                \
+            fprintf(stderr, "%s:%d: check '%s' failed\n", __FILE__, \
+                    __LINE__, #cond);                                 \
+            unitTestFailures++;                                       \
+        }                                                             \
+    } while (0)
+
+extern int unitTestFailures;
+
+int runUnitTest(const char *name, void (*test)(void));
+#endif
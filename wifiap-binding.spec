@@ -46,6 +46,9 @@ Summary: redtest package (coverage build)
 Requires: lcov
 Requires: findutils
 Requires: procps-ng
+Requires: iw
+Requires: wpa_supplicant
+Requires: dhcp-client
 Requires: afb-libpython
 Requires: afb-test-py
 Recommends: kmod(mac80211_hwsim.ko)
@@ -102,6 +105,14 @@ cd ..
 %defattr(-,root,root)
 %{_libexecdir}/redtest/%{name}/run-redtest
 %{_libexecdir}/redtest/%{name}/tests.py
+%{_libexecdir}/redtest/%{name}/scale_tests.py
+%{_libexecdir}/redtest/%{name}/soak_tests.py
+%{_libexecdir}/redtest/%{name}/load_tests.py
+%{_libexecdir}/redtest/%{name}/state_tests.py
+%{_libexecdir}/redtest/%{name}/boot_tests.py
+%{_libexecdir}/redtest/%{name}/afb_ws.py
+%{_libexecdir}/redtest/%{name}/*.json
+%{_libexecdir}/redtest/%{name}/golden/
 %{coverage_dir}
 
 %changelog